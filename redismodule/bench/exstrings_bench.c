@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+/*
+ * Microbenchmark of every command of the module, run in process against the
+ * fake server of fakeredis.c, for 100 to 10000 keys of 16 B and 1 kB values.
+ * Reports ns/op, allocations/op (module and server, including the argument
+ * vector of the command) and ops/s per command, and writes the same as CSV.
+ * The costs of the real server that the fake does not have (networking,
+ * the dict of the keyspace, replication) are not included, so the numbers
+ * compare versions of the module, not the module against the server.
+ *
+ * Usage: exstrings_bench [csv_file] [ms_per_run]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "fakeredis.h"
+#include "xxhash64.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEF_CSV_FILE "exstrings_bench.csv"
+#define DEF_RUN_MS 100
+#define MAX_ARGS 16
+#define KEY_FMT "key:%08u"
+#define KEY_LEN 12
+#define KEY_BUF 24
+
+static const long key_counts[] = {100, 1000, 10000};
+static const size_t value_sizes[] = {16, 1024};
+
+/* Untimed preparation of each round of a scenario. */
+typedef enum {
+    PREP_NONE = 0,
+    PREP_SET,       /* string keys exist */
+    PREP_DEL,       /* keys do not exist */
+    PREP_SETVER,    /* versioned keys exist at version 1 */
+    PREP_NS,        /* namespace "ns" holds a field for each key */
+    PREP_JOB        /* an NDEL.NOATOMIC job is running */
+} Prep;
+
+/* Arguments are copied as is, except:
+ *   $K  the key of the operation, the n:th key in a round of n operations
+ *   $1..$3  the keys after $K
+ *   $V  a value of the run's value size, which the keys are set to
+ *   $W  another value of the same size
+ *   $D  the digest of $V as given to the *DIGEST commands
+ *   $J  the id of the NDEL.NOATOMIC job of the round
+ * Scenarios with a round of 0 run once per round on all keys. */
+typedef struct {
+    const char *command;
+    const char *variant;
+    Prep prep;
+    int round;
+    bool run_timers;    /* the command finishes in timers */
+    const char *args[MAX_ARGS];
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"setie", "", PREP_NONE, 1, false, {"SETIE", "$K", "$V", "$V"}},
+    {"setie", "current", PREP_NONE, 1, false, {"SETIE", "$K", "$V", "$V", "RETURNCURRENT"}},
+    {"setne", "", PREP_NONE, 1, false, {"SETNE", "$K", "$W", "$V"}},
+    {"delie", "", PREP_SET, 1, false, {"DELIE", "$K", "$V"}},
+    {"delne", "", PREP_SET, 1, false, {"DELNE", "$K", "$W"}},
+    {"setiedigest", "", PREP_SET, 1, false, {"SETIEDIGEST", "$K", "$V", "$D"}},
+    {"setnedigest", "", PREP_SET, 1, false, {"SETNEDIGEST", "$K", "$V", "0000000000000000"}},
+    {"deliedigest", "", PREP_SET, 1, false, {"DELIEDIGEST", "$K", "$D"}},
+    {"delnedigest", "", PREP_SET, 1, false, {"DELNEDIGEST", "$K", "0000000000000000"}},
+    {"nget.atomic", "prefix", PREP_NONE, 0, false, {"NGET.ATOMIC", "key:*"}},
+    {"nget.atomic", "glob", PREP_NONE, 0, false, {"NGET.ATOMIC", "k?y:*"}},
+    {"nget.noatomic", "prefix", PREP_NONE, 0, false, {"NGET.NOATOMIC", "key:*"}},
+    {"nget.noatomic", "glob", PREP_NONE, 0, false, {"NGET.NOATOMIC", "k?y:*"}},
+    {"poolstats", "", PREP_NONE, 1, false, {"POOLSTATS"}},
+    {"nscan", "", PREP_NONE, 0, false, {"NSCAN", "0", "key:*", "COUNT", "100"}},
+    {"ndel.atomic", "prefix", PREP_SET, 0, false, {"NDEL.ATOMIC", "key:*"}},
+    {"ndel.atomic", "glob", PREP_SET, 0, false, {"NDEL.ATOMIC", "k?y:*"}},
+    {"ndel.noatomic", "prefix", PREP_SET, 0, true, {"NDEL.NOATOMIC", "key:*"}},
+    {"ndel.status", "", PREP_JOB, 1, false, {"NDEL.STATUS", "$J"}},
+    {"ndel.cancel", "", PREP_JOB, 0, false, {"NDEL.CANCEL", "$J"}},
+    {"nslowlog", "", PREP_NONE, 1, false, {"NSLOWLOG", "GET"}},
+    {"msetpub", "", PREP_NONE, 1, false, {"MSETPUB", "$K", "$V", "ch", "msg"}},
+    {"msetmpub", "", PREP_NONE, 1, false, {"MSETMPUB", "2", "2", "$K", "$V", "$1", "$V", "ch", "msg", "ch", "msg"}},
+    {"msetmpub", "packed", PREP_NONE, 1, false, {"MSETMPUB", "2", "2", "$K", "$V", "$1", "$V", "ch", "msg", "ch", "msg", "PACKED"}},
+    {"setiepub", "", PREP_NONE, 1, false, {"SETIEPUB", "$K", "$V", "$V", "ch", "msg"}},
+    {"setiempub", "", PREP_NONE, 1, false, {"SETIEMPUB", "$K", "$V", "$V", "ch", "msg", "ch2", "msg"}},
+    {"setnepub", "", PREP_NONE, 1, false, {"SETNEPUB", "$K", "$W", "$V", "ch", "msg"}},
+    {"setxxpub", "", PREP_NONE, 1, false, {"SETXXPUB", "$K", "$V", "ch", "msg"}},
+    {"setnxpub", "", PREP_DEL, 1, false, {"SETNXPUB", "$K", "$V", "ch", "msg"}},
+    {"setnxmpub", "", PREP_DEL, 1, false, {"SETNXMPUB", "$K", "$V", "ch", "msg", "ch2", "msg"}},
+    {"delpub", "", PREP_SET, 1, false, {"DELPUB", "$K", "ch", "msg"}},
+    {"delmpub", "", PREP_SET, 1, false, {"DELMPUB", "1", "2", "$K", "ch", "msg", "ch2", "msg"}},
+    {"delmpub", "packed", PREP_SET, 1, false, {"DELMPUB", "1", "2", "$K", "ch", "msg", "ch2", "msg", "PACKED"}},
+    {"deliepub", "", PREP_SET, 1, false, {"DELIEPUB", "$K", "$V", "ch", "msg"}},
+    {"deliempub", "", PREP_SET, 1, false, {"DELIEMPUB", "$K", "$V", "ch", "msg", "ch2", "msg"}},
+    {"delnepub", "", PREP_SET, 1, false, {"DELNEPUB", "$K", "$W", "ch", "msg"}},
+    {"setiedigestpub", "", PREP_SET, 1, false, {"SETIEDIGESTPUB", "$K", "$V", "$D", "ch", "msg"}},
+    {"setiedigestmpub", "", PREP_SET, 1, false, {"SETIEDIGESTMPUB", "$K", "$V", "$D", "ch", "msg", "ch2", "msg"}},
+    {"setnedigestpub", "", PREP_SET, 1, false, {"SETNEDIGESTPUB", "$K", "$V", "0000000000000000", "ch", "msg"}},
+    {"deliedigestpub", "", PREP_SET, 1, false, {"DELIEDIGESTPUB", "$K", "$D", "ch", "msg"}},
+    {"deliedigestmpub", "", PREP_SET, 1, false, {"DELIEDIGESTMPUB", "$K", "$D", "ch", "msg", "ch2", "msg"}},
+    {"delnedigestpub", "", PREP_SET, 1, false, {"DELNEDIGESTPUB", "$K", "0000000000000000", "ch", "msg"}},
+    {"mdigest", "", PREP_NONE, 1, false, {"MDIGEST", "$K", "$1", "$2", "$3"}},
+    {"getver", "", PREP_SETVER, 1, false, {"GETVER", "$K"}},
+    {"setver", "", PREP_SETVER, 1, false, {"SETVER", "$K", "$V", "1"}},
+    {"setifver", "", PREP_SETVER, 1, false, {"SETIFVER", "$K", "$V", "1"}},
+    {"setifverpub", "", PREP_SETVER, 1, false, {"SETIFVERPUB", "$K", "$V", "1", "ch", "msg"}},
+    {"delifver", "", PREP_SETVER, 1, false, {"DELIFVER", "$K", "1"}},
+    {"delifverpub", "", PREP_SETVER, 1, false, {"DELIFVERPUB", "$K", "1", "ch", "msg"}},
+    {"ns.set", "", PREP_NS, 1, false, {"NS.SET", "ns", "$K", "$V"}},
+    {"ns.setpub", "", PREP_NS, 1, false, {"NS.SETPUB", "ns", "$K", "$V", "ch", "msg"}},
+    {"ns.get", "", PREP_NS, 1, false, {"NS.GET", "ns", "$K"}},
+    {"ns.mget", "", PREP_NS, 1, false, {"NS.MGET", "ns", "$K", "$1", "$2", "$3"}},
+    {"ns.getall", "", PREP_NS, 0, false, {"NS.GETALL", "ns"}},
+    {"ns.del", "", PREP_NS, 1, false, {"NS.DEL", "ns", "$K"}},
+    {"ns.delpub", "", PREP_NS, 1, false, {"NS.DELPUB", "ns", "$K", "ch", "msg"}},
+    {"ns.setie", "", PREP_NS, 1, false, {"NS.SETIE", "ns", "$K", "$V", "$V"}},
+    {"ns.setiepub", "", PREP_NS, 1, false, {"NS.SETIEPUB", "ns", "$K", "$V", "$V", "ch", "msg"}},
+    {"ns.delie", "", PREP_NS, 1, false, {"NS.DELIE", "ns", "$K", "$V"}},
+    {"ns.deliepub", "", PREP_NS, 1, false, {"NS.DELIEPUB", "ns", "$K", "$V", "ch", "msg"}},
+    {"ns.clear", "", PREP_NS, 0, false, {"NS.CLEAR", "ns"}},
+    {"ns.clearpub", "", PREP_NS, 0, false, {"NS.CLEARPUB", "ns", "ch", "msg"}},
+    {"cset", "", PREP_NONE, 1, false, {"CSET", "$K", "$V"}},
+    {"csetie", "", PREP_NONE, 1, false, {"CSETIE", "$K", "$V", "$V"}},
+    {"csetiepub", "", PREP_NONE, 1, false, {"CSETIEPUB", "$K", "$V", "$V", "ch", "msg"}},
+    {"cget", "", PREP_NONE, 1, false, {"CGET", "$K"}},
+    {"nget.atomic", "decomp", PREP_NONE, 0, false, {"NGET.ATOMIC", "key:*", "DECOMPRESS"}},
+    {"cstats", "", PREP_NONE, 1, false, {"CSTATS"}},
+    {"nsstats", "", PREP_NONE, 1, false, {"NSSTATS", "TOP", "10"}},
+    {"sdl.batch", "", PREP_SET, 1, false, {"SDL.BATCH", "SET", "$K", "$V", "SETIE", "$1", "$V", "$V",
+                                          "DELIE", "$2", "$V", "GET", "$3", "PUBLISH", "ch", "msg"}},
+    {"cmdstats", "", PREP_NONE, 1, false, {"CMDSTATS"}},
+};
+
+#define SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+    long keys;
+    size_t value_size;
+    char *value;
+    char *other;
+    char digest[XXHASH64_HEX_LEN + 1];
+    char job[24];
+    char keybuf[4][KEY_BUF];
+} Run;
+
+static double nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void keyName(char *buf, long i)
+{
+    snprintf(buf, KEY_BUF, KEY_FMT, (unsigned)(i % 100000000));
+}
+
+static const char *run(int argc, const char **argv, const size_t *argvlen, size_t *replylen)
+{
+    const char *reply = fakeRedisRun(argc, argv, argvlen, replylen);
+    if (reply == NULL) {
+        fprintf(stderr, "unknown command %s\n", argv[0]);
+        exit(1);
+    }
+    return reply;
+}
+
+static const char *runCommand(const char *command, const char *key, const char *value, size_t valuelen,
+                              const char *last)
+{
+    const char *argv[] = {command, key, value, last};
+    size_t argvlen[] = {strlen(command), strlen(key), valuelen, last ? strlen(last) : 0};
+    size_t replylen;
+    return run(last ? 4 : value ? 3 : 2, argv, argvlen, &replylen);
+}
+
+static void prepare(Run *r, Prep prep)
+{
+    char key[KEY_BUF];
+    long i;
+
+    if (prep == PREP_JOB) {
+        /* A job on no keys stays running until the timers run. The job of
+         * the previous round is cancelled to stay within NDELJOBS. */
+        if (r->job[0])
+            runCommand("NDEL.CANCEL", r->job, NULL, 0, NULL);
+        const char *reply = runCommand("NDEL.NOATOMIC", "nomatch:*", NULL, 0, NULL);
+        snprintf(r->job, sizeof(r->job), "%lld", atoll(reply + 1));
+        return;
+    }
+    if (prep == PREP_NS) {
+        size_t argvlen[] = {6, 2, KEY_LEN, r->value_size}, replylen;
+        const char *argv[] = {"NS.SET", "ns", key, r->value};
+        runCommand("UNLINK", "ns", NULL, 0, NULL);
+        for (i = 0; i < r->keys; i++) {
+            keyName(key, i);
+            run(4, argv, argvlen, &replylen);
+        }
+        return;
+    }
+    for (i = 0; prep != PREP_NONE && i < r->keys; i++) {
+        keyName(key, i);
+        runCommand("UNLINK", key, NULL, 0, NULL);
+        if (prep == PREP_SET)
+            runCommand("SET", key, r->value, r->value_size, NULL);
+        else if (prep == PREP_SETVER)
+            runCommand("SETVER", key, r->value, r->value_size, "1");
+    }
+}
+
+static int buildArgs(Run *r, const Scenario *s, long op, const char **argv, size_t *argvlen)
+{
+    int argc, k;
+
+    for (k = 0; k < 4; k++)
+        keyName(r->keybuf[k], (op + k) % r->keys);
+    for (argc = 0; argc < MAX_ARGS && s->args[argc]; argc++) {
+        const char *a = s->args[argc];
+        if (a[0] != '$') {
+            argv[argc] = a;
+            argvlen[argc] = strlen(a);
+        } else if (a[1] == 'K' || (a[1] >= '1' && a[1] <= '3')) {
+            argv[argc] = r->keybuf[a[1] == 'K' ? 0 : a[1] - '0'];
+            argvlen[argc] = KEY_LEN;
+        } else if (a[1] == 'V' || a[1] == 'W') {
+            argv[argc] = a[1] == 'V' ? r->value : r->other;
+            argvlen[argc] = r->value_size;
+        } else if (a[1] == 'D') {
+            argv[argc] = r->digest;
+            argvlen[argc] = XXHASH64_HEX_LEN;
+        } else {
+            argv[argc] = r->job;
+            argvlen[argc] = strlen(r->job);
+        }
+    }
+    return argc;
+}
+
+/* Runs rounds of the scenario for about 'ms' milliseconds. */
+static void runScenario(Run *r, const Scenario *s, long ms, FILE *csv)
+{
+    const char *argv[MAX_ARGS];
+    size_t argvlen[MAX_ARGS], replylen, replybytes = 0;
+    long round = s->round ? r->keys : 1;
+    long long ops = 0;
+    unsigned long long allocs = 0;
+    double elapsed = 0;
+    FakeRedisStats before, after;
+    long i;
+
+    prepare(r, PREP_SET);
+    while (elapsed < ms * 1e6) {
+        prepare(r, s->prep);
+        fakeRedisGetStats(&before);
+        double start = nowNs();
+        for (i = 0; i < round; i++) {
+            int argc = buildArgs(r, s, i, argv, argvlen);
+            run(argc, argv, argvlen, &replylen);
+            replybytes += replylen;
+            if (s->run_timers) {
+                while (fakeRedisDbSize(0))
+                    fakeRedisRunTimers(1);
+            }
+        }
+        elapsed += nowNs() - start;
+        fakeRedisGetStats(&after);
+        allocs += after.allocs - before.allocs;
+        ops += round;
+    }
+
+    double ns = elapsed / ops;
+    printf("%-15s %-7s %6ld %6zu %10.0f %10.1f %10.0f %12.0f\n", s->command, s->variant,
+           r->keys, r->value_size, ns, (double)allocs / ops, (double)replybytes / ops, 1e9 / ns);
+    if (csv)
+        fprintf(csv, "%s,%s,%ld,%zu,%lld,%.1f,%.2f,%.1f,%.0f\n", s->command, s->variant,
+                r->keys, r->value_size, ops, ns, (double)allocs / ops,
+                (double)replybytes / ops, 1e9 / ns);
+}
+
+/* Every registered command must have a scenario. */
+static void checkCoverage(void)
+{
+    size_t i, j;
+
+    for (i = 0; i < fakeRedisCommandCount(); i++) {
+        for (j = 0; j < SCENARIOS; j++) {
+            if (!strcmp(scenarios[j].command, fakeRedisCommandName(i)))
+                break;
+        }
+        if (j == SCENARIOS) {
+            fprintf(stderr, "no benchmark for command %s\n", fakeRedisCommandName(i));
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *csvfile = argc > 1 ? argv[1] : DEF_CSV_FILE;
+    long ms = argc > 2 ? atol(argv[2]) : DEF_RUN_MS;
+    size_t k, v, s;
+    FILE *csv;
+    /* The optional features are measured too */
+    const char *module_args[] = {"PREFIXINDEX", "yes", "CMDSTATS", "yes", "NSSTATS", "yes"};
+
+    if (ms <= 0 || fakeRedisLoad(6, module_args) != 0) {
+        fprintf(stderr, "cannot load the module\n");
+        return 1;
+    }
+    checkCoverage();
+
+    csv = fopen(csvfile, "w");
+    if (csv == NULL) {
+        perror(csvfile);
+        return 1;
+    }
+    fprintf(csv, "command,variant,keys,value_size,ops,ns_per_op,allocs_per_op,"
+                 "reply_bytes_per_op,ops_per_sec\n");
+    printf("%-15s %-7s %6s %6s %10s %10s %10s %12s\n", "command", "variant", "keys",
+           "value", "ns/op", "allocs/op", "reply B/op", "ops/s");
+
+    for (k = 0; k < sizeof(key_counts) / sizeof(key_counts[0]); k++) {
+        for (v = 0; v < sizeof(value_sizes) / sizeof(value_sizes[0]); v++) {
+            Run r = {.keys = key_counts[k], .value_size = value_sizes[v]};
+            r.value = malloc(r.value_size);
+            r.other = malloc(r.value_size);
+            if (!r.value || !r.other)
+                return 1;
+            memset(r.value, 'v', r.value_size);
+            memset(r.other, 'w', r.value_size);
+            xxhash64ToHex(xxhash64(r.value, r.value_size, 0), r.digest);
+
+            /* Let the prefix index and the namespace accounting build
+             * before the runs that use them */
+            prepare(&r, PREP_SET);
+            runCommand("NGET.ATOMIC", "key:*", NULL, 0, NULL);
+            runCommand("NSSTATS", "TOP", "10", 2, NULL);
+            fakeRedisRunTimers(1000);
+
+            for (s = 0; s < SCENARIOS; s++)
+                runScenario(&r, &scenarios[s], ms, csv);
+            runCommand("UNLINK", "ns", NULL, 0, NULL);
+            prepare(&r, PREP_DEL);
+            free(r.value);
+            free(r.other);
+        }
+    }
+
+    fclose(csv);
+    return 0;
+}
@@ -0,0 +1,865 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+/*
+ * Load generator for the module commands on a real server: client threads
+ * drive a weighted mix of commands over a key space with pipelining, while
+ * pattern subscribers receive the published messages. The latency of every
+ * command (from the write of its pipeline to its reply) is recorded in HDR
+ * histograms. Each mix can also be run with Lua scripts doing the same as
+ * the module commands, to compare the two on the same server.
+ *
+ * The server is either started from --server (a redis-server binary, with
+ * the module of --module loaded) or an already running one on --host and
+ * --port. The database of the run is flushed.
+ *
+ * Usage: exstrings_load [options]
+ *   --server PATH        start this redis-server
+ *   --module PATH        module the started server loads
+ *                        (default .libs/libredismodule.so)
+ *   --host HOST          (default 127.0.0.1)
+ *   --port PORT          (default 6391)
+ *   --threads N          client threads, one connection each (default 4)
+ *   --pipeline N         commands per pipeline (default 1)
+ *   --keys N             key space size (default 100000)
+ *   --namespace-keys N   keys per NGET namespace (default 100)
+ *   --value-size N       bytes per value (default 64)
+ *   --subscribers N      pattern subscribers of the channels (default 1)
+ *   --mix OP:W[,OP:W..]  command mix with weights (default
+ *                        setie:40,setne:20,setiepub:30,nget:10), OP is one
+ *                        of setie, setne, delie, delne, setiepub, setnepub,
+ *                        msetpub, nget
+ *   --impl module|lua|both   (default both)
+ *   --duration S         measured seconds per implementation (default 10)
+ *   --warmup S           unmeasured seconds before (default 1)
+ *   --csv FILE           also write the results as CSV
+ */
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <map>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <signal.h>
+#include <spawn.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+extern char **environ;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/* HdrHistogram of nanoseconds with three significant digits: each power of
+ * two range has 1024 linear sub-buckets, so a recorded value is off by less
+ * than 0.1%. Values up to about an hour are recorded. */
+class Histogram
+{
+public:
+    Histogram():
+        counts((BUCKETS + 1) * SUB_BUCKET_HALF_COUNT, 0),
+        total(0),
+        max(0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        size_t index = countsIndex(value);
+        if (index >= counts.size())
+            index = counts.size() - 1;
+        counts[index]++;
+        total++;
+        max = std::max(max, value);
+    }
+
+    void add(const Histogram &other)
+    {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t maxValue() const
+    {
+        return max;
+    }
+
+    /* The highest value equivalent to the one at the percentile. */
+    uint64_t percentile(double p) const
+    {
+        uint64_t wanted = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= wanted)
+                return std::min(highestEquivalentValue(i), max);
+        }
+        return max;
+    }
+
+private:
+    static const int SUB_BUCKET_HALF_COUNT_MAGNITUDE = 10;
+    static const uint64_t SUB_BUCKET_HALF_COUNT = 1 << SUB_BUCKET_HALF_COUNT_MAGNITUDE;
+    static const uint64_t SUB_BUCKET_MASK = 2 * SUB_BUCKET_HALF_COUNT - 1;
+    static const int BUCKETS = 32;
+
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t max;
+
+    static size_t countsIndex(uint64_t value)
+    {
+        int bucket = 63 - __builtin_clzll(value | SUB_BUCKET_MASK) - SUB_BUCKET_HALF_COUNT_MAGNITUDE;
+        uint64_t subBucket = value >> bucket;
+        return (static_cast<size_t>(bucket + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) +
+               static_cast<size_t>(subBucket - SUB_BUCKET_HALF_COUNT);
+    }
+
+    static uint64_t highestEquivalentValue(size_t index)
+    {
+        int bucket = static_cast<int>(index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+        uint64_t subBucket = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+        if (bucket < 0) {
+            subBucket -= SUB_BUCKET_HALF_COUNT;
+            bucket = 0;
+        }
+        return (subBucket << bucket) + (UINT64_C(1) << bucket) - 1;
+    }
+};
+
+/* Kinds of replies the load cares about. */
+enum class ReplyKind { Status, Error, Integer, Bulk, Nil, Array };
+
+/* A blocking RESP2 connection. Commands are buffered until flush(), so
+ * that a pipeline is written at once. */
+class Connection
+{
+public:
+    Connection(const std::string &host, int port):
+        fd(-1),
+        rpos(0)
+    {
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+            throw std::runtime_error("cannot resolve " + host);
+        for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+                break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        if (fd < 0)
+            throw std::runtime_error("cannot connect to " + host + ":" + std::to_string(port));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    ~Connection()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    void append(const std::vector<std::string> &args)
+    {
+        wbuf += "*" + std::to_string(args.size()) + "\r\n";
+        for (const auto &arg: args) {
+            wbuf += "$" + std::to_string(arg.size()) + "\r\n";
+            wbuf += arg;
+            wbuf += "\r\n";
+        }
+    }
+
+    void flush()
+    {
+        size_t done = 0;
+        while (done < wbuf.size()) {
+            ssize_t n = write(fd, wbuf.data() + done, wbuf.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("write failed");
+            done += static_cast<size_t>(n);
+        }
+        wbuf.clear();
+    }
+
+    /* Reads one reply, with the first line of a status or an error in
+     * 'text'. */
+    ReplyKind read(std::string *text = nullptr)
+    {
+        std::string line = readLine();
+        switch (line[0]) {
+        case '+':
+        case '-':
+            if (text)
+                *text = line.substr(1);
+            return line[0] == '+' ? ReplyKind::Status : ReplyKind::Error;
+        case ':':
+            if (text)
+                *text = line.substr(1);
+            return ReplyKind::Integer;
+        case '$': {
+            long len = atol(line.c_str() + 1);
+            if (len < 0)
+                return ReplyKind::Nil;
+            std::string bulk = readBytes(static_cast<size_t>(len) + 2);
+            if (text)
+                *text = bulk.substr(0, static_cast<size_t>(len));
+            return ReplyKind::Bulk;
+        }
+        case '*': {
+            long n = atol(line.c_str() + 1);
+            if (n < 0)
+                return ReplyKind::Nil;
+            for (long i = 0; i < n; i++)
+                read();
+            return ReplyKind::Array;
+        }
+        default:
+            throw std::runtime_error("protocol error: " + line);
+        }
+    }
+
+    /* Runs a command and throws on an error reply. */
+    std::string command(const std::vector<std::string> &args)
+    {
+        std::string text;
+        append(args);
+        flush();
+        if (read(&text) == ReplyKind::Error)
+            throw std::runtime_error(args[0] + ": " + text);
+        return text;
+    }
+
+    void shutdownSocket()
+    {
+        shutdown(fd, SHUT_RDWR);
+    }
+
+private:
+    int fd;
+    std::string wbuf;
+    std::string rbuf;
+    size_t rpos;
+
+    void fill()
+    {
+        char buf[64 * 1024];
+        if (rpos > 0) {
+            rbuf.erase(0, rpos);
+            rpos = 0;
+        }
+        for (;;) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("connection closed");
+            rbuf.append(buf, static_cast<size_t>(n));
+            return;
+        }
+    }
+
+    std::string readLine()
+    {
+        for (;;) {
+            size_t end = rbuf.find("\r\n", rpos);
+            if (end != std::string::npos) {
+                std::string line = rbuf.substr(rpos, end - rpos);
+                rpos = end + 2;
+                if (line.empty())
+                    throw std::runtime_error("protocol error: empty line");
+                return line;
+            }
+            fill();
+        }
+    }
+
+    std::string readBytes(size_t n)
+    {
+        while (rbuf.size() - rpos < n)
+            fill();
+        std::string bytes = rbuf.substr(rpos, n);
+        rpos += n;
+        return bytes;
+    }
+};
+
+/* Lua scripts doing the same as the module commands. */
+const char *const SETIE_LUA =
+    "if redis.call('GET',KEYS[1])==ARGV[2] then "
+    "return redis.call('SET',KEYS[1],ARGV[1]) end return false";
+const char *const SETNE_LUA =
+    "if redis.call('GET',KEYS[1])~=ARGV[2] then "
+    "return redis.call('SET',KEYS[1],ARGV[1]) end return false";
+const char *const DELIE_LUA =
+    "if redis.call('GET',KEYS[1])==ARGV[1] then "
+    "return redis.call('DEL',KEYS[1]) end return 0";
+const char *const DELNE_LUA =
+    "if redis.call('GET',KEYS[1])~=ARGV[1] then "
+    "return redis.call('DEL',KEYS[1]) end return 0";
+const char *const SETIEPUB_LUA =
+    "if redis.call('GET',KEYS[1])==ARGV[2] then "
+    "local r=redis.call('SET',KEYS[1],ARGV[1]) "
+    "redis.call('PUBLISH',ARGV[3],ARGV[4]) return r end return false";
+const char *const SETNEPUB_LUA =
+    "if redis.call('GET',KEYS[1])~=ARGV[2] then "
+    "local r=redis.call('SET',KEYS[1],ARGV[1]) "
+    "redis.call('PUBLISH',ARGV[3],ARGV[4]) return r end return false";
+const char *const MSETPUB_LUA =
+    "local r=redis.call('MSET',KEYS[1],ARGV[1]) "
+    "redis.call('PUBLISH',ARGV[2],ARGV[3]) return r";
+const char *const NGET_LUA =
+    "local c='0' local r={} repeat "
+    "local s=redis.call('SCAN',c,'MATCH',ARGV[1],'COUNT',1000) c=s[1] "
+    "for _,k in ipairs(s[2]) do local v=redis.call('GET',k) "
+    "if v then r[#r+1]=k r[#r+1]=v end end "
+    "until c=='0' return r";
+
+enum class Impl { Module, Lua };
+
+const char *implName(Impl impl)
+{
+    return impl == Impl::Module ? "module" : "lua";
+}
+
+/* Arguments after the key, "$V" is the value the keys hold, "$W" another
+ * value, "$C" the channel, and the pattern of NGET ("$P") is of the
+ * namespace of the key, which is not passed itself. */
+struct OpType
+{
+    const char *name;
+    const char *command;
+    const char *script;
+    std::vector<std::string> args;
+};
+
+const OpType OP_TYPES[] = {
+    {"setie", "SETIE", SETIE_LUA, {"$V", "$V"}},
+    {"setne", "SETNE", SETNE_LUA, {"$V", "$W"}},
+    {"delie", "DELIE", DELIE_LUA, {"$V"}},
+    {"delne", "DELNE", DELNE_LUA, {"$W"}},
+    {"setiepub", "SETIEPUB", SETIEPUB_LUA, {"$V", "$V", "$C", "m"}},
+    {"setnepub", "SETNEPUB", SETNEPUB_LUA, {"$V", "$W", "$C", "m"}},
+    {"msetpub", "MSETPUB", MSETPUB_LUA, {"$V", "$C", "m"}},
+    {"nget", "NGET.ATOMIC", NGET_LUA, {"$P"}},
+};
+
+const size_t OP_TYPE_COUNT = sizeof(OP_TYPES) / sizeof(OP_TYPES[0]);
+
+struct Options
+{
+    std::string server;
+    std::string module = ".libs/libredismodule.so";
+    std::string host = "127.0.0.1";
+    int port = 6391;
+    int threads = 4;
+    int pipeline = 1;
+    long keys = 100000;
+    long namespaceKeys = 100;
+    size_t valueSize = 64;
+    int subscribers = 1;
+    std::vector<std::pair<size_t, int>> mix;
+    std::vector<Impl> impls = {Impl::Module, Impl::Lua};
+    double duration = 10;
+    double warmup = 1;
+    std::string csv;
+};
+
+const char *const CHANNEL = "loadch";
+
+/* The commands of one operation, the keys hold 'value' and the other value
+ * never matches. */
+class Workload
+{
+public:
+    Workload(const Options &opts, Impl impl, const std::vector<std::string> &shas):
+        opts(opts),
+        impl(impl),
+        shas(shas),
+        value(opts.valueSize, 'v'),
+        other(opts.valueSize, 'w')
+    {
+    }
+
+    std::vector<std::string> args(size_t op, long key) const
+    {
+        const OpType &type = OP_TYPES[op];
+        std::vector<std::string> out;
+        size_t keys = type.args[0] == "$P" ? 0 : 1;
+
+        if (impl == Impl::Module)
+            out = {type.command};
+        else
+            out = {"EVALSHA", shas[op], std::to_string(keys)};
+        if (keys)
+            out.push_back(keyName(key));
+        for (const auto &arg: type.args) {
+            if (arg == "$V")
+                out.push_back(value);
+            else if (arg == "$W")
+                out.push_back(other);
+            else if (arg == "$C")
+                out.push_back(CHANNEL);
+            else if (arg == "$P")
+                out.push_back(namespacePattern(key));
+            else
+                out.push_back(arg);
+        }
+        return out;
+    }
+
+    std::string keyName(long key) const
+    {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "load:%06ld:%08ld", key / opts.namespaceKeys, key);
+        return buf;
+    }
+
+    const std::string &keyValue() const
+    {
+        return value;
+    }
+
+private:
+    const Options &opts;
+    Impl impl;
+    const std::vector<std::string> &shas;
+    std::string value;
+    std::string other;
+
+    std::string namespacePattern(long key) const
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "load:%06ld:*", key / opts.namespaceKeys);
+        return buf;
+    }
+};
+
+struct OpStats
+{
+    Histogram latency;
+    uint64_t errors = 0;
+    uint64_t nils = 0;
+    std::string firstError;
+};
+
+struct ThreadStats
+{
+    std::vector<OpStats> ops = std::vector<OpStats>(OP_TYPE_COUNT);
+};
+
+std::atomic<bool> measuring(false);
+std::atomic<bool> running(false);
+
+void clientThread(const Options &opts, const Workload &workload, const std::vector<size_t> &ops,
+                  unsigned seed, ThreadStats &stats)
+{
+    Connection conn(opts.host, opts.port);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pickOp(0, ops.size() - 1);
+    std::uniform_int_distribution<long> pickKey(0, opts.keys - 1);
+    std::vector<size_t> batch(static_cast<size_t>(opts.pipeline));
+
+    while (running.load(std::memory_order_relaxed)) {
+        for (auto &op: batch) {
+            op = ops[pickOp(rng)];
+            conn.append(workload.args(op, pickKey(rng)));
+        }
+        bool measured = measuring.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        conn.flush();
+        for (auto op: batch) {
+            std::string text;
+            ReplyKind kind = conn.read(&text);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            if (!measured)
+                continue;
+            OpStats &s = stats.ops[op];
+            s.latency.record(static_cast<uint64_t>(ns));
+            if (kind == ReplyKind::Error && s.errors++ == 0)
+                s.firstError = text;
+            else if (kind == ReplyKind::Nil)
+                s.nils++;
+        }
+    }
+}
+
+void subscriberThread(Connection &conn, std::atomic<uint64_t> &messages)
+{
+    try {
+        for (;;) {
+            conn.read();
+            messages.fetch_add(1, std::memory_order_relaxed);
+        }
+    } catch (const std::runtime_error &) {
+        /* closed at the end of the run */
+    }
+}
+
+void populate(const Options &opts, const Workload &workload)
+{
+    Connection conn(opts.host, opts.port);
+    const long batch = 1000;
+
+    conn.command({"FLUSHDB"});
+    for (long first = 0; first < opts.keys; first += batch) {
+        std::vector<std::string> args = {"MSET"};
+        for (long key = first; key < std::min(first + batch, opts.keys); key++) {
+            args.push_back(workload.keyName(key));
+            args.push_back(workload.keyValue());
+        }
+        conn.command(args);
+    }
+}
+
+struct Result
+{
+    Impl impl;
+    size_t op;
+    OpStats stats;
+    double seconds;
+};
+
+std::vector<Result> runImpl(const Options &opts, Impl impl, std::vector<size_t> ops,
+                            uint64_t &published)
+{
+    std::vector<std::string> shas;
+    {
+        Connection conn(opts.host, opts.port);
+        for (const auto &type: OP_TYPES)
+            shas.push_back(conn.command({"SCRIPT", "LOAD", type.script}));
+    }
+    Workload workload(opts, impl, shas);
+    populate(opts, workload);
+
+    std::vector<std::unique_ptr<Connection>> subs;
+    std::vector<std::thread> subThreads;
+    std::atomic<uint64_t> messages(0);
+    for (int i = 0; i < opts.subscribers; i++) {
+        subs.emplace_back(new Connection(opts.host, opts.port));
+        subs.back()->command({"PSUBSCRIBE", std::string(CHANNEL) + "*"});
+        subThreads.emplace_back(subscriberThread, std::ref(*subs.back()), std::ref(messages));
+    }
+
+    std::vector<ThreadStats> stats(static_cast<size_t>(opts.threads));
+    std::vector<std::thread> threads;
+    running = true;
+    measuring = false;
+    for (int i = 0; i < opts.threads; i++)
+        threads.emplace_back(clientThread, std::cref(opts), std::cref(workload), std::cref(ops),
+                             static_cast<unsigned>(i + 1), std::ref(stats[static_cast<size_t>(i)]));
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.warmup));
+    uint64_t messagesBefore = messages.load();
+    auto start = Clock::now();
+    measuring = true;
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.duration));
+    measuring = false;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    published = messages.load() - messagesBefore;
+    running = false;
+    for (auto &t: threads)
+        t.join();
+    for (auto &sub: subs)
+        sub->shutdownSocket();
+    for (auto &t: subThreads)
+        t.join();
+
+    std::vector<Result> results;
+    for (size_t op = 0; op < OP_TYPE_COUNT; op++) {
+        Result r = {impl, op, OpStats(), seconds};
+        for (const auto &s: stats) {
+            r.stats.latency.add(s.ops[op].latency);
+            r.stats.errors += s.ops[op].errors;
+            r.stats.nils += s.ops[op].nils;
+            if (r.stats.firstError.empty())
+                r.stats.firstError = s.ops[op].firstError;
+        }
+        if (r.stats.latency.count())
+            results.push_back(r);
+    }
+    return results;
+}
+
+void printResults(const std::vector<Result> &results, FILE *csv)
+{
+    printf("%-7s %-9s %10s %10s %8s %8s %9s %9s %9s %9s %9s\n", "impl", "command", "ops", "ops/s",
+           "errors", "nils", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    for (const auto &r: results) {
+        const Histogram &h = r.stats.latency;
+        printf("%-7s %-9s %10llu %10.0f %8llu %8llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+               implName(r.impl), OP_TYPES[r.op].name, static_cast<unsigned long long>(h.count()),
+               h.count() / r.seconds, static_cast<unsigned long long>(r.stats.errors),
+               static_cast<unsigned long long>(r.stats.nils), h.percentile(50) / 1e3,
+               h.percentile(90) / 1e3, h.percentile(99) / 1e3, h.percentile(99.9) / 1e3,
+               h.maxValue() / 1e3);
+        if (r.stats.errors)
+            fprintf(stderr, "%s %s: %s\n", implName(r.impl), OP_TYPES[r.op].name,
+                    r.stats.firstError.c_str());
+        if (csv)
+            fprintf(csv, "%s,%s,%llu,%.0f,%llu,%llu,%.1f,%.1f,%.1f,%.1f,%.1f\n", implName(r.impl),
+                    OP_TYPES[r.op].name, static_cast<unsigned long long>(h.count()),
+                    h.count() / r.seconds, static_cast<unsigned long long>(r.stats.errors),
+                    static_cast<unsigned long long>(r.stats.nils), h.percentile(50) / 1e3,
+                    h.percentile(90) / 1e3, h.percentile(99) / 1e3, h.percentile(99.9) / 1e3,
+                    h.maxValue() / 1e3);
+    }
+}
+
+/* Module against Lua, per command that both ran. */
+void printComparison(const std::vector<Result> &results)
+{
+    std::map<size_t, const Result *> module, lua;
+    for (const auto &r: results)
+        (r.impl == Impl::Module ? module : lua)[r.op] = &r;
+    if (module.empty() || lua.empty())
+        return;
+
+    printf("\n%-9s %16s %16s\n", "command", "ops/s module/lua", "p99 lua/module");
+    for (const auto &m: module) {
+        auto l = lua.find(m.first);
+        if (l == lua.end())
+            continue;
+        const Histogram &mh = m.second->stats.latency, &lh = l->second->stats.latency;
+        printf("%-9s %16.2f %16.2f\n", OP_TYPES[m.first].name,
+               (mh.count() / m.second->seconds) / (lh.count() / l->second->seconds),
+               static_cast<double>(lh.percentile(99)) / static_cast<double>(mh.percentile(99)));
+    }
+}
+
+bool parseMix(const std::string &spec, std::vector<std::pair<size_t, int>> &mix)
+{
+    size_t pos = 0;
+    mix.clear();
+    while (pos < spec.size()) {
+        size_t comma = spec.find(',', pos);
+        std::string item = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        int weight = colon == std::string::npos ? 1 : atoi(item.c_str() + colon + 1);
+        size_t op;
+        for (op = 0; op < OP_TYPE_COUNT; op++) {
+            if (name == OP_TYPES[op].name)
+                break;
+        }
+        if (op == OP_TYPE_COUNT || weight < 0)
+            return false;
+        if (weight > 0)
+            mix.emplace_back(op, weight);
+        if (comma == std::string::npos)
+            break;
+        pos = comma + 1;
+    }
+    return !mix.empty();
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--server PATH] [--module PATH] [--host HOST] [--port PORT]\n"
+                    "  [--threads N] [--pipeline N] [--keys N] [--namespace-keys N]\n"
+                    "  [--value-size N] [--subscribers N] [--mix OP:W[,OP:W...]]\n"
+                    "  [--impl module|lua|both] [--duration S] [--warmup S] [--csv FILE]\n", prog);
+    exit(2);
+}
+
+Options parseOptions(int argc, char **argv)
+{
+    static const struct option longopts[] = {
+        {"server", required_argument, nullptr, 's'},
+        {"module", required_argument, nullptr, 'm'},
+        {"host", required_argument, nullptr, 'h'},
+        {"port", required_argument, nullptr, 'p'},
+        {"threads", required_argument, nullptr, 't'},
+        {"pipeline", required_argument, nullptr, 'P'},
+        {"keys", required_argument, nullptr, 'k'},
+        {"namespace-keys", required_argument, nullptr, 'n'},
+        {"value-size", required_argument, nullptr, 'v'},
+        {"subscribers", required_argument, nullptr, 'S'},
+        {"mix", required_argument, nullptr, 'x'},
+        {"impl", required_argument, nullptr, 'i'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"csv", required_argument, nullptr, 'c'},
+        {"help", no_argument, nullptr, 'H'},
+        {nullptr, 0, nullptr, 0}
+    };
+    Options opts;
+    std::string mix = "setie:40,setne:20,setiepub:30,nget:10";
+    int c;
+
+    while ((c = getopt_long(argc, argv, "", longopts, nullptr)) != -1) {
+        switch (c) {
+        case 's': opts.server = optarg; break;
+        case 'm': opts.module = optarg; break;
+        case 'h': opts.host = optarg; break;
+        case 'p': opts.port = atoi(optarg); break;
+        case 't': opts.threads = atoi(optarg); break;
+        case 'P': opts.pipeline = atoi(optarg); break;
+        case 'k': opts.keys = atol(optarg); break;
+        case 'n': opts.namespaceKeys = atol(optarg); break;
+        case 'v': opts.valueSize = static_cast<size_t>(atol(optarg)); break;
+        case 'S': opts.subscribers = atoi(optarg); break;
+        case 'x': mix = optarg; break;
+        case 'i':
+            if (!strcmp(optarg, "module"))
+                opts.impls = {Impl::Module};
+            else if (!strcmp(optarg, "lua"))
+                opts.impls = {Impl::Lua};
+            else if (strcmp(optarg, "both"))
+                usage(argv[0]);
+            break;
+        case 'd': opts.duration = atof(optarg); break;
+        case 'w': opts.warmup = atof(optarg); break;
+        case 'c': opts.csv = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (optind != argc || opts.port <= 0 || opts.threads < 1 || opts.pipeline < 1 || opts.keys < 1 ||
+        opts.namespaceKeys < 1 || opts.subscribers < 0 || opts.duration <= 0 || opts.warmup < 0 ||
+        !parseMix(mix, opts.mix))
+        usage(argv[0]);
+    return opts;
+}
+
+pid_t startServer(const Options &opts)
+{
+    std::string port = std::to_string(opts.port);
+    std::vector<const char *> argv = {
+        opts.server.c_str(), "--port", port.c_str(), "--save", "", "--appendonly", "no",
+        "--loadmodule", opts.module.c_str(), nullptr
+    };
+    pid_t pid;
+    if (posix_spawnp(&pid, opts.server.c_str(), nullptr, nullptr, const_cast<char **>(argv.data()),
+                     environ) != 0)
+        throw std::runtime_error("cannot start " + opts.server);
+
+    for (int i = 0; i < 100; i++) {
+        try {
+            Connection conn(opts.host, opts.port);
+            conn.command({"PING"});
+            return pid;
+        } catch (const std::runtime_error &) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    kill(pid, SIGTERM);
+    throw std::runtime_error("server did not start");
+}
+
+void stopServer(const Options &opts, pid_t pid)
+{
+    try {
+        Connection conn(opts.host, opts.port);
+        conn.append({"SHUTDOWN", "NOSAVE"});
+        conn.flush();
+    } catch (const std::runtime_error &) {
+        kill(pid, SIGTERM);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options opts = parseOptions(argc, argv);
+    pid_t server = 0;
+    FILE *csv = nullptr;
+
+    signal(SIGPIPE, SIG_IGN);
+    if (!opts.csv.empty()) {
+        csv = fopen(opts.csv.c_str(), "w");
+        if (csv == nullptr) {
+            perror(opts.csv.c_str());
+            return 1;
+        }
+        fprintf(csv, "impl,command,ops,ops_per_sec,errors,nils,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    }
+
+    /* The mix as a table of operations, one entry per unit of weight */
+    std::vector<size_t> ops;
+    for (const auto &m: opts.mix)
+        ops.insert(ops.end(), static_cast<size_t>(m.second), m.first);
+
+    std::vector<Result> results;
+    try {
+        if (!opts.server.empty())
+            server = startServer(opts);
+        printf("threads %d, pipeline %d, keys %ld, namespace keys %ld, value size %zu, "
+               "subscribers %d\n", opts.threads, opts.pipeline, opts.keys, opts.namespaceKeys,
+               opts.valueSize, opts.subscribers);
+        for (Impl impl: opts.impls) {
+            uint64_t published;
+            std::vector<Result> r = runImpl(opts, impl, ops, published);
+            results.insert(results.end(), r.begin(), r.end());
+            printf("%s: %llu messages received by the subscribers\n", implName(impl),
+                   static_cast<unsigned long long>(published));
+        }
+    } catch (const std::runtime_error &e) {
+        fprintf(stderr, "%s\n", e.what());
+        if (server)
+            stopServer(opts, server);
+        return 1;
+    }
+    if (server)
+        stopServer(opts, server);
+
+    printResults(results, csv);
+    printComparison(results);
+    if (csv)
+        fclose(csv);
+    return 0;
+}
@@ -0,0 +1,1796 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Only the defines common to the server and the modules, the module API
+ * pointers are defined by exstrings.c, and the types are our own. */
+#define REDISMODULE_CORE
+#include "redismodule.h"
+#undef RedisModuleString
+#include "fakeredis.h"
+#include "globmatch.h"
+#include "xxhash64.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define FAKE_DBS 16
+#define FAKE_MIN_BUCKETS 16
+#define FAKE_MAX_POSTPONED 8
+#define FAKE_MAX_ARGS 64
+
+typedef long long mstime_t;
+
+typedef struct RedisModuleCtx RedisModuleCtx;
+typedef struct RedisModuleString RedisModuleString;
+typedef struct RedisModuleKey RedisModuleKey;
+typedef struct RedisModuleCallReply RedisModuleCallReply;
+typedef struct RedisModuleType RedisModuleType;
+typedef struct RedisModuleBlockedClient RedisModuleBlockedClient;
+typedef struct RedisModuleDict RedisModuleDict;
+typedef struct RedisModuleDictIter RedisModuleDictIter;
+typedef struct RedisModuleScanCursor RedisModuleScanCursor;
+typedef struct RedisModuleCommandFilter RedisModuleCommandFilter;
+typedef struct RedisModuleCommandFilterCtx RedisModuleCommandFilterCtx;
+
+typedef int (*RedisModuleCmdFunc)(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+typedef int (*RedisModuleNotificationFunc)(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key);
+typedef void (*RedisModuleTimerProc)(RedisModuleCtx *ctx, void *data);
+typedef void (*RedisModuleCommandFilterFunc)(RedisModuleCommandFilterCtx *filter);
+typedef void (*RedisModuleScanCB)(RedisModuleCtx *ctx, RedisModuleString *keyname, RedisModuleKey *key, void *privdata);
+typedef void (*RedisModuleTypeFreeFunc)(void *value);
+
+/* Same layout as in the module API, only 'free' is used. */
+typedef struct RedisModuleTypeMethods {
+    uint64_t version;
+    void *rdb_load;
+    void *rdb_save;
+    void *aof_rewrite;
+    void *mem_usage;
+    void *digest;
+    RedisModuleTypeFreeFunc free;
+    void *aux_load;
+    void *aux_save;
+    int aux_save_triggers;
+} RedisModuleTypeMethods;
+
+int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+
+/* ---------------------------- Allocations ------------------------------ */
+
+static FakeRedisStats stats;
+
+static void *fakeAlloc(size_t bytes)
+{
+    __atomic_fetch_add(&stats.allocs, 1, __ATOMIC_RELAXED);
+    return malloc(bytes);
+}
+
+static void *fakeCalloc(size_t nmemb, size_t size)
+{
+    __atomic_fetch_add(&stats.allocs, 1, __ATOMIC_RELAXED);
+    return calloc(nmemb, size);
+}
+
+static void *fakeRealloc(void *ptr, size_t bytes)
+{
+    __atomic_fetch_add(&stats.allocs, 1, __ATOMIC_RELAXED);
+    return realloc(ptr, bytes);
+}
+
+static void fakeFree(void *ptr)
+{
+    free(ptr);
+}
+
+static char *fakeStrdup(const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *s = fakeAlloc(len);
+    memcpy(s, str, len);
+    return s;
+}
+
+/* ------------------------------ Contexts ------------------------------- */
+
+typedef struct _FakeClient {
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t postponed[FAKE_MAX_POSTPONED];
+    int npostponed;
+} FakeClient;
+
+typedef enum _AutoType {
+    AUTO_STRING,
+    AUTO_REPLY,
+    AUTO_KEY
+} AutoType;
+
+typedef struct _AutoEntry {
+    AutoType type;
+    void *ptr;
+} AutoEntry;
+
+struct RedisModuleCtx {
+    void *getapifuncptr;    /* first, as RedisModule_Init reads it */
+    int db;
+    bool automemory;
+    FakeClient *client;
+    const char *cmdname;
+    AutoEntry *autos;
+    size_t nautos;
+    size_t capautos;
+    RedisModuleBlockedClient *blocked;
+};
+
+struct RedisModuleString {
+    size_t len;
+    int refcount;
+    char *ptr;
+};
+
+struct RedisModuleBlockedClient {
+    FakeClient client;
+    int db;
+    bool unblocked;
+};
+
+static pthread_mutex_t gil = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t unblock_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t unblock_cond = PTHREAD_COND_INITIALIZER;
+
+static int fakeGetApi(const char *name, void *ptr);
+
+static void ctxInit(RedisModuleCtx *ctx, int db, FakeClient *client)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->getapifuncptr = (void *)(unsigned long)fakeGetApi;
+    ctx->db = db;
+    ctx->client = client;
+}
+
+static void autoAdd(RedisModuleCtx *ctx, AutoType type, void *ptr)
+{
+    if (ctx == NULL || !ctx->automemory)
+        return;
+    if (ctx->nautos == ctx->capautos) {
+        ctx->capautos = ctx->capautos ? ctx->capautos * 2 : 16;
+        ctx->autos = fakeRealloc(ctx->autos, ctx->capautos * sizeof(AutoEntry));
+    }
+    ctx->autos[ctx->nautos].type = type;
+    ctx->autos[ctx->nautos].ptr = ptr;
+    ctx->nautos++;
+}
+
+/* Like the server, searches from the most recent entry and moves the last
+ * entry to the freed place. */
+static bool autoRemove(RedisModuleCtx *ctx, AutoType type, void *ptr)
+{
+    size_t i;
+
+    if (ctx == NULL || !ctx->automemory)
+        return false;
+    for (i = ctx->nautos; i > 0; i--) {
+        if (ctx->autos[i - 1].type == type && ctx->autos[i - 1].ptr == ptr) {
+            ctx->autos[i - 1] = ctx->autos[--ctx->nautos];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void stringDecr(RedisModuleString *str);
+static void replyFree(RedisModuleCallReply *reply);
+static void keyClose(RedisModuleKey *key);
+
+static void ctxFree(RedisModuleCtx *ctx)
+{
+    size_t i;
+
+    for (i = 0; i < ctx->nautos; i++) {
+        switch (ctx->autos[i].type) {
+        case AUTO_STRING: stringDecr(ctx->autos[i].ptr); break;
+        case AUTO_REPLY: replyFree(ctx->autos[i].ptr); break;
+        case AUTO_KEY: keyClose(ctx->autos[i].ptr); break;
+        default: break;
+        }
+    }
+    fakeFree(ctx->autos);
+    ctx->autos = NULL;
+    ctx->nautos = ctx->capautos = 0;
+}
+
+static void fakeAutoMemory(RedisModuleCtx *ctx)
+{
+    ctx->automemory = true;
+}
+
+static int fakeGetSelectedDb(RedisModuleCtx *ctx)
+{
+    return ctx->db;
+}
+
+static int fakeSelectDb(RedisModuleCtx *ctx, int newid)
+{
+    if (newid < 0 || newid >= FAKE_DBS)
+        return REDISMODULE_ERR;
+    ctx->db = newid;
+    return REDISMODULE_OK;
+}
+
+static int fakeGetContextFlags(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return REDISMODULE_CTX_FLAGS_MASTER;
+}
+
+/* Not a cluster, so the key positions are never asked. */
+static int fakeIsKeysPositionRequest(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return 0;
+}
+
+static void fakeKeyAtPos(RedisModuleCtx *ctx, int pos)
+{
+    (void)ctx;
+    (void)pos;
+}
+
+static mstime_t nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (mstime_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ------------------------------- Strings ------------------------------- */
+
+static RedisModuleString *stringNew(const char *ptr, size_t len)
+{
+    /* One allocation, as the embedded strings of the server */
+    RedisModuleString *str = fakeAlloc(sizeof(*str) + len + 1);
+    str->len = len;
+    str->refcount = 1;
+    str->ptr = (char *)(str + 1);
+    if (len)
+        memcpy(str->ptr, ptr, len);
+    str->ptr[len] = '\0';
+    return str;
+}
+
+static void stringIncr(RedisModuleString *str)
+{
+    __atomic_fetch_add(&str->refcount, 1, __ATOMIC_RELAXED);
+}
+
+static void stringDecr(RedisModuleString *str)
+{
+    if (__atomic_sub_fetch(&str->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        fakeFree(str);
+}
+
+static RedisModuleString *fakeCreateString(RedisModuleCtx *ctx, const char *ptr, size_t len)
+{
+    RedisModuleString *str = stringNew(ptr, len);
+    autoAdd(ctx, AUTO_STRING, str);
+    return str;
+}
+
+static RedisModuleString *fakeCreateStringFromLongLong(RedisModuleCtx *ctx, long long ll)
+{
+    char buf[24];
+    int len = snprintf(buf, sizeof(buf), "%lld", ll);
+    return fakeCreateString(ctx, buf, (size_t)len);
+}
+
+static RedisModuleString *fakeCreateStringFromString(RedisModuleCtx *ctx, const RedisModuleString *str)
+{
+    return fakeCreateString(ctx, str->ptr, str->len);
+}
+
+static void fakeFreeString(RedisModuleCtx *ctx, RedisModuleString *str)
+{
+    autoRemove(ctx, AUTO_STRING, str);
+    stringDecr(str);
+}
+
+/* A string in the pool of 'ctx' changes owner instead of getting a
+ * reference, as in the server. */
+static void fakeRetainString(RedisModuleCtx *ctx, RedisModuleString *str)
+{
+    if (!autoRemove(ctx, AUTO_STRING, str))
+        stringIncr(str);
+}
+
+static const char *fakeStringPtrLen(const RedisModuleString *str, size_t *len)
+{
+    if (len)
+        *len = str->len;
+    return str->ptr;
+}
+
+static bool parseLongLong(const char *s, size_t len, long long *ll)
+{
+    char buf[24];
+    char *end;
+
+    if (len == 0 || len >= sizeof(buf))
+        return false;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    *ll = strtoll(buf, &end, 10);
+    return *end == '\0' && !(buf[0] == '0' && len > 1) && buf[0] != '+' && buf[0] != ' ';
+}
+
+static int fakeStringToLongLong(const RedisModuleString *str, long long *ll)
+{
+    return parseLongLong(str->ptr, str->len, ll) ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+/* ------------------------------ Keyspace ------------------------------- */
+
+struct RedisModuleType {
+    char name[10];
+    RedisModuleTypeFreeFunc free;
+};
+
+typedef struct _Entry {
+    struct _Entry *next;
+    uint64_t hash;
+    RedisModuleString *name;
+    int type;
+    RedisModuleString *str;
+    RedisModuleType *mtype;
+    void *mvalue;
+    mstime_t expire;
+} Entry;
+
+typedef struct _Db {
+    Entry **buckets;
+    size_t size;
+    size_t count;
+} Db;
+
+static Db dbs[FAKE_DBS];
+
+typedef struct _Subscriber {
+    int types;
+    RedisModuleNotificationFunc cb;
+    bool active;
+} Subscriber;
+
+static Subscriber *subscribers;
+static size_t nsubscribers;
+
+static void notify(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
+{
+    size_t i;
+
+    stats.notified++;
+    for (i = 0; i < nsubscribers; i++) {
+        Subscriber *sub = &subscribers[i];
+        if (!(sub->types & type) || sub->active)
+            continue;
+        RedisModuleCtx subctx;
+        ctxInit(&subctx, ctx->db, NULL);
+        sub->active = true;
+        sub->cb(&subctx, type, event, key);
+        sub->active = false;
+        ctxFree(&subctx);
+    }
+}
+
+static int fakeNotifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
+{
+    notify(ctx, type, event, key);
+    return REDISMODULE_OK;
+}
+
+static int fakeSubscribeToKeyspaceEvents(RedisModuleCtx *ctx, int types, RedisModuleNotificationFunc cb)
+{
+    (void)ctx;
+    subscribers = fakeRealloc(subscribers, (nsubscribers + 1) * sizeof(Subscriber));
+    subscribers[nsubscribers].types = types;
+    subscribers[nsubscribers].cb = cb;
+    subscribers[nsubscribers].active = false;
+    nsubscribers++;
+    return REDISMODULE_OK;
+}
+
+static uint64_t keyHash(const char *name, size_t len)
+{
+    return xxhash64(name, len, 0);
+}
+
+static void entryFreeValue(Entry *e)
+{
+    if (e->str)
+        stringDecr(e->str);
+    if (e->mtype && e->mtype->free)
+        e->mtype->free(e->mvalue);
+    e->str = NULL;
+    e->mtype = NULL;
+    e->mvalue = NULL;
+}
+
+static void dbResize(Db *db, size_t size)
+{
+    Entry **buckets = fakeCalloc(size, sizeof(Entry *));
+    size_t i;
+
+    for (i = 0; i < db->size; i++) {
+        Entry *e = db->buckets[i];
+        while (e) {
+            Entry *next = e->next;
+            size_t b = e->hash & (size - 1);
+            e->next = buckets[b];
+            buckets[b] = e;
+            e = next;
+        }
+    }
+    fakeFree(db->buckets);
+    db->buckets = buckets;
+    db->size = size;
+}
+
+static Entry **dbLink(Db *db, const char *name, size_t len, uint64_t hash)
+{
+    Entry **link;
+
+    if (db->size == 0)
+        return NULL;
+    for (link = &db->buckets[hash & (db->size - 1)]; *link; link = &(*link)->next) {
+        Entry *e = *link;
+        if (e->hash == hash && e->name->len == len && !memcmp(e->name->ptr, name, len))
+            return link;
+    }
+    return NULL;
+}
+
+static void dbUnlink(Db *db, Entry **link)
+{
+    Entry *e = *link;
+    *link = e->next;
+    entryFreeValue(e);
+    stringDecr(e->name);
+    fakeFree(e);
+    db->count--;
+}
+
+/* Lookup with the lazy expiration of the server. */
+static Entry *dbFind(int dbid, RedisModuleString *name)
+{
+    Db *db = &dbs[dbid];
+    Entry **link = dbLink(db, name->ptr, name->len, keyHash(name->ptr, name->len));
+
+    if (link == NULL)
+        return NULL;
+    if ((*link)->expire != REDISMODULE_NO_EXPIRE && (*link)->expire <= nowMs()) {
+        dbUnlink(db, link);
+        return NULL;
+    }
+    return *link;
+}
+
+static Entry *dbAdd(int dbid, RedisModuleString *name)
+{
+    Db *db = &dbs[dbid];
+    uint64_t hash = keyHash(name->ptr, name->len);
+    Entry *e;
+
+    if (db->count >= db->size)
+        dbResize(db, db->size ? db->size * 2 : FAKE_MIN_BUCKETS);
+    e = fakeCalloc(1, sizeof(Entry));
+    e->hash = hash;
+    e->name = stringNew(name->ptr, name->len);
+    e->expire = REDISMODULE_NO_EXPIRE;
+    e->next = db->buckets[hash & (db->size - 1)];
+    db->buckets[hash & (db->size - 1)] = e;
+    db->count++;
+    return e;
+}
+
+static bool dbDelete(int dbid, RedisModuleString *name)
+{
+    Db *db = &dbs[dbid];
+    Entry **link;
+
+    if (dbFind(dbid, name) == NULL)
+        return false;
+    link = dbLink(db, name->ptr, name->len, keyHash(name->ptr, name->len));
+    dbUnlink(db, link);
+    return true;
+}
+
+static void dbSetString(int dbid, RedisModuleString *name, RedisModuleString *val)
+{
+    Entry *e = dbFind(dbid, name);
+
+    if (e == NULL)
+        e = dbAdd(dbid, name);
+    entryFreeValue(e);
+    e->type = REDISMODULE_KEYTYPE_STRING;
+    e->str = val;
+    e->expire = REDISMODULE_NO_EXPIRE;
+    stringIncr(val);
+}
+
+size_t fakeRedisDbSize(int db)
+{
+    return dbs[db].count;
+}
+
+/* --------------------------------- Keys -------------------------------- */
+
+struct RedisModuleKey {
+    RedisModuleCtx *ctx;
+    int db;
+    int mode;
+    RedisModuleString *name;
+    Entry *entry;
+};
+
+static void *fakeOpenKey(RedisModuleCtx *ctx, RedisModuleString *keyname, int mode)
+{
+    Entry *e = dbFind(ctx->db, keyname);
+    RedisModuleKey *key;
+
+    /* As in the server, a missing key opened for reading is NULL */
+    if (e == NULL && !(mode & REDISMODULE_WRITE))
+        return NULL;
+    key = fakeAlloc(sizeof(*key));
+    key->ctx = ctx;
+    key->db = ctx->db;
+    key->mode = mode;
+    key->name = keyname;
+    key->entry = e;
+    stringIncr(keyname);
+    autoAdd(ctx, AUTO_KEY, key);
+    return key;
+}
+
+static void keyClose(RedisModuleKey *key)
+{
+    stringDecr(key->name);
+    fakeFree(key);
+}
+
+static void fakeCloseKey(RedisModuleKey *key)
+{
+    if (key == NULL)
+        return;
+    autoRemove(key->ctx, AUTO_KEY, key);
+    keyClose(key);
+}
+
+static int fakeKeyType(RedisModuleKey *key)
+{
+    if (key == NULL || key->entry == NULL)
+        return REDISMODULE_KEYTYPE_EMPTY;
+    return key->entry->type;
+}
+
+static char *fakeStringDMA(RedisModuleKey *key, size_t *len, int mode)
+{
+    (void)mode;
+    if (key == NULL || key->entry == NULL || key->entry->type != REDISMODULE_KEYTYPE_STRING) {
+        *len = 0;
+        return "";
+    }
+    *len = key->entry->str->len;
+    return key->entry->str->ptr;
+}
+
+static int fakeStringSet(RedisModuleKey *key, RedisModuleString *str)
+{
+    if (key == NULL || !(key->mode & REDISMODULE_WRITE))
+        return REDISMODULE_ERR;
+    dbSetString(key->db, key->name, str);
+    key->entry = dbFind(key->db, key->name);
+    return REDISMODULE_OK;
+}
+
+static int fakeSetExpire(RedisModuleKey *key, mstime_t expire)
+{
+    if (key == NULL || key->entry == NULL)
+        return REDISMODULE_ERR;
+    key->entry->expire = expire == REDISMODULE_NO_EXPIRE ? expire : nowMs() + expire;
+    return REDISMODULE_OK;
+}
+
+static int fakeUnlinkKey(RedisModuleKey *key)
+{
+    if (key == NULL || !(key->mode & REDISMODULE_WRITE))
+        return REDISMODULE_ERR;
+    if (key->entry)
+        dbDelete(key->db, key->name);
+    key->entry = NULL;
+    return REDISMODULE_OK;
+}
+
+static RedisModuleType *fakeCreateDataType(RedisModuleCtx *ctx, const char *name, int encver,
+                                           RedisModuleTypeMethods *typemethods)
+{
+    (void)ctx;
+    (void)encver;
+    RedisModuleType *mt = fakeCalloc(1, sizeof(*mt));
+    strncpy(mt->name, name, sizeof(mt->name) - 1);
+    mt->free = typemethods->free;
+    return mt;
+}
+
+static int fakeModuleTypeSetValue(RedisModuleKey *key, RedisModuleType *mt, void *value)
+{
+    if (key == NULL || !(key->mode & REDISMODULE_WRITE))
+        return REDISMODULE_ERR;
+    if (key->entry == NULL)
+        key->entry = dbAdd(key->db, key->name);
+    entryFreeValue(key->entry);
+    key->entry->type = REDISMODULE_KEYTYPE_MODULE;
+    key->entry->mtype = mt;
+    key->entry->mvalue = value;
+    key->entry->expire = REDISMODULE_NO_EXPIRE;
+    return REDISMODULE_OK;
+}
+
+static RedisModuleType *fakeModuleTypeGetType(RedisModuleKey *key)
+{
+    return key && key->entry ? key->entry->mtype : NULL;
+}
+
+static void *fakeModuleTypeGetValue(RedisModuleKey *key)
+{
+    return key && key->entry ? key->entry->mvalue : NULL;
+}
+
+/* -------------------------------- Replies ------------------------------ */
+
+static void clientAppend(FakeClient *c, const char *buf, size_t len)
+{
+    if (c == NULL)
+        return;
+    if (c->len + len > c->cap) {
+        c->cap = (c->len + len) * 2;
+        c->buf = fakeRealloc(c->buf, c->cap);
+    }
+    memcpy(c->buf + c->len, buf, len);
+    c->len += len;
+}
+
+static void clientPrintf(FakeClient *c, const char *fmt, ...)
+{
+    char buf[64];
+    va_list ap;
+    int len;
+
+    if (c == NULL)
+        return;
+    va_start(ap, fmt);
+    len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    clientAppend(c, buf, (size_t)len);
+}
+
+static void clientBulk(FakeClient *c, const char *buf, size_t len)
+{
+    clientPrintf(c, "$%zu\r\n", len);
+    clientAppend(c, buf, len);
+    clientAppend(c, "\r\n", 2);
+}
+
+static int fakeReplyWithLongLong(RedisModuleCtx *ctx, long long ll)
+{
+    clientPrintf(ctx->client, ":%lld\r\n", ll);
+    return REDISMODULE_OK;
+}
+
+static int fakeReplyWithError(RedisModuleCtx *ctx, const char *err)
+{
+    if (err[0] != '-')
+        clientAppend(ctx->client, "-", 1);
+    clientAppend(ctx->client, err, strlen(err));
+    clientAppend(ctx->client, "\r\n", 2);
+    return REDISMODULE_OK;
+}
+
+static int fakeWrongArity(RedisModuleCtx *ctx)
+{
+    fakeReplyWithError(ctx, "ERR wrong number of arguments");
+    return REDISMODULE_OK;
+}
+
+static int fakeReplyWithSimpleString(RedisModuleCtx *ctx, const char *msg)
+{
+    clientAppend(ctx->client, "+", 1);
+    clientAppend(ctx->client, msg, strlen(msg));
+    clientAppend(ctx->client, "\r\n", 2);
+    return REDISMODULE_OK;
+}
+
+/* A postponed array reserves room for its length, as the server reserves a
+ * reply node. */
+#define POSTPONED_FMT "*%020ld\r\n"
+#define POSTPONED_LEN 23
+
+static int fakeReplyWithArray(RedisModuleCtx *ctx, long len)
+{
+    FakeClient *c = ctx->client;
+
+    if (len != REDISMODULE_POSTPONED_ARRAY_LEN) {
+        clientPrintf(c, "*%ld\r\n", len);
+    } else if (c && c->npostponed < FAKE_MAX_POSTPONED) {
+        c->postponed[c->npostponed++] = c->len;
+        clientPrintf(c, POSTPONED_FMT, 0L);
+    }
+    return REDISMODULE_OK;
+}
+
+static void fakeReplySetArrayLength(RedisModuleCtx *ctx, long len)
+{
+    FakeClient *c = ctx->client;
+    char buf[POSTPONED_LEN + 1];
+
+    if (c == NULL || c->npostponed == 0)
+        return;
+    snprintf(buf, sizeof(buf), POSTPONED_FMT, len);
+    memcpy(c->buf + c->postponed[--c->npostponed], buf, POSTPONED_LEN);
+}
+
+static int fakeReplyWithStringBuffer(RedisModuleCtx *ctx, const char *buf, size_t len)
+{
+    clientBulk(ctx->client, buf, len);
+    return REDISMODULE_OK;
+}
+
+static int fakeReplyWithCString(RedisModuleCtx *ctx, const char *buf)
+{
+    clientBulk(ctx->client, buf, strlen(buf));
+    return REDISMODULE_OK;
+}
+
+static int fakeReplyWithString(RedisModuleCtx *ctx, RedisModuleString *str)
+{
+    clientBulk(ctx->client, str->ptr, str->len);
+    return REDISMODULE_OK;
+}
+
+static int fakeReplyWithNull(RedisModuleCtx *ctx)
+{
+    clientAppend(ctx->client, "$-1\r\n", 5);
+    return REDISMODULE_OK;
+}
+
+/* ------------------------------ Call replies ---------------------------- */
+
+struct RedisModuleCallReply {
+    RedisModuleCtx *ctx;    /* of the pool, for the top level reply */
+    int type;
+    long long integer;
+    char *str;
+    size_t len;
+    RedisModuleCallReply *elements;
+    size_t n;
+};
+
+static void replySetString(RedisModuleCallReply *r, int type, const char *str, size_t len)
+{
+    r->type = type;
+    r->str = fakeAlloc(len + 1);
+    memcpy(r->str, str, len);
+    r->str[len] = '\0';
+    r->len = len;
+}
+
+static void replySetArray(RedisModuleCallReply *r, size_t n)
+{
+    r->type = REDISMODULE_REPLY_ARRAY;
+    r->elements = n ? fakeCalloc(n, sizeof(RedisModuleCallReply)) : NULL;
+    r->n = n;
+}
+
+static void replyFreeContent(RedisModuleCallReply *r)
+{
+    size_t i;
+
+    fakeFree(r->str);
+    for (i = 0; i < r->n; i++)
+        replyFreeContent(&r->elements[i]);
+    fakeFree(r->elements);
+}
+
+static void replyFree(RedisModuleCallReply *reply)
+{
+    replyFreeContent(reply);
+    fakeFree(reply);
+}
+
+static void replyWrite(FakeClient *c, RedisModuleCallReply *r)
+{
+    size_t i;
+
+    switch (r->type) {
+    case REDISMODULE_REPLY_STRING:
+        clientBulk(c, r->str, r->len);
+        break;
+    case REDISMODULE_REPLY_ERROR:
+        clientAppend(c, "-", 1);
+        clientAppend(c, r->str, r->len);
+        clientAppend(c, "\r\n", 2);
+        break;
+    case REDISMODULE_REPLY_INTEGER:
+        clientPrintf(c, ":%lld\r\n", r->integer);
+        break;
+    case REDISMODULE_REPLY_ARRAY:
+        clientPrintf(c, "*%zu\r\n", r->n);
+        for (i = 0; i < r->n; i++)
+            replyWrite(c, &r->elements[i]);
+        break;
+    default:
+        clientAppend(c, "$-1\r\n", 5);
+        break;
+    }
+}
+
+static int fakeReplyWithCallReply(RedisModuleCtx *ctx, RedisModuleCallReply *reply)
+{
+    replyWrite(ctx->client, reply);
+    return REDISMODULE_OK;
+}
+
+static int fakeCallReplyType(RedisModuleCallReply *reply)
+{
+    return reply ? reply->type : REDISMODULE_REPLY_UNKNOWN;
+}
+
+static long long fakeCallReplyInteger(RedisModuleCallReply *reply)
+{
+    return reply->type == REDISMODULE_REPLY_INTEGER ? reply->integer : LLONG_MIN;
+}
+
+static size_t fakeCallReplyLength(RedisModuleCallReply *reply)
+{
+    return reply->type == REDISMODULE_REPLY_ARRAY ? reply->n : reply->len;
+}
+
+static RedisModuleCallReply *fakeCallReplyArrayElement(RedisModuleCallReply *reply, size_t idx)
+{
+    if (reply->type != REDISMODULE_REPLY_ARRAY || idx >= reply->n)
+        return NULL;
+    return &reply->elements[idx];
+}
+
+static const char *fakeCallReplyStringPtr(RedisModuleCallReply *reply, size_t *len)
+{
+    if (reply->type != REDISMODULE_REPLY_STRING && reply->type != REDISMODULE_REPLY_ERROR)
+        return NULL;
+    if (len)
+        *len = reply->len;
+    return reply->str;
+}
+
+static RedisModuleString *fakeCreateStringFromCallReply(RedisModuleCallReply *reply)
+{
+    if (reply == NULL)
+        return NULL;
+    switch (reply->type) {
+    case REDISMODULE_REPLY_STRING:
+    case REDISMODULE_REPLY_ERROR:
+        return stringNew(reply->str, reply->len);
+    case REDISMODULE_REPLY_INTEGER:
+        return fakeCreateStringFromLongLong(NULL, reply->integer);
+    default:
+        return NULL;
+    }
+}
+
+static void fakeFreeCallReply(RedisModuleCallReply *reply)
+{
+    if (reply == NULL)
+        return;
+    autoRemove(reply->ctx, AUTO_REPLY, reply);
+    replyFree(reply);
+}
+
+/* ------------------------------- Commands ------------------------------- */
+
+/* The server commands the module calls. */
+static void cmdError(RedisModuleCallReply *r, const char *err)
+{
+    replySetString(r, REDISMODULE_REPLY_ERROR, err, strlen(err));
+}
+
+static bool argIs(RedisModuleString *arg, const char *name)
+{
+    return arg->len == strlen(name) && !strncasecmp(arg->ptr, name, arg->len);
+}
+
+static void cmdSet(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    bool nx = false, xx = false;
+    mstime_t expire = REDISMODULE_NO_EXPIRE;
+    long long n;
+    int i;
+
+    if (argc < 3)
+        return cmdError(r, "ERR wrong number of arguments for 'set' command");
+    for (i = 3; i < argc; i++) {
+        if (argIs(argv[i], "NX")) {
+            nx = true;
+        } else if (argIs(argv[i], "XX")) {
+            xx = true;
+        } else if ((argIs(argv[i], "EX") || argIs(argv[i], "PX")) && i + 1 < argc &&
+                   fakeStringToLongLong(argv[i + 1], &n) == REDISMODULE_OK && n > 0) {
+            expire = argIs(argv[i], "EX") ? n * 1000 : n;
+            i++;
+        } else {
+            return cmdError(r, "ERR syntax error");
+        }
+    }
+    bool exists = dbFind(ctx->db, argv[1]) != NULL;
+    if ((nx && exists) || (xx && !exists)) {
+        r->type = REDISMODULE_REPLY_NULL;
+        return;
+    }
+    dbSetString(ctx->db, argv[1], argv[2]);
+    if (expire != REDISMODULE_NO_EXPIRE)
+        dbFind(ctx->db, argv[1])->expire = nowMs() + expire;
+    notify(ctx, REDISMODULE_NOTIFY_STRING, "set", argv[1]);
+    if (expire != REDISMODULE_NO_EXPIRE)
+        notify(ctx, REDISMODULE_NOTIFY_GENERIC, "expire", argv[1]);
+    replySetString(r, REDISMODULE_REPLY_STRING, "OK", 2);
+}
+
+static void cmdMSet(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    int i;
+
+    if (argc < 3 || argc % 2 == 0)
+        return cmdError(r, "ERR wrong number of arguments for 'mset' command");
+    for (i = 1; i < argc; i += 2) {
+        dbSetString(ctx->db, argv[i], argv[i + 1]);
+        notify(ctx, REDISMODULE_NOTIFY_STRING, "set", argv[i]);
+    }
+    replySetString(r, REDISMODULE_REPLY_STRING, "OK", 2);
+}
+
+static void cmdDel(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    int i;
+
+    if (argc < 2)
+        return cmdError(r, "ERR wrong number of arguments for 'unlink' command");
+    r->type = REDISMODULE_REPLY_INTEGER;
+    for (i = 1; i < argc; i++) {
+        if (dbDelete(ctx->db, argv[i])) {
+            notify(ctx, REDISMODULE_NOTIFY_GENERIC, "del", argv[i]);
+            r->integer++;
+        }
+    }
+}
+
+static void cmdMGet(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    int i;
+
+    if (argc < 2)
+        return cmdError(r, "ERR wrong number of arguments for 'mget' command");
+    replySetArray(r, (size_t)argc - 1);
+    for (i = 1; i < argc; i++) {
+        Entry *e = dbFind(ctx->db, argv[i]);
+        RedisModuleCallReply *el = &r->elements[i - 1];
+        if (e && e->type == REDISMODULE_KEYTYPE_STRING)
+            replySetString(el, REDISMODULE_REPLY_STRING, e->str->ptr, e->str->len);
+        else
+            el->type = REDISMODULE_REPLY_NULL;
+    }
+}
+
+static void cmdPublish(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    (void)ctx;
+    (void)argv;
+    if (argc != 3)
+        return cmdError(r, "ERR wrong number of arguments for 'publish' command");
+    stats.published++;
+    r->type = REDISMODULE_REPLY_INTEGER;
+}
+
+static void cmdDbSize(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    (void)argv;
+    (void)argc;
+    r->type = REDISMODULE_REPLY_INTEGER;
+    r->integer = (long long)dbs[ctx->db].count;
+}
+
+/* The cursor is a bucket index, the table only grows between scans. */
+static void cmdScan(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    Db *db = &dbs[ctx->db];
+    RedisModuleString *pattern = NULL;
+    long long cursor, count = 10;
+    size_t visited = 0, found = 0, cap = 16;
+    RedisModuleString **keys;
+    char buf[24];
+    int i;
+
+    if (argc < 2 || fakeStringToLongLong(argv[1], &cursor) != REDISMODULE_OK || cursor < 0)
+        return cmdError(r, "ERR invalid cursor");
+    for (i = 2; i + 1 < argc; i += 2) {
+        if (argIs(argv[i], "MATCH"))
+            pattern = argv[i + 1];
+        else if (argIs(argv[i], "COUNT") &&
+                 fakeStringToLongLong(argv[i + 1], &count) == REDISMODULE_OK && count >= 1)
+            continue;
+        else
+            return cmdError(r, "ERR syntax error");
+    }
+    if (i != argc)
+        return cmdError(r, "ERR syntax error");
+
+    keys = fakeAlloc(cap * sizeof(*keys));
+    while ((size_t)cursor < db->size && visited < (size_t)count) {
+        Entry *e;
+        for (e = db->buckets[cursor]; e; e = e->next) {
+            visited++;
+            if (pattern && !(pattern->len == 1 && pattern->ptr[0] == '*') &&
+                !globMatch(pattern->ptr, pattern->len, e->name->ptr, e->name->len))
+                continue;
+            if (found == cap)
+                keys = fakeRealloc(keys, (cap *= 2) * sizeof(*keys));
+            keys[found++] = e->name;
+        }
+        cursor++;
+    }
+    if ((size_t)cursor >= db->size)
+        cursor = 0;
+
+    replySetArray(r, 2);
+    replySetString(&r->elements[0], REDISMODULE_REPLY_STRING, buf,
+                   (size_t)snprintf(buf, sizeof(buf), "%lld", cursor));
+    replySetArray(&r->elements[1], found);
+    for (visited = 0; visited < found; visited++)
+        replySetString(&r->elements[1].elements[visited], REDISMODULE_REPLY_STRING,
+                       keys[visited]->ptr, keys[visited]->len);
+    fakeFree(keys);
+}
+
+typedef void (*ServerCommand)(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r);
+
+static const struct {
+    const char *name;
+    ServerCommand run;
+} server_commands[] = {
+    {"set", cmdSet},
+    {"mset", cmdMSet},
+    {"del", cmdDel},
+    {"unlink", cmdDel},
+    {"mget", cmdMGet},
+    {"publish", cmdPublish},
+    {"dbsize", cmdDbSize},
+    {"scan", cmdScan},
+};
+
+static ServerCommand serverCommand(const char *name, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(server_commands) / sizeof(server_commands[0]); i++) {
+        if (strlen(server_commands[i].name) == len && !strncasecmp(server_commands[i].name, name, len))
+            return server_commands[i].run;
+    }
+    return NULL;
+}
+
+static void serverRun(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, RedisModuleCallReply *r)
+{
+    ServerCommand run = serverCommand(argv[0]->ptr, argv[0]->len);
+
+    if (run == NULL)
+        return cmdError(r, "ERR unknown command");
+    run(ctx, argv, argc, r);
+}
+
+/* Formats as in RedisModule_Call: v (argv and count), s (string),
+ * c (C string), l (long long), b (buffer and length), and the flags ! and A
+ * which change nothing here. */
+static int callArgs(RedisModuleString **argv, size_t cap, const char *cmdname, const char *fmt, va_list ap)
+{
+    int argc = 0;
+    const char *p;
+
+    argv[argc++] = stringNew(cmdname, strlen(cmdname));
+    for (p = fmt; *p && (size_t)argc < cap; p++) {
+        if (*p == 's') {
+            argv[argc] = va_arg(ap, RedisModuleString *);
+            stringIncr(argv[argc++]);
+        } else if (*p == 'c') {
+            const char *s = va_arg(ap, const char *);
+            argv[argc++] = stringNew(s, strlen(s));
+        } else if (*p == 'l') {
+            argv[argc++] = fakeCreateStringFromLongLong(NULL, va_arg(ap, long long));
+        } else if (*p == 'b') {
+            const char *buf = va_arg(ap, const char *);
+            size_t len = va_arg(ap, size_t);
+            argv[argc++] = stringNew(buf, len);
+        } else if (*p == 'v') {
+            RedisModuleString **v = va_arg(ap, RedisModuleString **);
+            size_t i, n = va_arg(ap, size_t);
+            for (i = 0; i < n; i++) {
+                if ((size_t)argc == cap)
+                    break;
+                argv[argc] = v[i];
+                stringIncr(argv[argc++]);
+            }
+        }
+    }
+    return argc;
+}
+
+/* The argument vectors of MGET and UNLINK batches ('v' first) may exceed
+ * the fixed vector. */
+static RedisModuleCallReply *fakeCall(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...)
+{
+    RedisModuleString *fixed[FAKE_MAX_ARGS], **argv = fixed;
+    RedisModuleCallReply *reply = fakeCalloc(1, sizeof(*reply));
+    size_t cap = FAKE_MAX_ARGS;
+    va_list ap;
+    int argc, i;
+
+    va_start(ap, fmt);
+    if (fmt[0] == 'v') {
+        va_list aq;
+        va_copy(aq, ap);
+        (void)va_arg(aq, RedisModuleString **);
+        cap = va_arg(aq, size_t) + FAKE_MAX_ARGS;
+        argv = fakeAlloc(cap * sizeof(*argv));
+        va_end(aq);
+    }
+    argc = callArgs(argv, cap, cmdname, fmt, ap);
+    va_end(ap);
+
+    serverRun(ctx, argv, argc, reply);
+    for (i = 0; i < argc; i++)
+        stringDecr(argv[i]);
+    if (argv != fixed)
+        fakeFree(argv);
+    reply->ctx = ctx;
+    autoAdd(ctx, AUTO_REPLY, reply);
+    return reply;
+}
+
+static int fakeReplicate(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...)
+{
+    (void)ctx;
+    (void)cmdname;
+    (void)fmt;
+    return REDISMODULE_OK;
+}
+
+static int fakePublishMessage(RedisModuleCtx *ctx, RedisModuleString *channel, RedisModuleString *message)
+{
+    (void)ctx;
+    (void)channel;
+    (void)message;
+    stats.published++;
+    return 0;
+}
+
+/* ------------------------------- Scan API ------------------------------- */
+
+struct RedisModuleScanCursor {
+    size_t bucket;
+    bool done;
+};
+
+static RedisModuleScanCursor *fakeScanCursorCreate(void)
+{
+    return fakeCalloc(1, sizeof(RedisModuleScanCursor));
+}
+
+static void fakeScanCursorDestroy(RedisModuleScanCursor *cursor)
+{
+    fakeFree(cursor);
+}
+
+/* One bucket per call, with a new key name string per key as the server
+ * creates. */
+static int fakeScan(RedisModuleCtx *ctx, RedisModuleScanCursor *cursor, RedisModuleScanCB fn, void *privdata)
+{
+    Db *db = &dbs[ctx->db];
+    Entry *e;
+
+    while (!cursor->done && cursor->bucket < db->size && db->buckets[cursor->bucket] == NULL)
+        cursor->bucket++;
+    if (cursor->done || cursor->bucket >= db->size) {
+        cursor->done = true;
+        return 0;
+    }
+    for (e = db->buckets[cursor->bucket]; e; e = e->next) {
+        RedisModuleString *name = stringNew(e->name->ptr, e->name->len);
+        fn(ctx, name, NULL, privdata);
+        stringDecr(name);
+    }
+    cursor->bucket++;
+    cursor->done = cursor->bucket >= db->size;
+    return !cursor->done;
+}
+
+/* ------------------------------ Dictionary ------------------------------ */
+
+/* A skip list, which has the order and the logarithmic updates of the radix
+ * tree of the server. */
+#define DICT_MAX_LEVEL 24
+
+typedef struct _DictNode {
+    char *key;
+    size_t len;
+    void *data;
+    int level;
+    struct _DictNode *next[];
+} DictNode;
+
+struct RedisModuleDict {
+    DictNode *head;
+    uint64_t size;
+    int level;
+};
+
+struct RedisModuleDictIter {
+    DictNode *node;
+};
+
+static int dictCmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    int cmp = memcmp(a, b, alen < blen ? alen : blen);
+    if (cmp)
+        return cmp;
+    return alen < blen ? -1 : alen > blen;
+}
+
+static DictNode *dictNodeNew(int level, const void *key, size_t len, void *data)
+{
+    DictNode *node = fakeCalloc(1, sizeof(DictNode) + (size_t)level * sizeof(DictNode *));
+    node->key = fakeAlloc(len ? len : 1);
+    memcpy(node->key, key, len);
+    node->len = len;
+    node->data = data;
+    node->level = level;
+    return node;
+}
+
+static void dictNodeFree(DictNode *node)
+{
+    fakeFree(node->key);
+    fakeFree(node);
+}
+
+/* The last node before 'key' on every level, the head if none. */
+static DictNode *dictSeek(RedisModuleDict *d, const void *key, size_t len, DictNode **update)
+{
+    DictNode *x = d->head;
+    int i;
+
+    for (i = d->level - 1; i >= 0; i--) {
+        while (x->next[i] && dictCmp(x->next[i]->key, x->next[i]->len, key, len) < 0)
+            x = x->next[i];
+        if (update)
+            update[i] = x;
+    }
+    return x;
+}
+
+static int dictRandomLevel(void)
+{
+    static uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    int level = 1;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    while (level < DICT_MAX_LEVEL && (seed >> (level * 2) & 3) == 0)
+        level++;
+    return level;
+}
+
+static RedisModuleDict *fakeCreateDict(RedisModuleCtx *ctx)
+{
+    RedisModuleDict *d = fakeCalloc(1, sizeof(RedisModuleDict));
+
+    (void)ctx;
+    d->head = dictNodeNew(DICT_MAX_LEVEL, "", 0, NULL);
+    d->level = 1;
+    return d;
+}
+
+static void fakeFreeDict(RedisModuleCtx *ctx, RedisModuleDict *d)
+{
+    DictNode *node = d->head;
+
+    (void)ctx;
+    while (node) {
+        DictNode *next = node->next[0];
+        dictNodeFree(node);
+        node = next;
+    }
+    fakeFree(d);
+}
+
+static uint64_t fakeDictSize(RedisModuleDict *d)
+{
+    return d->size;
+}
+
+static int fakeDictSetC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    DictNode *update[DICT_MAX_LEVEL], *node;
+    int i, level;
+
+    node = dictSeek(d, key, keylen, update)->next[0];
+    if (node && !dictCmp(node->key, node->len, key, keylen))
+        return REDISMODULE_ERR;
+    level = dictRandomLevel();
+    for (i = d->level; i < level; i++)
+        update[i] = d->head;
+    if (level > d->level)
+        d->level = level;
+    node = dictNodeNew(level, key, keylen, ptr);
+    for (i = 0; i < level; i++) {
+        node->next[i] = update[i]->next[i];
+        update[i]->next[i] = node;
+    }
+    d->size++;
+    return REDISMODULE_OK;
+}
+
+static int fakeDictDelC(RedisModuleDict *d, void *key, size_t keylen, void *oldval)
+{
+    DictNode *update[DICT_MAX_LEVEL], *node;
+    int i;
+
+    node = dictSeek(d, key, keylen, update)->next[0];
+    if (node == NULL || dictCmp(node->key, node->len, key, keylen))
+        return REDISMODULE_ERR;
+    if (oldval)
+        *(void **)oldval = node->data;
+    for (i = 0; i < node->level; i++)
+        update[i]->next[i] = node->next[i];
+    dictNodeFree(node);
+    d->size--;
+    return REDISMODULE_OK;
+}
+
+static void *fakeDictGetC(RedisModuleDict *d, void *key, size_t keylen, int *nokey)
+{
+    DictNode *update[DICT_MAX_LEVEL], *node;
+    bool missing;
+
+    node = dictSeek(d, key, keylen, update)->next[0];
+    missing = node == NULL || dictCmp(node->key, node->len, key, keylen);
+    if (nokey)
+        *nokey = missing;
+    return missing ? NULL : node->data;
+}
+
+static int fakeDictReplaceC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    DictNode *update[DICT_MAX_LEVEL], *node;
+
+    node = dictSeek(d, key, keylen, update)->next[0];
+    if (node && !dictCmp(node->key, node->len, key, keylen)) {
+        node->data = ptr;
+        return REDISMODULE_OK;
+    }
+    return fakeDictSetC(d, key, keylen, ptr);
+}
+
+/* Only the forward seeks ^ >= > == are used by the module. */
+static RedisModuleDictIter *fakeDictIteratorStartC(RedisModuleDict *d, const char *op, void *key, size_t keylen)
+{
+    RedisModuleDictIter *di = fakeAlloc(sizeof(*di));
+    DictNode *node = NULL;
+
+    if (!strcmp(op, "^")) {
+        node = d->head->next[0];
+    } else if (!strcmp(op, ">=") || !strcmp(op, "==") || !strcmp(op, ">")) {
+        node = dictSeek(d, key, keylen, NULL)->next[0];
+        bool equal = node && !dictCmp(node->key, node->len, key, keylen);
+        if (equal && !strcmp(op, ">"))
+            node = node->next[0];
+        else if (!equal && !strcmp(op, "=="))
+            node = NULL;
+    }
+    di->node = node;
+    return di;
+}
+
+static void fakeDictIteratorStop(RedisModuleDictIter *di)
+{
+    fakeFree(di);
+}
+
+static void *fakeDictNextC(RedisModuleDictIter *di, size_t *keylen, void **dataptr)
+{
+    DictNode *node = di->node;
+
+    if (node == NULL)
+        return NULL;
+    di->node = node->next[0];
+    if (keylen)
+        *keylen = node->len;
+    if (dataptr)
+        *dataptr = node->data;
+    return node->key;
+}
+
+/* -------------------------------- Timers -------------------------------- */
+
+typedef struct _FakeTimer {
+    struct _FakeTimer *next;
+    uint64_t id;
+    mstime_t when;
+    RedisModuleTimerProc callback;
+    void *data;
+} FakeTimer;
+
+static FakeTimer *timers;
+static uint64_t next_timer_id = 1;
+static mstime_t virtual_now;
+
+static uint64_t fakeCreateTimer(RedisModuleCtx *ctx, mstime_t period, RedisModuleTimerProc callback, void *data)
+{
+    FakeTimer *t = fakeAlloc(sizeof(*t));
+
+    (void)ctx;
+    t->id = next_timer_id++;
+    t->when = virtual_now + period;
+    t->callback = callback;
+    t->data = data;
+    t->next = timers;
+    timers = t;
+    return t->id;
+}
+
+static int fakeStopTimer(RedisModuleCtx *ctx, uint64_t id, void **data)
+{
+    FakeTimer **link;
+
+    (void)ctx;
+    for (link = &timers; *link; link = &(*link)->next) {
+        if ((*link)->id == id) {
+            FakeTimer *t = *link;
+            if (data)
+                *data = t->data;
+            *link = t->next;
+            fakeFree(t);
+            return REDISMODULE_OK;
+        }
+    }
+    return REDISMODULE_ERR;
+}
+
+void fakeRedisRunTimers(long long ms)
+{
+    mstime_t end = virtual_now + ms;
+
+    pthread_mutex_lock(&gil);
+    for (;;) {
+        FakeTimer **link, **first = NULL;
+        for (link = &timers; *link; link = &(*link)->next) {
+            if ((*link)->when <= end && (first == NULL || (*link)->when < (*first)->when))
+                first = link;
+        }
+        if (first == NULL)
+            break;
+
+        FakeTimer *t = *first;
+        *first = t->next;
+        if (t->when > virtual_now)
+            virtual_now = t->when;
+        RedisModuleCtx ctx;
+        ctxInit(&ctx, 0, NULL);
+        t->callback(&ctx, t->data);
+        ctxFree(&ctx);
+        fakeFree(t);
+    }
+    virtual_now = end;
+    pthread_mutex_unlock(&gil);
+}
+
+/* --------------------------- Blocked clients ---------------------------- */
+
+static RedisModuleBlockedClient *fakeBlockClient(RedisModuleCtx *ctx, RedisModuleCmdFunc reply_callback,
+                                                 RedisModuleCmdFunc timeout_callback,
+                                                 void (*free_privdata)(RedisModuleCtx*,void*),
+                                                 long long timeout_ms)
+{
+    (void)reply_callback;
+    (void)timeout_callback;
+    (void)free_privdata;
+    (void)timeout_ms;
+    RedisModuleBlockedClient *bc = fakeCalloc(1, sizeof(*bc));
+    bc->db = ctx->db;
+    ctx->blocked = bc;
+    return bc;
+}
+
+static void blockedFree(RedisModuleBlockedClient *bc)
+{
+    fakeFree(bc->client.buf);
+    fakeFree(bc);
+}
+
+static int fakeAbortBlock(RedisModuleBlockedClient *bc)
+{
+    blockedFree(bc);
+    return REDISMODULE_OK;
+}
+
+static int fakeUnblockClient(RedisModuleBlockedClient *bc, void *privdata)
+{
+    (void)privdata;
+    pthread_mutex_lock(&unblock_lock);
+    bc->unblocked = true;
+    pthread_cond_broadcast(&unblock_cond);
+    pthread_mutex_unlock(&unblock_lock);
+    return REDISMODULE_OK;
+}
+
+static RedisModuleCtx *fakeGetThreadSafeContext(RedisModuleBlockedClient *bc)
+{
+    RedisModuleCtx *ctx = fakeAlloc(sizeof(*ctx));
+    ctxInit(ctx, bc ? bc->db : 0, bc ? &bc->client : NULL);
+    return ctx;
+}
+
+static void fakeFreeThreadSafeContext(RedisModuleCtx *ctx)
+{
+    ctxFree(ctx);
+    fakeFree(ctx);
+}
+
+static void fakeThreadSafeContextLock(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    pthread_mutex_lock(&gil);
+}
+
+static void fakeThreadSafeContextUnlock(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    pthread_mutex_unlock(&gil);
+}
+
+/* ---------------------------- Command filter ---------------------------- */
+
+/* Registered but never run, the benchmarks use no filtered commands. */
+static RedisModuleCommandFilter *fakeRegisterCommandFilter(RedisModuleCtx *ctx, RedisModuleCommandFilterFunc cb, int flags)
+{
+    static int filter;
+    (void)ctx;
+    (void)cb;
+    (void)flags;
+    return (RedisModuleCommandFilter *)&filter;
+}
+
+static int fakeCommandFilterArgsCount(RedisModuleCommandFilterCtx *fctx)
+{
+    (void)fctx;
+    return 0;
+}
+
+static const RedisModuleString *fakeCommandFilterArgGet(RedisModuleCommandFilterCtx *fctx, int pos)
+{
+    (void)fctx;
+    (void)pos;
+    return NULL;
+}
+
+/* -------------------------------- Module -------------------------------- */
+
+typedef struct _ModuleCommand {
+    char *name;
+    RedisModuleCmdFunc run;
+} ModuleCommand;
+
+static ModuleCommand *module_commands;
+static size_t nmodule_commands;
+
+static int fakeCreateCommand(RedisModuleCtx *ctx, const char *name, RedisModuleCmdFunc cmdfunc,
+                             const char *strflags, int firstkey, int lastkey, int keystep)
+{
+    (void)ctx;
+    (void)strflags;
+    (void)firstkey;
+    (void)lastkey;
+    (void)keystep;
+    module_commands = fakeRealloc(module_commands, (nmodule_commands + 1) * sizeof(ModuleCommand));
+    module_commands[nmodule_commands].name = fakeStrdup(name);
+    module_commands[nmodule_commands].run = cmdfunc;
+    nmodule_commands++;
+    return REDISMODULE_OK;
+}
+
+static void fakeSetModuleAttribs(RedisModuleCtx *ctx, const char *name, int ver, int apiver)
+{
+    (void)ctx;
+    (void)name;
+    (void)ver;
+    (void)apiver;
+}
+
+size_t fakeRedisCommandCount(void)
+{
+    return nmodule_commands;
+}
+
+const char *fakeRedisCommandName(size_t i)
+{
+    return i < nmodule_commands ? module_commands[i].name : NULL;
+}
+
+static RedisModuleCmdFunc moduleCommand(const char *name, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < nmodule_commands; i++) {
+        if (strlen(module_commands[i].name) == len && !strncasecmp(module_commands[i].name, name, len))
+            return module_commands[i].run;
+    }
+    return NULL;
+}
+
+#define API(name) {"RedisModule_" #name, (void *)(unsigned long)fake ## name}
+
+static const struct {
+    const char *name;
+    void *func;
+} api[] = {
+    API(Alloc), API(Calloc), API(Free), API(Realloc), API(Strdup),
+    API(CreateCommand), API(SetModuleAttribs), API(WrongArity),
+    API(ReplyWithLongLong), API(ReplyWithError), API(ReplyWithSimpleString),
+    API(ReplyWithArray), API(ReplySetArrayLength), API(ReplyWithStringBuffer),
+    API(ReplyWithCString), API(ReplyWithString), API(ReplyWithNull),
+    API(ReplyWithCallReply), API(GetSelectedDb), API(SelectDb),
+    API(OpenKey), API(CloseKey), API(KeyType), API(Call), API(CallReplyType),
+    API(CallReplyInteger), API(CallReplyLength), API(CallReplyArrayElement),
+    API(CallReplyStringPtr), API(CreateStringFromCallReply), API(FreeCallReply),
+    API(CreateString), API(CreateStringFromLongLong), API(CreateStringFromString),
+    API(FreeString), API(StringPtrLen), API(StringToLongLong), API(AutoMemory),
+    API(Replicate), API(UnlinkKey), API(StringDMA), API(StringSet), API(SetExpire),
+    API(CreateDataType), API(ModuleTypeSetValue), API(ModuleTypeGetType),
+    API(ModuleTypeGetValue), API(BlockClient), API(UnblockClient), API(AbortBlock),
+    API(GetThreadSafeContext), API(FreeThreadSafeContext),
+    API(ThreadSafeContextLock), API(ThreadSafeContextUnlock),
+    API(NotifyKeyspaceEvent), API(SubscribeToKeyspaceEvents), API(GetContextFlags),
+    API(IsKeysPositionRequest), API(KeyAtPos),
+    API(CreateTimer), API(StopTimer), API(CreateDict), API(FreeDict), API(DictSize),
+    API(DictSetC), API(DictDelC), API(DictGetC), API(DictReplaceC),
+    API(DictIteratorStartC), API(DictIteratorStop), API(DictNextC),
+    API(RegisterCommandFilter), API(CommandFilterArgsCount),
+    API(CommandFilterArgGet), API(RetainString), API(ScanCursorCreate),
+    API(ScanCursorDestroy), API(Scan), API(PublishMessage),
+};
+
+static int fakeGetApi(const char *name, void *ptr)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(api) / sizeof(api[0]); i++) {
+        if (!strcmp(api[i].name, name)) {
+            *(void **)ptr = api[i].func;
+            return REDISMODULE_OK;
+        }
+    }
+    return REDISMODULE_ERR;
+}
+
+int fakeRedisLoad(int argc, const char **argv)
+{
+    RedisModuleString *args[FAKE_MAX_ARGS];
+    RedisModuleCtx ctx;
+    int i, ret;
+
+    if (argc > FAKE_MAX_ARGS)
+        return REDISMODULE_ERR;
+    for (i = 0; i < argc; i++)
+        args[i] = stringNew(argv[i], strlen(argv[i]));
+    ctxInit(&ctx, 0, NULL);
+    pthread_mutex_lock(&gil);
+    ret = RedisModule_OnLoad(&ctx, args, argc);
+    ctxFree(&ctx);
+    pthread_mutex_unlock(&gil);
+    for (i = 0; i < argc; i++)
+        stringDecr(args[i]);
+    return ret;
+}
+
+static FakeClient client;
+
+const char *fakeRedisRun(int argc, const char **argv, const size_t *argvlen, size_t *replylen)
+{
+    RedisModuleString **args;
+    RedisModuleCmdFunc run;
+    RedisModuleCtx ctx;
+    int i;
+
+    if (argc < 1)
+        return NULL;
+    run = moduleCommand(argv[0], argvlen[0]);
+    if (run == NULL && serverCommand(argv[0], argvlen[0]) == NULL)
+        return NULL;
+
+    args = fakeAlloc((size_t)argc * sizeof(*args));
+    for (i = 0; i < argc; i++)
+        args[i] = stringNew(argv[i], argvlen[i]);
+    client.len = 0;
+    client.npostponed = 0;
+    ctxInit(&ctx, 0, &client);
+
+    pthread_mutex_lock(&gil);
+    if (run) {
+        ctx.cmdname = argv[0];
+        run(&ctx, args, argc);
+    } else {
+        RedisModuleCallReply reply;
+        memset(&reply, 0, sizeof(reply));
+        serverRun(&ctx, args, argc, &reply);
+        replyWrite(&client, &reply);
+        replyFreeContent(&reply);
+    }
+    ctxFree(&ctx);
+
+    /* The argument vector stays with the client while it is blocked */
+    if (ctx.blocked) {
+        RedisModuleBlockedClient *bc = ctx.blocked;
+        pthread_mutex_unlock(&gil);
+        pthread_mutex_lock(&unblock_lock);
+        while (!bc->unblocked)
+            pthread_cond_wait(&unblock_cond, &unblock_lock);
+        pthread_mutex_unlock(&unblock_lock);
+        pthread_mutex_lock(&gil);
+        clientAppend(&client, bc->client.buf, bc->client.len);
+        blockedFree(bc);
+    }
+    pthread_mutex_unlock(&gil);
+
+    for (i = 0; i < argc; i++)
+        stringDecr(args[i]);
+    fakeFree(args);
+    *replylen = client.len;
+    return client.buf;
+}
+
+void fakeRedisGetStats(FakeRedisStats *out)
+{
+    out->allocs = __atomic_load_n(&stats.allocs, __ATOMIC_RELAXED);
+    out->published = stats.published;
+    out->notified = stats.notified;
+}
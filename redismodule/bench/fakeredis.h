@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef FAKEREDIS_H
+#define FAKEREDIS_H
+
+#include <stddef.h>
+
+/* In-process stand-in of a Redis server for benchmarking the module: a hash
+ * table keyspace per database, the commands the module runs with
+ * RedisModule_Call, and the part of the module API that exstrings.c uses,
+ * with every allocation counted. The module is linked in and loaded through
+ * its RedisModule_OnLoad like a real server does, so optional APIs are
+ * detected the same way.
+ *
+ * Commands and timers run on the calling thread, which plays the main thread
+ * of the server and holds the lock of the thread safe contexts meanwhile. */
+
+typedef struct _FakeRedisStats {
+    unsigned long long allocs;      /* every allocation, module and server */
+    unsigned long long published;   /* pub/sub messages */
+    unsigned long long notified;    /* keyspace notifications */
+} FakeRedisStats;
+
+/* Loads the module with the given module arguments. */
+int fakeRedisLoad(int argc, const char **argv);
+
+/* The commands the module registered. */
+size_t fakeRedisCommandCount(void);
+const char *fakeRedisCommandName(size_t i);
+
+/* Runs a module command or a server command as a client would, including
+ * the wait for a client that the command blocked. Returns the RESP reply,
+ * valid until the next call, or NULL for an unknown command. */
+const char *fakeRedisRun(int argc, const char **argv, const size_t *argvlen, size_t *replylen);
+
+/* Runs the timers due within 'ms' milliseconds of virtual time. */
+void fakeRedisRunTimers(long long ms);
+
+void fakeRedisGetStats(FakeRedisStats *stats);
+size_t fakeRedisDbSize(int db);
+
+#endif
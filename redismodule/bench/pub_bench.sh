@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# Copyright (c) 2018-2020 Nokia.
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+
+#
+# This source code is part of the near-RT RIC (RAN Intelligent Controller)
+# platform project (RICP).
+#
+
+#
+# Benchmark of the publish step of the *PUB commands: MSETMPUB with 1 to 64
+# channels per command, with the module publishing through the publish API
+# of the server (NATIVEPUBLISH yes) and through PUBLISH calls
+# (NATIVEPUBLISH no). A pattern subscriber receives every message.
+#
+# Needs redis-server, redis-cli and redis-benchmark of Redis 6 or newer.
+#
+# Usage: pub_bench.sh [module_path] [requests_per_run]
+
+MODULE=${1:-.libs/libredismodule.so}
+REQUESTS=${2:-100000}
+PORT=${PUB_BENCH_PORT:-6390}
+
+if [ ! -f "$MODULE" ]; then
+    echo "module $MODULE not found" >&2
+    exit 1
+fi
+MODULE=$(cd "$(dirname "$MODULE")" && pwd)/$(basename "$MODULE")
+
+run_server() {
+    redis-server --port "$PORT" --save "" --appendonly no \
+        --loadmodule "$MODULE" NATIVEPUBLISH "$1" >/dev/null &
+    SERVER=$!
+    until redis-cli -p "$PORT" ping >/dev/null 2>&1; do
+        sleep 0.1
+    done
+    redis-cli -p "$PORT" psubscribe 'ch*' >/dev/null &
+    SUBSCRIBER=$!
+}
+
+stop_server() {
+    kill "$SUBSCRIBER" 2>/dev/null
+    redis-cli -p "$PORT" shutdown nosave >/dev/null 2>&1
+    wait "$SERVER" 2>/dev/null
+}
+
+printf "%8s %16s %16s\n" "channels" "native ops/s" "PUBLISH ops/s"
+for channels in 1 2 4 8 16 32 64; do
+    args="MSETMPUB 1 $channels key value"
+    i=0
+    while [ $i -lt "$channels" ]; do
+        args="$args ch$i message$i"
+        i=$((i + 1))
+    done
+    for native in yes no; do
+        run_server $native
+        # shellcheck disable=SC2086
+        ops=$(redis-benchmark -p "$PORT" -n "$REQUESTS" -c 8 -q $args |
+              sed -n 's/.*: \([0-9.]*\) requests per second.*/\1/p' | tail -1)
+        stop_server
+        eval "ops_$native=\$ops"
+    done
+    printf "%8d %16s %16s\n" "$channels" "$ops_yes" "$ops_no"
+done
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+/*
+ * Microbenchmark of the IE/NE value comparison: valueEqual() against the
+ * strncmp() it replaced and bare memcmp(), for equal values (the worst case,
+ * every byte is read) from 16 B to 1 MB.
+ *
+ * Usage: valuecmp_bench [bytes_compared_per_size]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "valuecmp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_SIZE 16
+#define MAX_SIZE (1024 * 1024)
+#define DEF_TOTAL_BYTES (1024LL * 1024 * 1024)
+
+typedef int (*CompareFunc)(const char *a, size_t alen, const char *b, size_t blen);
+
+static int cmpValueEqual(const char *a, size_t alen, const char *b, size_t blen)
+{
+    return valueEqual(a, alen, b, blen);
+}
+
+static int cmpStrncmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    return alen == blen && !strncmp(a, b, alen);
+}
+
+static int cmpMemcmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    return alen == blen && !memcmp(a, b, alen);
+}
+
+static double nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double runOne(CompareFunc f, const char *a, const char *b, size_t len, long long iters)
+{
+    volatile int sink = 0;
+    long long i;
+    double start = nowNs();
+    for (i = 0; i < iters; i++)
+        sink += f(a, len, b, len);
+    double elapsed = nowNs() - start;
+    if (sink != iters) {
+        fprintf(stderr, "comparison failed for size %zu\n", len);
+        exit(1);
+    }
+    return elapsed / iters;
+}
+
+int main(int argc, char **argv)
+{
+    long long total = argc > 1 ? atoll(argv[1]) : DEF_TOTAL_BYTES;
+    char *a = malloc(MAX_SIZE + 1), *b = malloc(MAX_SIZE + 1);
+    size_t i, len;
+
+    if (!a || !b || total <= 0)
+        return 1;
+
+    /* No NUL bytes, so that strncmp reads the whole value too. The second
+     * buffer is offset by one byte to include unaligned loads. */
+    for (i = 0; i < MAX_SIZE; i++)
+        a[i] = 'a' + (char)(i % 26);
+    memcpy(b + 1, a, MAX_SIZE);
+
+    printf("%10s %14s %14s %14s %12s\n", "size", "valueEqual ns", "strncmp ns", "memcmp ns", "valueEqual GB/s");
+    for (len = MIN_SIZE; len <= MAX_SIZE; len *= 4) {
+        long long iters = total / (long long)len;
+        if (iters < 16)
+            iters = 16;
+        double ve = runOne(cmpValueEqual, a, b + 1, len, iters);
+        double sn = runOne(cmpStrncmp, a, b + 1, len, iters);
+        double mc = runOne(cmpMemcmp, a, b + 1, len, iters);
+        printf("%10zu %14.1f %14.1f %14.1f %12.2f\n", len, ve, sn, mc, len / ve);
+    }
+
+    free(a);
+    free(b);
+    return 0;
+}
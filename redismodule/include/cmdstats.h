@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#ifndef CMDSTATS_H
+#define CMDSTATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Latency histogram with 4 buckets per power of two nanoseconds, i.e. the
+ * bucket of a latency is at most 25% wider than the latency. The last bucket
+ * also takes everything over 2^41 ns, about 36 minutes. */
+#define CMDSTATS_BUCKETS 160
+
+/* Counters of one command. There is no locking: a thread records only into
+ * counters of its own, or under a lock shared with their readers. */
+typedef struct _CmdStats {
+    uint64_t calls;
+    uint64_t errors;        /* error replies */
+    uint64_t hits;          /* key conditions met */
+    uint64_t misses;        /* key conditions not met */
+    uint64_t keys;          /* keys read or written */
+    uint64_t ns;            /* total latency */
+    uint64_t latency[CMDSTATS_BUCKETS];
+} CmdStats;
+
+/* Counts of a call in progress. */
+typedef struct _CmdStatsCall {
+    uint64_t errors;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t keys;
+} CmdStatsCall;
+
+/* Histogram bucket of a latency and the largest latency of a bucket. */
+int cmdStatsBucket(uint64_t ns);
+uint64_t cmdStatsBucketMax(int bucket);
+
+/* Counts a call that took 'ns' nanoseconds. */
+void cmdStatsRecord(CmdStats *stats, const CmdStatsCall *call, uint64_t ns);
+
+/* Adds the counters of 'other' to 'stats'. */
+void cmdStatsMerge(CmdStats *stats, const CmdStats *other);
+
+/* Upper bounds of the latency of the given fractions of the calls, e.g. 0.99
+ * for the 99th percentile, 0 when there are no calls. The fractions must be
+ * in ascending order. */
+void cmdStatsPercentiles(const CmdStats *stats, const double *fractions, uint64_t *values,
+                         int count);
+
+void cmdStatsReset(CmdStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef GLOBMATCH_H
+#define GLOBMATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Binary safe glob-style matching with the syntax of the SCAN MATCH option:
+ * '*', '?', '[...]' with '^' negation and 'a-z' ranges, and '\' escapes. */
+bool globMatch(const char *pattern, size_t patternlen, const char *str, size_t stringlen);
+
+/* Patterns that need no glob matching, which is most of them: SDL clients
+ * send "{ns},*" and "{ns},prefix*". */
+typedef enum _GlobKind {
+    GLOB_GENERIC = 0,       /* matched with globMatch */
+    GLOB_ANY,               /* "*", also the empty key as with SCAN MATCH */
+    GLOB_PREFIX,            /* a literal prefix and one trailing '*' */
+    GLOB_EXACT              /* no wildcards */
+} GlobKind;
+
+typedef struct _GlobPattern {
+    GlobKind kind;
+    const char *pattern;
+    size_t patternlen;
+    char *literal;          /* unescaped prefix up to the first wildcard, the
+                             * whole key of GLOB_EXACT */
+    size_t literallen;
+} GlobPattern;
+
+/* Classifies 'pattern', which is not copied. 'literal' must hold
+ * 'patternlen' bytes. */
+void globCompile(GlobPattern *glob, const char *pattern, size_t patternlen, char *literal);
+
+/* Same result as globMatch, with a memcmp in place of the matcher for all
+ * but GLOB_GENERIC. Inline for the per key loops of the scans. */
+static inline bool globPatternMatch(const GlobPattern *glob, const char *str, size_t stringlen)
+{
+    switch (glob->kind) {
+    case GLOB_ANY:
+        return true;
+    case GLOB_PREFIX:
+        return stringlen >= glob->literallen && !memcmp(str, glob->literal, glob->literallen);
+    case GLOB_EXACT:
+        return stringlen == glob->literallen && !memcmp(str, glob->literal, stringlen);
+    default:
+        return globMatch(glob->pattern, glob->patternlen, str, stringlen);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
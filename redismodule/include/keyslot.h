@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef KEYSLOT_H
+#define KEYSLOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "globmatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KEYSLOT_COUNT 16384
+
+/* CRC16 of Redis Cluster, the XMODEM variant. */
+uint16_t crc16(const char *buf, size_t len);
+
+/* The hash slot of 'key' as Redis Cluster computes it: only the part between
+ * the first '{' and the next '}' is hashed when it is not empty. */
+int keyHashSlot(const char *key, size_t keylen);
+
+/* The hash slot of every key that 'glob' matches, or -1 when the keys can be
+ * in any slot. That is the case unless the literal prefix of the pattern
+ * holds a whole hash tag, like "{ns}," of the SDL patterns, or the pattern
+ * is an exact key. */
+int globHashSlot(const GlobPattern *glob);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
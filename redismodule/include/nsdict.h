@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef NSDICT_H
+#define NSDICT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Field to value table of one namespace: open addressing with linear
+ * probing in a flat array of 24 byte slots, so that a lookup compares the
+ * hashes of neighbouring slots without following pointers. The field and
+ * the value of an entry share one allocation. Deletion shifts the following
+ * entries back instead of leaving tombstones. */
+typedef struct _NsEntry {
+    uint64_t hash;
+    uint32_t fieldlen;
+    uint32_t valuelen;
+    char *data;             /* field then value, NULL for a free slot */
+} NsEntry;
+
+typedef struct _NsDict {
+    NsEntry *table;
+    size_t size;            /* slots, a power of two, or 0 */
+    size_t len;             /* entries */
+    size_t bytes;           /* of the fields and values */
+} NsDict;
+
+/* The allocator and the hash seed of all tables, malloc and 0 by default.
+ * Set before any table is created. */
+void nsDictConfigure(void *(*alloc)(size_t), void (*dealloc)(void *), uint64_t seed);
+
+void nsDictInit(NsDict *d);
+
+/* Frees the entries and the table, leaving an empty table. */
+void nsDictClear(NsDict *d);
+
+/* Makes room for 'len' entries without resizing. False when out of memory. */
+bool nsDictReserve(NsDict *d, size_t len);
+
+NsEntry *nsDictFind(const NsDict *d, const char *field, size_t fieldlen);
+
+/* Returns 1 when the field was added, 0 when its value was replaced and -1
+ * when out of memory or a length does not fit in 32 bits. */
+int nsDictSet(NsDict *d, const char *field, size_t fieldlen, const char *value, size_t valuelen);
+
+/* False when there is no such field. */
+bool nsDictDelete(NsDict *d, const char *field, size_t fieldlen);
+
+/* The entry at or after slot '*pos', which is then moved past it. NULL at
+ * the end. Start with '*pos' 0; the table must not change meanwhile. */
+NsEntry *nsDictNext(const NsDict *d, size_t *pos);
+
+/* Bytes used by the table and the entries, not counting 'd' itself. */
+size_t nsDictMemUsage(const NsDict *d);
+
+static inline const char *nsEntryField(const NsEntry *e)
+{
+    return e->data;
+}
+
+static inline const char *nsEntryValue(const NsEntry *e)
+{
+    return e->data + e->fieldlen;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef NSSTATS_H
+#define NSSTATS_H
+
+#include "nsdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Value sizes are counted in buckets of powers of 4: below 64 bytes, below
+ * 256, and so on up to 256 KB and over. */
+#define NSSTATS_BUCKETS 8
+
+/* Counters of one namespace. */
+typedef struct _NsCounters {
+    long long keys;
+    long long bytes;                    /* of the values */
+    long long sizes[NSSTATS_BUCKETS];   /* keys by value size */
+} NsCounters;
+
+/* Namespace to counters table, kept in an NsDict whose values are the
+ * NsCounters. Namespaces are dropped when their last key is. */
+typedef struct _NsStats {
+    NsDict names;
+} NsStats;
+
+void nsStatsInit(NsStats *s);
+
+void nsStatsClear(NsStats *s);
+
+/* The namespace of a key named "{ns},key", as SDL names them. False for
+ * other keys. */
+bool nsStatsKeyNamespace(const char *key, size_t keylen, const char **ns, size_t *nslen);
+
+/* Bucket of a value of 'size' bytes. */
+size_t nsStatsBucket(long long size);
+
+/* Accounts a key of the namespace changing from 'oldsize' to 'newsize'
+ * bytes, -1 for a key that did not or does not exist. False when out of
+ * memory. */
+bool nsStatsChange(NsStats *s, const char *ns, size_t nslen, long long oldsize, long long newsize);
+
+/* False when the namespace has no keys. */
+bool nsStatsGet(const NsStats *s, const char *ns, size_t nslen, NsCounters *counters);
+
+/* The counters of a namespace as returned by nsStatsTop. */
+void nsStatsCounters(const NsEntry *e, NsCounters *counters);
+
+/* The up to 'n' namespaces with the most bytes, most first, into 'top'.
+ * Returns how many there are. One pass over the namespaces, in which a
+ * namespace smaller than the n'th so far costs one comparison. */
+size_t nsStatsTop(const NsStats *s, const NsEntry **top, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#ifndef PUBFRAME_H
+#define PUBFRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A packed frame carries several messages of one channel in one message:
+ *
+ *   "\x1eMPUB" <count> ":" ( <length> ":" <bytes> ){count}
+ *
+ * with <count> and <length> in decimal ASCII. The README describes the
+ * format for subscribers. */
+#define PUBFRAME_MAGIC "\x1eMPUB"
+#define PUBFRAME_MAGIC_LEN 5
+
+/* Upper bound of the size of a frame of 'count' messages of 'total' bytes. */
+size_t pubFrameMaxSize(size_t count, size_t total);
+
+/* Write the frame header and the messages, each returns the end. */
+char *pubFrameStart(char *p, size_t count);
+char *pubFrameAppend(char *p, const char *msg, size_t len);
+
+typedef struct _PubFrameReader {
+    const char *p;
+    const char *end;
+    size_t left;
+} PubFrameReader;
+
+/* Reads the header of a frame, false if 'msg' is not a well formed header. */
+bool pubFrameOpen(PubFrameReader *reader, const char *msg, size_t len);
+
+/* Next message of the frame, false at the end or on a truncated frame. */
+bool pubFrameNext(PubFrameReader *reader, const char **msg, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
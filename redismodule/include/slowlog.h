@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#ifndef SLOWLOG_H
+#define SLOWLOG_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longer patterns are cut. */
+#define SLOWLOG_PATTERN_MAX 128
+
+/* One slow execution of a command that walks the keyspace. */
+typedef struct _SlowLogEntry {
+    long long id;
+    long long time;         /* unix time of the end */
+    int cmd;
+    int db;
+    char pattern[SLOWLOG_PATTERN_MAX];
+    size_t patternlen;
+    long long scanned;      /* keys visited */
+    long long matched;      /* keys that matched the pattern */
+    long long iterations;   /* batches */
+    long long lock_us;      /* time the keyspace was locked */
+    long long wall_us;
+} SlowLogEntry;
+
+/* Ring of the newest entries, in memory given by the caller. There is no
+ * locking, like in CmdStats. */
+typedef struct _SlowLog {
+    SlowLogEntry *entries;
+    size_t size;
+    size_t len;
+    size_t head;            /* index of the next entry */
+    long long next_id;
+} SlowLog;
+
+void slowLogInit(SlowLog *log, SlowLogEntry *entries, size_t size);
+
+/* A new entry with its id and pattern set, in place of the oldest one when
+ * the ring is full. NULL when the ring has no room at all. */
+SlowLogEntry *slowLogAdd(SlowLog *log, const char *pattern, size_t patternlen);
+
+/* The 'i'th newest entry, NULL when there are not that many. */
+const SlowLogEntry *slowLogGet(const SlowLog *log, size_t i);
+
+/* Drops the entries. The ids of the new ones go on from the old ones. */
+void slowLogReset(SlowLog *log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
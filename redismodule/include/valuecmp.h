@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef VALUECMP_H
+#define VALUECMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Binary safe equality of two values. Lengths are compared first, so values
+ * that differ in length are never read. The bytes are compared with memcmp,
+ * which libc implements with the widest vector loads the CPU supports;
+ * bench/valuecmp_bench.c measures it against strncmp. */
+bool valueEqual(const void *a, size_t alen, const void *b, size_t blen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef VALUECODEC_H
+#define VALUECODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Values written by the compressing commands start with a 7 byte header: the
+ * magic bytes, the method and a 4 byte check, the low half of the xxhash64 of
+ * what follows the header seeded with the method, little endian. Compressed
+ * values carry the decoded length as 4 more bytes, little endian, followed by
+ * the LZF stream; other values follow the header as they are. A header is
+ * only honoured when its check matches, so a value written by plain SET that
+ * happens to start with the magic bytes reads back as it is. */
+#define VALUECODEC_MAGIC0      0xc5
+#define VALUECODEC_MAGIC1      0x5a
+#define VALUECODEC_RAW         0
+#define VALUECODEC_LZF         1
+#define VALUECODEC_HEADER_LEN  7
+#define VALUECODEC_LZF_HEADER_LEN (VALUECODEC_HEADER_LEN + 4)
+
+/* Room needed by valueEncode for a value of 'len' bytes. */
+size_t valueEncodeBound(size_t len);
+
+/* Encodes 'len' bytes of 'val' into 'out', compressed if 'len' is at least
+ * 'minlen' and compressing saves space. Returns the encoded length. */
+size_t valueEncode(const char *val, size_t len, size_t minlen, char *out, bool *compressed);
+
+/* The stored bytes of a value that is not compressed, header skipped, or
+ * NULL for a compressed value. Values without a valid header are returned
+ * as they are. */
+const char *valueRaw(const char *val, size_t len, size_t *rawlen);
+
+/* Length of a compressed value once decoded, 0 if the header claims more
+ * than its stream can hold. */
+size_t valueDecodedLen(const char *val, size_t len);
+
+/* Decompresses a compressed value into 'out' of valueDecodedLen bytes.
+ * False if the stream is corrupt. */
+bool valueDecode(const char *val, size_t len, char *out);
+
+/* LZF compression of 'inlen' bytes into at most 'outcap' bytes. Returns the
+ * compressed length, or 0 if it does not fit. The format is that of liblzf:
+ * runs of 1 to 32 literals and back references of 3 to 264 bytes up to 8 KB
+ * back, which decode with byte copies only. */
+size_t lzfCompress(const void *in, size_t inlen, void *out, size_t outcap);
+
+/* Decodes exactly 'outlen' bytes, false if the stream does not. */
+bool lzfDecompress(const void *in, size_t inlen, void *out, size_t outlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
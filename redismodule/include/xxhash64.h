@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Length of a digest formatted as hex, without the terminating NUL. */
+#define XXHASH64_HEX_LEN 16
+
+/* XXH64 of 'len' bytes at 'input', compatible with the reference xxHash
+ * implementation so that clients can compute the same digest. */
+uint64_t xxhash64(const void *input, size_t len, uint64_t seed);
+
+/* Writes 'hash' as XXHASH64_HEX_LEN lower case hex digits and a NUL. */
+void xxhash64ToHex(uint64_t hash, char *buf);
+
+/* Parses exactly XXHASH64_HEX_LEN hex digits of either case. */
+bool xxhash64FromHex(const char *str, size_t len, uint64_t *hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
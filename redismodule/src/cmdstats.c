@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#include "cmdstats.h"
+#include <string.h>
+
+int cmdStatsBucket(uint64_t ns)
+{
+    if (ns < 4)
+        return (int)ns;
+
+    int msb = 63 - __builtin_clzll(ns);
+    int bucket = (msb - 1) * 4 + (int)((ns >> (msb - 2)) & 3);
+    return bucket < CMDSTATS_BUCKETS ? bucket : CMDSTATS_BUCKETS - 1;
+}
+
+uint64_t cmdStatsBucketMax(int bucket)
+{
+    if (bucket < 4)
+        return (uint64_t)bucket;
+    if (bucket >= CMDSTATS_BUCKETS - 1)
+        return UINT64_MAX;
+
+    int msb = bucket / 4 + 1;
+    uint64_t width = (uint64_t)1 << (msb - 2);
+    return ((uint64_t)1 << msb) + (uint64_t)(bucket % 4) * width + width - 1;
+}
+
+void cmdStatsRecord(CmdStats *stats, const CmdStatsCall *call, uint64_t ns)
+{
+    stats->calls++;
+    stats->errors += call->errors;
+    stats->hits += call->hits;
+    stats->misses += call->misses;
+    stats->keys += call->keys;
+    stats->ns += ns;
+    stats->latency[cmdStatsBucket(ns)]++;
+}
+
+void cmdStatsMerge(CmdStats *stats, const CmdStats *other)
+{
+    int i;
+
+    stats->calls += other->calls;
+    stats->errors += other->errors;
+    stats->hits += other->hits;
+    stats->misses += other->misses;
+    stats->keys += other->keys;
+    stats->ns += other->ns;
+    for (i = 0; i < CMDSTATS_BUCKETS; i++)
+        stats->latency[i] += other->latency[i];
+}
+
+void cmdStatsPercentiles(const CmdStats *stats, const double *fractions, uint64_t *values,
+                         int count)
+{
+    uint64_t seen = 0, rank;
+    int i = 0, j;
+
+    for (j = 0; j < count; j++) {
+        if (stats->calls == 0) {
+            values[j] = 0;
+            continue;
+        }
+        /* The rank of the call at the percentile, counting from 1. */
+        rank = (uint64_t)(fractions[j] * (double)stats->calls);
+        if ((double)rank < fractions[j] * (double)stats->calls)
+            rank++;
+        if (rank < 1)
+            rank = 1;
+
+        while (i < CMDSTATS_BUCKETS - 1 && seen + stats->latency[i] < rank)
+            seen += stats->latency[i++];
+        values[j] = cmdStatsBucketMax(i);
+    }
+}
+
+void cmdStatsReset(CmdStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
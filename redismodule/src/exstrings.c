@@ -19,12 +19,27 @@
  * platform project (RICP).
  */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include "redismodule.h"
+#include "cmdstats.h"
+#include "globmatch.h"
+#include "keyslot.h"
+#include "nsdict.h"
+#include "nsstats.h"
+#include "pubframe.h"
+#include "slowlog.h"
+#include "valuecmp.h"
+#include "valuecodec.h"
+#include "xxhash64.h"
+#include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 
 #ifdef __UT__
 #include "exstringsStub.h"
@@ -36,8 +51,9 @@
 sends the error to the client and exit the current function if its */
 #define  ASSERT_NOERROR(r) \
     if (r == NULL) { \
-        return RedisModule_ReplyWithError(ctx,"ERR reply is NULL"); \
+        return replyWithError(ctx,"ERR reply is NULL"); \
     } else if (RedisModule_CallReplyType(r) == REDISMODULE_REPLY_ERROR) { \
+        cmdStatsError(); \
         return RedisModule_ReplyWithCallReply(ctx,r); \
     }
 
@@ -46,18 +62,212 @@ sends the error to the client and exit the current function if its */
 #define OBJ_OP_NX (1<<2)     /* OP if key not exist */
 #define OBJ_OP_IE (1<<4)     /* OP if equal old value */
 #define OBJ_OP_NE (1<<5)     /* OP if not equal old value */
+#define OBJ_OP_RETURNCURRENT (1<<6) /* Reply current value if OP not done */
+#define OBJ_OP_DIGEST (1<<7) /* Old value given as its xxh64 digest */
+#define OBJ_OP_COMPRESS (1<<8) /* Value stored compressed, see CSET */
 
 #define DEF_COUNT     50
 #define ZERO          0
 #define MATCH_STR     "MATCH"
 #define COUNT_STR     "COUNT"
 #define SCANARGC      5
+#define RETURNCURRENT_STR "RETURNCURRENT"
+#define MAXBYTES_STR  "MAXBYTES"
+#define NSCAN_INDEX_CURSOR 'i'
+#define NSCAN_STEP_KEY     '+'
+#define NSCAN_CURSOR_DIGITS 20
+
+#define VERSIONED_TYPE_NAME   "exstr-ver"
+#define VERSIONED_TYPE_ENCVER 0
+
+#define NS_TYPE_NAME          "exstr-nsc"
+#define NS_TYPE_ENCVER        0
+
+#define PREFIX_INDEX_STR          "PREFIXINDEX"
+#define PREFIX_INDEX_BUILD_COUNT  1000
+#define PREFIX_INDEX_BUILD_PERIOD 1     /* ms between build steps */
+#define PREFIX_INDEX_CHECK_PERIOD 1000  /* ms between replica checks */
+
+#define NSSTATS_STR               "NSSTATS"
+#define TOP_STR                   "TOP"
+#define NSSTATS_MATCH             "{*},*"
+#define DEF_NSSTATS_TOP           10
+
+#define WORKERS_STR          "WORKERS"
+#define QUEUELEN_STR         "QUEUELEN"
+#define DEF_WORKERS          4
+#define MAX_WORKERS          64
+#define DEF_WORKER_QUEUE_LEN 1024
+
+#define LOCKBUDGET_STR       "LOCKBUDGET"
+#define DEF_LOCK_BUDGET_US   200
+#define MAX_LOCK_BUDGET_US   1000000
+#define MAX_ADAPTIVE_BATCH   10000
+
+#define NATIVESCAN_STR       "NATIVESCAN"
+#define SLOTSCAN_STR         "SLOTSCAN"
+#define MAX_SLOT_KEYS        MAX_ADAPTIVE_BATCH
+#define NATIVEPUBLISH_STR    "NATIVEPUBLISH"
+#define PACKED_STR           "PACKED"
+#define PACKED_CHANNEL_SUFFIX ".packed"
+#define CMDSTATS_STR         "CMDSTATS"
+#define RESET_STR            "RESET"
+#define HISTOGRAM_STR        "HISTOGRAM"
+
+#define SLOWLOGUS_STR        "SLOWLOGUS"
+#define SLOWLOGLEN_STR       "SLOWLOGLEN"
+#define GET_STR              "GET"
+#define LEN_STR              "LEN"
+#define DEF_SLOWLOG_US       10000
+#define DEF_SLOWLOG_LEN      128
+#define MAX_SLOWLOG_LEN      100000
+#define DEF_SLOWLOG_GET      10    /* Entries of NSLOWLOG GET */
+
+#define COMPRESSMIN_STR      "COMPRESSMIN"
+#define DECOMPRESS_STR       "DECOMPRESS"
+#define DEF_COMPRESS_MIN     256   /* Bytes from which CSET compresses */
+
+#define NDEL_SLICE_PERIOD    1     /* ms between slices of NDEL.NOATOMIC */
+#define NDEL_JOBS_KEPT       100   /* Finished jobs kept for NDEL.STATUS */
+#define NDELJOBS_STR         "NDELJOBS"
+#define DEF_NDEL_JOBS        16    /* Jobs of NDEL.NOATOMIC running at once */
 
 RedisModuleString *def_count_str = NULL, *match_str = NULL, *count_str = NULL, *zero_str = NULL;
+RedisModuleType *versioned_type = NULL;
+RedisModuleType *ns_type = NULL;
+
+/* The commands of the module, each with its counters and latency histogram,
+ * see CMDSTATS. */
+#define EXSTRINGS_COMMANDS(X) \
+    X(CMD_SETIE,         "setie",         SetIE_RedisCommand) \
+    X(CMD_SETNE,         "setne",         SetNE_RedisCommand) \
+    X(CMD_DELIE,         "delie",         DelIE_RedisCommand) \
+    X(CMD_DELNE,         "delne",         DelNE_RedisCommand) \
+    X(CMD_SETIEDIGEST,   "setiedigest",   SetIEDigest_RedisCommand) \
+    X(CMD_SETNEDIGEST,   "setnedigest",   SetNEDigest_RedisCommand) \
+    X(CMD_DELIEDIGEST,   "deliedigest",   DelIEDigest_RedisCommand) \
+    X(CMD_DELNEDIGEST,   "delnedigest",   DelNEDigest_RedisCommand) \
+    X(CMD_NGET_ATOMIC,   "nget.atomic",   NGet_Atomic_RedisCommand) \
+    X(CMD_NGET_NOATOMIC, "nget.noatomic", NGet_NoAtomic_RedisCommand) \
+    X(CMD_POOLSTATS,     "poolstats",     PoolStats_RedisCommand) \
+    X(CMD_NSCAN,         "nscan",         NScan_RedisCommand) \
+    X(CMD_NDEL_ATOMIC,   "ndel.atomic",   NDel_Atomic_RedisCommand) \
+    X(CMD_NDEL_NOATOMIC, "ndel.noatomic", NDel_NoAtomic_RedisCommand) \
+    X(CMD_NDEL_STATUS,   "ndel.status",   NDelStatus_RedisCommand) \
+    X(CMD_NDEL_CANCEL,   "ndel.cancel",   NDelCancel_RedisCommand) \
+    X(CMD_NSLOWLOG,      "nslowlog",      NSlowLog_RedisCommand) \
+    X(CMD_MSETPUB,       "msetpub",       SetPub_RedisCommand) \
+    X(CMD_MSETMPUB,      "msetmpub",      SetMPub_RedisCommand) \
+    X(CMD_SETIEPUB,      "setiepub",      SetIEPub_RedisCommand) \
+    X(CMD_SETIEMPUB,     "setiempub",     SetIEMPub_RedisCommand) \
+    X(CMD_SETNEPUB,      "setnepub",      SetNEPub_RedisCommand) \
+    X(CMD_SETXXPUB,      "setxxpub",      SetXXPub_RedisCommand) \
+    X(CMD_SETNXPUB,      "setnxpub",      SetNXPub_RedisCommand) \
+    X(CMD_SETNXMPUB,     "setnxmpub",     SetNXMPub_RedisCommand) \
+    X(CMD_DELPUB,        "delpub",        DelPub_RedisCommand) \
+    X(CMD_DELMPUB,       "delmpub",       DelMPub_RedisCommand) \
+    X(CMD_DELIEPUB,      "deliepub",      DelIEPub_RedisCommand) \
+    X(CMD_DELIEMPUB,     "deliempub",     DelIEMPub_RedisCommand) \
+    X(CMD_DELNEPUB,      "delnepub",      DelNEPub_RedisCommand) \
+    X(CMD_SETIEDIGESTPUB,  "setiedigestpub",  SetIEDigestPub_RedisCommand) \
+    X(CMD_SETIEDIGESTMPUB, "setiedigestmpub", SetIEDigestMPub_RedisCommand) \
+    X(CMD_SETNEDIGESTPUB,  "setnedigestpub",  SetNEDigestPub_RedisCommand) \
+    X(CMD_DELIEDIGESTPUB,  "deliedigestpub",  DelIEDigestPub_RedisCommand) \
+    X(CMD_DELIEDIGESTMPUB, "deliedigestmpub", DelIEDigestMPub_RedisCommand) \
+    X(CMD_DELNEDIGESTPUB,  "delnedigestpub",  DelNEDigestPub_RedisCommand) \
+    X(CMD_GETVER,        "getver",        GetVer_RedisCommand) \
+    X(CMD_SETVER,        "setver",        SetVer_RedisCommand) \
+    X(CMD_SETIFVER,      "setifver",      SetIfVer_RedisCommand) \
+    X(CMD_SETIFVERPUB,   "setifverpub",   SetIfVerPub_RedisCommand) \
+    X(CMD_DELIFVER,      "delifver",      DelIfVer_RedisCommand) \
+    X(CMD_DELIFVERPUB,   "delifverpub",   DelIfVerPub_RedisCommand) \
+    X(CMD_NS_SET,        "ns.set",        NsSet_RedisCommand) \
+    X(CMD_NS_SETPUB,     "ns.setpub",     NsSetPub_RedisCommand) \
+    X(CMD_NS_GET,        "ns.get",        NsGet_RedisCommand) \
+    X(CMD_NS_MGET,       "ns.mget",       NsMGet_RedisCommand) \
+    X(CMD_NS_GETALL,     "ns.getall",     NsGetAll_RedisCommand) \
+    X(CMD_NS_DEL,        "ns.del",        NsDel_RedisCommand) \
+    X(CMD_NS_DELPUB,     "ns.delpub",     NsDelPub_RedisCommand) \
+    X(CMD_NS_SETIE,      "ns.setie",      NsSetIE_RedisCommand) \
+    X(CMD_NS_SETIEPUB,   "ns.setiepub",   NsSetIEPub_RedisCommand) \
+    X(CMD_NS_DELIE,      "ns.delie",      NsDelIE_RedisCommand) \
+    X(CMD_NS_DELIEPUB,   "ns.deliepub",   NsDelIEPub_RedisCommand) \
+    X(CMD_NS_CLEAR,      "ns.clear",      NsClear_RedisCommand) \
+    X(CMD_NS_CLEARPUB,   "ns.clearpub",   NsClearPub_RedisCommand) \
+    X(CMD_CSET,          "cset",          CSet_RedisCommand) \
+    X(CMD_CSETIE,        "csetie",        CSetIE_RedisCommand) \
+    X(CMD_CSETIEPUB,     "csetiepub",     CSetIEPub_RedisCommand) \
+    X(CMD_CGET,          "cget",          CGet_RedisCommand) \
+    X(CMD_CSTATS,        "cstats",        CStats_RedisCommand) \
+    X(CMD_MDIGEST,       "mdigest",       MDigest_RedisCommand) \
+    X(CMD_NSSTATS,       "nsstats",       NsStats_RedisCommand) \
+    X(CMD_SDL_BATCH,     "sdl.batch",     SdlBatch_RedisCommand) \
+    X(CMD_CMDSTATS,      "cmdstats",      CmdStats_RedisCommand)
+
+#define CMD_ID(id, name, func) id,
+typedef enum _CommandId {
+    EXSTRINGS_COMMANDS(CMD_ID)
+    CMD_COUNT
+} CommandId;
+#undef CMD_ID
+
+#define CMD_NAME(id, name, func) name,
+const char *cmd_names[CMD_COUNT] = { EXSTRINGS_COMMANDS(CMD_NAME) };
+#undef CMD_NAME
+
+/* Recorded by the main thread, see worker_cmd_stats for the workers. */
+CmdStats cmd_stats[CMD_COUNT];
+bool cmd_stats_enabled = false;
+
+/* The call counted on this thread: the command, -1 when none, its start and
+ * its counts so far. */
+_Thread_local int cmd_stats_cmd = -1;
+_Thread_local uint64_t cmd_stats_start_ns = 0;
+_Thread_local CmdStatsCall cmd_stats_call;
+
+uint64_t monotonicNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* The counts are kept also when no call is counted, and then dropped. */
+void cmdStatsError(void)
+{
+    cmd_stats_call.errors++;
+}
+
+void cmdStatsKeys(uint64_t keys)
+{
+    cmd_stats_call.keys += keys;
+}
+
+void cmdStatsCondition(bool met)
+{
+    if (met)
+        cmd_stats_call.hits++;
+    else
+        cmd_stats_call.misses++;
+}
+
+/* Error replies of the commands go through these to be counted. */
+int replyWithError(RedisModuleCtx *ctx, const char *err)
+{
+    cmdStatsError();
+    return RedisModule_ReplyWithError(ctx, err);
+}
+
+int wrongArity(RedisModuleCtx *ctx)
+{
+    cmdStatsError();
+    return RedisModule_WrongArity(ctx);
+}
 
 typedef struct _NgetArgs {
     RedisModuleString *key;
     RedisModuleString *count;
+    bool decompress;
 } NgetArgs;
 
 typedef struct RedisModuleBlockedClientArgs {
@@ -79,22 +289,220 @@ void InitStaticVariable()
     return;
 }
 
-int getKeyType(RedisModuleCtx *ctx, RedisModuleString *key_str)
+bool keyContentsEqualString(RedisModuleKey *key, RedisModuleString *expected_value)
+{
+    size_t curlen = 0, expectedlen = 0;
+    const char *expectedval = RedisModule_StringPtrLen(expected_value, &expectedlen);
+    const char *curval = RedisModule_StringDMA(key, &curlen, REDISMODULE_READ);
+    return curval && valueEqual(expectedval, expectedlen, curval, curlen);
+}
+
+/* Values of CSET and friends, see CSTATS. Every update is made while holding
+ * the lock of redis, by the workers of NGET.NOATOMIC too. */
+typedef struct _CompressStats {
+    long long values;           /* values written */
+    long long compressed;       /* of which stored compressed */
+    long long bytes_in;         /* bytes given */
+    long long bytes_stored;     /* bytes stored */
+    long long decoded;          /* compressed values read back */
+} CompressStats;
+
+long long compress_min = DEF_COMPRESS_MIN;
+CompressStats compress_stats;
+
+/* Returns the value as given to CSET: 'val' itself if it is not compressed,
+ * else a decompressed copy in '*buf' that the caller frees. A value that does
+ * not decompress is returned as it is stored. */
+const char *decodeValue(const char *val, size_t len, size_t *outlen, char **buf)
+{
+    const char *raw = valueRaw(val, len, outlen);
+    size_t declen;
+
+    *buf = NULL;
+    if (raw)
+        return raw;
+
+    declen = valueDecodedLen(val, len);
+    if (declen > 0) {
+        *buf = RedisModule_Alloc(declen);
+        if (valueDecode(val, len, *buf)) {
+            compress_stats.decoded++;
+            *outlen = declen;
+            return *buf;
+        }
+        RedisModule_Free(*buf);
+        *buf = NULL;
+    }
+    *outlen = len;
+    return val;
+}
+
+/* keyContentsEqualString for a value written by CSET. */
+bool keyContentsEqualDecoded(RedisModuleKey *key, RedisModuleString *expected_value)
+{
+    size_t curlen = 0, expectedlen = 0, vallen;
+    char *buf;
+    const char *expectedval = RedisModule_StringPtrLen(expected_value, &expectedlen);
+    const char *curval = RedisModule_StringDMA(key, &curlen, REDISMODULE_READ);
+
+    if (!curval)
+        return false;
+    const char *val = decodeValue(curval, curlen, &vallen, &buf);
+    bool is_equal = valueEqual(expectedval, expectedlen, val, vallen);
+    if (buf)
+        RedisModule_Free(buf);
+    return is_equal;
+}
+
+bool keyContentsEqualDigest(RedisModuleKey *key, RedisModuleString *expected_digest)
+{
+    size_t curlen = 0, digestlen = 0;
+    uint64_t expected;
+    const char *digeststr = RedisModule_StringPtrLen(expected_digest, &digestlen);
+    const char *curval = RedisModule_StringDMA(key, &curlen, REDISMODULE_READ);
+    return curval &&
+           xxhash64FromHex(digeststr, digestlen, &expected) &&
+           xxhash64(curval, curlen, 0) == expected;
+}
+
+typedef enum _KeyCondition {
+    KEY_CONDITION_MET = 0,
+    KEY_CONDITION_NOT_MET,
+    KEY_CONDITION_WRONGTYPE
+} KeyCondition;
+
+/* Checks the OBJ_OP_* flags against a key opened by the caller. The flags
+ * can be combined, e.g. OBJ_OP_XX | OBJ_OP_NE requires an existing key whose
+ * value differs from 'oldvalstr'. 'oldvalstr' is only read for IE and NE, and
+ * holds the hex digest of the old value with OBJ_OP_DIGEST. */
+KeyCondition evalKeyCondition(RedisModuleKey *key, RedisModuleString *oldvalstr, int flag)
 {
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, key_str, REDISMODULE_READ);
     int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY && type != REDISMODULE_KEYTYPE_STRING)
+        return KEY_CONDITION_WRONGTYPE;
+
+    if (((flag & OBJ_OP_XX) && type == REDISMODULE_KEYTYPE_EMPTY) ||
+        ((flag & OBJ_OP_NX) && type == REDISMODULE_KEYTYPE_STRING))
+        return KEY_CONDITION_NOT_MET;
+
+    if (flag & (OBJ_OP_IE | OBJ_OP_NE)) {
+        bool is_equal = type == REDISMODULE_KEYTYPE_STRING &&
+                        ((flag & OBJ_OP_DIGEST) ?
+                         keyContentsEqualDigest(key, oldvalstr) :
+                         (flag & OBJ_OP_COMPRESS) ?
+                         keyContentsEqualDecoded(key, oldvalstr) :
+                         keyContentsEqualString(key, oldvalstr));
+        if (((flag & OBJ_OP_IE) && !is_equal) ||
+            ((flag & OBJ_OP_NE) && is_equal))
+            return KEY_CONDITION_NOT_MET;
+    }
+    return KEY_CONDITION_MET;
+}
+
+/* evalKeyCondition counted as a hit or a miss of the command. */
+KeyCondition checkKeyCondition(RedisModuleKey *key, RedisModuleString *oldvalstr, int flag)
+{
+    KeyCondition cond = evalKeyCondition(key, oldvalstr, flag);
+    if (cond != KEY_CONDITION_WRONGTYPE)
+        cmdStatsCondition(cond == KEY_CONDITION_MET);
+    return cond;
+}
+
+/* With OBJ_OP_DIGEST the old value is the xxh64 digest of the value as 16
+ * hex digits, see MDIGEST. */
+bool oldValueArgValid(RedisModuleString *oldvalstr, int flag)
+{
+    size_t len;
+    uint64_t digest;
+
+    if (!(flag & OBJ_OP_DIGEST))
+        return true;
+    const char *hex = RedisModule_StringPtrLen(oldvalstr, &len);
+    return xxhash64FromHex(hex, len, &digest);
+}
+
+/* Consumes a trailing RETURNCURRENT argument, if any, by shortening 'argc'.
+ * 'minargc' is the argument count of the command without the option. */
+int readReturnCurrent(RedisModuleString **argv, int *argc, int minargc)
+{
+    size_t optlen;
+
+    if (*argc <= minargc)
+        return OBJ_OP_NO;
+
+    const char *opt = RedisModule_StringPtrLen(argv[*argc - 1], &optlen);
+    if (strcasecmp(opt, RETURNCURRENT_STR))
+        return OBJ_OP_NO;
+
+    (*argc)--;
+    return OBJ_OP_RETURNCURRENT;
+}
+
+/* Reply for a key whose condition was not met: the integer 'notmet', or nil
+ * if it is negative. With OBJ_OP_RETURNCURRENT the value just compared is
+ * returned instead, nil if the key does not exist, so that the client does not
+ * need a GET before retrying. Must be called before the key is closed. */
+int replyKeyConditionNotMet(RedisModuleCtx *ctx, RedisModuleKey *key, KeyCondition cond,
+                            int flag, long long notmet)
+{
+    size_t curlen = 0;
+
+    if (cond == KEY_CONDITION_WRONGTYPE)
+        return replyWithError(ctx,REDISMODULE_ERRORMSG_WRONGTYPE);
+    if (flag & OBJ_OP_RETURNCURRENT) {
+        if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_STRING)
+            return RedisModule_ReplyWithNull(ctx);
+        const char *curval = RedisModule_StringDMA(key, &curlen, REDISMODULE_READ);
+        return RedisModule_ReplyWithStringBuffer(ctx, curval, curlen);
+    }
+    if (notmet < 0)
+        return RedisModule_ReplyWithNull(ctx);
+    return RedisModule_ReplyWithLongLong(ctx, notmet);
+}
+
+/* Keyspace notifications from module code need RedisModule_NotifyKeyspaceEvent,
+ * which older servers do not export. Without it the write is delegated to the
+ * corresponding redis command so that subscribers still see the events. */
+bool nativeKeyApiAvailable(void)
+{
+    return RMAPI_FUNC_SUPPORTED(RedisModule_NotifyKeyspaceEvent);
+}
+
+/* A key opened for write is signalled as modified when it is closed, which
+ * breaks the WATCH of other clients and invalidates client side caches even
+ * if nothing was written. Conditional writes thus check the key on a read
+ * handle and reopen it for write only once the condition is met. */
+RedisModuleKey *reopenKeyForWrite(RedisModuleCtx *ctx, RedisModuleKey *key, RedisModuleString *keystr)
+{
     RedisModule_CloseKey(key);
-    return type;
+    return RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ | REDISMODULE_WRITE);
 }
 
-bool replyContentsEqualString(RedisModuleCallReply *reply, RedisModuleString *expected_value)
+/* Reads the optional 'EX seconds' or 'PX milliseconds' arguments of SETIE and
+ * SETNE. Returns false for anything else, which is then left to SET itself. */
+bool readSetExpire(RedisModuleString **argv, int argc, mstime_t *expire)
 {
-    size_t replylen = 0, expectedlen = 0;
-    const char *expectedval = RedisModule_StringPtrLen(expected_value, &expectedlen);
-    const char *replyval = RedisModule_CallReplyStringPtr(reply, &replylen);
-    return replyval &&
-           expectedlen == replylen &&
-           !strncmp(expectedval, replyval, replylen);
+    size_t optlen;
+    long long number;
+
+    *expire = REDISMODULE_NO_EXPIRE;
+    if (argc == 0)
+        return true;
+    else if (argc != 2)
+        return false;
+
+    const char *opt = RedisModule_StringPtrLen(argv[0], &optlen);
+    if (RedisModule_StringToLongLong(argv[1], &number) != REDISMODULE_OK || number <= 0)
+        return false;
+
+    if (!strcasecmp(opt, "ex") && number <= LLONG_MAX / 1000)
+        *expire = number * 1000;
+    else if (!strcasecmp(opt, "px"))
+        *expire = number;
+    else
+        return false;
+
+    return true;
 }
 
 typedef struct _SetParams {
@@ -105,6 +513,7 @@ typedef struct _SetParams {
 typedef struct _PubParams {
     RedisModuleString **channel_msg_pairs;
     size_t length;
+    bool packed;            /* Sent in packed frames, see packedPubCommand */
 } PubParams;
 
 typedef struct _DelParams {
@@ -124,19 +533,27 @@ void readNgetArgs(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
     size_t str_len;
     long long number;
 
+    /* A trailing DECOMPRESS replies the values of CSET as they were given. */
+    nget_args->decompress = false;
+    if ((argc == 3 || argc == 5) &&
+        !strcasecmp(RedisModule_StringPtrLen(argv[argc - 1], &str_len), DECOMPRESS_STR)) {
+        nget_args->decompress = true;
+        argc--;
+    }
+
     if(argc == 2) {
         nget_args->key = argv[1];
         nget_args->count = def_count_str;
     } else if (argc == 4) {
         if (strcasecmp(RedisModule_StringPtrLen(argv[2], &str_len), "count")) {
-            RedisModule_ReplyWithError(ctx,"-ERR syntax error");
+            replyWithError(ctx,"-ERR syntax error");
             *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
             return;
         }
 
         int ret = RedisModule_StringToLongLong(argv[3], &number) != REDISMODULE_OK;
         if (ret != REDISMODULE_OK || number < 1) {
-            RedisModule_ReplyWithError(ctx,"-ERR value is not an integer or out of range");
+            replyWithError(ctx,"-ERR value is not an integer or out of range");
             *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
             return;
         }
@@ -155,7 +572,7 @@ void readNgetArgs(RedisModuleCtx *ctx, RedisModuleString **argv, int argc,
          * https://github.com/antirez/redis/issues/6382
          * 'If any thread tries to access the command arguments from
          *  within the ThreadSafeContext they will crash redis' */
-        RedisModule_WrongArity(ctx);
+        wrongArity(ctx);
         *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
         return;
     }
@@ -173,6 +590,7 @@ long long callReplyLongLong(RedisModuleCallReply* reply)
 void forwardIfError(RedisModuleCtx *ctx, RedisModuleCallReply *reply, ExstringsStatus* status)
 {
     if (RedisModule_CallReplyType(reply) == REDISMODULE_REPLY_ERROR) {
+        cmdStatsError();
         RedisModule_ReplyWithCallReply(ctx, reply);
         RedisModule_FreeCallReply(reply);
         *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
@@ -210,8 +628,73 @@ typedef struct _ScanSomeState {
     RedisModuleString *key;
     RedisModuleString *count;
     long long cursor;
+    bool started;
+    bool may_build_index;
+    GlobPattern glob;      /* 'key' classified at the start, see scanSomeStart */
+    int index_db;          /* Database whose index is walked, -1 for SCAN */
+    long long index_epoch;
+    char *lastkey;         /* Last key returned from the index */
+    size_t lastkeylen;
+    char *stepkey;         /* Last key returned of a SCAN step that NSCAN cut */
+    size_t stepkeylen;
+    long long batch;       /* Adaptive batch size, 0 to use 'count' */
+    bool need_scan_cursor; /* The SCAN cursor is given to the client */
+    RedisModuleScanCursor *native_cursor;
+    int slot;              /* Hash slot walked, -1 otherwise */
+    ScannedKeys *slot_keys; /* Matching keys of the slot, see slotSome */
+    size_t slot_pos;
+    long long scanned;     /* Keys visited, see SCAN in scanSome */
+    long long matched;     /* Keys returned */
+    long long iterations;  /* Batches */
 } ScanSomeState;
 
+void scanSomeStateInit(ScanSomeState *state, RedisModuleString *key,
+                       RedisModuleString *count, bool may_build_index)
+{
+    memset(state, 0, sizeof(*state));
+    state->key = key;
+    state->count = count;
+    state->may_build_index = may_build_index;
+    state->index_db = -1;
+    state->slot = -1;
+}
+
+void scanSomeStateFree(RedisModuleCtx *ctx, ScanSomeState *state)
+{
+    if (state->slot_keys) {
+        /* Only the keys not handed out yet are left. */
+        while (state->slot_pos < state->slot_keys->len)
+            RedisModule_FreeString(ctx, state->slot_keys->keys[state->slot_pos++]);
+        state->slot_keys->len = 0;
+        freeScannedKeys(ctx, state->slot_keys);
+        state->slot_keys = NULL;
+    }
+    RedisModule_Free(state->glob.literal);
+    RedisModule_Free(state->lastkey);
+    RedisModule_Free(state->stepkey);
+    state->glob.literal = state->lastkey = state->stepkey = NULL;
+    if (state->native_cursor) {
+        RedisModule_ScanCursorDestroy(state->native_cursor);
+        state->native_cursor = NULL;
+    }
+}
+
+void scanSomeStateSetLastKey(ScanSomeState *state, const char *key, size_t keylen)
+{
+    char *lastkey = RedisModule_Alloc(keylen + 1);
+    memcpy(lastkey, key, keylen);
+    RedisModule_Free(state->lastkey);
+    state->lastkey = lastkey;
+    state->lastkeylen = keylen;
+}
+
+/* Orders key names like the radix tree of the prefix index does. */
+bool keyNameAfter(const char *key, size_t keylen, const char *other, size_t otherlen)
+{
+    int cmp = memcmp(key, other, keylen < otherlen ? keylen : otherlen);
+    return cmp > 0 || (cmp == 0 && keylen > otherlen);
+}
+
 ScannedKeys *scanSome(RedisModuleCtx* ctx, ScanSomeState* state, ExstringsStatus* status)
 {
     RedisModuleString *scanargv[SCANARGC] = {NULL};
@@ -220,11 +703,13 @@ ScannedKeys *scanSome(RedisModuleCtx* ctx, ScanSomeState* state, ExstringsStatus
     scanargv[1] = match_str;
     scanargv[2] = state->key;
     scanargv[3] = count_str;
-    scanargv[4] = state->count;
+    scanargv[4] = state->batch ? RedisModule_CreateStringFromLongLong(ctx, state->batch) : state->count;
 
     RedisModuleCallReply *reply;
     reply = RedisModule_Call(ctx, "SCAN", "v", scanargv, SCANARGC);
     RedisModule_FreeString(ctx, scanargv[0]);
+    if (state->batch)
+        RedisModule_FreeString(ctx, scanargv[4]);
     forwardIfError(ctx, reply, status);
     if (*status == EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT)
         return NULL;
@@ -234,6 +719,9 @@ ScannedKeys *scanSome(RedisModuleCtx* ctx, ScanSomeState* state, ExstringsStatus
         RedisModule_CallReplyArrayElement(reply, 1);
 
     size_t scanned_keys_len = RedisModule_CallReplyLength(cr_keys);
+    /* SCAN does not tell how many keys it visited, only the ones that
+     * matched count. */
+    state->scanned += scanned_keys_len;
     if (scanned_keys_len == 0) {
         RedisModule_FreeCallReply(reply);
         *status = EXSTRINGS_STATUS_NO_ERRORS;
@@ -243,505 +731,3122 @@ ScannedKeys *scanSome(RedisModuleCtx* ctx, ScanSomeState* state, ExstringsStatus
     ScannedKeys *scanned_keys = allocScannedKeys(scanned_keys_len);
     if (scanned_keys == NULL) {
         RedisModule_FreeCallReply(reply);
-        RedisModule_ReplyWithError(ctx,"-ERR Out of memory");
+        replyWithError(ctx,"-ERR Out of memory");
         *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
         return NULL;
     }
 
-    scanned_keys->len = scanned_keys_len;
-    size_t j;
+    size_t j, n = 0;
     for (j = 0; j < scanned_keys_len; j++) {
-        RedisModuleString *rms = RedisModule_CreateStringFromCallReply(RedisModule_CallReplyArrayElement(cr_keys,j));
-        scanned_keys->keys[j] = rms;
+        RedisModuleCallReply *cr_key = RedisModule_CallReplyArrayElement(cr_keys,j);
+        /* After a switch from the index only the keys that the index walk
+         * had not reached yet are left. */
+        if (state->lastkey) {
+            size_t keylen;
+            const char *keyname = RedisModule_CallReplyStringPtr(cr_key, &keylen);
+            if (!keyNameAfter(keyname, keylen, state->lastkey, state->lastkeylen))
+                continue;
+        }
+        scanned_keys->keys[n++] = RedisModule_CreateStringFromCallReply(cr_key);
     }
+    scanned_keys->len = n;
     RedisModule_FreeCallReply(reply);
     *status = EXSTRINGS_STATUS_NO_ERRORS;
+    if (n == 0) {
+        freeScannedKeys(ctx, scanned_keys);
+        return NULL;
+    }
     return scanned_keys;
 }
 
-inline void unlockThreadsafeContext(RedisModuleCtx *ctx, bool using_threadsafe_context)
-{
-    if (using_threadsafe_context)
-        RedisModule_ThreadSafeContextUnlock(ctx);
-}
+/* Keyspace iteration with the scan API of the server, which visits the keys
+ * in place: no SCAN reply, no copy of the key names and no cursor to parse.
+ * Servers without the API, and NSCAN whose cursor is given to the client,
+ * use SCAN. */
+bool native_scan_enabled = false;
 
-inline void lockThreadsafeContext(RedisModuleCtx *ctx, bool using_threadsafe_context)
+bool nativeScanSupported(void)
 {
-    if (using_threadsafe_context)
-        RedisModule_ThreadSafeContextLock(ctx);
+    return RMAPI_FUNC_SUPPORTED(RedisModule_Scan) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_ScanCursorCreate) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_ScanCursorDestroy);
 }
 
-void multiPubCommand(RedisModuleCtx *ctx, PubParams* pubParams)
+typedef struct _NativeScanBatch {
+    ScanSomeState *state;
+    ScannedKeys *keys;
+    size_t size;           /* Allocated length of keys->keys */
+    size_t visited;
+    bool oom;
+} NativeScanBatch;
+
+void nativeScanCallback(RedisModuleCtx *ctx, RedisModuleString *keyname,
+                        RedisModuleKey *key, void *privdata)
 {
-    RedisModuleCallReply *reply = NULL;
-    for (unsigned int i = 0 ; i < pubParams->length ; i += 2) {
-        reply = RedisModule_Call(ctx, "PUBLISH", "v", pubParams->channel_msg_pairs + i, 2);
-        RedisModule_FreeCallReply(reply);
+    REDISMODULE_NOT_USED(ctx);
+    REDISMODULE_NOT_USED(key);
+    NativeScanBatch *batch = privdata;
+    ScanSomeState *state = batch->state;
+    size_t keylen;
+    const char *name = RedisModule_StringPtrLen(keyname, &keylen);
+
+    batch->visited++;
+    if (batch->oom)
+        return;
+    if (!globPatternMatch(&state->glob, name, keylen))
+        return;
+    if (state->lastkey && !keyNameAfter(name, keylen, state->lastkey, state->lastkeylen))
+        return;
+
+    /* A scan step visits whole buckets, so it can exceed the batch size. */
+    if (batch->keys->len == batch->size) {
+        RedisModuleString **keys = RedisModule_Alloc(sizeof(RedisModuleString *) * batch->size * 2);
+        if (keys == NULL) {
+            batch->oom = true;
+            return;
+        }
+        memcpy(keys, batch->keys->keys, sizeof(RedisModuleString *) * batch->size);
+        RedisModule_Free(batch->keys->keys);
+        batch->keys->keys = keys;
+        batch->size *= 2;
     }
+    RedisModule_RetainString(NULL, keyname);
+    batch->keys->keys[batch->keys->len++] = keyname;
 }
 
-int setStringGenericCommand(RedisModuleCtx *ctx, RedisModuleString **argv,
-                                       int argc, const int flag)
+/* Like scanSome, scan steps until about 'count' keys were visited. */
+ScannedKeys *nativeScanSome(RedisModuleCtx *ctx, ScanSomeState *state, ExstringsStatus *status)
 {
-    RedisModuleString *oldvalstr = NULL;
-    RedisModuleCallReply *reply = NULL;
-
-    if (argc < 4)
-        return RedisModule_WrongArity(ctx);
-    else
-        oldvalstr = argv[3];
-
-    /*Check if key type is string*/
-    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1],
-        REDISMODULE_READ);
-    int type = RedisModule_KeyType(key);
-    RedisModule_CloseKey(key);
+    long long count = state->batch;
+    NativeScanBatch batch;
+
+    if (count == 0 &&
+        (RedisModule_StringToLongLong(state->count, &count) != REDISMODULE_OK || count < 1))
+        count = DEF_COUNT;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.state = state;
+    batch.size = count;
+    batch.keys = allocScannedKeys(count);
+    if (batch.keys)
+        batch.keys->len = 0;
+    if (state->native_cursor == NULL)
+        state->native_cursor = RedisModule_ScanCursorCreate();
+    if (batch.keys == NULL || batch.keys->keys == NULL || state->native_cursor == NULL) {
+        freeScannedKeys(ctx, batch.keys);
+        replyWithError(ctx,"-ERR Out of memory");
+        *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
+        return NULL;
+    }
 
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        if (flag == OBJ_OP_IE){
-            RedisModule_ReplyWithNull(ctx);
-            return REDISMODULE_OK;
+    state->cursor = 1;
+    while (batch.visited < (size_t)count) {
+        if (!RedisModule_Scan(ctx, state->native_cursor, nativeScanCallback, &batch)) {
+            state->cursor = 0;
+            break;
         }
-    } else if (type != REDISMODULE_KEYTYPE_STRING) {
-        return RedisModule_ReplyWithError(ctx,REDISMODULE_ERRORMSG_WRONGTYPE);
     }
 
-    /*Get the value*/
-    reply = RedisModule_Call(ctx, "GET", "s", argv[1]);
-    ASSERT_NOERROR(reply)
-    size_t curlen=0, oldvallen=0;
-    const char *oldval = RedisModule_StringPtrLen(oldvalstr, &oldvallen);
-    const char *curval = RedisModule_CallReplyStringPtr(reply, &curlen);
-    if (((flag == OBJ_OP_IE) &&
-        (!curval || (oldvallen != curlen) || strncmp(oldval, curval, curlen)))
-        ||
-        ((flag == OBJ_OP_NE) && curval && (oldvallen == curlen) &&
-          !strncmp(oldval, curval, curlen))) {
-        RedisModule_FreeCallReply(reply);
-        return RedisModule_ReplyWithNull(ctx);
+    state->scanned += batch.visited;
+    if (batch.oom) {
+        freeScannedKeys(ctx, batch.keys);
+        replyWithError(ctx,"-ERR Out of memory");
+        *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
+        return NULL;
     }
-    RedisModule_FreeCallReply(reply);
+    *status = EXSTRINGS_STATUS_NO_ERRORS;
+    if (batch.keys->len == 0) {
+        freeScannedKeys(ctx, batch.keys);
+        return NULL;
+    }
+    return batch.keys;
+}
 
-    /* Prepare the arguments for the command. */
-    int i, j=0, cmdargc=argc-2;
-    RedisModuleString *cmdargv[cmdargc];
-    for (i = 1; i < argc; i++) {
-        if (i == 3)
-            continue;
-        cmdargv[j++] = argv[i];
+/* Ordered index of the key names of each database, so that NGET and NDEL of
+ * a "prefix*" pattern walk only the matching keys instead of SCANning the
+ * whole keyspace. The index of a database is built on its first such query,
+ * by a timer that SCANs the keyspace a step at a time, and is kept current
+ * from keyspace notifications. Until it is ready queries use SCAN.
+ *
+ * Events that can replace the dataset without per key notifications (flushes,
+ * SWAPDB, reloads, becoming a replica) drop all indexes; they are rebuilt on
+ * the next query. */
+typedef enum _PrefixIndexState {
+    PREFIX_INDEX_NONE = 0,
+    PREFIX_INDEX_BUILDING,
+    PREFIX_INDEX_READY
+} PrefixIndexState;
+
+typedef struct _PrefixIndex {
+    PrefixIndexState state;
+    RedisModuleDict *keys;
+    long long cursor;      /* SCAN cursor of the build */
+} PrefixIndex;
+
+bool prefix_index_enabled = false;
+PrefixIndex *prefix_indexes = NULL;
+int prefix_index_dbs = 0;
+long long prefix_index_epoch = 0;
+RedisModuleTimerID prefix_index_timer;
+mstime_t prefix_index_timer_period = 0;   /* 0 when no timer is armed */
+
+/* Every optional API the index needs, including NotifyKeyspaceEvent without
+ * which the writes of this module would not reach the index. */
+bool prefixIndexSupported(void)
+{
+    return nativeKeyApiAvailable() &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_CreateDict) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_SubscribeToKeyspaceEvents) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_CreateTimer) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_RegisterCommandFilter) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_GetContextFlags);
+}
+
+PrefixIndex *prefixIndexGet(int db, bool create)
+{
+    if (db < 0)
+        return NULL;
+    if (db >= prefix_index_dbs) {
+        if (!create)
+            return NULL;
+        PrefixIndex *indexes = RedisModule_Alloc(sizeof(PrefixIndex) * (db + 1));
+        if (indexes == NULL)
+            return NULL;
+        memset(indexes, 0, sizeof(PrefixIndex) * (db + 1));
+        if (prefix_indexes)
+            memcpy(indexes, prefix_indexes, sizeof(PrefixIndex) * prefix_index_dbs);
+        RedisModule_Free(prefix_indexes);
+        prefix_indexes = indexes;
+        prefix_index_dbs = db + 1;
     }
+    return &prefix_indexes[db];
+}
 
-    /* Call the command and pass back the reply. */
-    reply = RedisModule_Call(ctx, "SET", "v!", cmdargv, cmdargc);
-    ASSERT_NOERROR(reply)
-    RedisModule_ReplyWithCallReply(ctx, reply);
+void prefixIndexReset(PrefixIndex *idx)
+{
+    if (idx->keys)
+        RedisModule_FreeDict(NULL, idx->keys);
+    idx->keys = NULL;
+    idx->state = PREFIX_INDEX_NONE;
+    idx->cursor = 0;
+    prefix_index_epoch++;
+}
+
+void prefixIndexResetAll(void)
+{
+    int db;
+    for (db = 0; db < prefix_index_dbs; db++)
+        prefixIndexReset(&prefix_indexes[db]);
+    RedisModule_Free(prefix_indexes);
+    prefix_indexes = NULL;
+    prefix_index_dbs = 0;
+}
+
+/* A replica, or a server loading a dataset, gets keys without notifications. */
+bool prefixIndexUnsafe(RedisModuleCtx *ctx)
+{
+    return RedisModule_GetContextFlags(ctx) &
+           (REDISMODULE_CTX_FLAGS_SLAVE | REDISMODULE_CTX_FLAGS_LOADING);
+}
 
+void prefixIndexBuildStep(RedisModuleCtx *ctx, PrefixIndex *idx)
+{
+    RedisModuleCallReply *reply;
+    reply = RedisModule_Call(ctx, "SCAN", "lcl", idx->cursor, COUNT_STR,
+                             (long long)PREFIX_INDEX_BUILD_COUNT);
+    if (reply == NULL || RedisModule_CallReplyType(reply) != REDISMODULE_REPLY_ARRAY) {
+        if (reply)
+            RedisModule_FreeCallReply(reply);
+        prefixIndexReset(idx);
+        return;
+    }
+
+    idx->cursor = callReplyLongLong(RedisModule_CallReplyArrayElement(reply, 0));
+    RedisModuleCallReply *cr_keys = RedisModule_CallReplyArrayElement(reply, 1);
+    size_t j, keys = RedisModule_CallReplyLength(cr_keys);
+    for (j = 0; j < keys; j++) {
+        size_t keylen;
+        const char *keyname = RedisModule_CallReplyStringPtr(
+            RedisModule_CallReplyArrayElement(cr_keys, j), &keylen);
+        RedisModule_DictSetC(idx->keys, (void *)keyname, keylen, NULL);
+    }
     RedisModule_FreeCallReply(reply);
-    return REDISMODULE_OK;
+
+    if (idx->cursor == 0)
+        idx->state = PREFIX_INDEX_READY;
 }
 
-int SetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+void prefixIndexArmTimer(RedisModuleCtx *ctx, mstime_t period);
+
+/* Steps the builds and, while any index exists, checks once a second that
+ * the server has not become a replica. */
+void prefixIndexCron(RedisModuleCtx *ctx, void *data)
 {
-    RedisModule_AutoMemory(ctx);
-    return setStringGenericCommand(ctx, argv, argc, OBJ_OP_IE);
+    REDISMODULE_NOT_USED(data);
+    bool building = false;
+    int db;
+
+    prefix_index_timer_period = 0;
+    if (prefixIndexUnsafe(ctx))
+        prefixIndexResetAll();
+
+    for (db = 0; db < prefix_index_dbs; db++) {
+        PrefixIndex *idx = &prefix_indexes[db];
+        if (idx->state == PREFIX_INDEX_BUILDING) {
+            RedisModule_SelectDb(ctx, db);
+            prefixIndexBuildStep(ctx, idx);
+        }
+        building |= idx->state == PREFIX_INDEX_BUILDING;
+    }
+
+    if (prefix_indexes)
+        prefixIndexArmTimer(ctx, building ? PREFIX_INDEX_BUILD_PERIOD : PREFIX_INDEX_CHECK_PERIOD);
 }
 
-int SetNE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+void prefixIndexArmTimer(RedisModuleCtx *ctx, mstime_t period)
 {
-    RedisModule_AutoMemory(ctx);
-    return setStringGenericCommand(ctx, argv, argc, OBJ_OP_NE);
+    if (prefix_index_timer_period) {
+        if (prefix_index_timer_period <= period)
+            return;
+        RedisModule_StopTimer(ctx, prefix_index_timer, NULL);
+    }
+    prefix_index_timer = RedisModule_CreateTimer(ctx, period, prefixIndexCron, NULL);
+    prefix_index_timer_period = period;
 }
 
-int delStringGenericCommand(RedisModuleCtx *ctx, RedisModuleString **argv,
-                                       int argc, const int flag)
+/* Starts building the index of the selected database. Timers may only be
+ * created from the main thread. */
+void prefixIndexRequest(RedisModuleCtx *ctx)
 {
-    RedisModuleString *oldvalstr = NULL;
-    RedisModuleCallReply *reply = NULL;
+    if (!prefix_index_enabled || prefixIndexUnsafe(ctx))
+        return;
 
-    if (argc == 3)
-        oldvalstr = argv[2];
-    else
-        return RedisModule_WrongArity(ctx);
+    PrefixIndex *idx = prefixIndexGet(RedisModule_GetSelectedDb(ctx), true);
+    if (idx == NULL || idx->state != PREFIX_INDEX_NONE)
+        return;
 
-    /*Check if key type is string*/
-    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1],
-        REDISMODULE_READ);
-    int type = RedisModule_KeyType(key);
-    RedisModule_CloseKey(key);
+    idx->keys = RedisModule_CreateDict(NULL);
+    idx->state = PREFIX_INDEX_BUILDING;
+    idx->cursor = 0;
+    prefixIndexArmTimer(ctx, PREFIX_INDEX_BUILD_PERIOD);
+}
 
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        return RedisModule_ReplyWithLongLong(ctx, 0);
-    } else if (type != REDISMODULE_KEYTYPE_STRING) {
-        return RedisModule_ReplyWithError(ctx,REDISMODULE_ERRORMSG_WRONGTYPE);
-    }
+/* The ready index of the selected database, if it has every key. Keys that
+ * were created or removed without a notification, e.g. by a FLUSHALL queued
+ * in a MULTI that the command filter does not see, make its size differ from
+ * that of the database, which drops it for a rebuild. */
+PrefixIndex *prefixIndexReady(RedisModuleCtx *ctx)
+{
+    if (prefix_indexes == NULL || prefixIndexUnsafe(ctx))
+        return NULL;
 
-    /*Get the value*/
-    reply = RedisModule_Call(ctx, "GET", "s", argv[1]);
-    ASSERT_NOERROR(reply)
-    size_t curlen = 0, oldvallen = 0;
-    const char *oldval = RedisModule_StringPtrLen(oldvalstr, &oldvallen);
-    const char *curval = RedisModule_CallReplyStringPtr(reply, &curlen);
-    if (((flag == OBJ_OP_IE) &&
-        (!curval || (oldvallen != curlen) || strncmp(oldval, curval, curlen)))
-        ||
-        ((flag == OBJ_OP_NE) && curval && (oldvallen == curlen) &&
-          !strncmp(oldval, curval, curlen))) {
+    PrefixIndex *idx = prefixIndexGet(RedisModule_GetSelectedDb(ctx), false);
+    if (idx == NULL || idx->state != PREFIX_INDEX_READY)
+        return NULL;
+
+    RedisModuleCallReply *reply = RedisModule_Call(ctx, "DBSIZE", "");
+    long long dbsize = reply ? RedisModule_CallReplyInteger(reply) : -1;
+    if (reply)
         RedisModule_FreeCallReply(reply);
-        return RedisModule_ReplyWithLongLong(ctx, 0);
+    if (dbsize < 0 || RedisModule_DictSize(idx->keys) != (uint64_t)dbsize) {
+        prefixIndexReset(idx);
+        return NULL;
     }
-    RedisModule_FreeCallReply(reply);
+    return idx;
+}
 
-    /* Prepare the arguments for the command. */
-    int cmdargc=1;
-    RedisModuleString *cmdargv[1];
-    cmdargv[0] = argv[1];
+int prefixIndexNotify(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
+{
+    size_t keylen;
 
-    /* Call the command and pass back the reply. */
-    reply = RedisModule_Call(ctx, "UNLINK", "v!", cmdargv, cmdargc);
-    ASSERT_NOERROR(reply)
-    RedisModule_ReplyWithCallReply(ctx, reply);
+    if (prefix_indexes == NULL)
+        return REDISMODULE_OK;
 
-    RedisModule_FreeCallReply(reply);
+    PrefixIndex *idx = prefixIndexGet(RedisModule_GetSelectedDb(ctx), false);
+    if (idx == NULL || idx->state == PREFIX_INDEX_NONE)
+        return REDISMODULE_OK;
+
+    const char *keyname = RedisModule_StringPtrLen(key, &keylen);
+    if ((type & (REDISMODULE_NOTIFY_EXPIRED | REDISMODULE_NOTIFY_EVICTED)) ||
+        !strcmp(event, "del") || !strcmp(event, "rename_from") ||
+        !strcmp(event, "move_from"))
+        RedisModule_DictDelC(idx->keys, (void *)keyname, keylen, NULL);
+    else
+        RedisModule_DictSetC(idx->keys, (void *)keyname, keylen, NULL);
     return REDISMODULE_OK;
 }
 
-int DelIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Per namespace key counts and value sizes of each database, for the keys
+ * named "{ns},key" as SDL names them, see NSSTATS. Built and kept current like
+ * the prefix index: a timer SCANs the keyspace after the first query, keyspace
+ * notifications then account each change, and the events that replace the
+ * dataset drop it for a rebuild. The size accounted for each key is kept, so
+ * that a change or a deletion is accounted without the old value. */
+typedef struct _NsAccounting {
+    PrefixIndexState state;
+    RedisModuleDict *sizes;    /* key name to accounted size */
+    NsStats stats;
+    long long cursor;          /* SCAN cursor of the build */
+} NsAccounting;
+
+bool ns_accounting_enabled = false;
+NsAccounting *ns_accountings = NULL;
+int ns_accounting_dbs = 0;
+RedisModuleTimerID ns_accounting_timer;
+bool ns_accounting_timer_armed = false;
+
+bool nsAccountingSupported(void)
 {
-    RedisModule_AutoMemory(ctx);
-    return delStringGenericCommand(ctx, argv, argc, OBJ_OP_IE);
+    return prefixIndexSupported() &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_DictGetC) &&
+           RMAPI_FUNC_SUPPORTED(RedisModule_DictReplaceC);
 }
 
-int DelNE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+NsAccounting *nsAccountingGet(int db, bool create)
 {
-    RedisModule_AutoMemory(ctx);
-    return delStringGenericCommand(ctx, argv, argc, OBJ_OP_NE);
+    if (db < 0)
+        return NULL;
+    if (db >= ns_accounting_dbs) {
+        if (!create)
+            return NULL;
+        NsAccounting *accs = RedisModule_Alloc(sizeof(NsAccounting) * (db + 1));
+        if (accs == NULL)
+            return NULL;
+        memset(accs, 0, sizeof(NsAccounting) * (db + 1));
+        if (ns_accountings)
+            memcpy(accs, ns_accountings, sizeof(NsAccounting) * ns_accounting_dbs);
+        RedisModule_Free(ns_accountings);
+        ns_accountings = accs;
+        ns_accounting_dbs = db + 1;
+    }
+    return &ns_accountings[db];
 }
-int setPubStringCommon(RedisModuleCtx *ctx, SetParams* setParamsPtr, PubParams* pubParamsPtr)
+
+void nsAccountingReset(NsAccounting *acc)
 {
-    RedisModuleCallReply *setReply;
-    setReply = RedisModule_Call(ctx, "MSET", "v!", setParamsPtr->key_val_pairs, setParamsPtr->length);
-    ASSERT_NOERROR(setReply)
-    multiPubCommand(ctx, pubParamsPtr);
-    RedisModule_ReplyWithCallReply(ctx, setReply);
-    RedisModule_FreeCallReply(setReply);
-    return REDISMODULE_OK;
+    if (acc->sizes)
+        RedisModule_FreeDict(NULL, acc->sizes);
+    acc->sizes = NULL;
+    nsStatsClear(&acc->stats);
+    acc->state = PREFIX_INDEX_NONE;
+    acc->cursor = 0;
 }
 
-int SetPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+void nsAccountingResetAll(void)
 {
-    if (argc < 5 || (argc % 2) == 0)
-        return RedisModule_WrongArity(ctx);
+    int db;
+    for (db = 0; db < ns_accounting_dbs; db++)
+        nsAccountingReset(&ns_accountings[db]);
+    RedisModule_Free(ns_accountings);
+    ns_accountings = NULL;
+    ns_accounting_dbs = 0;
+}
 
-    RedisModule_AutoMemory(ctx);
-    SetParams setParams = {
-                           .key_val_pairs = argv + 1,
-                           .length = argc - 3
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 1 + setParams.length,
-                           .length = 2
-                          };
+/* Size accounted for a key: the length of a string, the bytes of the fields
+ * and values of a namespace container, 0 for the other types and -1 when the
+ * key does not exist. */
+long long nsAccountingKeySize(RedisModuleKey *key)
+{
+    int type = RedisModule_KeyType(key);
+    size_t len;
 
-    return setPubStringCommon(ctx, &setParams, &pubParams);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return -1;
+    if (type == REDISMODULE_KEYTYPE_STRING) {
+        RedisModule_StringDMA(key, &len, REDISMODULE_READ);
+        return (long long)len;
+    }
+    if (type == REDISMODULE_KEYTYPE_MODULE && RedisModule_ModuleTypeGetType(key) == ns_type)
+        return (long long)((NsDict *)RedisModule_ModuleTypeGetValue(key))->bytes;
+    return 0;
 }
 
-int SetMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Accounts the key 'keyname' of the namespace 'ns' as now 'size' bytes, -1
+ * when it no longer exists. Running out of memory drops the accounting. */
+void nsAccountingSet(NsAccounting *acc, const char *keyname, size_t keylen,
+                     const char *ns, size_t nslen, long long size)
 {
-    if (argc < 7 || (argc % 2) == 0)
-        return RedisModule_WrongArity(ctx);
+    int nokey;
+    void *old = RedisModule_DictGetC(acc->sizes, (void *)keyname, keylen, &nokey);
+    long long oldsize = nokey ? -1 : (long long)(uintptr_t)old;
 
-    RedisModule_AutoMemory(ctx);
-    long long setPairsCount, pubPairsCount;
-    RedisModule_StringToLongLong(argv[1], &setPairsCount);
-    RedisModule_StringToLongLong(argv[2], &pubPairsCount);
-    if (setPairsCount < 1 || pubPairsCount < 1)
-        return RedisModule_ReplyWithError(ctx, "ERR SET_PAIR_COUNT and PUB_PAIR_COUNT must be greater than zero");
-
-    long long setLen, pubLen;
-    setLen = 2*setPairsCount;
-    pubLen = 2*pubPairsCount;
-
-    if (setLen + pubLen + 3 != argc)
-        return RedisModule_ReplyWithError(ctx, "ERR SET_PAIR_COUNT or PUB_PAIR_COUNT do not match the total pair count");
+    if (oldsize == size)
+        return;
+    if (size < 0)
+        RedisModule_DictDelC(acc->sizes, (void *)keyname, keylen, NULL);
+    else
+        RedisModule_DictReplaceC(acc->sizes, (void *)keyname, keylen, (void *)(uintptr_t)size);
+    if (!nsStatsChange(&acc->stats, ns, nslen, oldsize, size))
+        nsAccountingReset(acc);
+}
 
-    SetParams setParams = {
-                           .key_val_pairs = argv + 3,
-                           .length = setLen
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 3 + setParams.length,
-                           .length = pubLen
-                          };
+/* Reads and accounts the key, if it is named after a namespace. */
+void nsAccountingKey(RedisModuleCtx *ctx, NsAccounting *acc, RedisModuleString *keyname, bool removed)
+{
+    const char *name, *ns;
+    size_t keylen, nslen;
+    long long size = -1;
 
-    return setPubStringCommon(ctx, &setParams, &pubParams);
+    name = RedisModule_StringPtrLen(keyname, &keylen);
+    if (!nsStatsKeyNamespace(name, keylen, &ns, &nslen))
+        return;
+    if (!removed) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+        size = nsAccountingKeySize(key);
+        RedisModule_CloseKey(key);
+    }
+    nsAccountingSet(acc, name, keylen, ns, nslen, size);
 }
 
-int setIENEPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+void nsAccountingBuildStep(RedisModuleCtx *ctx, NsAccounting *acc)
 {
-    SetParams setParams = {
-                           .key_val_pairs = argv + 1,
-                           .length = 2
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 4,
-                           .length = argc - 4
-                          };
-    RedisModuleString *key = setParams.key_val_pairs[0];
-    RedisModuleString *oldvalstr = argv[3];
-
-    int type = getKeyType(ctx, key);
-    if (flag == OBJ_OP_IE && type == REDISMODULE_KEYTYPE_EMPTY) {
-        return RedisModule_ReplyWithNull(ctx);
-    } else if (type != REDISMODULE_KEYTYPE_STRING && type != REDISMODULE_KEYTYPE_EMPTY) {
-        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    RedisModuleCallReply *reply;
+    reply = RedisModule_Call(ctx, "SCAN", "lcccl", acc->cursor, MATCH_STR, NSSTATS_MATCH,
+                             COUNT_STR, (long long)PREFIX_INDEX_BUILD_COUNT);
+    if (reply == NULL || RedisModule_CallReplyType(reply) != REDISMODULE_REPLY_ARRAY) {
+        if (reply)
+            RedisModule_FreeCallReply(reply);
+        nsAccountingReset(acc);
+        return;
     }
 
-    RedisModuleCallReply *reply = RedisModule_Call(ctx, "GET", "s", key);
-    ASSERT_NOERROR(reply)
-    bool is_equal = replyContentsEqualString(reply, oldvalstr);
-    RedisModule_FreeCallReply(reply);
-    if ((flag == OBJ_OP_IE && !is_equal) ||
-        (flag == OBJ_OP_NE && is_equal)) {
-        return RedisModule_ReplyWithNull(ctx);
+    acc->cursor = callReplyLongLong(RedisModule_CallReplyArrayElement(reply, 0));
+    RedisModuleCallReply *cr_keys = RedisModule_CallReplyArrayElement(reply, 1);
+    size_t j, keys = RedisModule_CallReplyLength(cr_keys);
+    for (j = 0; j < keys && acc->state == PREFIX_INDEX_BUILDING; j++) {
+        RedisModuleString *keyname = RedisModule_CreateStringFromCallReply(
+            RedisModule_CallReplyArrayElement(cr_keys, j));
+        nsAccountingKey(ctx, acc, keyname, false);
+        RedisModule_FreeString(ctx, keyname);
     }
+    RedisModule_FreeCallReply(reply);
 
-    return setPubStringCommon(ctx, &setParams, &pubParams);
+    if (acc->cursor == 0 && acc->state == PREFIX_INDEX_BUILDING)
+        acc->state = PREFIX_INDEX_READY;
 }
 
-int SetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Steps the builds, the timer lapses once none is left. */
+void nsAccountingCron(RedisModuleCtx *ctx, void *data)
 {
-    if (argc != 6)
-        return RedisModule_WrongArity(ctx);
+    REDISMODULE_NOT_USED(data);
+    bool building = false;
+    int db;
+
+    ns_accounting_timer_armed = false;
+    if (prefixIndexUnsafe(ctx))
+        nsAccountingResetAll();
+
+    for (db = 0; db < ns_accounting_dbs; db++) {
+        NsAccounting *acc = &ns_accountings[db];
+        if (acc->state == PREFIX_INDEX_BUILDING) {
+            RedisModule_SelectDb(ctx, db);
+            nsAccountingBuildStep(ctx, acc);
+        }
+        building |= acc->state == PREFIX_INDEX_BUILDING;
+    }
 
-    RedisModule_AutoMemory(ctx);
-    return setIENEPubStringCommon(ctx, argv, argc, OBJ_OP_IE);
+    if (building) {
+        ns_accounting_timer = RedisModule_CreateTimer(ctx, PREFIX_INDEX_BUILD_PERIOD,
+                                                      nsAccountingCron, NULL);
+        ns_accounting_timer_armed = true;
+    }
 }
 
-int SetIEMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+int nsAccountingNotify(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
 {
-    if (argc < 6 || (argc % 2) != 0)
-        return RedisModule_WrongArity(ctx);
+    if (ns_accountings == NULL)
+        return REDISMODULE_OK;
 
-    RedisModule_AutoMemory(ctx);
-    return setIENEPubStringCommon(ctx, argv, argc, OBJ_OP_IE);
+    NsAccounting *acc = nsAccountingGet(RedisModule_GetSelectedDb(ctx), false);
+    if (acc == NULL || acc->state == PREFIX_INDEX_NONE)
+        return REDISMODULE_OK;
+
+    /* The key of these events is already gone, or about to be. */
+    bool removed = (type & (REDISMODULE_NOTIFY_EXPIRED | REDISMODULE_NOTIFY_EVICTED)) ||
+                   !strcmp(event, "del") || !strcmp(event, "rename_from") ||
+                   !strcmp(event, "move_from");
+    nsAccountingKey(ctx, acc, key, removed);
+    return REDISMODULE_OK;
 }
 
-int SetNEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Drops the prefix indexes and the namespace accounting on the commands that
+ * replace the dataset without per key notifications. */
+void prefixIndexCommandFilter(RedisModuleCommandFilterCtx *fctx)
 {
-    if (argc != 6)
-        return RedisModule_WrongArity(ctx);
+    size_t len;
 
-    RedisModule_AutoMemory(ctx);
-    return setIENEPubStringCommon(ctx, argv, argc, OBJ_OP_NE);
+    if (prefix_indexes == NULL && ns_accountings == NULL)
+        return;
+
+    const char *cmd = RedisModule_StringPtrLen(RedisModule_CommandFilterArgGet(fctx, 0), &len);
+    if (!strcasecmp(cmd, "flushall") || !strcasecmp(cmd, "flushdb") ||
+        !strcasecmp(cmd, "swapdb") || !strcasecmp(cmd, "replicaof") ||
+        !strcasecmp(cmd, "slaveof")) {
+        prefixIndexResetAll();
+        nsAccountingResetAll();
+    } else if (!strcasecmp(cmd, "debug") && RedisModule_CommandFilterArgsCount(fctx) > 1) {
+        const char *sub = RedisModule_StringPtrLen(RedisModule_CommandFilterArgGet(fctx, 1), &len);
+        if (!strcasecmp(sub, "reload") || !strcasecmp(sub, "loadaof") ||
+            !strcasecmp(sub, "populate")) {
+            prefixIndexResetAll();
+            nsAccountingResetAll();
+        }
+    }
 }
 
-int setXXNXPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+/* NSSTATS [TOP n]: the n namespaces of the selected database with the most
+ * value bytes, each as [namespace, keys, bytes, [keys by value size]]. The
+ * first call starts the accounting and replies an error until it is built. */
+int NsStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
-    SetParams setParams = {
-                           .key_val_pairs = argv + 1,
-                           .length = 2
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 3,
-                           .length = argc - 3
-                          };
-    RedisModuleString *key = setParams.key_val_pairs[0];
-
-    int type = getKeyType(ctx, key);
-    if ((flag == OBJ_OP_XX && type == REDISMODULE_KEYTYPE_EMPTY) ||
-        (flag == OBJ_OP_NX && type == REDISMODULE_KEYTYPE_STRING)) {
-        return RedisModule_ReplyWithNull(ctx);
-    } else if (type != REDISMODULE_KEYTYPE_STRING && type != REDISMODULE_KEYTYPE_EMPTY) {
-        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
-        return REDISMODULE_OK;
+    long long n = DEF_NSSTATS_TOP;
+    size_t len, i, j;
+
+    if (argc != 1 && argc != 3)
+        return wrongArity(ctx);
+    if (argc == 3 &&
+        (strcasecmp(RedisModule_StringPtrLen(argv[1], &len), TOP_STR) ||
+         RedisModule_StringToLongLong(argv[2], &n) != REDISMODULE_OK || n < 1))
+        return replyWithError(ctx,"-ERR syntax error");
+
+    if (!ns_accounting_enabled)
+        return replyWithError(ctx,"-ERR namespace accounting is disabled");
+    if (prefixIndexUnsafe(ctx)) {
+        nsAccountingResetAll();
+        return replyWithError(ctx,"-ERR namespace accounting is not kept on a replica");
     }
 
-    return setPubStringCommon(ctx, &setParams, &pubParams);
+    NsAccounting *acc = nsAccountingGet(RedisModule_GetSelectedDb(ctx), true);
+    if (acc == NULL)
+        return replyWithError(ctx,"-ERR Out of memory");
+    if (acc->state == PREFIX_INDEX_NONE) {
+        acc->sizes = RedisModule_CreateDict(NULL);
+        nsStatsInit(&acc->stats);
+        acc->state = PREFIX_INDEX_BUILDING;
+        acc->cursor = 0;
+        if (!ns_accounting_timer_armed) {
+            ns_accounting_timer = RedisModule_CreateTimer(ctx, PREFIX_INDEX_BUILD_PERIOD,
+                                                          nsAccountingCron, NULL);
+            ns_accounting_timer_armed = true;
+        }
+    }
+    if (acc->state != PREFIX_INDEX_READY)
+        return replyWithError(ctx,"-ERR namespace accounting is being built, try again later");
+
+    if ((size_t)n > acc->stats.names.len)
+        n = (long long)acc->stats.names.len;
+    const NsEntry **top = RedisModule_Alloc(sizeof(NsEntry *) * (n ? n : 1));
+    if (top == NULL)
+        return replyWithError(ctx,"-ERR Out of memory");
+    n = (long long)nsStatsTop(&acc->stats, top, (size_t)n);
+
+    RedisModule_ReplyWithArray(ctx, n);
+    for (i = 0; i < (size_t)n; i++) {
+        NsCounters c;
+        nsStatsCounters(top[i], &c);
+        RedisModule_ReplyWithArray(ctx, 4);
+        RedisModule_ReplyWithStringBuffer(ctx, nsEntryField(top[i]), top[i]->fieldlen);
+        RedisModule_ReplyWithLongLong(ctx, c.keys);
+        RedisModule_ReplyWithLongLong(ctx, c.bytes);
+        RedisModule_ReplyWithArray(ctx, NSSTATS_BUCKETS);
+        for (j = 0; j < NSSTATS_BUCKETS; j++)
+            RedisModule_ReplyWithLongLong(ctx, c.sizes[j]);
+    }
+    RedisModule_Free(top);
+    return REDISMODULE_OK;
 }
 
-int SetNXPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Next batch of at most 'count' keys from the index walk. */
+ScannedKeys *indexSome(RedisModuleCtx *ctx, ScanSomeState *state, PrefixIndex *idx,
+                       ExstringsStatus *status)
 {
-    if (argc != 5)
-        return RedisModule_WrongArity(ctx);
+    long long count = DEF_COUNT;
+    RedisModuleDictIter *iter;
+    size_t keylen, n = 0;
+    char *keyname;
+
+    if (state->batch)
+        count = state->batch;
+    else if (RedisModule_StringToLongLong(state->count, &count) != REDISMODULE_OK || count < 1)
+        count = DEF_COUNT;
+    if (count > PREFIX_INDEX_BUILD_COUNT)
+        count = PREFIX_INDEX_BUILD_COUNT;
+
+    ScannedKeys *scanned_keys = allocScannedKeys(count);
+    if (scanned_keys == NULL) {
+        replyWithError(ctx,"-ERR Out of memory");
+        *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
+        return NULL;
+    }
 
-    RedisModule_AutoMemory(ctx);
-    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_NX);
-}
+    if (state->lastkey)
+        iter = RedisModule_DictIteratorStartC(idx->keys, ">", state->lastkey, state->lastkeylen);
+    else if (state->glob.literallen)
+        iter = RedisModule_DictIteratorStartC(idx->keys, ">=", state->glob.literal,
+                                              state->glob.literallen);
+    else
+        iter = RedisModule_DictIteratorStartC(idx->keys, "^", NULL, 0);
 
-int SetNXMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
-{
-    if (argc < 5 || (argc % 2) == 0)
-        return RedisModule_WrongArity(ctx);
+    state->cursor = 0;
+    while ((keyname = RedisModule_DictNextC(iter, &keylen, NULL)) != NULL) {
+        if (!globPatternMatch(&state->glob, keyname, keylen))
+            break;
+        scanned_keys->keys[n++] = RedisModule_CreateString(ctx, keyname, keylen);
+        if (n == (size_t)count) {
+            scanSomeStateSetLastKey(state, keyname, keylen);
+            state->cursor = 1;
+            break;
+        }
+    }
+    RedisModule_DictIteratorStop(iter);
 
-    RedisModule_AutoMemory(ctx);
-    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_NX);
+    state->scanned += n;
+    scanned_keys->len = n;
+    *status = EXSTRINGS_STATUS_NO_ERRORS;
+    if (n == 0) {
+        freeScannedKeys(ctx, scanned_keys);
+        return NULL;
+    }
+    return scanned_keys;
 }
 
-int SetXXPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* In a cluster all the keys with the same hash tag are in one hash slot, so
+ * the keys of an SDL namespace, "{ns},key", are. A pattern that fixes the
+ * hash tag is walked over the keys of its slot instead of the keyspace of the
+ * node, and costs the same however many keys the node has. CLUSTER
+ * GETKEYSINSLOT has no cursor, so the matching key names of the slot are
+ * taken in one step at the start and handed out a batch at a time. That step
+ * is bounded to MAX_SLOT_KEYS, the largest batch, so that it fits the lock
+ * budget of NGET.NOATOMIC and the slices of NDEL.NOATOMIC; larger slots are
+ * walked with the keyspace. NSCAN, whose cursor is given to the client, does
+ * not walk slots. */
+bool slot_scan_enabled = false;
+
+bool slotScanApplies(RedisModuleCtx *ctx, ScanSomeState *state)
 {
-    if (argc != 5)
-        return RedisModule_WrongArity(ctx);
-
-    RedisModule_AutoMemory(ctx);
-    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_XX);
+    return slot_scan_enabled && !state->need_scan_cursor &&
+           (RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_CLUSTER);
 }
 
-int delPubStringCommon(RedisModuleCtx *ctx, DelParams *delParamsPtr, PubParams *pubParamsPtr)
+/* Reads the matching keys of the slot. False if the server refuses the
+ * CLUSTER commands or the slot has more than MAX_SLOT_KEYS keys, and then the
+ * keyspace is walked instead. */
+bool slotKeysRead(RedisModuleCtx *ctx, ScanSomeState *state, ExstringsStatus *status)
 {
-    RedisModuleCallReply *reply = RedisModule_Call(ctx, "UNLINK", "v!", delParamsPtr->keys, delParamsPtr->length);
-    ASSERT_NOERROR(reply)
-    int replytype = RedisModule_CallReplyType(reply);
-    if (replytype == REDISMODULE_REPLY_NULL) {
-        RedisModule_ReplyWithNull(ctx);
-    } else if (RedisModule_CallReplyInteger(reply) == 0) {
-        RedisModule_ReplyWithCallReply(ctx, reply);
-    } else {
-        RedisModule_ReplyWithCallReply(ctx, reply);
-        multiPubCommand(ctx, pubParamsPtr);
+    RedisModuleCallReply *reply;
+    long long count = 0;
+    size_t len = 0, keylen, j, n = 0;
+
+    /* GETKEYSINSLOT allocates for as many keys as it is asked for, so it is
+     * asked for the number that the slot has. */
+    reply = RedisModule_Call(ctx, "CLUSTER", "cl", "COUNTKEYSINSLOT", (long long)state->slot);
+    if (reply == NULL || RedisModule_CallReplyType(reply) != REDISMODULE_REPLY_INTEGER) {
+        if (reply)
+            RedisModule_FreeCallReply(reply);
+        return false;
     }
+    count = RedisModule_CallReplyInteger(reply);
     RedisModule_FreeCallReply(reply);
-    return REDISMODULE_OK;
+    if (count > MAX_SLOT_KEYS)
+        return false;
+
+    reply = NULL;
+    if (count > 0) {
+        reply = RedisModule_Call(ctx, "CLUSTER", "cll", "GETKEYSINSLOT",
+                                 (long long)state->slot, count);
+        if (reply == NULL || RedisModule_CallReplyType(reply) != REDISMODULE_REPLY_ARRAY) {
+            if (reply)
+                RedisModule_FreeCallReply(reply);
+            return false;
+        }
+        len = RedisModule_CallReplyLength(reply);
+    }
+
+    state->slot_keys = allocScannedKeys(len ? len : 1);
+    if (state->slot_keys == NULL || state->slot_keys->keys == NULL) {
+        if (reply)
+            RedisModule_FreeCallReply(reply);
+        replyWithError(ctx,"-ERR Out of memory");
+        *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
+        return true;
+    }
+    /* Hash tags of other namespaces can fall in the same slot. */
+    for (j = 0; j < len; j++) {
+        RedisModuleString *key =
+            RedisModule_CreateStringFromCallReply(RedisModule_CallReplyArrayElement(reply, j));
+        const char *keyname = RedisModule_StringPtrLen(key, &keylen);
+        if (globPatternMatch(&state->glob, keyname, keylen))
+            state->slot_keys->keys[n++] = key;
+        else
+            RedisModule_FreeString(ctx, key);
+    }
+    state->slot_keys->len = n;
+    state->scanned += len;
+    if (reply)
+        RedisModule_FreeCallReply(reply);
+    return true;
 }
 
-int DelPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Next batch of at most 'count' keys of the slot. */
+ScannedKeys *slotSome(RedisModuleCtx *ctx, ScanSomeState *state, ExstringsStatus *status)
 {
-    if (argc < 4)
-        return RedisModule_WrongArity(ctx);
+    long long count = state->batch;
+    size_t n;
 
-    RedisModule_AutoMemory(ctx);
-    DelParams delParams = {
-                           .keys = argv + 1,
-                           .length = argc - 3
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 1 + delParams.length,
-                           .length = 2
-                          };
+    *status = EXSTRINGS_STATUS_NO_ERRORS;
+    if (state->slot_keys == NULL) {
+        if (!slotKeysRead(ctx, state, status)) {
+            state->slot = -1;
+            return NULL;
+        }
+        if (*status != EXSTRINGS_STATUS_NO_ERRORS)
+            return NULL;
+    }
 
-    return delPubStringCommon(ctx, &delParams, &pubParams);
+    if (count == 0 &&
+        (RedisModule_StringToLongLong(state->count, &count) != REDISMODULE_OK || count < 1))
+        count = DEF_COUNT;
+    n = state->slot_keys->len - state->slot_pos;
+    if (n > (size_t)count)
+        n = count;
+    state->cursor = state->slot_pos + n < state->slot_keys->len;
+    if (n == 0)
+        return NULL;
+
+    ScannedKeys *scanned_keys = allocScannedKeys(n);
+    if (scanned_keys == NULL) {
+        replyWithError(ctx,"-ERR Out of memory");
+        *status = EXSTRINGS_STATUS_ERROR_AND_REPLY_SENT;
+        return NULL;
+    }
+    memcpy(scanned_keys->keys, state->slot_keys->keys + state->slot_pos,
+           sizeof(RedisModuleString *) * n);
+    state->slot_pos += n;
+    return scanned_keys;
 }
 
-int DelMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Classifies the pattern once for the walks that match the keys in the
+ * module, the index, slot and native walks, and chooses the prefix index or
+ * the slot when the pattern allows. SCAN matches in the server. */
+void scanSomeStart(RedisModuleCtx *ctx, ScanSomeState *state)
 {
-    if (argc < 6)
-        return RedisModule_WrongArity(ctx);
+    size_t len = 0;
+    const char *pattern;
+    char *literal;
+    bool slot_scan = slotScanApplies(ctx, state);
+
+    state->started = true;
+    if (!prefix_index_enabled && !slot_scan &&
+        !(native_scan_enabled && !state->need_scan_cursor))
+        return;
 
-    RedisModule_AutoMemory(ctx);
-    long long delCount, pubPairsCount;
-    RedisModule_StringToLongLong(argv[1], &delCount);
-    RedisModule_StringToLongLong(argv[2], &pubPairsCount);
-    if (delCount < 1 || pubPairsCount < 1)
-        return RedisModule_ReplyWithError(ctx, "ERR DEL_COUNT and PUB_PAIR_COUNT must be greater than zero");
+    pattern = RedisModule_StringPtrLen(state->key, &len);
+    literal = RedisModule_Alloc(len + 1);
+    if (literal == NULL) {
+        state->glob.pattern = pattern;
+        state->glob.patternlen = len;
+        return;
+    }
+    globCompile(&state->glob, pattern, len, literal);
+
+    if (prefix_index_enabled &&
+        (state->glob.kind == GLOB_PREFIX || state->glob.kind == GLOB_ANY)) {
+        if (state->may_build_index)
+            prefixIndexRequest(ctx);
+        if (prefixIndexReady(ctx)) {
+            state->index_db = RedisModule_GetSelectedDb(ctx);
+            state->index_epoch = prefix_index_epoch;
+        }
+    }
+    /* The index walks only the matching keys, the slot also the others of
+     * the slot. */
+    if (slot_scan && state->index_db < 0)
+        state->slot = globHashSlot(&state->glob);
+}
 
-    long long delLen, pubLen;
-    delLen = delCount;
-    pubLen = 2*pubPairsCount;
-    if (delLen + pubLen + 3 != argc)
-        return RedisModule_ReplyWithError(ctx, "ERR DEL_COUNT or PUB_PAIR_COUNT do not match the total pair count");
+/* Walks the prefix index or the slot when the pattern allows, the keyspace
+ * otherwise. Call with the context locked. */
+ScannedKeys *walkSome(RedisModuleCtx *ctx, ScanSomeState *state, ExstringsStatus *status)
+{
+    if (!state->started)
+        scanSomeStart(ctx, state);
+
+    if (state->index_db >= 0) {
+        PrefixIndex *idx = prefixIndexGet(state->index_db, false);
+        if (idx && idx->state == PREFIX_INDEX_READY && state->index_epoch == prefix_index_epoch)
+            return indexSome(ctx, state, idx, status);
+        /* Dropped between two batches, finish with SCAN. */
+        state->index_db = -1;
+        state->cursor = 0;
+    }
+    if (state->slot >= 0) {
+        ScannedKeys *keys = slotSome(ctx, state, status);
+        if (state->slot >= 0)
+            return keys;
+        state->cursor = 0;
+    }
+    if (native_scan_enabled && !state->need_scan_cursor)
+        return nativeScanSome(ctx, state, status);
+    return scanSome(ctx, state, status);
+}
 
-    DelParams delParams = {
-                           .keys = argv + 3,
-                           .length = delLen
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 3 + delParams.length,
-                           .length = pubLen
-                          };
+/* The next batch of keys, counted for the slow log. */
+ScannedKeys *nextKeys(RedisModuleCtx *ctx, ScanSomeState *state, ExstringsStatus *status)
+{
+    ScannedKeys *keys = walkSome(ctx, state, status);
 
-    return delPubStringCommon(ctx, &delParams, &pubParams);
+    state->iterations++;
+    if (keys)
+        state->matched += keys->len;
+    return keys;
 }
 
-int delIENEPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+inline void unlockThreadsafeContext(RedisModuleCtx *ctx, bool using_threadsafe_context)
 {
-    DelParams delParams = {
-                           .keys = argv + 1,
-                           .length = 1
-                          };
-    PubParams pubParams = {
-                           .channel_msg_pairs = argv + 3,
-                           .length = argc - 3
-                          };
-    RedisModuleString *key = argv[1];
-    RedisModuleString *oldvalstr = argv[2];
+    if (using_threadsafe_context)
+        RedisModule_ThreadSafeContextUnlock(ctx);
+}
 
-    int type = getKeyType(ctx, key);
-    if (type == REDISMODULE_KEYTYPE_EMPTY) {
-        return RedisModule_ReplyWithLongLong(ctx, 0);
-    } else if (type != REDISMODULE_KEYTYPE_STRING) {
-        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
-    }
+inline void lockThreadsafeContext(RedisModuleCtx *ctx, bool using_threadsafe_context)
+{
+    if (using_threadsafe_context)
+        RedisModule_ThreadSafeContextLock(ctx);
+}
 
-    RedisModuleCallReply *reply = RedisModule_Call(ctx, "GET", "s", key);
-    ASSERT_NOERROR(reply)
-    bool is_equal = replyContentsEqualString(reply, oldvalstr);
-    RedisModule_FreeCallReply(reply);
-    if ((flag == OBJ_OP_IE && !is_equal) ||
-        (flag == OBJ_OP_NE && is_equal)) {
-        return RedisModule_ReplyWithLongLong(ctx, 0);
-    }
+/* Publishing with the publish API of the server, which sends the message
+ * without running a PUBLISH command and building its reply. Servers without
+ * the API run PUBLISH. Returns the number of receivers. */
+bool native_publish_enabled = false;
 
-    return delPubStringCommon(ctx, &delParams, &pubParams);
+long long publishMessage(RedisModuleCtx *ctx, RedisModuleString *channel, RedisModuleString *message)
+{
+    long long receivers = 0;
+
+    if (native_publish_enabled) {
+        receivers = RedisModule_PublishMessage(ctx, channel, message);
+    } else {
+        RedisModuleCallReply *reply = RedisModule_Call(ctx, "PUBLISH", "ss", channel, message);
+        if (reply && RedisModule_CallReplyType(reply) == REDISMODULE_REPLY_INTEGER)
+            receivers = RedisModule_CallReplyInteger(reply);
+        RedisModule_FreeCallReply(reply);
+    }
+    return receivers;
 }
 
-int DelIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* With the PACKED option the messages that one command posts to the same
+ * channel are sent in one packed frame, see pubframe.h, to the channel named
+ * with PACKED_CHANNEL_SUFFIX appended, so that frames and plain messages
+ * never share a channel. A channel with a single message gets a frame of
+ * one. The channels are grouped in one pass and get their frames in the
+ * order of their first message. */
+void packedPubCommand(RedisModuleCtx *ctx, PubParams *pubParams)
 {
-    if (argc != 5)
-        return RedisModule_WrongArity(ctx);
+    RedisModuleString **pairs = pubParams->channel_msg_pairs;
+    size_t npairs = pubParams->length / 2, ngroups = 0, i, g, len;
+    size_t *group = RedisModule_Alloc(npairs * sizeof(*group));
+    size_t *first = RedisModule_Alloc(npairs * sizeof(*first));
+    size_t *count = RedisModule_Alloc(npairs * sizeof(*count));
+    size_t *total = RedisModule_Alloc(npairs * sizeof(*total));
+    char **frame = RedisModule_Alloc(npairs * sizeof(*frame));
+    char **end = RedisModule_Alloc(npairs * sizeof(*end));
+    NsDict channels;
+
+    nsDictInit(&channels);
+    for (i = 0; i < npairs; i++) {
+        const char *ch = RedisModule_StringPtrLen(pairs[2*i], &len);
+        NsEntry *e = nsDictFind(&channels, ch, len);
+        if (e) {
+            memcpy(&g, nsEntryValue(e), sizeof(g));
+        } else {
+            g = ngroups++;
+            nsDictSet(&channels, ch, len, (const char *)&g, sizeof(g));
+            first[g] = i;
+            count[g] = 0;
+            total[g] = 0;
+        }
+        group[i] = g;
+        count[g]++;
+        RedisModule_StringPtrLen(pairs[2*i + 1], &len);
+        total[g] += len;
+    }
+    nsDictClear(&channels);
 
-    RedisModule_AutoMemory(ctx);
-    return delIENEPubStringCommon(ctx, argv, argc, OBJ_OP_IE);
+    for (g = 0; g < ngroups; g++) {
+        frame[g] = RedisModule_Alloc(pubFrameMaxSize(count[g], total[g]));
+        end[g] = pubFrameStart(frame[g], count[g]);
+    }
+    for (i = 0; i < npairs; i++) {
+        const char *msg = RedisModule_StringPtrLen(pairs[2*i + 1], &len);
+        end[group[i]] = pubFrameAppend(end[group[i]], msg, len);
+    }
+    for (g = 0; g < ngroups; g++) {
+        const char *ch = RedisModule_StringPtrLen(pairs[2*first[g]], &len);
+        char *name = RedisModule_Alloc(len + sizeof(PACKED_CHANNEL_SUFFIX));
+        memcpy(name, ch, len);
+        memcpy(name + len, PACKED_CHANNEL_SUFFIX, sizeof(PACKED_CHANNEL_SUFFIX));
+        RedisModuleString *channel = RedisModule_CreateString(ctx, name,
+                                        len + sizeof(PACKED_CHANNEL_SUFFIX) - 1);
+        RedisModule_Free(name);
+        RedisModuleString *packed = RedisModule_CreateString(ctx, frame[g], end[g] - frame[g]);
+        publishMessage(ctx, channel, packed);
+        RedisModule_FreeString(ctx, packed);
+        RedisModule_FreeString(ctx, channel);
+        RedisModule_Free(frame[g]);
+    }
+    RedisModule_Free(end);
+    RedisModule_Free(frame);
+    RedisModule_Free(total);
+    RedisModule_Free(count);
+    RedisModule_Free(first);
+    RedisModule_Free(group);
 }
 
-int DelIEMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Consumes a trailing PACKED argument, if any, by shortening 'argc'. Only
+ * called where the argument count tells it apart from a message. */
+bool readPacked(RedisModuleString **argv, int *argc)
 {
-    if (argc < 5 || (argc % 2) == 0)
-        return RedisModule_WrongArity(ctx);
+    size_t optlen;
+    const char *opt = RedisModule_StringPtrLen(argv[*argc - 1], &optlen);
 
-    RedisModule_AutoMemory(ctx);
-    return delIENEPubStringCommon(ctx, argv, argc, OBJ_OP_IE);
+    if (strcasecmp(opt, PACKED_STR))
+        return false;
+    (*argc)--;
+    return true;
 }
 
-int DelNEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+void multiPubCommand(RedisModuleCtx *ctx, PubParams* pubParams)
 {
-    if (argc != 5)
-        return RedisModule_WrongArity(ctx);
-
-    RedisModule_AutoMemory(ctx);
-    return delIENEPubStringCommon(ctx, argv, argc, OBJ_OP_NE);
+    if (pubParams->packed) {
+        packedPubCommand(ctx, pubParams);
+        return;
+    }
+    for (size_t i = 0 ; i < pubParams->length ; i += 2)
+        publishMessage(ctx, pubParams->channel_msg_pairs[i], pubParams->channel_msg_pairs[i + 1]);
 }
 
-int Nget_RedisCommand(RedisModuleCtx *ctx, NgetArgs* nget_args, bool using_threadsafe_context)
+int setStringGenericCommand(RedisModuleCtx *ctx, RedisModuleString **argv,
+                                       int argc, const int flag)
 {
-    int ret = REDISMODULE_OK;
-    size_t replylen = 0;
+    RedisModuleString *oldvalstr = NULL;
     RedisModuleCallReply *reply = NULL;
-    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
-    ScanSomeState scan_state;
-    ScannedKeys *scanned_keys;
+    mstime_t expire;
 
-    scan_state.key = nget_args->key;
-    scan_state.count = nget_args->count;
-    scan_state.cursor = 0;
+    if (argc < 4)
+        return wrongArity(ctx);
+    else
+        oldvalstr = argv[3];
+    if (!oldValueArgValid(oldvalstr, flag))
+        return replyWithError(ctx,"-ERR invalid digest");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyCondition(key, oldvalstr, flag);
+    if (cond != KEY_CONDITION_MET) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, flag, -1);
+        RedisModule_CloseKey(key);
+        return ret;
+    }
 
-    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
-    do {
-        lockThreadsafeContext(ctx, using_threadsafe_context);
+    /* Prepare the arguments for the command. */
+    int i, j=0, cmdargc=argc-2;
+    RedisModuleString *cmdargv[cmdargc];
+    for (i = 1; i < argc; i++) {
+        if (i == 3)
+            continue;
+        cmdargv[j++] = argv[i];
+    }
 
-        status = EXSTRINGS_STATUS_NOT_SET;
-        scanned_keys = scanSome(ctx, &scan_state, &status);
+    if (nativeKeyApiAvailable() && readSetExpire(argv + 4, argc - 4, &expire)) {
+        key = reopenKeyForWrite(ctx, key, argv[1]);
+        RedisModule_StringSet(key, argv[2]);
+        if (expire != REDISMODULE_NO_EXPIRE)
+            RedisModule_SetExpire(key, expire);
+        RedisModule_CloseKey(key);
+
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_STRING, "set", argv[1]);
+        if (expire != REDISMODULE_NO_EXPIRE)
+            RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "expire", argv[1]);
+        RedisModule_Replicate(ctx, "SET", "v", cmdargv, cmdargc);
+        return RedisModule_ReplyWithSimpleString(ctx, "OK");
+    }
+    RedisModule_CloseKey(key);
+
+    /* Call the command and pass back the reply. */
+    reply = RedisModule_Call(ctx, "SET", "v!", cmdargv, cmdargc);
+    ASSERT_NOERROR(reply)
+    RedisModule_ReplyWithCallReply(ctx, reply);
+
+    RedisModule_FreeCallReply(reply);
+    return REDISMODULE_OK;
+}
+
+int SetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    int flag = OBJ_OP_IE | readReturnCurrent(argv, &argc, 4);
+    return setStringGenericCommand(ctx, argv, argc, flag);
+}
+
+int SetNE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    return setStringGenericCommand(ctx, argv, argc, OBJ_OP_NE);
+}
+
+int SetIEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    int flag = OBJ_OP_IE | OBJ_OP_DIGEST | readReturnCurrent(argv, &argc, 4);
+    return setStringGenericCommand(ctx, argv, argc, flag);
+}
+
+int SetNEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    return setStringGenericCommand(ctx, argv, argc, OBJ_OP_NE | OBJ_OP_DIGEST);
+}
+
+int delStringGenericCommand(RedisModuleCtx *ctx, RedisModuleString **argv,
+                                       int argc, const int flag)
+{
+    RedisModuleString *oldvalstr = NULL;
+    RedisModuleCallReply *reply = NULL;
+
+    if (argc == 3)
+        oldvalstr = argv[2];
+    else
+        return wrongArity(ctx);
+    if (!oldValueArgValid(oldvalstr, flag))
+        return replyWithError(ctx,"-ERR invalid digest");
+
+    /* Only an existing key can be deleted, hence OBJ_OP_XX. */
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyCondition(key, oldvalstr, flag | OBJ_OP_XX);
+    if (cond != KEY_CONDITION_MET) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, flag, 0);
+        RedisModule_CloseKey(key);
+        return ret;
+    }
+
+    if (nativeKeyApiAvailable()) {
+        key = reopenKeyForWrite(ctx, key, argv[1]);
+        RedisModule_UnlinkKey(key);
+        RedisModule_CloseKey(key);
+
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "del", argv[1]);
+        RedisModule_Replicate(ctx, "UNLINK", "s", argv[1]);
+        return RedisModule_ReplyWithLongLong(ctx, 1);
+    }
+    RedisModule_CloseKey(key);
+
+    /* Prepare the arguments for the command. */
+    int cmdargc=1;
+    RedisModuleString *cmdargv[1];
+    cmdargv[0] = argv[1];
+
+    /* Call the command and pass back the reply. */
+    reply = RedisModule_Call(ctx, "UNLINK", "v!", cmdargv, cmdargc);
+    ASSERT_NOERROR(reply)
+    RedisModule_ReplyWithCallReply(ctx, reply);
+
+    RedisModule_FreeCallReply(reply);
+    return REDISMODULE_OK;
+}
+
+int DelIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    int flag = OBJ_OP_IE | readReturnCurrent(argv, &argc, 3);
+    return delStringGenericCommand(ctx, argv, argc, flag);
+}
+
+int DelNE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    return delStringGenericCommand(ctx, argv, argc, OBJ_OP_NE);
+}
+
+int DelIEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    int flag = OBJ_OP_IE | OBJ_OP_DIGEST | readReturnCurrent(argv, &argc, 3);
+    return delStringGenericCommand(ctx, argv, argc, flag);
+}
+
+int DelNEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    return delStringGenericCommand(ctx, argv, argc, OBJ_OP_NE | OBJ_OP_DIGEST);
+}
+int setPubStringCommon(RedisModuleCtx *ctx, SetParams* setParamsPtr, PubParams* pubParamsPtr)
+{
+    RedisModuleCallReply *setReply;
+    setReply = RedisModule_Call(ctx, "MSET", "v!", setParamsPtr->key_val_pairs, setParamsPtr->length);
+    ASSERT_NOERROR(setReply)
+    multiPubCommand(ctx, pubParamsPtr);
+    RedisModule_ReplyWithCallReply(ctx, setReply);
+    RedisModule_FreeCallReply(setReply);
+    return REDISMODULE_OK;
+}
+
+int SetPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 5 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    SetParams setParams = {
+                           .key_val_pairs = argv + 1,
+                           .length = argc - 3
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 1 + setParams.length,
+                           .length = 2
+                          };
+
+    cmdStatsKeys(setParams.length / 2);
+    return setPubStringCommon(ctx, &setParams, &pubParams);
+}
+
+int SetMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    bool packed = false;
+
+    /* Without PACKED the argument count is odd */
+    if (argc >= 8 && (argc % 2) == 0)
+        packed = readPacked(argv, &argc);
+    if (argc < 7 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    long long setPairsCount, pubPairsCount;
+    RedisModule_StringToLongLong(argv[1], &setPairsCount);
+    RedisModule_StringToLongLong(argv[2], &pubPairsCount);
+    if (setPairsCount < 1 || pubPairsCount < 1)
+        return replyWithError(ctx, "ERR SET_PAIR_COUNT and PUB_PAIR_COUNT must be greater than zero");
+
+    long long setLen, pubLen;
+    setLen = 2*setPairsCount;
+    pubLen = 2*pubPairsCount;
+
+    if (setLen + pubLen + 3 != argc)
+        return replyWithError(ctx, "ERR SET_PAIR_COUNT or PUB_PAIR_COUNT do not match the total pair count");
+
+    SetParams setParams = {
+                           .key_val_pairs = argv + 3,
+                           .length = setLen
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 3 + setParams.length,
+                           .length = pubLen,
+                           .packed = packed
+                          };
+
+    cmdStatsKeys(setParams.length / 2);
+    return setPubStringCommon(ctx, &setParams, &pubParams);
+}
+
+/* The value as stored by CSET, counted in CSTATS. */
+RedisModuleString *encodeValueString(RedisModuleCtx *ctx, RedisModuleString *value)
+{
+    size_t len, enclen;
+    bool compressed;
+    const char *val = RedisModule_StringPtrLen(value, &len);
+    char *buf = RedisModule_Alloc(valueEncodeBound(len));
+
+    enclen = valueEncode(val, len, (size_t)compress_min, buf, &compressed);
+    RedisModuleString *encoded = RedisModule_CreateString(ctx, buf, enclen);
+    RedisModule_Free(buf);
+
+    compress_stats.values++;
+    if (compressed)
+        compress_stats.compressed++;
+    compress_stats.bytes_in += len;
+    compress_stats.bytes_stored += enclen;
+    return encoded;
+}
+
+/* Shared engine of SET{IE,NE,XX,NX}[M]PUB. The existence, type and value
+ * check and the write are done on one opened key. With OBJ_OP_COMPRESS the
+ * value is encoded in place, so the pairs must not be the argv of redis. */
+int setCondPubStringCommon(RedisModuleCtx *ctx, SetParams *setParamsPtr, RedisModuleString *oldvalstr,
+                           PubParams *pubParamsPtr, int flag)
+{
+    RedisModuleString *keystr = setParamsPtr->key_val_pairs[0];
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyCondition(key, oldvalstr, flag);
+    if (cond != KEY_CONDITION_MET) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, flag, -1);
+        RedisModule_CloseKey(key);
+        return ret;
+    }
+
+    if (flag & OBJ_OP_COMPRESS)
+        setParamsPtr->key_val_pairs[1] = encodeValueString(ctx, setParamsPtr->key_val_pairs[1]);
+
+    if (!nativeKeyApiAvailable()) {
+        RedisModule_CloseKey(key);
+        return setPubStringCommon(ctx, setParamsPtr, pubParamsPtr);
+    }
+
+    key = reopenKeyForWrite(ctx, key, keystr);
+    RedisModule_StringSet(key, setParamsPtr->key_val_pairs[1]);
+    RedisModule_CloseKey(key);
+    RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_STRING, "set", keystr);
+    RedisModule_Replicate(ctx, "MSET", "v", setParamsPtr->key_val_pairs, setParamsPtr->length);
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
+
+int setIENEPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    SetParams setParams = {
+                           .key_val_pairs = argv + 1,
+                           .length = 2
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 4,
+                           .length = argc - 4
+                          };
+    RedisModuleString *oldvalstr = argv[3];
+
+    if (!oldValueArgValid(oldvalstr, flag))
+        return replyWithError(ctx,"-ERR invalid digest");
+    return setCondPubStringCommon(ctx, &setParams, oldvalstr, &pubParams, flag);
+}
+
+int setIEPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc == 7)
+        flag |= readReturnCurrent(argv, &argc, 6);
+    if (argc != 6)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int setIEMPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc < 6 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int setNEPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc != 6)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int SetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setIEPubCommand(ctx, argv, argc, OBJ_OP_IE);
+}
+
+int SetIEMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setIEMPubCommand(ctx, argv, argc, OBJ_OP_IE);
+}
+
+int SetNEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setNEPubCommand(ctx, argv, argc, OBJ_OP_NE);
+}
+
+int SetIEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setIEPubCommand(ctx, argv, argc, OBJ_OP_IE | OBJ_OP_DIGEST);
+}
+
+int SetIEDigestMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setIEMPubCommand(ctx, argv, argc, OBJ_OP_IE | OBJ_OP_DIGEST);
+}
+
+int SetNEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return setNEPubCommand(ctx, argv, argc, OBJ_OP_NE | OBJ_OP_DIGEST);
+}
+
+int setXXNXPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    SetParams setParams = {
+                           .key_val_pairs = argv + 1,
+                           .length = 2
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 3,
+                           .length = argc - 3
+                          };
+
+    return setCondPubStringCommon(ctx, &setParams, NULL, &pubParams, flag);
+}
+
+int SetNXPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_NX);
+}
+
+int SetNXMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 5 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_NX);
+}
+
+int SetXXPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return setXXNXPubStringCommon(ctx, argv, argc, OBJ_OP_XX);
+}
+
+int delPubStringCommon(RedisModuleCtx *ctx, DelParams *delParamsPtr, PubParams *pubParamsPtr)
+{
+    RedisModuleCallReply *reply = RedisModule_Call(ctx, "UNLINK", "v!", delParamsPtr->keys, delParamsPtr->length);
+    ASSERT_NOERROR(reply)
+    int replytype = RedisModule_CallReplyType(reply);
+    if (replytype == REDISMODULE_REPLY_NULL) {
+        RedisModule_ReplyWithNull(ctx);
+    } else if (RedisModule_CallReplyInteger(reply) == 0) {
+        RedisModule_ReplyWithCallReply(ctx, reply);
+    } else {
+        RedisModule_ReplyWithCallReply(ctx, reply);
+        multiPubCommand(ctx, pubParamsPtr);
+    }
+    RedisModule_FreeCallReply(reply);
+    return REDISMODULE_OK;
+}
+
+int DelPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 4)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    DelParams delParams = {
+                           .keys = argv + 1,
+                           .length = argc - 3
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 1 + delParams.length,
+                           .length = 2
+                          };
+
+    cmdStatsKeys(delParams.length);
+    return delPubStringCommon(ctx, &delParams, &pubParams);
+}
+
+int DelMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 6)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    long long delCount, pubPairsCount;
+    RedisModule_StringToLongLong(argv[1], &delCount);
+    RedisModule_StringToLongLong(argv[2], &pubPairsCount);
+    if (delCount < 1 || pubPairsCount < 1)
+        return replyWithError(ctx, "ERR DEL_COUNT and PUB_PAIR_COUNT must be greater than zero");
+
+    long long delLen, pubLen;
+    bool packed = false;
+    delLen = delCount;
+    pubLen = 2*pubPairsCount;
+    if (delLen + pubLen + 4 == argc)
+        packed = readPacked(argv, &argc);
+    if (delLen + pubLen + 3 != argc)
+        return replyWithError(ctx, "ERR DEL_COUNT or PUB_PAIR_COUNT do not match the total pair count");
+
+    DelParams delParams = {
+                           .keys = argv + 3,
+                           .length = delLen
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 3 + delParams.length,
+                           .length = pubLen,
+                           .packed = packed
+                          };
+
+    cmdStatsKeys(delParams.length);
+    return delPubStringCommon(ctx, &delParams, &pubParams);
+}
+
+/* Shared engine of DEL{IE,NE}[M]PUB, see setCondPubStringCommon. */
+int delCondPubStringCommon(RedisModuleCtx *ctx, DelParams *delParamsPtr, RedisModuleString *oldvalstr,
+                           PubParams *pubParamsPtr, int flag)
+{
+    RedisModuleString *keystr = delParamsPtr->keys[0];
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyCondition(key, oldvalstr, flag | OBJ_OP_XX);
+    if (cond != KEY_CONDITION_MET) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, flag, 0);
+        RedisModule_CloseKey(key);
+        return ret;
+    }
+
+    if (!nativeKeyApiAvailable()) {
+        RedisModule_CloseKey(key);
+        return delPubStringCommon(ctx, delParamsPtr, pubParamsPtr);
+    }
+
+    key = reopenKeyForWrite(ctx, key, keystr);
+    RedisModule_UnlinkKey(key);
+    RedisModule_CloseKey(key);
+    RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "del", keystr);
+    RedisModule_Replicate(ctx, "UNLINK", "v", delParamsPtr->keys, delParamsPtr->length);
+    RedisModule_ReplyWithLongLong(ctx, 1);
+    multiPubCommand(ctx, pubParamsPtr);
+    return REDISMODULE_OK;
+}
+
+int delIENEPubStringCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    DelParams delParams = {
+                           .keys = argv + 1,
+                           .length = 1
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 3,
+                           .length = argc - 3
+                          };
+    RedisModuleString *oldvalstr = argv[2];
+
+    if (!oldValueArgValid(oldvalstr, flag))
+        return replyWithError(ctx,"-ERR invalid digest");
+    return delCondPubStringCommon(ctx, &delParams, oldvalstr, &pubParams, flag);
+}
+
+int delIEPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc == 6)
+        flag |= readReturnCurrent(argv, &argc, 5);
+    if (argc != 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return delIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int delIEMPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc < 5 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return delIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int delNEPubCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int flag)
+{
+    if (argc != 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return delIENEPubStringCommon(ctx, argv, argc, flag);
+}
+
+int DelIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delIEPubCommand(ctx, argv, argc, OBJ_OP_IE);
+}
+
+int DelIEMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delIEMPubCommand(ctx, argv, argc, OBJ_OP_IE);
+}
+
+int DelNEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delNEPubCommand(ctx, argv, argc, OBJ_OP_NE);
+}
+
+int DelIEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delIEPubCommand(ctx, argv, argc, OBJ_OP_IE | OBJ_OP_DIGEST);
+}
+
+int DelIEDigestMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delIEMPubCommand(ctx, argv, argc, OBJ_OP_IE | OBJ_OP_DIGEST);
+}
+
+int DelNEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    return delNEPubCommand(ctx, argv, argc, OBJ_OP_NE | OBJ_OP_DIGEST);
+}
+
+/* Value of the versioned type: a string and a version that is incremented by
+ * every SETIFVER, so compare-and-set costs the same for any value size. */
+typedef struct _VersionedValue {
+    long long version;
+    size_t len;
+    char *buf;
+} VersionedValue;
+
+void *createVersionedValue(const char *buf, size_t len, long long version)
+{
+    VersionedValue *vv = RedisModule_Alloc(sizeof(VersionedValue));
+    vv->version = version;
+    vv->len = len;
+    vv->buf = RedisModule_Alloc(len ? len : 1);
+    memcpy(vv->buf, buf, len);
+    return vv;
+}
+
+void freeVersionedValue(void *value)
+{
+    VersionedValue *vv = value;
+    RedisModule_Free(vv->buf);
+    RedisModule_Free(vv);
+}
+
+void *versionedRdbLoad(RedisModuleIO *rdb, int encver)
+{
+    if (encver != VERSIONED_TYPE_ENCVER)
+        return NULL;
+
+    VersionedValue *vv = RedisModule_Alloc(sizeof(VersionedValue));
+    vv->version = (long long)RedisModule_LoadUnsigned(rdb);
+    vv->buf = RedisModule_LoadStringBuffer(rdb, &vv->len);
+    return vv;
+}
+
+void versionedRdbSave(RedisModuleIO *rdb, void *value)
+{
+    VersionedValue *vv = value;
+    RedisModule_SaveUnsigned(rdb, (uint64_t)vv->version);
+    RedisModule_SaveStringBuffer(rdb, vv->buf, vv->len);
+}
+
+void versionedAofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value)
+{
+    VersionedValue *vv = value;
+    RedisModule_EmitAOF(aof, "SETVER", "sbl", key, vv->buf, vv->len, vv->version);
+}
+
+size_t versionedMemUsage(const void *value)
+{
+    const VersionedValue *vv = value;
+    return sizeof(VersionedValue) + vv->len;
+}
+
+/* Checks an opened key against the version a client read earlier; a missing
+ * key has version 0. The version of the key is stored to 'current'. */
+KeyCondition checkKeyVersion(RedisModuleKey *key, long long version, long long *current)
+{
+    int type = RedisModule_KeyType(key);
+
+    *current = 0;
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return version == 0 ? KEY_CONDITION_MET : KEY_CONDITION_NOT_MET;
+    if (type != REDISMODULE_KEYTYPE_MODULE ||
+        RedisModule_ModuleTypeGetType(key) != versioned_type)
+        return KEY_CONDITION_WRONGTYPE;
+
+    VersionedValue *vv = RedisModule_ModuleTypeGetValue(key);
+    *current = vv->version;
+    return version == vv->version ? KEY_CONDITION_MET : KEY_CONDITION_NOT_MET;
+}
+
+/* Parses a version argument, replying with an error if it is not valid. */
+int readVersion(RedisModuleCtx *ctx, RedisModuleString *str, long long *version)
+{
+    if (RedisModule_StringToLongLong(str, version) != REDISMODULE_OK || *version < 0) {
+        replyWithError(ctx, "ERR version is not an integer or out of range");
+        return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+int GetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    long long current;
+
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyVersion(key, 0, &current);
+    if (cond == KEY_CONDITION_WRONGTYPE) {
+        RedisModule_CloseKey(key);
+        return replyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    } else if (current == 0) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithNull(ctx);
+    }
+
+    VersionedValue *vv = RedisModule_ModuleTypeGetValue(key);
+    RedisModule_ReplyWithArray(ctx, 2);
+    RedisModule_ReplyWithStringBuffer(ctx, vv->buf, vv->len);
+    RedisModule_ReplyWithLongLong(ctx, vv->version);
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+/* Shared engine of SETIFVER and SETIFVERPUB. Replies the new version, or nil
+ * if 'verstr' is not the current version of the key. */
+int setIfVerPubCommon(RedisModuleCtx *ctx, RedisModuleString *keystr, RedisModuleString *valstr,
+                      RedisModuleString *verstr, PubParams *pubParamsPtr)
+{
+    long long version, current;
+    size_t len;
+
+    if (readVersion(ctx, verstr, &version) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyVersion(key, version, &current);
+    if (cond != KEY_CONDITION_WRONGTYPE)
+        cmdStatsCondition(cond == KEY_CONDITION_MET);
+    if (cond != KEY_CONDITION_MET) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, OBJ_OP_NO, -1);
+        RedisModule_CloseKey(key);
+        return ret;
+    } else if (current == LLONG_MAX) {
+        RedisModule_CloseKey(key);
+        return replyWithError(ctx, "ERR version would overflow");
+    }
+
+    const char *val = RedisModule_StringPtrLen(valstr, &len);
+    key = reopenKeyForWrite(ctx, key, keystr);
+    RedisModule_ModuleTypeSetValue(key, versioned_type, createVersionedValue(val, len, current + 1));
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "setver", keystr);
+    RedisModule_Replicate(ctx, "SETVER", "ssl", keystr, valstr, current + 1);
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithLongLong(ctx, current + 1);
+}
+
+/* Shared engine of DELIFVER and DELIFVERPUB. Replies 1 if the key was
+ * deleted, 0 if it does not exist or 'verstr' is not its current version. */
+int delIfVerPubCommon(RedisModuleCtx *ctx, RedisModuleString *keystr, RedisModuleString *verstr,
+                      PubParams *pubParamsPtr)
+{
+    long long version, current;
+
+    if (readVersion(ctx, verstr, &version) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ);
+    cmdStatsKeys(1);
+    KeyCondition cond = checkKeyVersion(key, version, &current);
+    if (cond != KEY_CONDITION_WRONGTYPE)
+        cmdStatsCondition(cond == KEY_CONDITION_MET && current != 0);
+    if (cond != KEY_CONDITION_MET || current == 0) {
+        int ret = replyKeyConditionNotMet(ctx, key, cond, OBJ_OP_NO, 0);
+        RedisModule_CloseKey(key);
+        return ret;
+    }
+
+    key = reopenKeyForWrite(ctx, key, keystr);
+    RedisModule_UnlinkKey(key);
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "del", keystr);
+    RedisModule_Replicate(ctx, "UNLINK", "s", keystr);
+    RedisModule_ReplyWithLongLong(ctx, 1);
+    multiPubCommand(ctx, pubParamsPtr);
+    return REDISMODULE_OK;
+}
+
+int SetIfVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 4)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return setIfVerPubCommon(ctx, argv[1], argv[2], argv[3], &pubParams);
+}
+
+int SetIfVerPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 6 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 4,
+                           .length = argc - 4
+                          };
+    return setIfVerPubCommon(ctx, argv[1], argv[2], argv[3], &pubParams);
+}
+
+int DelIfVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 3)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return delIfVerPubCommon(ctx, argv[1], argv[2], &pubParams);
+}
+
+int DelIfVerPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 5 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 3,
+                           .length = argc - 3
+                          };
+    return delIfVerPubCommon(ctx, argv[1], argv[2], &pubParams);
+}
+
+/* Sets a versioned value with the given version unconditionally. SETIFVER
+ * replicates as SETVER, and AOF rewrite emits it, so that replicas and
+ * reloads end up with exactly the version of the master. Versions start
+ * from 1 as 0 stands for a missing key. */
+int SetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    long long version;
+    size_t len;
+
+    if (argc != 4)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    if (readVersion(ctx, argv[3], &version) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (version == 0)
+        return replyWithError(ctx, "ERR version is not an integer or out of range");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    cmdStatsKeys(1);
+    int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY &&
+        (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != versioned_type)) {
+        RedisModule_CloseKey(key);
+        return replyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    }
+
+    const char *val = RedisModule_StringPtrLen(argv[2], &len);
+    RedisModule_ModuleTypeSetValue(key, versioned_type, createVersionedValue(val, len, version));
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "setver", argv[1]);
+    RedisModule_Replicate(ctx, "SETVER", "v", argv + 1, 3);
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
+
+/* Value of the namespace type: the entries of one SDL namespace as the
+ * fields of a single key, see nsdict.h. Reading or clearing a namespace
+ * walks one table instead of the keyspace, and an entry costs a table slot
+ * and one allocation instead of a key, a string object and a dict entry. */
+void *createNsValue(void)
+{
+    NsDict *d = RedisModule_Alloc(sizeof(NsDict));
+    nsDictInit(d);
+    return d;
+}
+
+void freeNsValue(void *value)
+{
+    nsDictClear(value);
+    RedisModule_Free(value);
+}
+
+void *nsRdbLoad(RedisModuleIO *rdb, int encver)
+{
+    uint64_t n, i;
+    size_t fieldlen, valuelen;
+
+    if (encver != NS_TYPE_ENCVER)
+        return NULL;
+
+    NsDict *d = createNsValue();
+    n = RedisModule_LoadUnsigned(rdb);
+    if (!nsDictReserve(d, n)) {
+        freeNsValue(d);
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        char *field = RedisModule_LoadStringBuffer(rdb, &fieldlen);
+        char *value = RedisModule_LoadStringBuffer(rdb, &valuelen);
+        int added = field && value ? nsDictSet(d, field, fieldlen, value, valuelen) : -1;
+        if (field)
+            RedisModule_Free(field);
+        if (value)
+            RedisModule_Free(value);
+        if (added < 0) {
+            freeNsValue(d);
+            return NULL;
+        }
+    }
+    return d;
+}
+
+void nsRdbSave(RedisModuleIO *rdb, void *value)
+{
+    NsDict *d = value;
+    NsEntry *e;
+    size_t pos = 0;
+
+    RedisModule_SaveUnsigned(rdb, d->len);
+    while ((e = nsDictNext(d, &pos)) != NULL) {
+        RedisModule_SaveStringBuffer(rdb, nsEntryField(e), e->fieldlen);
+        RedisModule_SaveStringBuffer(rdb, nsEntryValue(e), e->valuelen);
+    }
+}
+
+void nsAofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value)
+{
+    NsDict *d = value;
+    NsEntry *e;
+    size_t pos = 0;
+
+    while ((e = nsDictNext(d, &pos)) != NULL)
+        RedisModule_EmitAOF(aof, "NS.SET", "sbb", key, nsEntryField(e), (size_t)e->fieldlen,
+                            nsEntryValue(e), (size_t)e->valuelen);
+}
+
+size_t nsMemUsage(const void *value)
+{
+    return sizeof(NsDict) + nsDictMemUsage(value);
+}
+
+/* Lets UNLINK and NS.CLEAR free large namespaces in a background thread. */
+size_t nsFreeEffort(RedisModuleString *key, const void *value)
+{
+    const NsDict *d = value;
+    (void)key;
+    return d->len;
+}
+
+/* Moves the dict, its table and the entries. Large namespaces are done over
+ * several calls, resuming from the slot saved in the cursor. */
+int nsDefrag(RedisModuleDefragCtx *ctx, RedisModuleString *key, void **value)
+{
+    unsigned long i = 0;
+    NsDict *d = *value;
+    void *moved;
+    (void)key;
+
+    if (RedisModule_DefragCursorGet(ctx, &i) != REDISMODULE_OK)
+        i = 0;
+    if (i == 0) {
+        if ((moved = RedisModule_DefragAlloc(ctx, d)) != NULL)
+            *value = d = moved;
+        if (d->table && (moved = RedisModule_DefragAlloc(ctx, d->table)) != NULL)
+            d->table = moved;
+    }
+    for (; i < d->size; i++) {
+        NsEntry *e = &d->table[i];
+        if (e->data == NULL)
+            continue;
+        if ((moved = RedisModule_DefragAlloc(ctx, e->data)) != NULL)
+            e->data = moved;
+        if (i + 1 < d->size && RedisModule_DefragShouldStop(ctx)) {
+            RedisModule_DefragCursorSet(ctx, i + 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Opens a namespace key and stores its dict to 'd', NULL if the key does not
+ * exist. Replies WRONGTYPE and returns REDISMODULE_ERR, with the key closed,
+ * if it is not a namespace. */
+int nsOpenKey(RedisModuleCtx *ctx, RedisModuleString *keystr, int mode, RedisModuleKey **key, NsDict **d)
+{
+    *key = RedisModule_OpenKey(ctx, keystr, mode);
+    int type = RedisModule_KeyType(*key);
+
+    cmdStatsKeys(1);
+    *d = NULL;
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return REDISMODULE_OK;
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(*key) != ns_type) {
+        RedisModule_CloseKey(*key);
+        replyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+    *d = RedisModule_ModuleTypeGetValue(*key);
+    return REDISMODULE_OK;
+}
+
+/* Closes a namespace key after fields were removed, deleting it if it became
+ * empty, and sends the matching keyspace event. */
+void nsCloseRemoved(RedisModuleCtx *ctx, RedisModuleKey *key, RedisModuleString *keystr, NsDict *d)
+{
+    bool empty = d->len == 0;
+
+    if (empty)
+        RedisModule_UnlinkKey(key);
+    RedisModule_CloseKey(key);
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, empty ? "del" : "ns.del", keystr);
+}
+
+bool nsFieldValueFits(RedisModuleString **argv, int argc)
+{
+    size_t len;
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        RedisModule_StringPtrLen(argv[i], &len);
+        if (len > UINT32_MAX)
+            return false;
+    }
+    return true;
+}
+
+/* Shared engine of NS.SET and NS.SETPUB. 'argv' is the key followed by
+ * 'npairs' field value pairs. Replies the number of fields added. */
+int nsSetPubCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int npairs, PubParams *pubParamsPtr)
+{
+    const char *field, *value;
+    size_t fieldlen, valuelen;
+    long long added = 0;
+    RedisModuleKey *key;
+    NsDict *d;
+    int i;
+
+    if (!nsFieldValueFits(argv + 1, 2 * npairs))
+        return replyWithError(ctx, "ERR field or value is too long");
+
+    if (nsOpenKey(ctx, argv[0], REDISMODULE_READ | REDISMODULE_WRITE, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (d == NULL) {
+        d = createNsValue();
+        RedisModule_ModuleTypeSetValue(key, ns_type, d);
+    }
+    for (i = 0; i < npairs; i++) {
+        field = RedisModule_StringPtrLen(argv[1 + 2 * i], &fieldlen);
+        value = RedisModule_StringPtrLen(argv[2 + 2 * i], &valuelen);
+        added += nsDictSet(d, field, fieldlen, value, valuelen);
+    }
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "ns.set", argv[0]);
+    RedisModule_Replicate(ctx, "NS.SET", "v", argv, (size_t)(1 + 2 * npairs));
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithLongLong(ctx, added);
+}
+
+/* Shared engine of NS.DEL and NS.DELPUB. 'argv' is the key followed by
+ * 'nfields' fields. Publishes only if a field was removed. Replies the number
+ * of fields removed. */
+int nsDelPubCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int nfields, PubParams *pubParamsPtr)
+{
+    const char *field;
+    size_t fieldlen;
+    long long removed = 0;
+    RedisModuleKey *key;
+    NsDict *d;
+    int i;
+
+    if (nsOpenKey(ctx, argv[0], REDISMODULE_READ | REDISMODULE_WRITE, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    for (i = 0; d && i < nfields; i++) {
+        field = RedisModule_StringPtrLen(argv[1 + i], &fieldlen);
+        removed += nsDictDelete(d, field, fieldlen);
+    }
+    if (removed == 0) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithLongLong(ctx, 0);
+    }
+    nsCloseRemoved(ctx, key, argv[0], d);
+
+    RedisModule_Replicate(ctx, "NS.DEL", "v", argv, (size_t)(1 + nfields));
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithLongLong(ctx, removed);
+}
+
+/* Finds 'fieldstr' of a namespace if its value equals 'oldvalstr'. */
+NsEntry *nsFindEqual(NsDict *d, RedisModuleString *fieldstr, RedisModuleString *oldvalstr)
+{
+    size_t fieldlen, oldlen;
+    const char *field = RedisModule_StringPtrLen(fieldstr, &fieldlen);
+    const char *oldval = RedisModule_StringPtrLen(oldvalstr, &oldlen);
+    NsEntry *e = d ? nsDictFind(d, field, fieldlen) : NULL;
+
+    if (e && valueEqual(nsEntryValue(e), e->valuelen, oldval, oldlen))
+        return e;
+    return NULL;
+}
+
+/* Shared engine of NS.SETIE and NS.SETIEPUB. Replies OK, or nil if the field
+ * does not hold 'oldvalstr'. */
+int nsSetIEPubCommon(RedisModuleCtx *ctx, RedisModuleString **argv, PubParams *pubParamsPtr)
+{
+    const char *field, *value;
+    size_t fieldlen, valuelen;
+    RedisModuleKey *key;
+    NsDict *d;
+
+    if (!nsFieldValueFits(argv + 1, 2))
+        return replyWithError(ctx, "ERR field or value is too long");
+
+    if (nsOpenKey(ctx, argv[0], REDISMODULE_READ, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    bool met = nsFindEqual(d, argv[1], argv[3]) != NULL;
+    cmdStatsCondition(met);
+    if (!met) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithNull(ctx);
+    }
+
+    key = reopenKeyForWrite(ctx, key, argv[0]);
+    d = RedisModule_ModuleTypeGetValue(key);
+    field = RedisModule_StringPtrLen(argv[1], &fieldlen);
+    value = RedisModule_StringPtrLen(argv[2], &valuelen);
+    nsDictSet(d, field, fieldlen, value, valuelen);
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "ns.set", argv[0]);
+    RedisModule_Replicate(ctx, "NS.SET", "v", argv, (size_t)3);
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
+
+/* Shared engine of NS.DELIE and NS.DELIEPUB. Replies 1 if the field was
+ * removed, 0 if it does not hold 'oldvalstr'. */
+int nsDelIEPubCommon(RedisModuleCtx *ctx, RedisModuleString **argv, PubParams *pubParamsPtr)
+{
+    RedisModuleKey *key;
+    NsDict *d;
+
+    if (nsOpenKey(ctx, argv[0], REDISMODULE_READ, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    NsEntry *e = nsFindEqual(d, argv[1], argv[2]);
+    cmdStatsCondition(e != NULL);
+    if (e == NULL) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithLongLong(ctx, 0);
+    }
+
+    size_t fieldlen;
+    const char *field = RedisModule_StringPtrLen(argv[1], &fieldlen);
+    key = reopenKeyForWrite(ctx, key, argv[0]);
+    d = RedisModule_ModuleTypeGetValue(key);
+    nsDictDelete(d, field, fieldlen);
+    nsCloseRemoved(ctx, key, argv[0], d);
+
+    RedisModule_Replicate(ctx, "NS.DEL", "v", argv, (size_t)2);
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithLongLong(ctx, 1);
+}
+
+/* Shared engine of NS.CLEAR and NS.CLEARPUB. Replies the number of fields
+ * removed; a large namespace is freed lazily, see nsFreeEffort. */
+int nsClearPubCommon(RedisModuleCtx *ctx, RedisModuleString *keystr, PubParams *pubParamsPtr)
+{
+    RedisModuleKey *key;
+    NsDict *d;
+
+    if (nsOpenKey(ctx, keystr, REDISMODULE_READ | REDISMODULE_WRITE, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (d == NULL) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithLongLong(ctx, 0);
+    }
+
+    long long removed = (long long)d->len;
+    RedisModule_UnlinkKey(key);
+    RedisModule_CloseKey(key);
+
+    if (nativeKeyApiAvailable())
+        RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "del", keystr);
+    RedisModule_Replicate(ctx, "UNLINK", "s", keystr);
+    multiPubCommand(ctx, pubParamsPtr);
+    return RedisModule_ReplyWithLongLong(ctx, removed);
+}
+
+int NsSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 4 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return nsSetPubCommon(ctx, argv + 1, (argc - 2) / 2, &pubParams);
+}
+
+int NsSetPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 6 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + argc - 2,
+                           .length = 2
+                          };
+    return nsSetPubCommon(ctx, argv + 1, (argc - 4) / 2, &pubParams);
+}
+
+int NsGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    const char *field;
+    size_t fieldlen;
+    RedisModuleKey *key;
+    NsDict *d;
+
+    if (argc != 3)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    if (nsOpenKey(ctx, argv[1], REDISMODULE_READ, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    field = RedisModule_StringPtrLen(argv[2], &fieldlen);
+    NsEntry *e = d ? nsDictFind(d, field, fieldlen) : NULL;
+    if (e)
+        RedisModule_ReplyWithStringBuffer(ctx, nsEntryValue(e), e->valuelen);
+    else
+        RedisModule_ReplyWithNull(ctx);
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+int NsMGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    const char *field;
+    size_t fieldlen;
+    RedisModuleKey *key;
+    NsDict *d;
+    int i;
+
+    if (argc < 3)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    if (nsOpenKey(ctx, argv[1], REDISMODULE_READ, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    RedisModule_ReplyWithArray(ctx, argc - 2);
+    for (i = 2; i < argc; i++) {
+        field = RedisModule_StringPtrLen(argv[i], &fieldlen);
+        NsEntry *e = d ? nsDictFind(d, field, fieldlen) : NULL;
+        if (e)
+            RedisModule_ReplyWithStringBuffer(ctx, nsEntryValue(e), e->valuelen);
+        else
+            RedisModule_ReplyWithNull(ctx);
+    }
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+/* Replies the fields and values of a namespace as a flat array, the
+ * counterpart of NGET for namespaces stored with NS.SET. */
+int NsGetAll_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    size_t pos = 0;
+    NsEntry *e;
+    RedisModuleKey *key;
+    NsDict *d;
+
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    if (nsOpenKey(ctx, argv[1], REDISMODULE_READ, &key, &d) != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    RedisModule_ReplyWithArray(ctx, d ? 2 * (long)d->len : 0);
+    while (d && (e = nsDictNext(d, &pos)) != NULL) {
+        RedisModule_ReplyWithStringBuffer(ctx, nsEntryField(e), e->fieldlen);
+        RedisModule_ReplyWithStringBuffer(ctx, nsEntryValue(e), e->valuelen);
+    }
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+int NsDel_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 3)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return nsDelPubCommon(ctx, argv + 1, argc - 2, &pubParams);
+}
+
+int NsDelPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + argc - 2,
+                           .length = 2
+                          };
+    return nsDelPubCommon(ctx, argv + 1, argc - 4, &pubParams);
+}
+
+int NsSetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 5)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return nsSetIEPubCommon(ctx, argv + 1, &pubParams);
+}
+
+int NsSetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 7 || (argc % 2) == 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 5,
+                           .length = argc - 5
+                          };
+    return nsSetIEPubCommon(ctx, argv + 1, &pubParams);
+}
+
+int NsDelIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 4)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return nsDelIEPubCommon(ctx, argv + 1, &pubParams);
+}
+
+int NsDelIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 6 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 4,
+                           .length = argc - 4
+                          };
+    return nsDelIEPubCommon(ctx, argv + 1, &pubParams);
+}
+
+int NsClear_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+    return nsClearPubCommon(ctx, argv[1], &pubParams);
+}
+
+int NsClearPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 4 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 2,
+                           .length = argc - 2
+                          };
+    return nsClearPubCommon(ctx, argv[1], &pubParams);
+}
+
+/* CSET key value: SET of a value compressed when it is at least COMPRESSMIN
+ * bytes long and compressing saves space. */
+int CSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 3)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    RedisModuleString *pairs[2] = { argv[1], encodeValueString(ctx, argv[2]) };
+    SetParams setParams = {
+                           .key_val_pairs = pairs,
+                           .length = 2
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = NULL,
+                           .length = 0
+                          };
+
+    cmdStatsKeys(1);
+    return setPubStringCommon(ctx, &setParams, &pubParams);
+}
+
+/* CSETIE key value oldvalue [channel message ...]: SETIE[M]PUB of a value
+ * written by CSET, compared with 'oldvalue' once decompressed. */
+int csetIEPubCommon(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModuleString *pairs[2] = { argv[1], argv[2] };
+    SetParams setParams = {
+                           .key_val_pairs = pairs,
+                           .length = 2
+                          };
+    PubParams pubParams = {
+                           .channel_msg_pairs = argv + 4,
+                           .length = argc - 4
+                          };
+
+    return setCondPubStringCommon(ctx, &setParams, argv[3], &pubParams,
+                                  OBJ_OP_IE | OBJ_OP_COMPRESS);
+}
+
+int CSetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 4)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return csetIEPubCommon(ctx, argv, argc);
+}
+
+int CSetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc < 6 || (argc % 2) != 0)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    return csetIEPubCommon(ctx, argv, argc);
+}
+
+/* Replies the string value of a key as GET does, decoded with 'decompress'. */
+int replyKeyValue(RedisModuleCtx *ctx, RedisModuleString *keyname, bool decompress)
+{
+    size_t len;
+    char *buf = NULL;
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+    cmdStatsKeys(1);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithNull(ctx);
+    } else if (type != REDISMODULE_KEYTYPE_STRING) {
+        RedisModule_CloseKey(key);
+        return replyWithError(ctx,REDISMODULE_ERRORMSG_WRONGTYPE);
+    }
+
+    const char *val = RedisModule_StringDMA(key, &len, REDISMODULE_READ);
+    if (decompress)
+        val = decodeValue(val, len, &len, &buf);
+    RedisModule_ReplyWithStringBuffer(ctx, val, len);
+    if (buf)
+        RedisModule_Free(buf);
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+/* CGET key: the value of a key written by CSET as it was given, nil for a
+ * missing key. Values written by plain SET are returned as they are. */
+int CGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    return replyKeyValue(ctx, argv[1], true);
+}
+
+/* Counters of the values written by CSET and friends since the module was
+ * loaded. 'ratio' is bytes_in / bytes_stored. */
+int CStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    REDISMODULE_NOT_USED(argv);
+    char ratio[32];
+
+    if (argc != 1)
+        return wrongArity(ctx);
+
+    snprintf(ratio, sizeof(ratio), "%.2f", compress_stats.bytes_stored ?
+             (double)compress_stats.bytes_in / compress_stats.bytes_stored : 1.0);
+
+    RedisModule_ReplyWithArray(ctx, 14);
+    RedisModule_ReplyWithSimpleString(ctx, "min_size");
+    RedisModule_ReplyWithLongLong(ctx, compress_min);
+    RedisModule_ReplyWithSimpleString(ctx, "values");
+    RedisModule_ReplyWithLongLong(ctx, compress_stats.values);
+    RedisModule_ReplyWithSimpleString(ctx, "compressed");
+    RedisModule_ReplyWithLongLong(ctx, compress_stats.compressed);
+    RedisModule_ReplyWithSimpleString(ctx, "bytes_in");
+    RedisModule_ReplyWithLongLong(ctx, compress_stats.bytes_in);
+    RedisModule_ReplyWithSimpleString(ctx, "bytes_stored");
+    RedisModule_ReplyWithLongLong(ctx, compress_stats.bytes_stored);
+    RedisModule_ReplyWithSimpleString(ctx, "ratio");
+    RedisModule_ReplyWithSimpleString(ctx, ratio);
+    RedisModule_ReplyWithSimpleString(ctx, "decoded");
+    RedisModule_ReplyWithLongLong(ctx, compress_stats.decoded);
+    return REDISMODULE_OK;
+}
+
+/* The operations of SDL.BATCH, the number of arguments after each name and
+ * whether the first of them is a key. */
+typedef enum {
+    BATCH_OP_SET,
+    BATCH_OP_SETIE,
+    BATCH_OP_DEL,
+    BATCH_OP_DELIE,
+    BATCH_OP_GET,
+    BATCH_OP_PUBLISH,
+    BATCH_OP_COUNT
+} BatchOpType;
+
+static const struct {
+    const char *name;
+    int argc;
+    bool key;
+} batch_ops[BATCH_OP_COUNT] = {
+    [BATCH_OP_SET]     = {"SET", 2, true},
+    [BATCH_OP_SETIE]   = {"SETIE", 3, true},
+    [BATCH_OP_DEL]     = {"DEL", 1, true},
+    [BATCH_OP_DELIE]   = {"DELIE", 2, true},
+    [BATCH_OP_GET]     = {"GET", 1, true},
+    [BATCH_OP_PUBLISH] = {"PUBLISH", 2, false},
+};
+
+/* The operation named by 'name', BATCH_OP_COUNT when there is none. */
+BatchOpType batchOpFind(RedisModuleString *name)
+{
+    size_t len;
+    const char *op = RedisModule_StringPtrLen(name, &len);
+    int i;
+
+    for (i = 0; i < BATCH_OP_COUNT; i++) {
+        if (!strcasecmp(op, batch_ops[i].name))
+            break;
+    }
+    return (BatchOpType)i;
+}
+
+/* SET of SDL.BATCH: replaces a value of any type, as SET does. */
+int batchOpSet(RedisModuleCtx *ctx, RedisModuleString *keystr, RedisModuleString *valstr)
+{
+    cmdStatsKeys(1);
+    if (!nativeKeyApiAvailable()) {
+        RedisModuleCallReply *reply = RedisModule_Call(ctx, "SET", "ss!", keystr, valstr);
+        ASSERT_NOERROR(reply)
+        RedisModule_ReplyWithCallReply(ctx, reply);
+        RedisModule_FreeCallReply(reply);
+        return REDISMODULE_OK;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ | REDISMODULE_WRITE);
+    RedisModule_StringSet(key, valstr);
+    RedisModule_CloseKey(key);
+    RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_STRING, "set", keystr);
+    RedisModule_Replicate(ctx, "SET", "ss", keystr, valstr);
+    return RedisModule_ReplyWithSimpleString(ctx, "OK");
+}
+
+/* DEL of SDL.BATCH: deletes a key of any type, as DEL does. */
+int batchOpDel(RedisModuleCtx *ctx, RedisModuleString *keystr)
+{
+    cmdStatsKeys(1);
+    if (!nativeKeyApiAvailable()) {
+        RedisModuleCallReply *reply = RedisModule_Call(ctx, "UNLINK", "s!", keystr);
+        ASSERT_NOERROR(reply)
+        RedisModule_ReplyWithCallReply(ctx, reply);
+        RedisModule_FreeCallReply(reply);
+        return REDISMODULE_OK;
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keystr, REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_EMPTY) {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithLongLong(ctx, 0);
+    }
+    RedisModule_UnlinkKey(key);
+    RedisModule_CloseKey(key);
+    RedisModule_NotifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_GENERIC, "del", keystr);
+    RedisModule_Replicate(ctx, "UNLINK", "s", keystr);
+    return RedisModule_ReplyWithLongLong(ctx, 1);
+}
+
+/* Runs one operation of SDL.BATCH, 'op' being its name and arguments. SETIE
+ * and DELIE use the engines of their families, so that each one replies and
+ * replicates as the standalone command does. */
+int batchOpRun(RedisModuleCtx *ctx, BatchOpType type, RedisModuleString **op)
+{
+    PubParams nopub = { .channel_msg_pairs = NULL, .length = 0 };
+    SetParams setParams = { .key_val_pairs = op + 1, .length = 2 };
+    DelParams delParams = { .keys = op + 1, .length = 1 };
+
+    switch (type) {
+    case BATCH_OP_SET:
+        return batchOpSet(ctx, op[1], op[2]);
+    case BATCH_OP_SETIE:
+        return setCondPubStringCommon(ctx, &setParams, op[3], &nopub, OBJ_OP_IE);
+    case BATCH_OP_DEL:
+        return batchOpDel(ctx, op[1]);
+    case BATCH_OP_DELIE:
+        return delCondPubStringCommon(ctx, &delParams, op[2], &nopub, OBJ_OP_IE);
+    case BATCH_OP_GET:
+        return replyKeyValue(ctx, op[1], false);
+    default:
+        return RedisModule_ReplyWithLongLong(ctx, publishMessage(ctx, op[1], op[2]));
+    }
+}
+
+/* SDL.BATCH op arg [arg ...] [op arg [arg ...] ...]: runs the operations in
+ * order in one command and replies an array of their replies. The whole
+ * batch is checked before the first operation runs. The command is
+ * registered with "getkeys-api", as the key positions depend on the
+ * operations: the server asks for them to redirect the command in Redis
+ * Cluster, and the keys must be in one slot as for MSET. */
+int SdlBatch_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    BatchOpType type;
+    long nops = 0;
+    int i, slot = -1;
+    size_t len;
+    bool keys_request = RMAPI_FUNC_SUPPORTED(RedisModule_IsKeysPositionRequest) &&
+                        RedisModule_IsKeysPositionRequest(ctx);
+    bool cluster = RMAPI_FUNC_SUPPORTED(RedisModule_GetContextFlags) &&
+                   (RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_CLUSTER);
+
+    /* A key position request is not a call of the command */
+    if (keys_request)
+        cmd_stats_cmd = -1;
+    if (argc < 3)
+        return keys_request ? REDISMODULE_OK : wrongArity(ctx);
+
+    for (i = 1; i < argc; i += 1 + batch_ops[type].argc) {
+        type = batchOpFind(argv[i]);
+        if (type == BATCH_OP_COUNT || i + batch_ops[type].argc >= argc) {
+            if (keys_request)
+                return REDISMODULE_OK;
+            if (type == BATCH_OP_COUNT)
+                return replyWithError(ctx,"-ERR unknown batch operation");
+            return wrongArity(ctx);
+        }
+        if (batch_ops[type].key && keys_request) {
+            RedisModule_KeyAtPos(ctx, i + 1);
+        } else if (batch_ops[type].key && cluster) {
+            const char *key = RedisModule_StringPtrLen(argv[i + 1], &len);
+            int keyslot = keyHashSlot(key, len);
+            if (slot >= 0 && keyslot != slot)
+                return replyWithError(ctx,"-CROSSSLOT Keys in request don't hash to the same slot");
+            slot = keyslot;
+        }
+        nops++;
+    }
+    if (keys_request)
+        return REDISMODULE_OK;
+
+    RedisModule_AutoMemory(ctx);
+    RedisModule_ReplyWithArray(ctx, nops);
+    for (i = 1; i < argc; i += 1 + batch_ops[type].argc) {
+        type = batchOpFind(argv[i]);
+        batchOpRun(ctx, type, argv + i);
+    }
+    return REDISMODULE_OK;
+}
+
+/* Replies the xxh64 digests of the given keys as used by the *DIGEST
+ * commands, nil for keys that do not hold a string. */
+int MDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    char hex[XXHASH64_HEX_LEN + 1];
+    size_t len;
+    int i;
+
+    if (argc < 2)
+        return wrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx);
+    cmdStatsKeys(argc - 1);
+    RedisModule_ReplyWithArray(ctx, argc - 1);
+    for (i = 1; i < argc; i++) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[i], REDISMODULE_READ);
+        if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_STRING) {
+            const char *val = RedisModule_StringDMA(key, &len, REDISMODULE_READ);
+            xxhash64ToHex(xxhash64(val, len, 0), hex);
+            RedisModule_ReplyWithStringBuffer(ctx, hex, XXHASH64_HEX_LEN);
+        } else {
+            RedisModule_ReplyWithNull(ctx);
+        }
+        RedisModule_CloseKey(key);
+    }
+    return REDISMODULE_OK;
+}
+
+long long nget_lock_budget_us = DEF_LOCK_BUDGET_US;
+
+long long monotonicUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Next batch size of NGET.NOATOMIC, which aims at holding the lock for about
+ * the lock budget per batch: a batch over the budget shrinks in proportion,
+ * an empty batch or one well under the budget doubles. */
+long long adaptBatchCount(long long batch, long long elapsed_us, size_t found)
+{
+    if (elapsed_us > nget_lock_budget_us) {
+        batch = batch * nget_lock_budget_us / elapsed_us;
+        if (batch < 1)
+            batch = 1;
+    } else if (found == 0 || elapsed_us < nget_lock_budget_us / 2) {
+        batch *= 2;
+        if (batch > MAX_ADAPTIVE_BATCH)
+            batch = MAX_ADAPTIVE_BATCH;
+    }
+    return batch;
+}
+
+/* Slow log of NGET and NDEL, see NSLOWLOG: the newest executions that took
+ * at least slow_log_us. The workers of NGET.NOATOMIC add to it too, hence
+ * its own lock. */
+SlowLog slow_log;
+pthread_mutex_t slow_log_lock = PTHREAD_MUTEX_INITIALIZER;
+long long slow_log_len = DEF_SLOWLOG_LEN;
+long long slow_log_us = DEF_SLOWLOG_US;
+
+bool slowLogWanted(long long wall_us)
+{
+    return slow_log_len > 0 && wall_us >= slow_log_us;
+}
+
+void slowLogRecord(int cmd, int db, RedisModuleString *pattern, const ScanSomeState *state,
+                   long long lock_us, long long wall_us)
+{
+    size_t len = 0;
+    const char *ptr = RedisModule_StringPtrLen(pattern, &len);
+
+    pthread_mutex_lock(&slow_log_lock);
+    if (slow_log.entries == NULL) {
+        SlowLogEntry *entries = RedisModule_Alloc(sizeof(SlowLogEntry) * slow_log_len);
+        if (entries)
+            slowLogInit(&slow_log, entries, slow_log_len);
+    }
+    SlowLogEntry *entry = slowLogAdd(&slow_log, ptr, len);
+    if (entry) {
+        entry->time = (long long)time(NULL);
+        entry->cmd = cmd;
+        entry->db = db;
+        entry->scanned = state->scanned;
+        entry->matched = state->matched;
+        entry->iterations = state->iterations;
+        entry->lock_us = lock_us;
+        entry->wall_us = wall_us;
+    }
+    pthread_mutex_unlock(&slow_log_lock);
+}
+
+/* Replies the key and its value straight from the string object of an opened
+ * key, without the copies of an MGET reply. Returns the number of replied
+ * elements, 0 for keys that do not hold a string. With 'decompress' values
+ * written by CSET are decompressed, see CGET. */
+size_t replyKeyStringValue(RedisModuleCtx *ctx, RedisModuleString *keyname, bool decompress)
+{
+    size_t len, replied = 0;
+    char *buf = NULL;
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_STRING) {
+        const char *val = RedisModule_StringDMA(key, &len, REDISMODULE_READ);
+        if (decompress)
+            val = decodeValue(val, len, &len, &buf);
+        RedisModule_ReplyWithString(ctx, keyname);
+        RedisModule_ReplyWithStringBuffer(ctx, val, len);
+        if (buf)
+            RedisModule_Free(buf);
+        replied = 2;
+    }
+    RedisModule_CloseKey(key);
+    return replied;
+}
+
+int Nget_RedisCommand(RedisModuleCtx *ctx, NgetArgs* nget_args, bool using_threadsafe_context)
+{
+    int ret = REDISMODULE_OK;
+    size_t replylen = 0;
+    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+    ScanSomeState scan_state;
+    ScannedKeys *scanned_keys;
+    long long begin = monotonicUs(), start = 0, elapsed, lock_us = 0;
+
+    scanSomeStateInit(&scan_state, nget_args->key, nget_args->count, !using_threadsafe_context);
+    /* The main thread is not given up between batches, so only the
+     * background scan adapts its batches to the lock budget. */
+    if (using_threadsafe_context &&
+        (RedisModule_StringToLongLong(nget_args->count, &scan_state.batch) != REDISMODULE_OK ||
+         scan_state.batch < 1))
+        scan_state.batch = DEF_COUNT;
+
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+    do {
+        lockThreadsafeContext(ctx, using_threadsafe_context);
+        if (using_threadsafe_context)
+            start = monotonicUs();
+
+        status = EXSTRINGS_STATUS_NOT_SET;
+        scanned_keys = nextKeys(ctx, &scan_state, &status);
 
         if (status != EXSTRINGS_STATUS_NO_ERRORS) {
+            if (using_threadsafe_context)
+                lock_us += monotonicUs() - start;
             unlockThreadsafeContext(ctx, using_threadsafe_context);
             ret = REDISMODULE_ERR;
             break;
         } else if (scanned_keys == NULL) {
+            if (using_threadsafe_context) {
+                elapsed = monotonicUs() - start;
+                lock_us += elapsed;
+                scan_state.batch = adaptBatchCount(scan_state.batch, elapsed, 0);
+            }
             unlockThreadsafeContext(ctx, using_threadsafe_context);
             continue;
         }
 
-        reply = RedisModule_Call(ctx, "MGET", "v", scanned_keys->keys, scanned_keys->len);
+        /* The values are read while the keys are still locked, which also
+         * makes the lock budget cover the reply writing. */
+        cmdStatsKeys(scanned_keys->len);
+        size_t i;
+        for (i = 0; i < scanned_keys->len; i++)
+            replylen += replyKeyStringValue(ctx, scanned_keys->keys[i], nget_args->decompress);
 
+        if (using_threadsafe_context) {
+            elapsed = monotonicUs() - start;
+            lock_us += elapsed;
+            scan_state.batch = adaptBatchCount(scan_state.batch, elapsed, scanned_keys->len);
+        }
         unlockThreadsafeContext(ctx, using_threadsafe_context);
+        freeScannedKeys(ctx, scanned_keys);
+    } while (scan_state.cursor != 0);
+
+    scanSomeStateFree(ctx, &scan_state);
+    RedisModule_ReplySetArrayLength(ctx,replylen);
+
+    /* The main thread holds the lock for the whole command. */
+    elapsed = monotonicUs() - begin;
+    if (slowLogWanted(elapsed))
+        slowLogRecord(using_threadsafe_context ? CMD_NGET_NOATOMIC : CMD_NGET_ATOMIC,
+                      RedisModule_GetSelectedDb(ctx), nget_args->key, &scan_state,
+                      using_threadsafe_context ? lock_us : elapsed, elapsed);
+    return ret;
+}
+
+/* Runs the blocking part of the command nget.noatomic on a worker of the
+ * pool.
+ */
+void NGet_NoAtomic_Job(void *arg)
+{
+    RedisModuleBlockedClientArgs *bca = arg;
+    RedisModuleBlockedClient *bc = bca->bc;
+    RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(bc);
+
+    Nget_RedisCommand(ctx, &bca->nget_args, true);
+    RedisModule_FreeThreadSafeContext(ctx);
+    RedisModule_UnblockClient(bc, NULL);
+    RedisModule_Free(bca);
+}
+
+/* Fixed size pool of worker threads, started at module load, which runs the
+ * blocking commands from a bounded FIFO queue. A full queue rejects the
+ * command instead of growing without limit. */
+typedef struct _WorkerJob {
+    void (*run)(void *arg);
+    void *arg;
+    int cmd;                    /* the command counted, -1 if none */
+    uint64_t start_ns;          /* start of the command */
+    CmdStatsCall call;          /* counts of the command so far */
+    struct _WorkerJob *next;
+} WorkerJob;
+
+typedef struct _WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    WorkerJob *head;
+    WorkerJob *tail;
+    bool started;
+    bool stopping;
+    long long queue_depth;
+    long long queue_depth_peak;
+    long long busy;
+    long long submitted;
+    long long rejected;
+    long long completed;
+} WorkerPool;
+
+int worker_pool_size = DEF_WORKERS;
+long long worker_pool_queue_len = DEF_WORKER_QUEUE_LEN;
+WorkerPool worker_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER
+};
+/* Commands run by the workers, recorded under the lock of the pool. */
+CmdStats worker_cmd_stats[CMD_COUNT];
+
+/* Worker thread main loop. Returns once the pool is stopped and its queue
+ * is empty. */
+void *workerPoolMain(void *arg)
+{
+    REDISMODULE_NOT_USED(arg);
+    pthread_detach(pthread_self());
+
+    pthread_mutex_lock(&worker_pool.lock);
+    for (;;) {
+        while (worker_pool.head == NULL && !worker_pool.stopping)
+            pthread_cond_wait(&worker_pool.queued, &worker_pool.lock);
+
+        WorkerJob *job = worker_pool.head;
+        if (job == NULL)
+            break;
+        worker_pool.head = job->next;
+        if (worker_pool.head == NULL)
+            worker_pool.tail = NULL;
+        worker_pool.queue_depth--;
+        worker_pool.busy++;
+        pthread_mutex_unlock(&worker_pool.lock);
+
+        /* The latency of a command run by a worker is counted from its
+         * start on the main thread to the end of the job. */
+        cmd_stats_call = job->call;
+        job->run(job->arg);
+        uint64_t ns = monotonicNs() - job->start_ns;
+        int cmd = job->cmd;
+        RedisModule_Free(job);
+
+        pthread_mutex_lock(&worker_pool.lock);
+        if (cmd >= 0)
+            cmdStatsRecord(&worker_cmd_stats[cmd], &cmd_stats_call, ns);
+        worker_pool.busy--;
+        worker_pool.completed++;
+    }
+    pthread_mutex_unlock(&worker_pool.lock);
+    return NULL;
+}
+
+void workerPoolStop(void)
+{
+    pthread_mutex_lock(&worker_pool.lock);
+    worker_pool.stopping = true;
+    worker_pool.started = false;
+    pthread_cond_broadcast(&worker_pool.queued);
+    pthread_mutex_unlock(&worker_pool.lock);
+}
+
+int workerPoolStart(void)
+{
+    pthread_t tid;
+    int i;
+
+    pthread_mutex_lock(&worker_pool.lock);
+    if (worker_pool.started) {
+        pthread_mutex_unlock(&worker_pool.lock);
+        return REDISMODULE_OK;
+    }
+    worker_pool.started = true;
+    worker_pool.stopping = false;
+    worker_pool.queue_depth_peak = worker_pool.queue_depth;
+    worker_pool.submitted = worker_pool.rejected = worker_pool.completed = 0;
+    pthread_mutex_unlock(&worker_pool.lock);
+
+    for (i = 0; i < worker_pool_size; i++) {
+        if (pthread_create(&tid, NULL, workerPoolMain, NULL) != 0) {
+            workerPoolStop();
+            return REDISMODULE_ERR;
+        }
+    }
+    return REDISMODULE_OK;
+}
+
+/* Queues 'run(arg)' for a worker, counted for the command the calling
+ * thread runs. Returns false, leaving 'arg' to the caller, when the queue is
+ * full. */
+bool workerPoolSubmit(void (*run)(void *arg), void *arg)
+{
+    WorkerJob *job = RedisModule_Alloc(sizeof(WorkerJob));
+    if (job == NULL)
+        return false;
+    job->run = run;
+    job->arg = arg;
+    job->cmd = cmd_stats_cmd;
+    job->start_ns = cmd_stats_start_ns;
+    job->call = cmd_stats_call;
+    job->next = NULL;
+
+    pthread_mutex_lock(&worker_pool.lock);
+    if (!worker_pool.started || worker_pool.queue_depth >= worker_pool_queue_len) {
+        worker_pool.rejected++;
+        pthread_mutex_unlock(&worker_pool.lock);
+        RedisModule_Free(job);
+        return false;
+    }
+    if (worker_pool.tail)
+        worker_pool.tail->next = job;
+    else
+        worker_pool.head = job;
+    worker_pool.tail = job;
+    worker_pool.queue_depth++;
+    if (worker_pool.queue_depth > worker_pool.queue_depth_peak)
+        worker_pool.queue_depth_peak = worker_pool.queue_depth;
+    worker_pool.submitted++;
+    pthread_cond_signal(&worker_pool.queued);
+    pthread_mutex_unlock(&worker_pool.lock);
+    return true;
+}
+
+int PoolStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    REDISMODULE_NOT_USED(argv);
+    if (argc != 1)
+        return wrongArity(ctx);
+
+    pthread_mutex_lock(&worker_pool.lock);
+    WorkerPool stats = worker_pool;
+    pthread_mutex_unlock(&worker_pool.lock);
+
+    RedisModule_ReplyWithArray(ctx, 16);
+    RedisModule_ReplyWithSimpleString(ctx, "workers");
+    RedisModule_ReplyWithLongLong(ctx, stats.started ? worker_pool_size : 0);
+    RedisModule_ReplyWithSimpleString(ctx, "queue_len");
+    RedisModule_ReplyWithLongLong(ctx, worker_pool_queue_len);
+    RedisModule_ReplyWithSimpleString(ctx, "queue_depth");
+    RedisModule_ReplyWithLongLong(ctx, stats.queue_depth);
+    RedisModule_ReplyWithSimpleString(ctx, "queue_depth_peak");
+    RedisModule_ReplyWithLongLong(ctx, stats.queue_depth_peak);
+    RedisModule_ReplyWithSimpleString(ctx, "busy_workers");
+    RedisModule_ReplyWithLongLong(ctx, stats.busy);
+    RedisModule_ReplyWithSimpleString(ctx, "submitted");
+    RedisModule_ReplyWithLongLong(ctx, stats.submitted);
+    RedisModule_ReplyWithSimpleString(ctx, "rejected");
+    RedisModule_ReplyWithLongLong(ctx, stats.rejected);
+    RedisModule_ReplyWithSimpleString(ctx, "completed");
+    RedisModule_ReplyWithLongLong(ctx, stats.completed);
+    return REDISMODULE_OK;
+}
+
+int NGet_NoAtomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+
+    InitStaticVariable();
+
+    RedisModuleBlockedClientArgs *bca = RedisModule_Alloc(sizeof(RedisModuleBlockedClientArgs));
+    if (bca == NULL) {
+        replyWithError(ctx,"-ERR Out of memory");
+        return REDISMODULE_ERR;
+    }
+
+    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+    readNgetArgs(ctx, argv, argc, &bca->nget_args, &status);
+    if (status != EXSTRINGS_STATUS_NO_ERRORS) {
+        RedisModule_Free(bca);
+        return REDISMODULE_ERR;
+    }
+
+    /* The workers cannot start the build of the prefix index. */
+    prefixIndexRequest(ctx);
+
+    /* Note that when blocking the client we do not set any callback: no
+     * timeout is possible since we passed '0', nor we need a reply callback
+     * because we'll use the thread safe context to accumulate a reply. */
+    RedisModuleBlockedClient *bc = RedisModule_BlockClient(ctx,NULL,NULL,NULL,0);
+
+    bca->bc = bc;
+
+    /* Now that we setup a blocking client, we pass it to a worker with the
+     * reference to the blocked client handle. */
+    if (!workerPoolSubmit(NGet_NoAtomic_Job, bca)) {
+        RedisModule_AbortBlock(bc);
+        RedisModule_Free(bca);
+        return replyWithError(ctx,"-ERR Too many queued requests, see POOLSTATS");
+    }
+
+    /* The worker counts the call when it is done. */
+    cmd_stats_cmd = -1;
+    return REDISMODULE_OK;
+}
+
+int NGet_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    NgetArgs nget_args;
+    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+
+    InitStaticVariable();
+
+    readNgetArgs(ctx, argv, argc, &nget_args, &status);
+    if (status != EXSTRINGS_STATUS_NO_ERRORS) {
+        return REDISMODULE_ERR;
+    }
+
+    return Nget_RedisCommand(ctx, &nget_args, false);
+}
+
+int NDel_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    int ret = REDISMODULE_OK;
+    long long replylen = 0;
+    RedisModuleCallReply *reply = NULL;
+    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+    ScanSomeState scan_state;
+    ScannedKeys *scanned_keys = NULL;
+    long long begin = monotonicUs(), elapsed;
+
+    InitStaticVariable();
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    scanSomeStateInit(&scan_state, argv[1], def_count_str, true);
+
+    do {
+        status = EXSTRINGS_STATUS_NOT_SET;
+        scanned_keys = nextKeys(ctx, &scan_state, &status);
+
+        if (status != EXSTRINGS_STATUS_NO_ERRORS) {
+            ret = REDISMODULE_ERR;
+            break;
+        } else if (scanned_keys == NULL) {
+            continue;
+        }
+
+        cmdStatsKeys(scanned_keys->len);
+        reply = RedisModule_Call(ctx, "UNLINK", "v!", scanned_keys->keys, scanned_keys->len);
 
         status = EXSTRINGS_STATUS_NOT_SET;
         forwardIfError(ctx, reply, &status);
@@ -751,235 +3856,1205 @@ int Nget_RedisCommand(RedisModuleCtx *ctx, NgetArgs* nget_args, bool using_threa
             break;
         }
 
-        size_t i;
-        for (i = 0; i < scanned_keys->len; i++) {
-            RedisModuleString *rms = RedisModule_CreateStringFromCallReply(RedisModule_CallReplyArrayElement(reply, i));
-            if (rms) {
-                RedisModule_ReplyWithString(ctx, scanned_keys->keys[i]);
-                RedisModule_ReplyWithString(ctx, rms);
-                RedisModule_FreeString(ctx, rms);
-                replylen += 2;
+        replylen += RedisModule_CallReplyInteger(reply);
+        RedisModule_FreeCallReply(reply);
+        freeScannedKeys(ctx, scanned_keys);
+    } while (scan_state.cursor != 0);
+
+    scanSomeStateFree(ctx, &scan_state);
+    if (ret == REDISMODULE_OK) {
+        RedisModule_ReplyWithLongLong(ctx, replylen);
+    }
+
+    elapsed = monotonicUs() - begin;
+    if (slowLogWanted(elapsed))
+        slowLogRecord(CMD_NDEL_ATOMIC, RedisModule_GetSelectedDb(ctx), argv[1], &scan_state,
+                      elapsed, elapsed);
+    return ret;
+}
+
+/* NSCAN cursors are "0" to start, the SCAN cursor while SCANning, 'i' and
+ * the hex encoded last key while walking the prefix index, and the SCAN
+ * cursor, ':' and the hex encoded last key when an index walk had to finish
+ * with SCAN. A SCAN step that MAXBYTES cut is given again as its own cursor,
+ * '+' and the hex encoded last key returned of it, see NScan_RedisCommand.
+ * Keys are hex encoded to keep the cursor printable. */
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool readNScanKey(const char *hex, size_t hexlen, char **key, size_t *keylen)
+{
+    size_t i;
+
+    if (hexlen % 2)
+        return false;
+    *key = RedisModule_Alloc(hexlen / 2 + 1);
+    *keylen = hexlen / 2;
+    for (i = 0; i < *keylen; i++) {
+        int hi = hexDigit(hex[2 * i]), lo = hexDigit(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        (*key)[i] = (char)(hi << 4 | lo);
+    }
+    return true;
+}
+
+size_t writeNScanKey(char *buf, const char *key, size_t keylen)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    size_t i;
+
+    for (i = 0; i < keylen; i++) {
+        buf[2 * i] = hex_digits[(unsigned char)key[i] >> 4];
+        buf[2 * i + 1] = hex_digits[(unsigned char)key[i] & 0xf];
+    }
+    return 2 * keylen;
+}
+
+bool readNScanCursor(RedisModuleCtx *ctx, RedisModuleString *cursor_str, ScanSomeState *state)
+{
+    size_t len = 0, i;
+    long long cursor = 0;
+    const char *cursor_ptr = RedisModule_StringPtrLen(cursor_str, &len);
+
+    if (len == 0)
+        return false;
+
+    if (cursor_ptr[0] == NSCAN_INDEX_CURSOR) {
+        if (!readNScanKey(cursor_ptr + 1, len - 1, &state->lastkey, &state->lastkeylen))
+            return false;
+        /* Continues the walk if the index is still there, otherwise SCANs
+         * the keys after the last one returned. */
+        scanSomeStart(ctx, state);
+        return true;
+    }
+
+    for (i = 0; i < len && cursor_ptr[i] >= '0' && cursor_ptr[i] <= '9'; i++) {
+        if (cursor > (LLONG_MAX - (cursor_ptr[i] - '0')) / 10)
+            return false;
+        cursor = cursor * 10 + (cursor_ptr[i] - '0');
+    }
+    if (i == 0)
+        return false;
+    if (i < len && cursor_ptr[i] == NSCAN_STEP_KEY) {
+        size_t end = i + 1;
+        while (end < len && cursor_ptr[end] != ':')
+            end++;
+        if (!readNScanKey(cursor_ptr + i + 1, end - i - 1, &state->stepkey, &state->stepkeylen))
+            return false;
+        i = end;
+    }
+    if (i < len) {
+        if (cursor_ptr[i] != ':' ||
+            !readNScanKey(cursor_ptr + i + 1, len - i - 1, &state->lastkey, &state->lastkeylen))
+            return false;
+    }
+
+    state->cursor = cursor;
+    /* Only the first page may choose the prefix index. */
+    state->started = state->cursor != 0 || state->lastkey != NULL || state->stepkey != NULL;
+    return true;
+}
+
+void replyNScanCursor(RedisModuleCtx *ctx, ScanSomeState *state)
+{
+    size_t len = 0;
+    char *buf;
+
+    if (state->cursor == 0 && state->stepkey == NULL) {
+        RedisModule_ReplyWithStringBuffer(ctx, "0", 1);
+        return;
+    }
+
+    buf = RedisModule_Alloc(NSCAN_CURSOR_DIGITS + 3 + 2 * state->lastkeylen + 2 * state->stepkeylen);
+    if (state->index_db >= 0) {
+        buf[len++] = NSCAN_INDEX_CURSOR;
+    } else {
+        len = sprintf(buf, "%lld", state->cursor);
+        if (state->stepkey) {
+            buf[len++] = NSCAN_STEP_KEY;
+            len += writeNScanKey(buf + len, state->stepkey, state->stepkeylen);
+        }
+    }
+    if (state->lastkey) {
+        if (state->index_db < 0)
+            buf[len++] = ':';
+        len += writeNScanKey(buf + len, state->lastkey, state->lastkeylen);
+    }
+    buf[len] = '\0';
+    RedisModule_ReplyWithStringBuffer(ctx, buf, len);
+    RedisModule_Free(buf);
+}
+
+typedef struct _NScanKey {
+    RedisModuleString *key;
+    const char *name;
+    size_t namelen;
+} NScanKey;
+
+static int nscanKeyCompare(const void *a, const void *b)
+{
+    const NScanKey *ka = a, *kb = b;
+
+    if (keyNameAfter(ka->name, ka->namelen, kb->name, kb->namelen))
+        return 1;
+    return keyNameAfter(kb->name, kb->namelen, ka->name, ka->namelen) ? -1 : 0;
+}
+
+/* Orders the keys of a SCAN step by name and returns the index of the first
+ * one after the step key of the cursor, if any. */
+size_t nscanSortStep(ScannedKeys *scanned_keys, ScanSomeState *state)
+{
+    size_t i, from = 0;
+    NScanKey *sorted = RedisModule_Alloc(scanned_keys->len * sizeof(*sorted));
+
+    for (i = 0; i < scanned_keys->len; i++) {
+        sorted[i].key = scanned_keys->keys[i];
+        sorted[i].name = RedisModule_StringPtrLen(sorted[i].key, &sorted[i].namelen);
+    }
+    qsort(sorted, scanned_keys->len, sizeof(*sorted), nscanKeyCompare);
+    for (i = 0; i < scanned_keys->len; i++) {
+        scanned_keys->keys[i] = sorted[i].key;
+        if (state->stepkey && from == i &&
+            !keyNameAfter(sorted[i].name, sorted[i].namelen, state->stepkey, state->stepkeylen))
+            from = i + 1;
+    }
+    RedisModule_Free(sorted);
+    return from;
+}
+
+/* The index of the first key from 'from' whose pair would take the page over
+ * 'maxbytes'; the page holds at least one pair. The sizes are read before the
+ * page is written. */
+size_t nscanCut(RedisModuleCtx *ctx, ScannedKeys *scanned_keys, size_t from, long long maxbytes)
+{
+    size_t i, keylen, vallen, bytes = 0;
+
+    for (i = from; i < scanned_keys->len; i++) {
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, scanned_keys->keys[i], REDISMODULE_READ);
+        bool string = RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_STRING;
+        if (string)
+            RedisModule_StringDMA(key, &vallen, REDISMODULE_READ);
+        RedisModule_CloseKey(key);
+        if (!string)
+            continue;
+        RedisModule_StringPtrLen(scanned_keys->keys[i], &keylen);
+        if (bytes && bytes + keylen + vallen > (size_t)maxbytes)
+            return i;
+        bytes += keylen + vallen;
+    }
+    return scanned_keys->len;
+}
+
+/* One page of NSCAN: a single SCAN step or index batch, so that the work and
+ * the reply of each call stay bounded however large the namespace is. With
+ * MAXBYTES the index walk continues after the last key of the page. A SCAN
+ * step can only be run again as a whole, so its keys are ordered by name and
+ * the next page runs the same step and skips the keys up to the last one
+ * returned. */
+int NScan_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx);
+    long long count, maxbytes = 0, step_cursor;
+    size_t i, len, keylen, replylen = 0, from = 0, cut = 0;
+    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+    ScanSomeState scan_state;
+    ScannedKeys *scanned_keys;
+    int j;
+
+    if (argc < 3 || argc > 7 || argc % 2 == 0)
+        return wrongArity(ctx);
+
+    InitStaticVariable();
+
+    RedisModuleString *count_arg = def_count_str;
+    for (j = 3; j < argc; j += 2) {
+        long long *number;
+        const char *option = RedisModule_StringPtrLen(argv[j], &len);
+        if (!strcasecmp(option, COUNT_STR)) {
+            number = &count;
+            count_arg = argv[j + 1];
+        } else if (!strcasecmp(option, MAXBYTES_STR)) {
+            number = &maxbytes;
+        } else {
+            return replyWithError(ctx,"-ERR syntax error");
+        }
+        if (RedisModule_StringToLongLong(argv[j + 1], number) != REDISMODULE_OK || *number < 1)
+            return replyWithError(ctx,"-ERR value is not an integer or out of range");
+    }
+
+    scanSomeStateInit(&scan_state, argv[2], count_arg, true);
+    scan_state.need_scan_cursor = true;
+    if (!readNScanCursor(ctx, argv[1], &scan_state)) {
+        scanSomeStateFree(ctx, &scan_state);
+        return replyWithError(ctx,"-ERR invalid cursor");
+    }
+
+    step_cursor = scan_state.cursor;
+    scanned_keys = nextKeys(ctx, &scan_state, &status);
+    if (status != EXSTRINGS_STATUS_NO_ERRORS) {
+        scanSomeStateFree(ctx, &scan_state);
+        return REDISMODULE_ERR;
+    }
+
+    if (scanned_keys) {
+        cmdStatsKeys(scanned_keys->len);
+        if (scan_state.index_db < 0 && (maxbytes || scan_state.stepkey))
+            from = nscanSortStep(scanned_keys, &scan_state);
+        cut = maxbytes ? nscanCut(ctx, scanned_keys, from, maxbytes) : scanned_keys->len;
+    }
+    RedisModule_Free(scan_state.stepkey);
+    scan_state.stepkey = NULL;
+    scan_state.stepkeylen = 0;
+    if (scanned_keys && cut < scanned_keys->len) {
+        const char *lastkey = RedisModule_StringPtrLen(scanned_keys->keys[cut - 1], &keylen);
+        if (scan_state.index_db >= 0) {
+            scanSomeStateSetLastKey(&scan_state, lastkey, keylen);
+            scan_state.cursor = 1;
+        } else {
+            scan_state.stepkey = RedisModule_Alloc(keylen + 1);
+            memcpy(scan_state.stepkey, lastkey, keylen);
+            scan_state.stepkeylen = keylen;
+            scan_state.cursor = step_cursor;
+        }
+    }
+
+    RedisModule_ReplyWithArray(ctx, 2);
+    replyNScanCursor(ctx, &scan_state);
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+    for (i = from; i < cut; i++)
+        replylen += replyKeyStringValue(ctx, scanned_keys->keys[i], false);
+    RedisModule_ReplySetArrayLength(ctx, replylen);
+
+    freeScannedKeys(ctx, scanned_keys);
+    scanSomeStateFree(ctx, &scan_state);
+    return REDISMODULE_OK;
+}
+
+/* NDEL.NOATOMIC jobs run on the main thread, in slices of about the lock
+ * budget from a timer, so that other clients are served between them. The
+ * newest finished jobs are kept for NDEL.STATUS. */
+typedef enum _NDelJobState {
+    NDEL_JOB_RUNNING = 0,
+    NDEL_JOB_DONE,
+    NDEL_JOB_CANCELLED,
+    NDEL_JOB_FAILED
+} NDelJobState;
+
+typedef struct _NDelJob {
+    long long id;
+    NDelJobState state;
+    RedisModuleString *pattern;
+    int db;
+    ScanSomeState scan_state;  /* Also counts the keys scanned and matched */
+    long long deleted;
+    long long start_us;
+    long long end_us;
+    long long lock_us;         /* Time of the slices */
+    struct _NDelJob *next;
+} NDelJob;
+
+NDelJob *ndel_jobs = NULL;         /* Newest first */
+long long ndel_next_job_id = 1;
+long long ndel_jobs_running = 0;
+long long ndel_jobs_max = DEF_NDEL_JOBS;
+RedisModuleTimerID ndel_timer;
+bool ndel_timer_armed = false;
+
+static const char *ndelJobStateName(NDelJobState state)
+{
+    switch (state) {
+    case NDEL_JOB_RUNNING:
+        return "running";
+    case NDEL_JOB_DONE:
+        return "done";
+    case NDEL_JOB_CANCELLED:
+        return "cancelled";
+    default:
+        return "failed";
+    }
+}
+
+NDelJob *ndelJobFind(long long id)
+{
+    NDelJob *job;
+    for (job = ndel_jobs; job; job = job->next)
+        if (job->id == id)
+            return job;
+    return NULL;
+}
+
+void ndelJobFinish(NDelJob *job, NDelJobState state)
+{
+    ndel_jobs_running--;
+    job->state = state;
+    job->end_us = monotonicUs();
+    scanSomeStateFree(NULL, &job->scan_state);
+    if (slowLogWanted(job->end_us - job->start_us))
+        slowLogRecord(CMD_NDEL_NOATOMIC, job->db, job->pattern, &job->scan_state,
+                      job->lock_us, job->end_us - job->start_us);
+}
+
+/* Drops the oldest finished jobs beyond NDEL_JOBS_KEPT. */
+void ndelJobsTrim(void)
+{
+    NDelJob **link = &ndel_jobs;
+    int finished = 0;
+
+    while (*link) {
+        NDelJob *job = *link;
+        if (job->state != NDEL_JOB_RUNNING && ++finished > NDEL_JOBS_KEPT) {
+            *link = job->next;
+            RedisModule_FreeString(NULL, job->pattern);
+            RedisModule_Free(job);
+        } else {
+            link = &job->next;
+        }
+    }
+}
+
+/* One slice of a job: batches until the lock budget is used. Returns the
+ * state of the job after the slice. */
+NDelJobState ndelJobSlice(RedisModuleCtx *ctx, NDelJob *job)
+{
+    long long start = monotonicUs(), batch_start;
+    ExstringsStatus status;
+    ScannedKeys *scanned_keys;
+
+    RedisModule_SelectDb(ctx, job->db);
+    do {
+        batch_start = monotonicUs();
+        status = EXSTRINGS_STATUS_NOT_SET;
+        scanned_keys = nextKeys(ctx, &job->scan_state, &status);
+        if (status != EXSTRINGS_STATUS_NO_ERRORS)
+            return NDEL_JOB_FAILED;
+        if (scanned_keys) {
+            RedisModuleCallReply *reply = RedisModule_Call(ctx, "UNLINK", "v!",
+                                                           scanned_keys->keys, scanned_keys->len);
+            cmdStatsKeys(scanned_keys->len);
+            if (reply) {
+                if (RedisModule_CallReplyType(reply) == REDISMODULE_REPLY_INTEGER)
+                    job->deleted += RedisModule_CallReplyInteger(reply);
+                RedisModule_FreeCallReply(reply);
             }
         }
-        RedisModule_FreeCallReply(reply);
+        job->scan_state.batch = adaptBatchCount(job->scan_state.batch, monotonicUs() - batch_start,
+                                                scanned_keys ? scanned_keys->len : 0);
         freeScannedKeys(ctx, scanned_keys);
-    } while (scan_state.cursor != 0);
-
-    RedisModule_ReplySetArrayLength(ctx,replylen);
-    return ret;
+        if (job->scan_state.cursor == 0)
+            return NDEL_JOB_DONE;
+    } while (monotonicUs() - start < nget_lock_budget_us);
+    return NDEL_JOB_RUNNING;
 }
 
-/* The thread entry point that actually executes the blocking part
- * of the command nget.noatomic
- */
-void *NGet_NoAtomic_ThreadMain(void *arg)
+void ndelJobsCron(RedisModuleCtx *ctx, void *data)
 {
-    pthread_detach(pthread_self());
-
-    RedisModuleBlockedClientArgs *bca = arg;
-    RedisModuleBlockedClient *bc = bca->bc;
-    RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(bc);
-
-    Nget_RedisCommand(ctx, &bca->nget_args, true);
-    RedisModule_FreeThreadSafeContext(ctx);
-    RedisModule_UnblockClient(bc, NULL);
-    RedisModule_Free(bca);
-    return NULL;
+    REDISMODULE_NOT_USED(data);
+    bool running = false;
+    NDelJob *job;
+    NDelJobState state;
+    long long start;
+
+    ndel_timer_armed = false;
+    memset(&cmd_stats_call, 0, sizeof(cmd_stats_call));
+    /* A replica must not delete keys on its own, nor a server that loads its
+     * data, so the running jobs fail. */
+    bool unsafe = prefixIndexUnsafe(ctx);
+    for (job = ndel_jobs; job; job = job->next) {
+        if (job->state == NDEL_JOB_RUNNING && unsafe) {
+            ndelJobFinish(job, NDEL_JOB_FAILED);
+        } else if (job->state == NDEL_JOB_RUNNING) {
+            start = monotonicUs();
+            state = ndelJobSlice(ctx, job);
+            job->lock_us += monotonicUs() - start;
+            if (state != NDEL_JOB_RUNNING)
+                ndelJobFinish(job, state);
+        }
+        running |= job->state == NDEL_JOB_RUNNING;
+    }
+    /* The keys of the slices count for NDEL.NOATOMIC. */
+    if (cmd_stats_enabled)
+        cmd_stats[CMD_NDEL_NOATOMIC].keys += cmd_stats_call.keys;
+    ndelJobsTrim();
+
+    if (running) {
+        ndel_timer = RedisModule_CreateTimer(ctx, NDEL_SLICE_PERIOD, ndelJobsCron, NULL);
+        ndel_timer_armed = true;
+    }
 }
 
-int NGet_NoAtomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+int NDel_NoAtomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
     RedisModule_AutoMemory(ctx);
-    pthread_t tid;
 
     InitStaticVariable();
+    if (argc != 2)
+        return wrongArity(ctx);
+    if (ndel_jobs_running >= ndel_jobs_max)
+        return replyWithError(ctx,"-ERR Too many running jobs, see NDEL.CANCEL");
+
+    NDelJob *job = RedisModule_Alloc(sizeof(NDelJob));
+    if (job == NULL)
+        return replyWithError(ctx,"-ERR Out of memory");
+
+    memset(job, 0, sizeof(*job));
+    job->id = ndel_next_job_id++;
+    job->state = NDEL_JOB_RUNNING;
+    job->pattern = RedisModule_CreateStringFromString(NULL, argv[1]);
+    job->db = RedisModule_GetSelectedDb(ctx);
+    scanSomeStateInit(&job->scan_state, job->pattern, def_count_str, true);
+    job->scan_state.batch = DEF_COUNT;
+    job->start_us = monotonicUs();
+    job->next = ndel_jobs;
+    ndel_jobs = job;
+    ndel_jobs_running++;
+
+    if (!ndel_timer_armed) {
+        ndel_timer = RedisModule_CreateTimer(ctx, NDEL_SLICE_PERIOD, ndelJobsCron, NULL);
+        ndel_timer_armed = true;
+    }
+    return RedisModule_ReplyWithLongLong(ctx, job->id);
+}
 
-    RedisModuleBlockedClientArgs *bca = RedisModule_Alloc(sizeof(RedisModuleBlockedClientArgs));
-    if (bca == NULL) {
-        RedisModule_ReplyWithError(ctx,"-ERR Out of memory");
+NDelJob *readNDelJob(RedisModuleCtx *ctx, RedisModuleString *id_str)
+{
+    long long id;
+    NDelJob *job = NULL;
+
+    if (RedisModule_StringToLongLong(id_str, &id) != REDISMODULE_OK)
+        replyWithError(ctx,"-ERR value is not an integer or out of range");
+    else if ((job = ndelJobFind(id)) == NULL)
+        replyWithError(ctx,"-ERR no such job");
+    return job;
+}
+
+int NDelStatus_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    NDelJob *job = readNDelJob(ctx, argv[1]);
+    if (job == NULL)
         return REDISMODULE_ERR;
-    }
 
-    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
-    readNgetArgs(ctx, argv, argc, &bca->nget_args, &status);
-    if (status != EXSTRINGS_STATUS_NO_ERRORS) {
-        RedisModule_Free(bca);
+    long long end_us = job->state == NDEL_JOB_RUNNING ? monotonicUs() : job->end_us;
+    const char *state = ndelJobStateName(job->state);
+
+    RedisModule_ReplyWithArray(ctx, 14);
+    RedisModule_ReplyWithSimpleString(ctx, "id");
+    RedisModule_ReplyWithLongLong(ctx, job->id);
+    RedisModule_ReplyWithSimpleString(ctx, "pattern");
+    RedisModule_ReplyWithString(ctx, job->pattern);
+    RedisModule_ReplyWithSimpleString(ctx, "state");
+    RedisModule_ReplyWithStringBuffer(ctx, state, strlen(state));
+    RedisModule_ReplyWithSimpleString(ctx, "scanned");
+    RedisModule_ReplyWithLongLong(ctx, job->scan_state.scanned);
+    RedisModule_ReplyWithSimpleString(ctx, "matched");
+    RedisModule_ReplyWithLongLong(ctx, job->scan_state.matched);
+    RedisModule_ReplyWithSimpleString(ctx, "deleted");
+    RedisModule_ReplyWithLongLong(ctx, job->deleted);
+    RedisModule_ReplyWithSimpleString(ctx, "elapsed_ms");
+    RedisModule_ReplyWithLongLong(ctx, (end_us - job->start_us) / 1000);
+    return REDISMODULE_OK;
+}
+
+int NDelCancel_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    if (argc != 2)
+        return wrongArity(ctx);
+
+    NDelJob *job = readNDelJob(ctx, argv[1]);
+    if (job == NULL)
         return REDISMODULE_ERR;
-    }
 
-    /* Note that when blocking the client we do not set any callback: no
-     * timeout is possible since we passed '0', nor we need a reply callback
-     * because we'll use the thread safe context to accumulate a reply. */
-    RedisModuleBlockedClient *bc = RedisModule_BlockClient(ctx,NULL,NULL,NULL,0);
+    if (job->state != NDEL_JOB_RUNNING)
+        return RedisModule_ReplyWithLongLong(ctx, 0);
+    ndelJobFinish(job, NDEL_JOB_CANCELLED);
+    return RedisModule_ReplyWithLongLong(ctx, 1);
+}
 
-    bca->bc = bc;
+void slowLogReplyEntry(RedisModuleCtx *ctx, const SlowLogEntry *entry)
+{
+    RedisModule_ReplyWithArray(ctx, 20);
+    RedisModule_ReplyWithSimpleString(ctx, "id");
+    RedisModule_ReplyWithLongLong(ctx, entry->id);
+    RedisModule_ReplyWithSimpleString(ctx, "time");
+    RedisModule_ReplyWithLongLong(ctx, entry->time);
+    RedisModule_ReplyWithSimpleString(ctx, "command");
+    RedisModule_ReplyWithSimpleString(ctx, cmd_names[entry->cmd]);
+    RedisModule_ReplyWithSimpleString(ctx, "pattern");
+    RedisModule_ReplyWithStringBuffer(ctx, entry->pattern, entry->patternlen);
+    RedisModule_ReplyWithSimpleString(ctx, "db");
+    RedisModule_ReplyWithLongLong(ctx, entry->db);
+    RedisModule_ReplyWithSimpleString(ctx, "scanned");
+    RedisModule_ReplyWithLongLong(ctx, entry->scanned);
+    RedisModule_ReplyWithSimpleString(ctx, "matched");
+    RedisModule_ReplyWithLongLong(ctx, entry->matched);
+    RedisModule_ReplyWithSimpleString(ctx, "iterations");
+    RedisModule_ReplyWithLongLong(ctx, entry->iterations);
+    RedisModule_ReplyWithSimpleString(ctx, "lock_us");
+    RedisModule_ReplyWithLongLong(ctx, entry->lock_us);
+    RedisModule_ReplyWithSimpleString(ctx, "wall_us");
+    RedisModule_ReplyWithLongLong(ctx, entry->wall_us);
+}
 
-    /* Now that we setup a blocking client, we need to pass the control
-     * to the thread. However we need to pass arguments to the thread:
-     * the reference to the blocked client handle. */
-    if (pthread_create(&tid,NULL,NGet_NoAtomic_ThreadMain,bca) != 0) {
-        RedisModule_AbortBlock(bc);
-        RedisModule_Free(bca);
-        return RedisModule_ReplyWithError(ctx,"-ERR Can't start thread");
-    }
+/* NSLOWLOG GET [count]   the newest entries first, -1 for all of them
+ * NSLOWLOG LEN           number of entries
+ * NSLOWLOG RESET         clears the log */
+int NSlowLog_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    long long count = DEF_SLOWLOG_GET, i;
+    const char *option;
+    size_t len;
+
+    if (argc < 2 || argc > 3)
+        return wrongArity(ctx);
 
+    option = RedisModule_StringPtrLen(argv[1], &len);
+    if (argc == 2 && !strcasecmp(option, LEN_STR)) {
+        pthread_mutex_lock(&slow_log_lock);
+        count = (long long)slow_log.len;
+        pthread_mutex_unlock(&slow_log_lock);
+        return RedisModule_ReplyWithLongLong(ctx, count);
+    }
+    if (argc == 2 && !strcasecmp(option, RESET_STR)) {
+        pthread_mutex_lock(&slow_log_lock);
+        slowLogReset(&slow_log);
+        pthread_mutex_unlock(&slow_log_lock);
+        return RedisModule_ReplyWithSimpleString(ctx, "OK");
+    }
+    if (strcasecmp(option, GET_STR))
+        return replyWithError(ctx, "-ERR syntax error");
+    if (argc == 3 &&
+        (RedisModule_StringToLongLong(argv[2], &count) != REDISMODULE_OK || count < -1))
+        return replyWithError(ctx, "-ERR value is not an integer or out of range");
+
+    pthread_mutex_lock(&slow_log_lock);
+    if (count < 0 || count > (long long)slow_log.len)
+        count = (long long)slow_log.len;
+    RedisModule_ReplyWithArray(ctx, count);
+    for (i = 0; i < count; i++)
+        slowLogReplyEntry(ctx, slowLogGet(&slow_log, i));
+    pthread_mutex_unlock(&slow_log_lock);
     return REDISMODULE_OK;
 }
 
-int NGet_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+/* Runs a command with its counters, see CMDSTATS. A command that hands its
+ * work over to a worker clears cmd_stats_cmd, the worker then counts the
+ * call. */
+int cmdStatsCall(int cmd, RedisModuleCmdFunc func, RedisModuleCtx *ctx,
+                 RedisModuleString **argv, int argc)
 {
-    RedisModule_AutoMemory(ctx);
-    NgetArgs nget_args;
-    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
+    if (!cmd_stats_enabled)
+        return func(ctx, argv, argc);
+
+    memset(&cmd_stats_call, 0, sizeof(cmd_stats_call));
+    cmd_stats_cmd = cmd;
+    cmd_stats_start_ns = monotonicNs();
+    int ret = func(ctx, argv, argc);
+    if (cmd_stats_cmd >= 0)
+        cmdStatsRecord(&cmd_stats[cmd], &cmd_stats_call, monotonicNs() - cmd_stats_start_ns);
+    cmd_stats_cmd = -1;
+    return ret;
+}
 
-    InitStaticVariable();
+/* The fields of a command in CMDSTATS and INFO, latencies in nanoseconds. */
+#define CMD_STATS_FIELDS 9
+const char *cmd_stats_fields[CMD_STATS_FIELDS] = {
+    "calls", "errors", "hits", "misses", "keys", "ns", "p50_ns", "p99_ns", "p999_ns"
+};
 
-    readNgetArgs(ctx, argv, argc, &nget_args, &status);
-    if (status != EXSTRINGS_STATUS_NO_ERRORS) {
-        return REDISMODULE_ERR;
+const double cmd_stats_percentiles[3] = {0.5, 0.99, 0.999};
+
+/* The counters of a command, of the main thread and the workers. */
+void cmdStatsRead(int cmd, CmdStats *stats)
+{
+    *stats = cmd_stats[cmd];
+    pthread_mutex_lock(&worker_pool.lock);
+    cmdStatsMerge(stats, &worker_cmd_stats[cmd]);
+    pthread_mutex_unlock(&worker_pool.lock);
+}
+
+/* Reads the fields of a command, false if it has not been counted. */
+bool cmdStatsValues(int cmd, unsigned long long *values)
+{
+    CmdStats stats;
+    uint64_t percentiles[3];
+
+    cmdStatsRead(cmd, &stats);
+    if (stats.calls == 0 && stats.keys == 0)
+        return false;
+
+    cmdStatsPercentiles(&stats, cmd_stats_percentiles, percentiles, 3);
+    values[0] = stats.calls;
+    values[1] = stats.errors;
+    values[2] = stats.hits;
+    values[3] = stats.misses;
+    values[4] = stats.keys;
+    values[5] = stats.ns;
+    values[6] = percentiles[0];
+    values[7] = percentiles[1];
+    values[8] = percentiles[2];
+    return true;
+}
+
+int cmdStatsFind(const char *name)
+{
+    int i;
+
+    for (i = 0; i < CMD_COUNT; i++) {
+        if (!strcasecmp(name, cmd_names[i]))
+            return i;
     }
+    return -1;
+}
 
-    return Nget_RedisCommand(ctx, &nget_args, false);
+void cmdStatsResetAll(void)
+{
+    int i;
+
+    pthread_mutex_lock(&worker_pool.lock);
+    for (i = 0; i < CMD_COUNT; i++) {
+        cmdStatsReset(&cmd_stats[i]);
+        cmdStatsReset(&worker_cmd_stats[i]);
+    }
+    pthread_mutex_unlock(&worker_pool.lock);
 }
 
-int NDel_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+long long cmdStatsReplyValue(unsigned long long value)
 {
-    RedisModule_AutoMemory(ctx);
-    int ret = REDISMODULE_OK;
-    long long replylen = 0;
-    RedisModuleCallReply *reply = NULL;
-    ExstringsStatus status = EXSTRINGS_STATUS_NOT_SET;
-    ScanSomeState scan_state;
-    ScannedKeys *scanned_keys = NULL;
+    return value > LLONG_MAX ? LLONG_MAX : (long long)value;
+}
 
-    InitStaticVariable();
-    if (argc != 2)
-        return RedisModule_WrongArity(ctx);
+/* CMDSTATS                     counters of the commands that were called
+ * CMDSTATS HISTOGRAM command   latency histogram of a command
+ * CMDSTATS RESET               clears the counters */
+int CmdStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    unsigned long long values[CMD_STATS_FIELDS];
+    const char *option;
+    size_t len;
+    int i, j;
+
+    if (argc == 2) {
+        option = RedisModule_StringPtrLen(argv[1], &len);
+        if (strcasecmp(option, RESET_STR))
+            return replyWithError(ctx, "-ERR syntax error");
+        cmdStatsResetAll();
+        return RedisModule_ReplyWithSimpleString(ctx, "OK");
+    }
 
-    scan_state.key = argv[1];
-    scan_state.count = def_count_str;
-    scan_state.cursor = 0;
+    if (argc == 3) {
+        option = RedisModule_StringPtrLen(argv[1], &len);
+        if (strcasecmp(option, HISTOGRAM_STR))
+            return replyWithError(ctx, "-ERR syntax error");
+        int cmd = cmdStatsFind(RedisModule_StringPtrLen(argv[2], &len));
+        if (cmd < 0)
+            return replyWithError(ctx, "-ERR unknown command");
+
+        CmdStats stats;
+        long long replylen = 0;
+        cmdStatsRead(cmd, &stats);
+        RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+        for (i = 0; i < CMDSTATS_BUCKETS; i++) {
+            if (stats.latency[i] == 0)
+                continue;
+            RedisModule_ReplyWithLongLong(ctx, cmdStatsReplyValue(cmdStatsBucketMax(i)));
+            RedisModule_ReplyWithLongLong(ctx, cmdStatsReplyValue(stats.latency[i]));
+            replylen += 2;
+        }
+        RedisModule_ReplySetArrayLength(ctx, replylen);
+        return REDISMODULE_OK;
+    }
 
-    do {
-        status = EXSTRINGS_STATUS_NOT_SET;
-        scanned_keys = scanSome(ctx, &scan_state, &status);
+    if (argc != 1)
+        return wrongArity(ctx);
 
-        if (status != EXSTRINGS_STATUS_NO_ERRORS) {
-            ret = REDISMODULE_ERR;
-            break;
-        } else if (scanned_keys == NULL) {
+    long long replylen = 0;
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+    for (i = 0; i < CMD_COUNT; i++) {
+        if (!cmdStatsValues(i, values))
             continue;
+        RedisModule_ReplyWithSimpleString(ctx, cmd_names[i]);
+        RedisModule_ReplyWithArray(ctx, 2 * CMD_STATS_FIELDS);
+        for (j = 0; j < CMD_STATS_FIELDS; j++) {
+            RedisModule_ReplyWithSimpleString(ctx, cmd_stats_fields[j]);
+            RedisModule_ReplyWithLongLong(ctx, cmdStatsReplyValue(values[j]));
         }
+        replylen += 2;
+    }
+    RedisModule_ReplySetArrayLength(ctx, replylen);
+    return REDISMODULE_OK;
+}
 
-        reply = RedisModule_Call(ctx, "UNLINK", "v!", scanned_keys->keys, scanned_keys->len);
+/* The cmdstats section of INFO, a field per command that was called. */
+void cmdStatsInfo(RedisModuleInfoCtx *ctx, int for_crash_report)
+{
+    REDISMODULE_NOT_USED(for_crash_report);
+    unsigned long long values[CMD_STATS_FIELDS];
+    int i, j;
 
-        status = EXSTRINGS_STATUS_NOT_SET;
-        forwardIfError(ctx, reply, &status);
-        if (status != EXSTRINGS_STATUS_NO_ERRORS) {
-            freeScannedKeys(ctx, scanned_keys);
-            ret = REDISMODULE_ERR;
-            break;
-        }
+    RedisModule_InfoAddSection(ctx, "cmdstats");
+    for (i = 0; i < CMD_COUNT; i++) {
+        if (!cmdStatsValues(i, values))
+            continue;
+        RedisModule_InfoBeginDictField(ctx, (char *)cmd_names[i]);
+        for (j = 0; j < CMD_STATS_FIELDS; j++)
+            RedisModule_InfoAddFieldULongLong(ctx, (char *)cmd_stats_fields[j], values[j]);
+        RedisModule_InfoEndDictField(ctx);
+    }
+}
 
-        replylen += RedisModule_CallReplyInteger(reply);
-        RedisModule_FreeCallReply(reply);
-        freeScannedKeys(ctx, scanned_keys);
-    } while (scan_state.cursor != 0);
+/* Module arguments are name value pairs, e.g.
+ * loadmodule libredismodule.so PREFIXINDEX yes WORKERS 8 */
+int readModuleArgs(RedisModuleString **argv, int argc)
+{
+    size_t len;
+    long long number;
+    int i;
 
-    if (ret == REDISMODULE_OK) {
-        RedisModule_ReplyWithLongLong(ctx, replylen);
+    if (argc % 2)
+        return REDISMODULE_ERR;
+
+    for (i = 0; i < argc; i += 2) {
+        const char *name = RedisModule_StringPtrLen(argv[i], &len);
+        const char *value = RedisModule_StringPtrLen(argv[i + 1], &len);
+        if (!strcasecmp(name, PREFIX_INDEX_STR)) {
+            if (!strcasecmp(value, "yes"))
+                prefix_index_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                prefix_index_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, NSSTATS_STR)) {
+            if (!strcasecmp(value, "yes"))
+                ns_accounting_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                ns_accounting_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, WORKERS_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 1 || number > MAX_WORKERS)
+                return REDISMODULE_ERR;
+            worker_pool_size = (int)number;
+        } else if (!strcasecmp(name, QUEUELEN_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 1)
+                return REDISMODULE_ERR;
+            worker_pool_queue_len = number;
+        } else if (!strcasecmp(name, NDELJOBS_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 1)
+                return REDISMODULE_ERR;
+            ndel_jobs_max = number;
+        } else if (!strcasecmp(name, NATIVESCAN_STR)) {
+            if (!strcasecmp(value, "yes"))
+                native_scan_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                native_scan_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, SLOTSCAN_STR)) {
+            if (!strcasecmp(value, "yes"))
+                slot_scan_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                slot_scan_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, NATIVEPUBLISH_STR)) {
+            if (!strcasecmp(value, "yes"))
+                native_publish_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                native_publish_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, CMDSTATS_STR)) {
+            if (!strcasecmp(value, "yes"))
+                cmd_stats_enabled = true;
+            else if (!strcasecmp(value, "no"))
+                cmd_stats_enabled = false;
+            else
+                return REDISMODULE_ERR;
+        } else if (!strcasecmp(name, SLOWLOGUS_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 0)
+                return REDISMODULE_ERR;
+            slow_log_us = number;
+        } else if (!strcasecmp(name, SLOWLOGLEN_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 0 || number > MAX_SLOWLOG_LEN)
+                return REDISMODULE_ERR;
+            slow_log_len = number;
+        } else if (!strcasecmp(name, COMPRESSMIN_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 0)
+                return REDISMODULE_ERR;
+            compress_min = number;
+        } else if (!strcasecmp(name, LOCKBUDGET_STR)) {
+            if (RedisModule_StringToLongLong(argv[i + 1], &number) != REDISMODULE_OK ||
+                number < 1 || number > MAX_LOCK_BUDGET_US)
+                return REDISMODULE_ERR;
+            nget_lock_budget_us = number;
+        } else {
+            return REDISMODULE_ERR;
+        }
     }
+    return REDISMODULE_OK;
+}
 
-    return ret;
+/* The commands as registered, counted by cmdStatsCall. */
+#define CMD_STATS_FUNC(id, name, func) \
+int func##_Stats(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) \
+{ \
+    return cmdStatsCall(id, func, ctx, argv, argc); \
 }
+EXSTRINGS_COMMANDS(CMD_STATS_FUNC)
+#undef CMD_STATS_FUNC
 
 /* This function must be present on each Redis module. It is used in order to
  * register the commands into the Redis server. */
 int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
-    REDISMODULE_NOT_USED(argv);
-    REDISMODULE_NOT_USED(argc);
-
     if (RedisModule_Init(ctx,"exstrings",1,REDISMODULE_APIVER_1)
         == REDISMODULE_ERR) return REDISMODULE_ERR;
 
+    prefix_index_enabled = false;
+    native_scan_enabled = true;
+    slot_scan_enabled = true;
+    native_publish_enabled = true;
+    cmd_stats_enabled = false;
+    ns_accounting_enabled = false;
+    if (readModuleArgs(argv, argc) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (!nativeScanSupported())
+        native_scan_enabled = false;
+    if (!RMAPI_FUNC_SUPPORTED(RedisModule_GetContextFlags))
+        slot_scan_enabled = false;
+    if (!RMAPI_FUNC_SUPPORTED(RedisModule_PublishMessage))
+        native_publish_enabled = false;
+
+    if (cmd_stats_enabled && RMAPI_FUNC_SUPPORTED(RedisModule_RegisterInfoFunc) &&
+        RedisModule_RegisterInfoFunc(ctx, cmdStatsInfo) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (prefix_index_enabled && prefixIndexSupported()) {
+        if (RedisModule_SubscribeToKeyspaceEvents(ctx, REDISMODULE_NOTIFY_ALL,
+            prefixIndexNotify) == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+    } else {
+        prefix_index_enabled = false;
+    }
+    if (ns_accounting_enabled && nsAccountingSupported()) {
+        if (RedisModule_SubscribeToKeyspaceEvents(ctx, REDISMODULE_NOTIFY_ALL,
+            nsAccountingNotify) == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+    } else {
+        ns_accounting_enabled = false;
+    }
+    if ((prefix_index_enabled || ns_accounting_enabled) &&
+        RedisModule_RegisterCommandFilter(ctx, prefixIndexCommandFilter, 0) == NULL)
+        return REDISMODULE_ERR;
+
+    RedisModuleTypeMethods versioned_type_methods = {
+        .version = REDISMODULE_TYPE_METHOD_VERSION,
+        .rdb_load = versionedRdbLoad,
+        .rdb_save = versionedRdbSave,
+        .aof_rewrite = versionedAofRewrite,
+        .mem_usage = versionedMemUsage,
+        .free = freeVersionedValue
+    };
+    versioned_type = RedisModule_CreateDataType(ctx, VERSIONED_TYPE_NAME,
+        VERSIONED_TYPE_ENCVER, &versioned_type_methods);
+    if (versioned_type == NULL)
+        return REDISMODULE_ERR;
+
+    if (RMAPI_FUNC_SUPPORTED(RedisModule_GetRandomBytes)) {
+        uint64_t seed;
+        RedisModule_GetRandomBytes((unsigned char *)&seed, sizeof(seed));
+        nsDictConfigure(RedisModule_Alloc, RedisModule_Free, seed);
+    } else {
+        nsDictConfigure(RedisModule_Alloc, RedisModule_Free, 0);
+    }
+    RedisModuleTypeMethods ns_type_methods = {
+        .version = REDISMODULE_TYPE_METHOD_VERSION,
+        .rdb_load = nsRdbLoad,
+        .rdb_save = nsRdbSave,
+        .aof_rewrite = nsAofRewrite,
+        .mem_usage = nsMemUsage,
+        .free = freeNsValue,
+        .free_effort = nsFreeEffort,
+        .defrag = RMAPI_FUNC_SUPPORTED(RedisModule_DefragAlloc) ? nsDefrag : NULL
+    };
+    ns_type = RedisModule_CreateDataType(ctx, NS_TYPE_NAME, NS_TYPE_ENCVER, &ns_type_methods);
+    if (ns_type == NULL)
+        return REDISMODULE_ERR;
+
     if (RedisModule_CreateCommand(ctx,"setie",
-        SetIE_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetIE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setne",
-        SetNE_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetNE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"delie",
-        DelIE_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelIE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"delne",
-        DelNE_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelNE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setiedigest",
+        SetIEDigest_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setnedigest",
+        SetNEDigest_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"deliedigest",
+        DelIEDigest_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"delnedigest",
+        DelNEDigest_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"nget.atomic",
-        NGet_Atomic_RedisCommand,"readonly",1,1,1) == REDISMODULE_ERR)
+        NGet_Atomic_RedisCommand_Stats,"readonly",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"nget.noatomic",
-        NGet_NoAtomic_RedisCommand,"readonly",1,1,1) == REDISMODULE_ERR)
+        NGet_NoAtomic_RedisCommand_Stats,"readonly",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"poolstats",
+        PoolStats_RedisCommand_Stats,"readonly fast",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"nscan",
+        NScan_RedisCommand_Stats,"readonly",0,0,0) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"ndel.atomic",
-        NDel_Atomic_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        NDel_Atomic_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ndel.noatomic",
+        NDel_NoAtomic_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ndel.status",
+        NDelStatus_RedisCommand_Stats,"readonly fast",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ndel.cancel",
+        NDelCancel_RedisCommand_Stats,"fast",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"nslowlog",
+        NSlowLog_RedisCommand_Stats,"readonly fast",0,0,0) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"msetpub",
-        SetPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"msetmpub",
-        SetMPub_RedisCommand,"write deny-oom pubsub",1,1,1) == REDISMODULE_ERR)
+        SetMPub_RedisCommand_Stats,"write deny-oom pubsub",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setiepub",
-        SetIEPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetIEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setiempub",
-        SetIEMPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetIEMPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setnepub",
-        SetNEPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetNEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setxxpub",
-        SetXXPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetXXPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setnxpub",
-        SetNXPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetNXPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"setnxmpub",
-        SetNXMPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        SetNXMPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"delpub",
-        DelPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"delmpub",
-        DelMPub_RedisCommand,"write deny-oom pubsub",1,1,1) == REDISMODULE_ERR)
+        DelMPub_RedisCommand_Stats,"write deny-oom pubsub",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"deliepub",
-        DelIEPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelIEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"deliempub",
-        DelIEMPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelIEMPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     if (RedisModule_CreateCommand(ctx,"delnepub",
-        DelNEPub_RedisCommand,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        DelNEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setiedigestpub",
+        SetIEDigestPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setiedigestmpub",
+        SetIEDigestMPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setnedigestpub",
+        SetNEDigestPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"deliedigestpub",
+        DelIEDigestPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"deliedigestmpub",
+        DelIEDigestMPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"delnedigestpub",
+        DelNEDigestPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"getver",
+        GetVer_RedisCommand_Stats,"readonly",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setver",
+        SetVer_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setifver",
+        SetIfVer_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"setifverpub",
+        SetIfVerPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"delifver",
+        DelIfVer_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"delifverpub",
+        DelIfVerPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.set",
+        NsSet_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.setpub",
+        NsSetPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.get",
+        NsGet_RedisCommand_Stats,"readonly fast",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.mget",
+        NsMGet_RedisCommand_Stats,"readonly fast",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.getall",
+        NsGetAll_RedisCommand_Stats,"readonly",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.del",
+        NsDel_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.delpub",
+        NsDelPub_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.setie",
+        NsSetIE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.setiepub",
+        NsSetIEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.delie",
+        NsDelIE_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.deliepub",
+        NsDelIEPub_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.clear",
+        NsClear_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"ns.clearpub",
+        NsClearPub_RedisCommand_Stats,"write",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"cset",
+        CSet_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"csetie",
+        CSetIE_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"csetiepub",
+        CSetIEPub_RedisCommand_Stats,"write deny-oom",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"cget",
+        CGet_RedisCommand_Stats,"readonly fast",1,1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"cstats",
+        CStats_RedisCommand_Stats,"readonly fast",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"mdigest",
+        MDigest_RedisCommand_Stats,"readonly fast",1,-1,1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"nsstats",
+        NsStats_RedisCommand_Stats,"readonly",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"sdl.batch",
+        SdlBatch_RedisCommand_Stats,"write deny-oom pubsub getkeys-api",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx,"cmdstats",
+        CmdStats_RedisCommand_Stats,"readonly fast",0,0,0) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (workerPoolStart() == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
     return REDISMODULE_OK;
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#include "globmatch.h"
+
+/* Follows stringmatchlen() of the Redis server, so that the native scan
+ * matches exactly the keys SCAN MATCH would. */
+static bool globMatchImpl(const char *pattern, size_t patternlen,
+                          const char *str, size_t stringlen, bool *skip_longer)
+{
+    while (patternlen && stringlen) {
+        switch (pattern[0]) {
+        case '*':
+            while (patternlen > 1 && pattern[1] == '*') {
+                pattern++;
+                patternlen--;
+            }
+            if (patternlen == 1)
+                return true;
+            while (stringlen) {
+                if (globMatchImpl(pattern + 1, patternlen - 1, str, stringlen, skip_longer))
+                    return true;
+                /* The rest of the pattern matches nowhere in the rest of
+                 * the string, so longer matches of an earlier '*' cannot
+                 * help either. */
+                if (*skip_longer)
+                    return false;
+                str++;
+                stringlen--;
+            }
+            *skip_longer = true;
+            return false;
+        case '?':
+            str++;
+            stringlen--;
+            break;
+        case '[': {
+            bool negate, match = false;
+
+            pattern++;
+            patternlen--;
+            negate = patternlen && pattern[0] == '^';
+            if (negate) {
+                pattern++;
+                patternlen--;
+            }
+            while (patternlen) {
+                if (pattern[0] == '\\' && patternlen >= 2) {
+                    pattern++;
+                    patternlen--;
+                    if (pattern[0] == str[0])
+                        match = true;
+                } else if (pattern[0] == ']') {
+                    break;
+                } else if (patternlen >= 3 && pattern[1] == '-') {
+                    unsigned char start = pattern[0], end = pattern[2], c = str[0];
+                    if (start > end) {
+                        unsigned char t = start;
+                        start = end;
+                        end = t;
+                    }
+                    if (c >= start && c <= end)
+                        match = true;
+                    pattern += 2;
+                    patternlen -= 2;
+                } else if (pattern[0] == str[0]) {
+                    match = true;
+                }
+                pattern++;
+                patternlen--;
+            }
+            /* An unterminated '[' ends the pattern. */
+            if (patternlen == 0) {
+                pattern--;
+                patternlen++;
+            }
+            if (negate)
+                match = !match;
+            if (!match)
+                return false;
+            str++;
+            stringlen--;
+            break;
+        }
+        case '\\':
+            if (patternlen >= 2) {
+                pattern++;
+                patternlen--;
+            }
+            /* fall through */
+        default:
+            if (pattern[0] != str[0])
+                return false;
+            str++;
+            stringlen--;
+            break;
+        }
+        pattern++;
+        patternlen--;
+        if (stringlen == 0) {
+            while (patternlen && pattern[0] == '*') {
+                pattern++;
+                patternlen--;
+            }
+            break;
+        }
+    }
+    return patternlen == 0 && stringlen == 0;
+}
+
+bool globMatch(const char *pattern, size_t patternlen, const char *str, size_t stringlen)
+{
+    bool skip_longer = false;
+    return globMatchImpl(pattern, patternlen, str, stringlen, &skip_longer);
+}
+
+void globCompile(GlobPattern *glob, const char *pattern, size_t patternlen, char *literal)
+{
+    size_t i, n = 0;
+
+    glob->kind = GLOB_GENERIC;
+    glob->pattern = pattern;
+    glob->patternlen = patternlen;
+    glob->literal = literal;
+    glob->literallen = 0;
+
+    for (i = 0; i < patternlen; i++) {
+        if (pattern[i] == '\\') {
+            /* A trailing '\\' is left to the matcher. */
+            if (++i == patternlen)
+                return;
+        } else if (pattern[i] == '*') {
+            if (i == patternlen - 1)
+                glob->kind = n ? GLOB_PREFIX : GLOB_ANY;
+            return;
+        } else if (pattern[i] == '?' || pattern[i] == '[') {
+            return;
+        }
+        literal[n++] = pattern[i];
+        glob->literallen = n;
+    }
+    glob->kind = GLOB_EXACT;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#include "nsdict.h"
+#include "xxhash64.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NSDICT_MIN_SIZE 8
+
+static void *(*nsdict_alloc)(size_t) = malloc;
+static void (*nsdict_free)(void *) = free;
+static uint64_t nsdict_seed = 0;
+
+void nsDictConfigure(void *(*alloc)(size_t), void (*dealloc)(void *), uint64_t seed)
+{
+    nsdict_alloc = alloc;
+    nsdict_free = dealloc;
+    nsdict_seed = seed;
+}
+
+void nsDictInit(NsDict *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+void nsDictClear(NsDict *d)
+{
+    size_t i;
+
+    for (i = 0; i < d->size; i++)
+        nsdict_free(d->table[i].data);
+    nsdict_free(d->table);
+    nsDictInit(d);
+}
+
+/* Slot of 'hash', or the free slot where it would go. */
+static size_t nsDictSlot(const NsDict *d, uint64_t hash, const char *field, size_t fieldlen)
+{
+    size_t mask = d->size - 1, i = hash & mask;
+    const NsEntry *e;
+
+    for (;; i = (i + 1) & mask) {
+        e = &d->table[i];
+        if (e->data == NULL ||
+            (e->hash == hash && e->fieldlen == fieldlen && !memcmp(e->data, field, fieldlen)))
+            return i;
+    }
+}
+
+static bool nsDictResize(NsDict *d, size_t size)
+{
+    NsEntry *table = nsdict_alloc(size * sizeof(NsEntry)), *old = d->table;
+    size_t i, j, oldsize = d->size;
+
+    if (table == NULL)
+        return false;
+    memset(table, 0, size * sizeof(NsEntry));
+    d->table = table;
+    d->size = size;
+    for (i = 0; i < oldsize; i++) {
+        if (old[i].data == NULL)
+            continue;
+        for (j = old[i].hash & (size - 1); table[j].data; j = (j + 1) & (size - 1))
+            ;
+        table[j] = old[i];
+    }
+    nsdict_free(old);
+    return true;
+}
+
+/* Tables are kept at most 3/4 full. */
+static size_t nsDictSizeFor(size_t len)
+{
+    size_t size = NSDICT_MIN_SIZE;
+
+    while (size / 4 * 3 < len)
+        size *= 2;
+    return size;
+}
+
+bool nsDictReserve(NsDict *d, size_t len)
+{
+    size_t size = nsDictSizeFor(len);
+    return size <= d->size || nsDictResize(d, size);
+}
+
+NsEntry *nsDictFind(const NsDict *d, const char *field, size_t fieldlen)
+{
+    if (d->len == 0)
+        return NULL;
+
+    NsEntry *e = &d->table[nsDictSlot(d, xxhash64(field, fieldlen, nsdict_seed), field, fieldlen)];
+    return e->data ? e : NULL;
+}
+
+int nsDictSet(NsDict *d, const char *field, size_t fieldlen, const char *value, size_t valuelen)
+{
+    uint64_t hash = xxhash64(field, fieldlen, nsdict_seed);
+    NsEntry *e;
+    char *data;
+
+    if (fieldlen > UINT32_MAX || valuelen > UINT32_MAX || !nsDictReserve(d, d->len + 1))
+        return -1;
+
+    e = &d->table[nsDictSlot(d, hash, field, fieldlen)];
+    if (e->data && e->valuelen == valuelen) {
+        memcpy(e->data + fieldlen, value, valuelen);
+        return 0;
+    }
+
+    data = nsdict_alloc(fieldlen + valuelen ? fieldlen + valuelen : 1);
+    if (data == NULL)
+        return -1;
+    memcpy(data, field, fieldlen);
+    memcpy(data + fieldlen, value, valuelen);
+    if (e->data) {
+        d->bytes -= e->valuelen;
+        d->bytes += valuelen;
+        nsdict_free(e->data);
+        e->data = data;
+        e->valuelen = (uint32_t)valuelen;
+        return 0;
+    }
+    e->hash = hash;
+    e->fieldlen = (uint32_t)fieldlen;
+    e->valuelen = (uint32_t)valuelen;
+    e->data = data;
+    d->len++;
+    d->bytes += fieldlen + valuelen;
+    return 1;
+}
+
+bool nsDictDelete(NsDict *d, const char *field, size_t fieldlen)
+{
+    NsEntry *e = nsDictFind(d, field, fieldlen);
+    size_t mask = d->size - 1, i, j, k;
+
+    if (e == NULL)
+        return false;
+    d->len--;
+    d->bytes -= e->fieldlen + e->valuelen;
+    nsdict_free(e->data);
+
+    /* Moves back the following entries of the probe run that the free slot
+     * would hide from their home slot. */
+    i = j = (size_t)(e - d->table);
+    for (;;) {
+        j = (j + 1) & mask;
+        if (d->table[j].data == NULL)
+            break;
+        k = d->table[j].hash & mask;
+        if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+            d->table[i] = d->table[j];
+            i = j;
+        }
+    }
+    d->table[i].data = NULL;
+
+    if (d->len == 0)
+        nsDictClear(d);
+    else if (d->size > NSDICT_MIN_SIZE && d->len < d->size / 8)
+        nsDictResize(d, d->size / 2);
+    return true;
+}
+
+NsEntry *nsDictNext(const NsDict *d, size_t *pos)
+{
+    while (*pos < d->size) {
+        NsEntry *e = &d->table[(*pos)++];
+        if (e->data)
+            return e;
+    }
+    return NULL;
+}
+
+size_t nsDictMemUsage(const NsDict *d)
+{
+    return d->size * sizeof(NsEntry) + d->bytes;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#include "nsstats.h"
+#include <stddef.h>
+#include <string.h>
+
+void nsStatsInit(NsStats *s)
+{
+    nsDictInit(&s->names);
+}
+
+void nsStatsClear(NsStats *s)
+{
+    nsDictClear(&s->names);
+}
+
+bool nsStatsKeyNamespace(const char *key, size_t keylen, const char **ns, size_t *nslen)
+{
+    const char *end;
+
+    if (keylen < 4 || key[0] != '{')
+        return false;
+    end = memchr(key + 1, '}', keylen - 1);
+    if (end == NULL || end == key + 1 || end + 1 == key + keylen || end[1] != ',')
+        return false;
+    *ns = key + 1;
+    *nslen = (size_t)(end - key - 1);
+    return true;
+}
+
+size_t nsStatsBucket(long long size)
+{
+    size_t i;
+    long long limit = 64;
+
+    for (i = 0; i < NSSTATS_BUCKETS - 1 && size >= limit; i++)
+        limit *= 4;
+    return i;
+}
+
+void nsStatsCounters(const NsEntry *e, NsCounters *counters)
+{
+    /* The values are not aligned. */
+    memcpy(counters, nsEntryValue(e), sizeof(*counters));
+}
+
+bool nsStatsChange(NsStats *s, const char *ns, size_t nslen, long long oldsize, long long newsize)
+{
+    NsEntry *e = nsDictFind(&s->names, ns, nslen);
+    NsCounters c;
+
+    if (e)
+        nsStatsCounters(e, &c);
+    else
+        memset(&c, 0, sizeof(c));
+
+    if (oldsize >= 0) {
+        c.keys--;
+        c.bytes -= oldsize;
+        c.sizes[nsStatsBucket(oldsize)]--;
+    }
+    if (newsize >= 0) {
+        c.keys++;
+        c.bytes += newsize;
+        c.sizes[nsStatsBucket(newsize)]++;
+    }
+
+    if (c.keys <= 0) {
+        nsDictDelete(&s->names, ns, nslen);
+        return true;
+    }
+    /* Same length, so an existing entry is overwritten in place. */
+    return nsDictSet(&s->names, ns, nslen, (const char *)&c, sizeof(c)) >= 0;
+}
+
+bool nsStatsGet(const NsStats *s, const char *ns, size_t nslen, NsCounters *counters)
+{
+    const NsEntry *e = nsDictFind(&s->names, ns, nslen);
+
+    if (e == NULL)
+        return false;
+    nsStatsCounters(e, counters);
+    return true;
+}
+
+static long long nsStatsBytes(const NsEntry *e)
+{
+    long long bytes;
+
+    memcpy(&bytes, nsEntryValue(e) + offsetof(NsCounters, bytes), sizeof(bytes));
+    return bytes;
+}
+
+size_t nsStatsTop(const NsStats *s, const NsEntry **top, size_t n)
+{
+    size_t pos = 0, len = 0, i;
+    const NsEntry *e;
+    long long bytes;
+
+    if (n == 0)
+        return 0;
+    while ((e = nsDictNext(&s->names, &pos))) {
+        bytes = nsStatsBytes(e);
+        if (len == n && bytes <= nsStatsBytes(top[n - 1]))
+            continue;
+        i = len < n ? len++ : n - 1;
+        for (; i > 0 && nsStatsBytes(top[i - 1]) < bytes; i--)
+            top[i] = top[i - 1];
+        top[i] = e;
+    }
+    return len;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#include "pubframe.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Digits of SIZE_MAX and the ':' */
+#define PUBFRAME_LEN_MAX 21
+
+size_t pubFrameMaxSize(size_t count, size_t total)
+{
+    return PUBFRAME_MAGIC_LEN + PUBFRAME_LEN_MAX + count * PUBFRAME_LEN_MAX + total;
+}
+
+char *pubFrameStart(char *p, size_t count)
+{
+    memcpy(p, PUBFRAME_MAGIC, PUBFRAME_MAGIC_LEN);
+    p += PUBFRAME_MAGIC_LEN;
+    return p + sprintf(p, "%zu:", count);
+}
+
+char *pubFrameAppend(char *p, const char *msg, size_t len)
+{
+    p += sprintf(p, "%zu:", len);
+    memcpy(p, msg, len);
+    return p + len;
+}
+
+static bool readLen(PubFrameReader *reader, size_t *len)
+{
+    const char *p = reader->p;
+    size_t n = 0;
+
+    if (p == reader->end || *p < '0' || *p > '9')
+        return false;
+    for (; p < reader->end && *p >= '0' && *p <= '9'; p++) {
+        if (n > ((size_t)-1 - 9) / 10)
+            return false;
+        n = n * 10 + (size_t)(*p - '0');
+    }
+    if (p == reader->end || *p != ':')
+        return false;
+    reader->p = p + 1;
+    *len = n;
+    return true;
+}
+
+bool pubFrameOpen(PubFrameReader *reader, const char *msg, size_t len)
+{
+    if (len < PUBFRAME_MAGIC_LEN || memcmp(msg, PUBFRAME_MAGIC, PUBFRAME_MAGIC_LEN))
+        return false;
+    reader->p = msg + PUBFRAME_MAGIC_LEN;
+    reader->end = msg + len;
+    return readLen(reader, &reader->left);
+}
+
+bool pubFrameNext(PubFrameReader *reader, const char **msg, size_t *len)
+{
+    size_t n;
+
+    if (reader->left == 0 || !readLen(reader, &n) ||
+        n > (size_t)(reader->end - reader->p))
+        return false;
+    *msg = reader->p;
+    *len = n;
+    reader->p += n;
+    reader->left--;
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+#include "slowlog.h"
+#include <string.h>
+
+void slowLogInit(SlowLog *log, SlowLogEntry *entries, size_t size)
+{
+    memset(log, 0, sizeof(*log));
+    log->entries = entries;
+    log->size = size;
+}
+
+SlowLogEntry *slowLogAdd(SlowLog *log, const char *pattern, size_t patternlen)
+{
+    if (log->size == 0)
+        return NULL;
+
+    SlowLogEntry *entry = &log->entries[log->head];
+    memset(entry, 0, sizeof(*entry));
+    entry->id = log->next_id++;
+    if (patternlen > SLOWLOG_PATTERN_MAX)
+        patternlen = SLOWLOG_PATTERN_MAX;
+    if (patternlen)
+        memcpy(entry->pattern, pattern, patternlen);
+    entry->patternlen = patternlen;
+
+    log->head = (log->head + 1) % log->size;
+    if (log->len < log->size)
+        log->len++;
+    return entry;
+}
+
+const SlowLogEntry *slowLogGet(const SlowLog *log, size_t i)
+{
+    if (i >= log->len)
+        return NULL;
+    return &log->entries[(log->head + log->size - 1 - i) % log->size];
+}
+
+void slowLogReset(SlowLog *log)
+{
+    log->len = 0;
+    log->head = 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+#include "valuecodec.h"
+#include "xxhash64.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZF_HASH_LOG  12
+#define LZF_MAX_LIT   32
+#define LZF_MAX_OFF   (1 << 13)
+#define LZF_MAX_REF   (7 + 255 + 2)
+
+static inline uint32_t lzfHash(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - LZF_HASH_LOG);
+}
+
+static bool lzfLiterals(const uint8_t *lit, size_t n, uint8_t *out, size_t *op, size_t outcap)
+{
+    while (n) {
+        size_t k = n < LZF_MAX_LIT ? n : LZF_MAX_LIT;
+        if (*op + 1 + k > outcap)
+            return false;
+        out[(*op)++] = (uint8_t)(k - 1);
+        memcpy(out + *op, lit, k);
+        *op += k;
+        lit += k;
+        n -= k;
+    }
+    return true;
+}
+
+size_t lzfCompress(const void *in, size_t inlen, void *out, size_t outcap)
+{
+    /* Positions plus one of the last 3 byte sequences seen, 0 for none */
+    uint32_t htab[1 << LZF_HASH_LOG];
+    const uint8_t *ip = in;
+    uint8_t *op = out;
+    size_t i = 0, anchor = 0, o = 0;
+
+    if (inlen > UINT32_MAX - 1)
+        return 0;
+    memset(htab, 0, sizeof(htab));
+    while (i + 2 < inlen) {
+        uint32_t h = lzfHash(ip + i);
+        size_t ref = htab[h];
+        htab[h] = (uint32_t)(i + 1);
+        if (ref == 0 || i - (ref - 1) > LZF_MAX_OFF || memcmp(ip + ref - 1, ip + i, 3)) {
+            i++;
+            continue;
+        }
+
+        size_t from = ref - 1, off = i - from - 1, len = 3;
+        size_t maxlen = inlen - i < LZF_MAX_REF ? inlen - i : LZF_MAX_REF;
+        while (len < maxlen && ip[from + len] == ip[i + len])
+            len++;
+
+        if (!lzfLiterals(ip + anchor, i - anchor, op, &o, outcap) || o + 3 > outcap)
+            return 0;
+        size_t l = len - 2;
+        if (l < 7) {
+            op[o++] = (uint8_t)(l << 5 | off >> 8);
+        } else {
+            op[o++] = (uint8_t)(7 << 5 | off >> 8);
+            op[o++] = (uint8_t)(l - 7);
+        }
+        op[o++] = (uint8_t)off;
+
+        /* Index the positions inside the match too, it finds longer repeats
+         * in the structured values this is meant for. */
+        for (i++, len--; len > 0; i++, len--) {
+            if (i + 2 < inlen)
+                htab[lzfHash(ip + i)] = (uint32_t)(i + 1);
+        }
+        anchor = i;
+    }
+    if (!lzfLiterals(ip + anchor, inlen - anchor, op, &o, outcap))
+        return 0;
+    return o;
+}
+
+bool lzfDecompress(const void *in, size_t inlen, void *out, size_t outlen)
+{
+    const uint8_t *ip = in;
+    uint8_t *op = out;
+    size_t i = 0, o = 0;
+
+    while (i < inlen) {
+        size_t c = ip[i++];
+        if (c < LZF_MAX_LIT) {
+            size_t n = c + 1;
+            if (n > inlen - i || n > outlen - o)
+                return false;
+            memcpy(op + o, ip + i, n);
+            i += n;
+            o += n;
+            continue;
+        }
+
+        size_t len = c >> 5;
+        if (len == 7) {
+            if (i >= inlen)
+                return false;
+            len += ip[i++];
+        }
+        if (i >= inlen)
+            return false;
+        size_t off = (c & 0x1f) << 8 | ip[i++];
+        len += 2;
+        if (off >= o || len > outlen - o)
+            return false;
+        /* Byte by byte, the reference may overlap the output */
+        const uint8_t *ref = op + o - off - 1;
+        while (len--)
+            op[o++] = *ref++;
+    }
+    return o == outlen;
+}
+
+size_t valueEncodeBound(size_t len)
+{
+    return len + VALUECODEC_HEADER_LEN;
+}
+
+static uint32_t valueCheck(const char *val, size_t len, uint8_t method)
+{
+    return (uint32_t)xxhash64(val + VALUECODEC_HEADER_LEN, len - VALUECODEC_HEADER_LEN, method);
+}
+
+static void valueSetHeader(char *out, size_t len, uint8_t method)
+{
+    uint32_t check = valueCheck(out, len, method);
+
+    out[0] = (char)VALUECODEC_MAGIC0;
+    out[1] = (char)VALUECODEC_MAGIC1;
+    out[2] = (char)method;
+    for (size_t i = 0; i < 4; i++)
+        out[3 + i] = (char)(check >> (8 * i));
+}
+
+/* The method of a value with a valid header, -1 for any other value. */
+static int valueMethod(const char *val, size_t len)
+{
+    uint8_t method;
+    uint32_t check = 0;
+
+    if (len < VALUECODEC_HEADER_LEN ||
+        (uint8_t)val[0] != VALUECODEC_MAGIC0 || (uint8_t)val[1] != VALUECODEC_MAGIC1)
+        return -1;
+    method = (uint8_t)val[2];
+    if (method != VALUECODEC_RAW && (method != VALUECODEC_LZF || len <= VALUECODEC_LZF_HEADER_LEN))
+        return -1;
+    for (size_t i = 0; i < 4; i++)
+        check |= (uint32_t)(uint8_t)val[3 + i] << (8 * i);
+    return check == valueCheck(val, len, method) ? method : -1;
+}
+
+size_t valueEncode(const char *val, size_t len, size_t minlen, char *out, bool *compressed)
+{
+    size_t n;
+
+    *compressed = false;
+    if (len >= minlen && len > 4 && len <= UINT32_MAX) {
+        /* Worth it only if it is smaller than the value with a raw header */
+        n = lzfCompress(val, len, out + VALUECODEC_LZF_HEADER_LEN, len - 4 - 1);
+        if (n) {
+            for (size_t i = 0; i < 4; i++)
+                out[VALUECODEC_HEADER_LEN + i] = (char)(len >> (8 * i));
+            valueSetHeader(out, VALUECODEC_LZF_HEADER_LEN + n, VALUECODEC_LZF);
+            *compressed = true;
+            return VALUECODEC_LZF_HEADER_LEN + n;
+        }
+    }
+
+    memcpy(out + VALUECODEC_HEADER_LEN, val, len);
+    valueSetHeader(out, len + VALUECODEC_HEADER_LEN, VALUECODEC_RAW);
+    return len + VALUECODEC_HEADER_LEN;
+}
+
+const char *valueRaw(const char *val, size_t len, size_t *rawlen)
+{
+    int method = valueMethod(val, len);
+
+    if (method == VALUECODEC_RAW) {
+        *rawlen = len - VALUECODEC_HEADER_LEN;
+        return val + VALUECODEC_HEADER_LEN;
+    }
+    if (method == VALUECODEC_LZF)
+        return NULL;
+    *rawlen = len;
+    return val;
+}
+
+size_t valueDecodedLen(const char *val, size_t len)
+{
+    size_t n = 0, i;
+
+    if (len <= VALUECODEC_LZF_HEADER_LEN)
+        return 0;
+    for (i = 0; i < 4; i++)
+        n |= (size_t)(uint8_t)val[VALUECODEC_HEADER_LEN + i] << (8 * i);
+    /* At most a 264 byte reference per 3 bytes of stream. */
+    if (n / 88 > len - VALUECODEC_LZF_HEADER_LEN)
+        return 0;
+    return n;
+}
+
+bool valueDecode(const char *val, size_t len, char *out)
+{
+    return lzfDecompress(val + VALUECODEC_LZF_HEADER_LEN, len - VALUECODEC_LZF_HEADER_LEN,
+                         out, valueDecodedLen(val, len));
+}
@@ -34,4 +34,7 @@ RedisModuleString **createRedisStrVec(size_t size);
 
 void returnNKeysFromScanSome(long keys);
 
+void stringPtrLenReturns(const char *str);
+void stringValuesRead(long keys);
+
 #endif
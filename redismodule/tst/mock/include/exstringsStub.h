@@ -23,7 +23,27 @@
 #define EXSTRINGSTUB_H_
 
 
+#include <stdbool.h>
 #include "redismodule.h"
+#include "cmdstats.h"
+#include "nsstats.h"
+#include "slowlog.h"
+
+extern bool prefix_index_enabled;
+extern bool ns_accounting_enabled;
+extern bool native_scan_enabled;
+extern bool slot_scan_enabled;
+extern bool native_publish_enabled;
+extern int worker_pool_size;
+extern long long worker_pool_queue_len;
+extern long long nget_lock_budget_us;
+extern long long ndel_next_job_id;
+extern long long ndel_jobs_running;
+extern long long ndel_jobs_max;
+extern long long slow_log_us;
+extern SlowLog slow_log;
+extern bool cmd_stats_enabled;
+extern CmdStats cmd_stats[];
 
 int setStringGenericCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, const int flag);
 int SetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
@@ -45,9 +65,83 @@ int DelMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc
 int DelIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
 int DelIEMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
 int DelNEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int MDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetIEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetNEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelIEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelNEDigest_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetIEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetIEDigestMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetNEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelIEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelIEDigestMPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelNEDigestPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void *createVersionedValue(const char *buf, size_t len, long long version);
+void freeVersionedValue(void *value);
+void *versionedRdbLoad(RedisModuleIO *rdb, int encver);
+void versionedRdbSave(RedisModuleIO *rdb, void *value);
+void versionedAofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value);
+int GetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetIfVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SetIfVerPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelIfVer_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int DelIfVerPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void *createNsValue(void);
+void freeNsValue(void *value);
+void *nsRdbLoad(RedisModuleIO *rdb, int encver);
+void nsRdbSave(RedisModuleIO *rdb, void *value);
+void nsAofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value);
+size_t nsMemUsage(const void *value);
+int nsDefrag(RedisModuleDefragCtx *ctx, RedisModuleString *key, void **value);
+int NsSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsSetPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsMGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsGetAll_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsDel_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsDelPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsSetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsSetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsDelIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsDelIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsClear_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NsClearPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int CSet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int CSetIE_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int CSetIEPub_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int CGet_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int CStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
 int NDel_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NDel_NoAtomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NDelStatus_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NDelCancel_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void ndelJobsCron(RedisModuleCtx *ctx, void *data);
+int NSlowLog_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
 int NGet_Atomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int NScan_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
 int NGet_NoAtomic_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
-void *NGet_NoAtomic_ThreadMain(void *arg);
+void NGet_NoAtomic_Job(void *arg);
+long long adaptBatchCount(long long batch, long long elapsed_us, size_t found);
+void *workerPoolMain(void *arg);
+int workerPoolStart(void);
+void workerPoolStop(void);
+int PoolStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void prefixIndexRequest(RedisModuleCtx *ctx);
+void prefixIndexCron(RedisModuleCtx *ctx, void *data);
+void prefixIndexResetAll(void);
+int prefixIndexNotify(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key);
+void prefixIndexCommandFilter(RedisModuleCommandFilterCtx *fctx);
+void nsAccountingCron(RedisModuleCtx *ctx, void *data);
+void nsAccountingResetAll(void);
+int nsAccountingNotify(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key);
+int NsStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int SdlBatch_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+int cmdStatsCall(int cmd, RedisModuleCmdFunc func, RedisModuleCtx *ctx,
+                 RedisModuleString **argv, int argc);
+int cmdStatsFind(const char *name);
+void cmdStatsResetAll(void);
+int CmdStats_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+void cmdStatsInfo(RedisModuleInfoCtx *ctx, int for_crash_report);
 
 #endif
@@ -57,11 +57,33 @@
 /* Postponed array length. */
 #define REDISMODULE_POSTPONED_ARRAY_LEN -1
 
+/* Expire */
+#define REDISMODULE_NO_EXPIRE -1
+
+#define REDISMODULE_NOTIFY_GENERIC (1<<2)     /* g */
+#define REDISMODULE_NOTIFY_STRING (1<<3)      /* $ */
+#define REDISMODULE_NOTIFY_LIST (1<<4)        /* l */
+#define REDISMODULE_NOTIFY_SET (1<<5)         /* s */
+#define REDISMODULE_NOTIFY_HASH (1<<6)        /* h */
+#define REDISMODULE_NOTIFY_ZSET (1<<7)        /* z */
+#define REDISMODULE_NOTIFY_EXPIRED (1<<8)     /* x */
+#define REDISMODULE_NOTIFY_EVICTED (1<<9)     /* e */
+#define REDISMODULE_NOTIFY_STREAM (1<<10)     /* t */
+#define REDISMODULE_NOTIFY_ALL (REDISMODULE_NOTIFY_GENERIC | REDISMODULE_NOTIFY_STRING | REDISMODULE_NOTIFY_LIST | REDISMODULE_NOTIFY_SET | REDISMODULE_NOTIFY_HASH | REDISMODULE_NOTIFY_ZSET | REDISMODULE_NOTIFY_EXPIRED | REDISMODULE_NOTIFY_EVICTED | REDISMODULE_NOTIFY_STREAM)      /* A */
+
+/* Context flags */
+#define REDISMODULE_CTX_FLAGS_CLUSTER (1<<5)
+#define REDISMODULE_CTX_FLAGS_SLAVE (1<<3)
+#define REDISMODULE_CTX_FLAGS_LOADING (1<<13)
+
 /* Error messages. */
 #define REDISMODULE_ERRORMSG_WRONGTYPE "WRONGTYPE Operation against a key holding the wrong kind of value"
 
 #define REDISMODULE_NOT_USED(V) ((void) V)
 
+/* UT stubs provide every optional API */
+#define RMAPI_FUNC_SUPPORTED(func) 1
+
 typedef long long mstime_t;
 
 /* UT dummy definitions for opaque redis types */
@@ -73,6 +95,14 @@ typedef struct { int dummy; } RedisModuleIO;
 typedef struct { int dummy; } RedisModuleType;
 typedef struct { int dummy; } RedisModuleDigest;
 typedef struct { int dummy; } RedisModuleBlockedClient;
+typedef struct { int dummy; } RedisModuleDict;
+typedef struct { int dummy; } RedisModuleDictIter;
+typedef struct { int dummy; } RedisModuleCommandFilterCtx;
+typedef struct { int dummy; } RedisModuleCommandFilter;
+typedef struct { int dummy; } RedisModuleScanCursor;
+typedef struct { int dummy; } RedisModuleInfoCtx;
+typedef struct { int dummy; } RedisModuleDefragCtx;
+typedef uint64_t RedisModuleTimerID;
 
 typedef void *(*RedisModuleTypeLoadFunc)(RedisModuleIO *rdb, int encver);
 typedef void (*RedisModuleTypeSaveFunc)(RedisModuleIO *rdb, void *value);
@@ -80,8 +110,28 @@ typedef void (*RedisModuleTypeRewriteFunc)(RedisModuleIO *aof, RedisModuleString
 typedef size_t (*RedisModuleTypeMemUsageFunc)(const void *value);
 typedef void (*RedisModuleTypeDigestFunc)(RedisModuleDigest *digest, void *value);
 typedef void (*RedisModuleTypeFreeFunc)(void *value);
+typedef size_t (*RedisModuleTypeFreeEffortFunc)(RedisModuleString *key, const void *value);
+typedef int (*RedisModuleTypeDefragFunc)(RedisModuleDefragCtx *ctx, RedisModuleString *key, void **value);
 
 typedef int (*RedisModuleCmdFunc) (RedisModuleCtx *ctx, RedisModuleString **argv, int argc);
+typedef int (*RedisModuleNotificationFunc)(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key);
+typedef void (*RedisModuleTimerProc)(RedisModuleCtx *ctx, void *data);
+typedef void (*RedisModuleCommandFilterFunc) (RedisModuleCommandFilterCtx *filter);
+typedef void (*RedisModuleScanCB)(RedisModuleCtx *ctx, RedisModuleString *keyname, RedisModuleKey *key, void *privdata);
+typedef void (*RedisModuleInfoFunc)(RedisModuleInfoCtx *ctx, int for_crash_report);
+
+#define REDISMODULE_TYPE_METHOD_VERSION 3
+typedef struct RedisModuleTypeMethods {
+    uint64_t version;
+    RedisModuleTypeLoadFunc rdb_load;
+    RedisModuleTypeSaveFunc rdb_save;
+    RedisModuleTypeRewriteFunc aof_rewrite;
+    RedisModuleTypeMemUsageFunc mem_usage;
+    RedisModuleTypeDigestFunc digest;
+    RedisModuleTypeFreeFunc free;
+    RedisModuleTypeFreeEffortFunc free_effort;
+    RedisModuleTypeDefragFunc defrag;
+} RedisModuleTypeMethods;
 
 int RedisModule_CreateCommand(RedisModuleCtx *ctx, const char *name, RedisModuleCmdFunc cmdfunc, const char *strflags, int firstkey, int lastkey, int keystep);
 int RedisModule_WrongArity(RedisModuleCtx *ctx);
@@ -94,6 +144,7 @@ long long RedisModule_CallReplyInteger(RedisModuleCallReply *reply);
 const char *RedisModule_StringPtrLen(const RedisModuleString *str, size_t *len);
 int RedisModule_ReplyWithError(RedisModuleCtx *ctx, const char *err);
 int RedisModule_ReplyWithString(RedisModuleCtx *ctx, RedisModuleString *str);
+int RedisModule_ReplyWithStringBuffer(RedisModuleCtx *ctx, const char *buf, size_t len);
 int RedisModule_ReplyWithNull(RedisModuleCtx *ctx);
 int RedisModule_ReplyWithCallReply(RedisModuleCtx *ctx, RedisModuleCallReply *reply);
 const char *RedisModule_CallReplyStringPtr(RedisModuleCallReply *reply, size_t *len);
@@ -119,8 +170,61 @@ void RedisModule_ThreadSafeContextUnlock(RedisModuleCtx *ctx);
 void RedisModule_ReplySetArrayLength(RedisModuleCtx *ctx, long len);
 RedisModuleCtx *RedisModule_GetThreadSafeContext(RedisModuleBlockedClient *bc);
 RedisModuleString *RedisModule_CreateStringFromLongLong(RedisModuleCtx *ctx, long long ll);
+RedisModuleString *RedisModule_CreateStringFromString(RedisModuleCtx *ctx, const RedisModuleString *str);
 void RedisModule_AutoMemory(RedisModuleCtx *ctx);
 void *RedisModule_Alloc(size_t bytes);
 void RedisModule_Free(void *ptr);
+int RedisModule_ReplyWithSimpleString(RedisModuleCtx *ctx, const char *msg);
+char *RedisModule_StringDMA(RedisModuleKey *key, size_t *len, int mode);
+int RedisModule_StringSet(RedisModuleKey *key, RedisModuleString *str);
+int RedisModule_SetExpire(RedisModuleKey *key, mstime_t expire);
+int RedisModule_UnlinkKey(RedisModuleKey *key);
+int RedisModule_NotifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key);
+int RedisModule_Replicate(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...);
+RedisModuleType *RedisModule_CreateDataType(RedisModuleCtx *ctx, const char *name, int encver, RedisModuleTypeMethods *typemethods);
+int RedisModule_ModuleTypeSetValue(RedisModuleKey *key, RedisModuleType *mt, void *value);
+RedisModuleType *RedisModule_ModuleTypeGetType(RedisModuleKey *key);
+void *RedisModule_ModuleTypeGetValue(RedisModuleKey *key);
+void RedisModule_SaveUnsigned(RedisModuleIO *io, uint64_t value);
+uint64_t RedisModule_LoadUnsigned(RedisModuleIO *io);
+void RedisModule_SaveStringBuffer(RedisModuleIO *io, const char *str, size_t len);
+char *RedisModule_LoadStringBuffer(RedisModuleIO *io, size_t *lenptr);
+void RedisModule_EmitAOF(RedisModuleIO *io, const char *cmdname, const char *fmt, ...);
+int RedisModule_GetSelectedDb(RedisModuleCtx *ctx);
+int RedisModule_SelectDb(RedisModuleCtx *ctx, int newid);
+int RedisModule_GetContextFlags(RedisModuleCtx *ctx);
+int RedisModule_IsKeysPositionRequest(RedisModuleCtx *ctx);
+void RedisModule_KeyAtPos(RedisModuleCtx *ctx, int pos);
+RedisModuleDict *RedisModule_CreateDict(RedisModuleCtx *ctx);
+void RedisModule_FreeDict(RedisModuleCtx *ctx, RedisModuleDict *d);
+uint64_t RedisModule_DictSize(RedisModuleDict *d);
+int RedisModule_DictSetC(RedisModuleDict *d, void *key, size_t keylen, void *ptr);
+int RedisModule_DictDelC(RedisModuleDict *d, void *key, size_t keylen, void *oldval);
+void *RedisModule_DictGetC(RedisModuleDict *d, void *key, size_t keylen, int *nokey);
+int RedisModule_DictReplaceC(RedisModuleDict *d, void *key, size_t keylen, void *ptr);
+RedisModuleDictIter *RedisModule_DictIteratorStartC(RedisModuleDict *d, const char *op, void *key, size_t keylen);
+void RedisModule_DictIteratorStop(RedisModuleDictIter *di);
+void *RedisModule_DictNextC(RedisModuleDictIter *di, size_t *keylen, void **dataptr);
+int RedisModule_SubscribeToKeyspaceEvents(RedisModuleCtx *ctx, int types, RedisModuleNotificationFunc cb);
+RedisModuleTimerID RedisModule_CreateTimer(RedisModuleCtx *ctx, mstime_t period, RedisModuleTimerProc callback, void *data);
+int RedisModule_StopTimer(RedisModuleCtx *ctx, RedisModuleTimerID id, void **data);
+RedisModuleCommandFilter *RedisModule_RegisterCommandFilter(RedisModuleCtx *ctx, RedisModuleCommandFilterFunc cb, int flags);
+int RedisModule_CommandFilterArgsCount(RedisModuleCommandFilterCtx *fctx);
+const RedisModuleString *RedisModule_CommandFilterArgGet(RedisModuleCommandFilterCtx *fctx, int pos);
+void RedisModule_RetainString(RedisModuleCtx *ctx, RedisModuleString *str);
+RedisModuleScanCursor *RedisModule_ScanCursorCreate(void);
+void RedisModule_ScanCursorDestroy(RedisModuleScanCursor *cursor);
+int RedisModule_Scan(RedisModuleCtx *ctx, RedisModuleScanCursor *cursor, RedisModuleScanCB fn, void *privdata);
+int RedisModule_PublishMessage(RedisModuleCtx *ctx, RedisModuleString *channel, RedisModuleString *message);
+int RedisModule_RegisterInfoFunc(RedisModuleCtx *ctx, RedisModuleInfoFunc cb);
+int RedisModule_InfoAddSection(RedisModuleInfoCtx *ctx, char *name);
+int RedisModule_InfoBeginDictField(RedisModuleInfoCtx *ctx, char *name);
+int RedisModule_InfoEndDictField(RedisModuleInfoCtx *ctx);
+int RedisModule_InfoAddFieldULongLong(RedisModuleInfoCtx *ctx, char *field, unsigned long long value);
+void RedisModule_GetRandomBytes(unsigned char *dst, size_t len);
+int RedisModule_DefragShouldStop(RedisModuleDefragCtx *ctx);
+int RedisModule_DefragCursorSet(RedisModuleDefragCtx *ctx, unsigned long cursor);
+int RedisModule_DefragCursorGet(RedisModuleDefragCtx *ctx, unsigned long *cursor);
+void *RedisModule_DefragAlloc(RedisModuleDefragCtx *ctx, void *ptr);
 
 #endif /* REDISMODULE_H */
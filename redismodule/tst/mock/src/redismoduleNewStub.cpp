@@ -33,6 +33,10 @@ extern "C" {
 #include <CppUTest/TestHarness.h>
 #include <CppUTestExt/MockSupport.h>
 
+#include <map>
+#include <set>
+#include <string>
+
 #include "ut_helpers.hpp"
 
 RedisModuleCallReply *RedisModule_Call(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...)
@@ -53,6 +57,16 @@ int RedisModule_ReplyWithString(RedisModuleCtx *ctx, RedisModuleString *str)
         .returnIntValueOrDefault(REDISMODULE_OK);
 }
 
+int RedisModule_ReplyWithStringBuffer(RedisModuleCtx *ctx, const char *buf, size_t len)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_ReplyWithStringBuffer")
+        .withParameter("buf", buf)
+        .withParameter("len", (long)len)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
 RedisModuleString *RedisModule_CreateStringFromCallReply(RedisModuleCallReply *reply)
 {
     (void)reply;
@@ -109,6 +123,16 @@ RedisModuleString *RedisModule_CreateStringFromLongLong(RedisModuleCtx *ctx, lon
         .returnPointerValueOrDefault(buf);
 }
 
+RedisModuleString *RedisModule_CreateStringFromString(RedisModuleCtx *ctx, const RedisModuleString *str)
+{
+    (void)ctx;
+    (void)str;
+    void* buf = malloc(UT_DUMMY_BUFFER_SIZE);
+    return (RedisModuleString *)mock()
+        .actualCall("RedisModule_CreateStringFromString")
+        .returnPointerValueOrDefault(buf);
+}
+
 void RedisModule_AutoMemory(RedisModuleCtx *ctx)
 {
     (void)ctx;
@@ -358,3 +382,474 @@ void RedisModule_Free(void *ptr)
     mock()
         .actualCall("RedisModule_Free");
 }
+
+int RedisModule_ReplyWithSimpleString(RedisModuleCtx *ctx, const char *msg)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_ReplyWithSimpleString")
+        .withParameter("msg", msg)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+char *RedisModule_StringDMA(RedisModuleKey *key, size_t *len, int mode)
+{
+    (void)key;
+    (void)mode;
+    return (char *)mock()
+        .actualCall("RedisModule_StringDMA")
+        .withOutputParameter("len", len)
+        .returnPointerValueOrDefault(NULL);
+}
+
+int RedisModule_StringSet(RedisModuleKey *key, RedisModuleString *str)
+{
+    (void)key;
+    (void)str;
+    return mock()
+        .actualCall("RedisModule_StringSet")
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_SetExpire(RedisModuleKey *key, mstime_t expire)
+{
+    (void)key;
+    return mock()
+        .actualCall("RedisModule_SetExpire")
+        .withParameter("expire", (long)expire)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_UnlinkKey(RedisModuleKey *key)
+{
+    (void)key;
+    return mock()
+        .actualCall("RedisModule_UnlinkKey")
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_NotifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
+{
+    (void)ctx;
+    (void)type;
+    (void)key;
+    return mock()
+        .actualCall("RedisModule_NotifyKeyspaceEvent")
+        .withParameter("event", event)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_Replicate(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...)
+{
+    (void)ctx;
+    (void)fmt;
+    return mock()
+        .actualCall("RedisModule_Replicate")
+        .withParameter("cmdname", cmdname)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+RedisModuleType *RedisModule_CreateDataType(RedisModuleCtx *ctx, const char *name, int encver, RedisModuleTypeMethods *typemethods)
+{
+    (void)ctx;
+    (void)encver;
+    (void)typemethods;
+    static RedisModuleType dummy_type;
+    return (RedisModuleType *)mock()
+        .actualCall("RedisModule_CreateDataType")
+        .withParameter("name", name)
+        .returnPointerValueOrDefault(&dummy_type);
+}
+
+int RedisModule_ModuleTypeSetValue(RedisModuleKey *key, RedisModuleType *mt, void *value)
+{
+    (void)key;
+    (void)mt;
+    return mock()
+        .actualCall("RedisModule_ModuleTypeSetValue")
+        .withParameter("value", value)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+RedisModuleType *RedisModule_ModuleTypeGetType(RedisModuleKey *key)
+{
+    (void)key;
+    return (RedisModuleType *)mock()
+        .actualCall("RedisModule_ModuleTypeGetType")
+        .returnPointerValueOrDefault(NULL);
+}
+
+void *RedisModule_ModuleTypeGetValue(RedisModuleKey *key)
+{
+    (void)key;
+    return mock()
+        .actualCall("RedisModule_ModuleTypeGetValue")
+        .returnPointerValueOrDefault(NULL);
+}
+
+void RedisModule_SaveUnsigned(RedisModuleIO *io, uint64_t value)
+{
+    (void)io;
+    mock()
+        .actualCall("RedisModule_SaveUnsigned")
+        .withParameter("value", (unsigned long)value);
+}
+
+uint64_t RedisModule_LoadUnsigned(RedisModuleIO *io)
+{
+    (void)io;
+    return mock()
+        .actualCall("RedisModule_LoadUnsigned")
+        .returnUnsignedLongIntValueOrDefault(0);
+}
+
+void RedisModule_SaveStringBuffer(RedisModuleIO *io, const char *str, size_t len)
+{
+    (void)io;
+    (void)str;
+    mock()
+        .actualCall("RedisModule_SaveStringBuffer")
+        .withParameter("len", (unsigned long)len);
+}
+
+char *RedisModule_LoadStringBuffer(RedisModuleIO *io, size_t *lenptr)
+{
+    (void)io;
+    return (char *)mock()
+        .actualCall("RedisModule_LoadStringBuffer")
+        .withOutputParameter("lenptr", lenptr)
+        .returnPointerValueOrDefault(NULL);
+}
+
+void RedisModule_EmitAOF(RedisModuleIO *io, const char *cmdname, const char *fmt, ...)
+{
+    (void)io;
+    (void)fmt;
+    mock()
+        .actualCall("RedisModule_EmitAOF")
+        .withParameter("cmdname", cmdname);
+}
+
+int RedisModule_GetSelectedDb(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_GetSelectedDb")
+        .returnIntValueOrDefault(0);
+}
+
+int RedisModule_SelectDb(RedisModuleCtx *ctx, int newid)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_SelectDb")
+        .withParameter("newid", newid)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_GetContextFlags(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_GetContextFlags")
+        .returnIntValueOrDefault(0);
+}
+
+int RedisModule_IsKeysPositionRequest(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_IsKeysPositionRequest")
+        .returnIntValueOrDefault(0);
+}
+
+void RedisModule_KeyAtPos(RedisModuleCtx *ctx, int pos)
+{
+    (void)ctx;
+    mock().actualCall("RedisModule_KeyAtPos")
+          .withParameter("pos", pos);
+}
+
+/* The dict API is faked with an ordered map rather than mocked, so that the
+ * prefix index can be tested through its lookups and walks. */
+typedef std::map<std::string, void *> UtDict;
+
+struct UtDictIter {
+    UtDict *dict;
+    UtDict::iterator it;
+    std::string current;
+};
+
+RedisModuleDict *RedisModule_CreateDict(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    mock().actualCall("RedisModule_CreateDict");
+    return (RedisModuleDict *)new UtDict();
+}
+
+void RedisModule_FreeDict(RedisModuleCtx *ctx, RedisModuleDict *d)
+{
+    (void)ctx;
+    mock().actualCall("RedisModule_FreeDict");
+    delete (UtDict *)d;
+}
+
+uint64_t RedisModule_DictSize(RedisModuleDict *d)
+{
+    return ((UtDict *)d)->size();
+}
+
+int RedisModule_DictSetC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    bool inserted = ((UtDict *)d)->insert(std::make_pair(std::string((char *)key, keylen), ptr)).second;
+    return inserted ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+int RedisModule_DictDelC(RedisModuleDict *d, void *key, size_t keylen, void *oldval)
+{
+    (void)oldval;
+    bool deleted = ((UtDict *)d)->erase(std::string((char *)key, keylen)) > 0;
+    return deleted ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+void *RedisModule_DictGetC(RedisModuleDict *d, void *key, size_t keylen, int *nokey)
+{
+    UtDict::iterator it = ((UtDict *)d)->find(std::string((char *)key, keylen));
+    bool missing = it == ((UtDict *)d)->end();
+    if (nokey)
+        *nokey = missing;
+    return missing ? NULL : it->second;
+}
+
+int RedisModule_DictReplaceC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    (*(UtDict *)d)[std::string((char *)key, keylen)] = ptr;
+    return REDISMODULE_OK;
+}
+
+RedisModuleDictIter *RedisModule_DictIteratorStartC(RedisModuleDict *d, const char *op, void *key, size_t keylen)
+{
+    UtDictIter *di = new UtDictIter();
+    std::string k((char *)key, key ? keylen : 0);
+    di->dict = (UtDict *)d;
+    if (!strcmp(op, ">="))
+        di->it = di->dict->lower_bound(k);
+    else if (!strcmp(op, ">"))
+        di->it = di->dict->upper_bound(k);
+    else
+        di->it = di->dict->begin();
+    return (RedisModuleDictIter *)di;
+}
+
+void RedisModule_DictIteratorStop(RedisModuleDictIter *di)
+{
+    delete (UtDictIter *)di;
+}
+
+void *RedisModule_DictNextC(RedisModuleDictIter *di, size_t *keylen, void **dataptr)
+{
+    UtDictIter *iter = (UtDictIter *)di;
+    if (iter->it == iter->dict->end())
+        return NULL;
+    iter->current = iter->it->first;
+    if (dataptr)
+        *dataptr = iter->it->second;
+    *keylen = iter->current.size();
+    ++iter->it;
+    return (void *)iter->current.data();
+}
+
+int RedisModule_SubscribeToKeyspaceEvents(RedisModuleCtx *ctx, int types, RedisModuleNotificationFunc cb)
+{
+    (void)ctx;
+    (void)cb;
+    return mock()
+        .actualCall("RedisModule_SubscribeToKeyspaceEvents")
+        .withParameter("types", types)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+RedisModuleTimerID RedisModule_CreateTimer(RedisModuleCtx *ctx, mstime_t period, RedisModuleTimerProc callback, void *data)
+{
+    (void)ctx;
+    (void)callback;
+    (void)data;
+    return mock()
+        .actualCall("RedisModule_CreateTimer")
+        .withParameter("period", (long)period)
+        .returnUnsignedLongIntValueOrDefault(1);
+}
+
+int RedisModule_StopTimer(RedisModuleCtx *ctx, RedisModuleTimerID id, void **data)
+{
+    (void)ctx;
+    (void)id;
+    (void)data;
+    return mock()
+        .actualCall("RedisModule_StopTimer")
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+RedisModuleCommandFilter *RedisModule_RegisterCommandFilter(RedisModuleCtx *ctx, RedisModuleCommandFilterFunc cb, int flags)
+{
+    (void)ctx;
+    (void)cb;
+    (void)flags;
+    static RedisModuleCommandFilter dummy_filter;
+    return (RedisModuleCommandFilter *)mock()
+        .actualCall("RedisModule_RegisterCommandFilter")
+        .returnPointerValueOrDefault(&dummy_filter);
+}
+
+int RedisModule_CommandFilterArgsCount(RedisModuleCommandFilterCtx *fctx)
+{
+    (void)fctx;
+    return mock()
+        .actualCall("RedisModule_CommandFilterArgsCount")
+        .returnIntValueOrDefault(0);
+}
+
+const RedisModuleString *RedisModule_CommandFilterArgGet(RedisModuleCommandFilterCtx *fctx, int pos)
+{
+    (void)fctx;
+    return (const RedisModuleString *)mock()
+        .actualCall("RedisModule_CommandFilterArgGet")
+        .withParameter("pos", pos)
+        .returnConstPointerValueOrDefault(NULL);
+}
+
+/* Key names retained in a scan callback, which the module then frees */
+static std::set<RedisModuleString *> ut_retained_strings;
+
+void RedisModule_RetainString(RedisModuleCtx *ctx, RedisModuleString *str)
+{
+    (void)ctx;
+    ut_retained_strings.insert(str);
+    mock().actualCall("RedisModule_RetainString");
+}
+
+RedisModuleScanCursor *RedisModule_ScanCursorCreate(void)
+{
+    mock().actualCall("RedisModule_ScanCursorCreate");
+    return (RedisModuleScanCursor *)malloc(sizeof(RedisModuleScanCursor));
+}
+
+void RedisModule_ScanCursorDestroy(RedisModuleScanCursor *cursor)
+{
+    free(cursor);
+    mock().actualCall("RedisModule_ScanCursorDestroy");
+}
+
+/* Visits 'keys' key names, returns whether the scan goes on */
+int RedisModule_Scan(RedisModuleCtx *ctx, RedisModuleScanCursor *cursor, RedisModuleScanCB fn, void *privdata)
+{
+    (void)cursor;
+    int keys = 0;
+    int more = mock()
+        .actualCall("RedisModule_Scan")
+        .withOutputParameter("keys", &keys)
+        .returnIntValueOrDefault(0);
+    for (int i = 0; i < keys; i++) {
+        RedisModuleString *keyname = (RedisModuleString *)malloc(UT_DUMMY_BUFFER_SIZE);
+        fn(ctx, keyname, NULL, privdata);
+        if (!ut_retained_strings.erase(keyname))
+            free(keyname);
+    }
+    return more;
+}
+
+int RedisModule_PublishMessage(RedisModuleCtx *ctx, RedisModuleString *channel, RedisModuleString *message)
+{
+    (void)ctx;
+    (void)channel;
+    (void)message;
+    return mock()
+        .actualCall("RedisModule_PublishMessage")
+        .returnIntValueOrDefault(0);
+}
+
+int RedisModule_RegisterInfoFunc(RedisModuleCtx *ctx, RedisModuleInfoFunc cb)
+{
+    (void)ctx;
+    (void)cb;
+    return mock()
+        .actualCall("RedisModule_RegisterInfoFunc")
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_InfoAddSection(RedisModuleInfoCtx *ctx, char *name)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_InfoAddSection")
+        .withParameter("name", name)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_InfoBeginDictField(RedisModuleInfoCtx *ctx, char *name)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_InfoBeginDictField")
+        .withParameter("name", name)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_InfoEndDictField(RedisModuleInfoCtx *ctx)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_InfoEndDictField")
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_InfoAddFieldULongLong(RedisModuleInfoCtx *ctx, char *field, unsigned long long value)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_InfoAddFieldULongLong")
+        .withParameter("field", field)
+        .withParameter("value", (unsigned long)value)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+void RedisModule_GetRandomBytes(unsigned char *dst, size_t len)
+{
+    mock().actualCall("RedisModule_GetRandomBytes");
+    memset(dst, 0x5a, len);
+}
+
+int RedisModule_DefragShouldStop(RedisModuleDefragCtx *ctx)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_DefragShouldStop")
+        .returnIntValueOrDefault(0);
+}
+
+int RedisModule_DefragCursorSet(RedisModuleDefragCtx *ctx, unsigned long cursor)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_DefragCursorSet")
+        .withParameter("cursor", cursor)
+        .returnIntValueOrDefault(REDISMODULE_OK);
+}
+
+int RedisModule_DefragCursorGet(RedisModuleDefragCtx *ctx, unsigned long *cursor)
+{
+    (void)ctx;
+    *cursor = mock()
+        .actualCall("RedisModule_DefragCursorGet")
+        .returnUnsignedLongIntValueOrDefault(0);
+    return REDISMODULE_OK;
+}
+
+void *RedisModule_DefragAlloc(RedisModuleDefragCtx *ctx, void *ptr)
+{
+    (void)ctx;
+    return mock()
+        .actualCall("RedisModule_DefragAlloc")
+        .withParameter("ptr", ptr)
+        .returnPointerValueOrDefault(NULL);
+}
@@ -66,7 +66,10 @@ void *RedisModule_OpenKey(RedisModuleCtx *ctx, RedisModuleString *keyname, int m
 {
     (void)ctx;
     (void)keyname;
-    (void)mode;
+
+    if (mode & REDISMODULE_WRITE)
+        mock().setData("RedisModule_OpenKey_write",
+                       mock().getData("RedisModule_OpenKey_write").getIntValue() + 1);
 
     if (mock().hasData("RedisModule_OpenKey_no"))
     {
@@ -156,9 +159,52 @@ long long RedisModule_CallReplyInteger(RedisModuleCallReply *reply)
 
 const char *RedisModule_StringPtrLen(const RedisModuleString *str, size_t *len)
 {
+    /* Content given to one string, e.g. a module argument */
+    char name[64];
+    snprintf(name, sizeof(name), "RedisModule_String_%p", (const void *)str);
+    if (mock().hasData(name))
+    {
+        const char *value = mock().getData(name).getStringValue();
+        if (len) *len = strlen(value);
+        return value;
+    }
+
+    if (mock().hasData("RedisModule_String_returncurrent") &&
+        str == mock().getData("RedisModule_String_returncurrent").getPointerValue())
+    {
+        if (len) *len = 13;
+        return "RETURNCURRENT";
+    }
+
+    if (mock().hasData("RedisModule_String_digest") &&
+        str == mock().getData("RedisModule_String_digest").getPointerValue())
+    {
+        if (len) *len = 6;
+        return "DIGEST";
+    }
+
+    if (mock().hasData("RedisModule_String_packed") &&
+        str == mock().getData("RedisModule_String_packed").getPointerValue())
+    {
+        if (len) *len = 6;
+        return "PACKED";
+    }
+
+    /* xxh64 of "11111" */
+    if (mock().hasData("RedisModule_String_digestvalue") &&
+        str == mock().getData("RedisModule_String_digestvalue").getPointerValue())
+    {
+        if (len) *len = 16;
+        return "3baf032d46de01d6";
+    }
 
-    (void)str;
     if (len) *len = 5;
+    if (mock().hasData("RedisModule_String_px"))
+    {
+        if (len) *len = 2;
+        return "PX";
+    }
+
     if (mock().hasData("RedisModule_String_same"))
     {
         return "11111";
@@ -199,6 +245,14 @@ int RedisModule_ReplyWithString(RedisModuleCtx *ctx, RedisModuleString *str)
     return REDISMODULE_OK;
 }
 
+int RedisModule_ReplyWithStringBuffer(RedisModuleCtx *ctx, const char *buf, size_t len)
+{
+    (void)ctx;
+    (void)buf;
+    mock().setData("RedisModule_ReplyWithStringBuffer", (int)len);
+    return REDISMODULE_OK;
+}
+
 int RedisModule_ReplyWithNull(RedisModuleCtx *ctx)
 {
 
@@ -264,6 +318,11 @@ int RedisModule_KeyType(RedisModuleKey *kp)
         return REDISMODULE_KEYTYPE_SET;
     }
 
+    if (mock().hasData("RedisModule_KeyType_module"))
+    {
+        return REDISMODULE_KEYTYPE_MODULE;
+    }
+
     return REDISMODULE_KEYTYPE_EMPTY;
 
 
@@ -414,6 +473,13 @@ RedisModuleString *RedisModule_CreateStringFromLongLong(RedisModuleCtx *ctx, lon
     return rms;
 }
 
+RedisModuleString *RedisModule_CreateStringFromString(RedisModuleCtx *ctx, const RedisModuleString *str)
+{
+    (void)ctx;
+    (void)str;
+    return (RedisModuleString*)malloc(sizeof(RedisModuleString));
+}
+
 void RedisModule_AutoMemory(RedisModuleCtx *ctx)
 {
     (void)ctx;
@@ -435,3 +501,410 @@ void RedisModule_Free(void *ptr)
         .actualCall("RedisModule_Free");
     free(ptr);
 }
+
+int RedisModule_ReplyWithSimpleString(RedisModuleCtx *ctx, const char *msg)
+{
+    (void)ctx;
+    (void)msg;
+    mock().setData("RedisModule_ReplyWithSimpleString", 1);
+    return REDISMODULE_OK;
+}
+
+char *RedisModule_StringDMA(RedisModuleKey *key, size_t *len, int mode)
+{
+    (void)key;
+    (void)mode;
+    static char same_literal[] = "11111";
+    static char nosame_literal[] = "333333";
+    mock().setData("RedisModule_StringDMA", mock().getData("RedisModule_StringDMA").getIntValue()+1);
+
+    if (mock().hasData("RedisModule_String_nosame"))
+    {
+        *len = 6;
+        return nosame_literal;
+    }
+
+    *len = 5;
+    return same_literal;
+}
+
+int RedisModule_StringSet(RedisModuleKey *key, RedisModuleString *str)
+{
+    (void)key;
+    (void)str;
+    mock().setData("RedisModule_StringSet", mock().getData("RedisModule_StringSet").getIntValue()+1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_SetExpire(RedisModuleKey *key, mstime_t expire)
+{
+    (void)key;
+    mock().setData("RedisModule_SetExpire", (int)expire);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_UnlinkKey(RedisModuleKey *key)
+{
+    (void)key;
+    mock().setData("RedisModule_UnlinkKey", mock().getData("RedisModule_UnlinkKey").getIntValue()+1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_NotifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event, RedisModuleString *key)
+{
+    (void)ctx;
+    (void)type;
+    (void)event;
+    (void)key;
+    mock().setData("RedisModule_NotifyKeyspaceEvent", mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue()+1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_Replicate(RedisModuleCtx *ctx, const char *cmdname, const char *fmt, ...)
+{
+    (void)ctx;
+    (void)fmt;
+    mock().setData("RedisModule_Replicate", mock().getData("RedisModule_Replicate").getIntValue()+1);
+    mock().setData("RedisModule_Replicate_cmdname", cmdname);
+    return REDISMODULE_OK;
+}
+
+static RedisModuleType ut_versioned_type;
+static RedisModuleType ut_ns_type;
+
+RedisModuleType *RedisModule_CreateDataType(RedisModuleCtx *ctx, const char *name, int encver, RedisModuleTypeMethods *typemethods)
+{
+    (void)ctx;
+    (void)encver;
+    (void)typemethods;
+    if (mock().hasData("RedisModule_CreateDataType_fail"))
+        return NULL;
+    if (!strcmp(name, "exstr-nsc"))
+        return &ut_ns_type;
+    return &ut_versioned_type;
+}
+
+int RedisModule_ModuleTypeSetValue(RedisModuleKey *key, RedisModuleType *mt, void *value)
+{
+    (void)key;
+    (void)mt;
+    mock().setData("RedisModule_ModuleTypeSetValue", mock().getData("RedisModule_ModuleTypeSetValue").getIntValue()+1);
+    mock().setData("RedisModule_ModuleTypeSetValue_value", value);
+    return REDISMODULE_OK;
+}
+
+RedisModuleType *RedisModule_ModuleTypeGetType(RedisModuleKey *key)
+{
+    (void)key;
+    if (mock().hasData("RedisModule_ModuleTypeGetType_other"))
+        return NULL;
+    if (mock().hasData("RedisModule_ModuleTypeGetType_ns"))
+        return &ut_ns_type;
+    return &ut_versioned_type;
+}
+
+void *RedisModule_ModuleTypeGetValue(RedisModuleKey *key)
+{
+    (void)key;
+    return mock().getData("RedisModule_ModuleTypeGetValue").getPointerValue();
+}
+
+void RedisModule_SaveUnsigned(RedisModuleIO *io, uint64_t value)
+{
+    (void)io;
+    mock().setData("RedisModule_SaveUnsigned", (int)value);
+}
+
+uint64_t RedisModule_LoadUnsigned(RedisModuleIO *io)
+{
+    (void)io;
+    return mock().getData("RedisModule_LoadUnsigned").getIntValue();
+}
+
+void RedisModule_SaveStringBuffer(RedisModuleIO *io, const char *str, size_t len)
+{
+    (void)io;
+    (void)str;
+    mock().setData("RedisModule_SaveStringBuffer", (int)len);
+}
+
+char *RedisModule_LoadStringBuffer(RedisModuleIO *io, size_t *lenptr)
+{
+    (void)io;
+    *lenptr = 5;
+    char *buf = (char *)malloc(*lenptr);
+    memcpy(buf, "11111", *lenptr);
+    return buf;
+}
+
+void RedisModule_EmitAOF(RedisModuleIO *io, const char *cmdname, const char *fmt, ...)
+{
+    (void)io;
+    (void)fmt;
+    mock().setData("RedisModule_EmitAOF", mock().getData("RedisModule_EmitAOF").getIntValue()+1);
+    mock().setData("RedisModule_EmitAOF_cmdname", cmdname);
+}
+
+int RedisModule_GetSelectedDb(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return 0;
+}
+
+int RedisModule_SelectDb(RedisModuleCtx *ctx, int newid)
+{
+    (void)ctx;
+    (void)newid;
+    return REDISMODULE_OK;
+}
+
+int RedisModule_GetContextFlags(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return mock().getData("RedisModule_GetContextFlags").getIntValue();
+}
+
+int RedisModule_IsKeysPositionRequest(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return mock().getData("RedisModule_IsKeysPositionRequest").getIntValue();
+}
+
+void RedisModule_KeyAtPos(RedisModuleCtx *ctx, int pos)
+{
+    (void)ctx;
+    (void)pos;
+    mock().setData("RedisModule_KeyAtPos", mock().getData("RedisModule_KeyAtPos").getIntValue()+1);
+}
+
+RedisModuleDict *RedisModule_CreateDict(RedisModuleCtx *ctx)
+{
+    (void)ctx;
+    return NULL;
+}
+
+void RedisModule_FreeDict(RedisModuleCtx *ctx, RedisModuleDict *d)
+{
+    (void)ctx;
+    (void)d;
+}
+
+uint64_t RedisModule_DictSize(RedisModuleDict *d)
+{
+    (void)d;
+    return 0;
+}
+
+int RedisModule_DictSetC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    (void)d;
+    (void)key;
+    (void)keylen;
+    (void)ptr;
+    return REDISMODULE_OK;
+}
+
+int RedisModule_DictDelC(RedisModuleDict *d, void *key, size_t keylen, void *oldval)
+{
+    (void)d;
+    (void)key;
+    (void)keylen;
+    (void)oldval;
+    return REDISMODULE_OK;
+}
+
+void *RedisModule_DictGetC(RedisModuleDict *d, void *key, size_t keylen, int *nokey)
+{
+    (void)d;
+    (void)key;
+    (void)keylen;
+    if (nokey)
+        *nokey = 1;
+    return NULL;
+}
+
+int RedisModule_DictReplaceC(RedisModuleDict *d, void *key, size_t keylen, void *ptr)
+{
+    (void)d;
+    (void)key;
+    (void)keylen;
+    (void)ptr;
+    return REDISMODULE_OK;
+}
+
+RedisModuleDictIter *RedisModule_DictIteratorStartC(RedisModuleDict *d, const char *op, void *key, size_t keylen)
+{
+    (void)d;
+    (void)op;
+    (void)key;
+    (void)keylen;
+    return NULL;
+}
+
+void RedisModule_DictIteratorStop(RedisModuleDictIter *di)
+{
+    (void)di;
+}
+
+void *RedisModule_DictNextC(RedisModuleDictIter *di, size_t *keylen, void **dataptr)
+{
+    (void)di;
+    (void)keylen;
+    (void)dataptr;
+    return NULL;
+}
+
+int RedisModule_SubscribeToKeyspaceEvents(RedisModuleCtx *ctx, int types, RedisModuleNotificationFunc cb)
+{
+    (void)ctx;
+    (void)cb;
+    mock().setData("RedisModule_SubscribeToKeyspaceEvents", types);
+    return REDISMODULE_OK;
+}
+
+RedisModuleTimerID RedisModule_CreateTimer(RedisModuleCtx *ctx, mstime_t period, RedisModuleTimerProc callback, void *data)
+{
+    (void)ctx;
+    (void)period;
+    (void)callback;
+    (void)data;
+    return 1;
+}
+
+int RedisModule_StopTimer(RedisModuleCtx *ctx, RedisModuleTimerID id, void **data)
+{
+    (void)ctx;
+    (void)id;
+    (void)data;
+    return REDISMODULE_OK;
+}
+
+static RedisModuleCommandFilter ut_command_filter;
+
+RedisModuleCommandFilter *RedisModule_RegisterCommandFilter(RedisModuleCtx *ctx, RedisModuleCommandFilterFunc cb, int flags)
+{
+    (void)ctx;
+    (void)cb;
+    (void)flags;
+    mock().setData("RedisModule_RegisterCommandFilter", mock().getData("RedisModule_RegisterCommandFilter").getIntValue()+1);
+    return &ut_command_filter;
+}
+
+int RedisModule_CommandFilterArgsCount(RedisModuleCommandFilterCtx *fctx)
+{
+    (void)fctx;
+    return 0;
+}
+
+const RedisModuleString *RedisModule_CommandFilterArgGet(RedisModuleCommandFilterCtx *fctx, int pos)
+{
+    (void)fctx;
+    (void)pos;
+    return NULL;
+}
+
+void RedisModule_RetainString(RedisModuleCtx *ctx, RedisModuleString *str)
+{
+    (void)ctx;
+    (void)str;
+}
+
+RedisModuleScanCursor *RedisModule_ScanCursorCreate(void)
+{
+    return (RedisModuleScanCursor *)malloc(sizeof(RedisModuleScanCursor));
+}
+
+void RedisModule_ScanCursorDestroy(RedisModuleScanCursor *cursor)
+{
+    free(cursor);
+}
+
+int RedisModule_Scan(RedisModuleCtx *ctx, RedisModuleScanCursor *cursor, RedisModuleScanCB fn, void *privdata)
+{
+    (void)ctx;
+    (void)cursor;
+    (void)fn;
+    (void)privdata;
+    return 0;
+}
+
+int RedisModule_PublishMessage(RedisModuleCtx *ctx, RedisModuleString *channel, RedisModuleString *message)
+{
+    (void)ctx;
+    (void)channel;
+    (void)message;
+    mock().setData("PublishMessage", mock().getData("PublishMessage").getIntValue() + 1);
+    return 0;
+}
+
+int RedisModule_RegisterInfoFunc(RedisModuleCtx *ctx, RedisModuleInfoFunc cb)
+{
+    (void)ctx;
+    (void)cb;
+    mock().setData("RedisModule_RegisterInfoFunc", 1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_InfoAddSection(RedisModuleInfoCtx *ctx, char *name)
+{
+    (void)ctx;
+    (void)name;
+    mock().setData("RedisModule_InfoAddSection", 1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_InfoBeginDictField(RedisModuleInfoCtx *ctx, char *name)
+{
+    (void)ctx;
+    (void)name;
+    mock().setData("RedisModule_InfoBeginDictField", mock().getData("RedisModule_InfoBeginDictField").getIntValue() + 1);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_InfoEndDictField(RedisModuleInfoCtx *ctx)
+{
+    (void)ctx;
+    return REDISMODULE_OK;
+}
+
+int RedisModule_InfoAddFieldULongLong(RedisModuleInfoCtx *ctx, char *field, unsigned long long value)
+{
+    (void)ctx;
+    (void)field;
+    (void)value;
+    mock().setData("RedisModule_InfoAddFieldULongLong", mock().getData("RedisModule_InfoAddFieldULongLong").getIntValue() + 1);
+    return REDISMODULE_OK;
+}
+
+void RedisModule_GetRandomBytes(unsigned char *dst, size_t len)
+{
+    memset(dst, 0x5a, len);
+}
+
+int RedisModule_DefragShouldStop(RedisModuleDefragCtx *ctx)
+{
+    (void)ctx;
+    return mock().getData("RedisModule_DefragShouldStop").getIntValue();
+}
+
+int RedisModule_DefragCursorSet(RedisModuleDefragCtx *ctx, unsigned long cursor)
+{
+    (void)ctx;
+    mock().setData("RedisModule_DefragCursorSet", (unsigned int)cursor);
+    return REDISMODULE_OK;
+}
+
+int RedisModule_DefragCursorGet(RedisModuleDefragCtx *ctx, unsigned long *cursor)
+{
+    (void)ctx;
+    *cursor = mock().getData("RedisModule_DefragCursorGet").getUnsignedIntValue();
+    return REDISMODULE_OK;
+}
+
+void *RedisModule_DefragAlloc(RedisModuleDefragCtx *ctx, void *ptr)
+{
+    (void)ctx;
+    (void)ptr;
+    mock().setData("RedisModule_DefragAlloc", mock().getData("RedisModule_DefragAlloc").getIntValue() + 1);
+    return NULL;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "cmdstats.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(cmdstats)
+{
+    CmdStats stats;
+
+    void setup()
+    {
+        memset(&stats, 0, sizeof(stats));
+    }
+};
+
+TEST(cmdstats, small_latencies_have_a_bucket_each)
+{
+    uint64_t ns;
+    for (ns = 0; ns < 8; ns++) {
+        CHECK_EQUAL((int)ns, cmdStatsBucket(ns));
+        CHECK_EQUAL(ns, cmdStatsBucketMax((int)ns));
+    }
+}
+
+TEST(cmdstats, four_buckets_per_power_of_two)
+{
+    CHECK_EQUAL(8, cmdStatsBucket(8));
+    CHECK_EQUAL(8, cmdStatsBucket(9));
+    CHECK_EQUAL(9, cmdStatsBucket(10));
+    CHECK_EQUAL(11, cmdStatsBucket(15));
+    CHECK_EQUAL(12, cmdStatsBucket(16));
+    CHECK_EQUAL(cmdStatsBucket(1000), cmdStatsBucket(1023));
+    CHECK(cmdStatsBucket(1024) > cmdStatsBucket(1023));
+}
+
+TEST(cmdstats, bucket_max_bounds_its_latencies)
+{
+    uint64_t ns;
+    for (ns = 1; ns < ((uint64_t)1 << 40); ns = ns * 3 + 1) {
+        int bucket = cmdStatsBucket(ns);
+        CHECK(ns <= cmdStatsBucketMax(bucket));
+        CHECK(ns > cmdStatsBucketMax(bucket - 1));
+        /* At most 25% wider than the latency. */
+        CHECK(cmdStatsBucketMax(bucket) - cmdStatsBucketMax(bucket - 1) <= ns / 4 + 1);
+    }
+}
+
+TEST(cmdstats, last_bucket_takes_the_largest_latencies)
+{
+    CHECK_EQUAL(CMDSTATS_BUCKETS - 1, cmdStatsBucket((uint64_t)1 << 50));
+    CHECK_EQUAL(CMDSTATS_BUCKETS - 1, cmdStatsBucket(UINT64_MAX));
+    CHECK_EQUAL(UINT64_MAX, cmdStatsBucketMax(CMDSTATS_BUCKETS - 1));
+}
+
+TEST(cmdstats, record_counts_call_and_latency)
+{
+    CmdStatsCall call = {1, 2, 3, 4};
+    cmdStatsRecord(&stats, &call, 100);
+    memset(&call, 0, sizeof(call));
+    cmdStatsRecord(&stats, &call, 300);
+    UNSIGNED_LONGS_EQUAL(2, stats.calls);
+    UNSIGNED_LONGS_EQUAL(1, stats.errors);
+    UNSIGNED_LONGS_EQUAL(2, stats.hits);
+    UNSIGNED_LONGS_EQUAL(3, stats.misses);
+    UNSIGNED_LONGS_EQUAL(4, stats.keys);
+    UNSIGNED_LONGS_EQUAL(400, stats.ns);
+    UNSIGNED_LONGS_EQUAL(1, stats.latency[cmdStatsBucket(100)]);
+    UNSIGNED_LONGS_EQUAL(1, stats.latency[cmdStatsBucket(300)]);
+}
+
+TEST(cmdstats, percentiles)
+{
+    const double fractions[4] = {0.5, 0.99, 0.999, 1.0};
+    uint64_t values[4];
+    CmdStatsCall call = {0, 0, 0, 0};
+    int i;
+
+    cmdStatsPercentiles(&stats, fractions, values, 4);
+    UNSIGNED_LONGS_EQUAL(0, values[1]);
+
+    for (i = 0; i < 990; i++)
+        cmdStatsRecord(&stats, &call, 1000);
+    for (i = 0; i < 9; i++)
+        cmdStatsRecord(&stats, &call, 50000);
+    cmdStatsRecord(&stats, &call, 2000000);
+
+    cmdStatsPercentiles(&stats, fractions, values, 4);
+    CHECK_EQUAL(cmdStatsBucketMax(cmdStatsBucket(1000)), values[0]);
+    CHECK_EQUAL(cmdStatsBucketMax(cmdStatsBucket(1000)), values[1]);
+    CHECK_EQUAL(cmdStatsBucketMax(cmdStatsBucket(50000)), values[2]);
+    CHECK_EQUAL(cmdStatsBucketMax(cmdStatsBucket(2000000)), values[3]);
+}
+
+TEST(cmdstats, merge_and_reset)
+{
+    CmdStats other, zero;
+    CmdStatsCall call = {1, 0, 1, 2};
+    memset(&other, 0, sizeof(other));
+    memset(&zero, 0, sizeof(zero));
+    cmdStatsRecord(&stats, &call, 10);
+    cmdStatsRecord(&other, &call, 1000);
+
+    cmdStatsMerge(&stats, &other);
+    UNSIGNED_LONGS_EQUAL(2, stats.calls);
+    UNSIGNED_LONGS_EQUAL(2, stats.errors);
+    UNSIGNED_LONGS_EQUAL(4, stats.keys);
+    UNSIGNED_LONGS_EQUAL(1010, stats.ns);
+    UNSIGNED_LONGS_EQUAL(1, stats.latency[cmdStatsBucket(1000)]);
+
+    cmdStatsReset(&stats);
+    CHECK_EQUAL(0, memcmp(&stats, &zero, sizeof(stats)));
+}
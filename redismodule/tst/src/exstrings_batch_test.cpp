@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_batch)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+    }
+
+    void teardown()
+    {
+        mock().clear();
+        mock().disable();
+        native_publish_enabled = false;
+    }
+
+};
+
+static void operationsRead(const char **ops, size_t nops)
+{
+    for (size_t i = 0; i < nops; i++)
+        stringPtrLenReturns(ops[i]);
+}
+
+TEST(exstrings_batch, operations_run_in_order_with_one_reply_each)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(18);
+    const char *ops[] = { "SET", "setie", "DELIE", "DEL", "GET", "PUBLISH" };
+
+    native_publish_enabled = true;
+    /* Checked, then run */
+    operationsRead(ops, 6);
+    operationsRead(ops, 6);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 6L);
+    /* All the keys are missing */
+    mock().expectOneCall("RedisModule_StringSet");
+    mock().expectOneCall("RedisModule_ReplyWithSimpleString")
+          .withParameter("msg", "OK");
+    mock().expectNCalls(2, "RedisModule_ReplyWithNull");
+    mock().expectNCalls(2, "RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 0);
+    mock().expectOneCall("RedisModule_PublishMessage")
+          .andReturnValue(2);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 2);
+    mock().expectNoCall("RedisModule_UnlinkKey");
+    mock().expectNoCall("RedisModule_Call");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 18);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, existing_key_is_deleted)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    const char *ops[] = { "DEL" };
+
+    operationsRead(ops, 1);
+    operationsRead(ops, 1);
+    mock().expectOneCall("RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_STRING);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectOneCall("RedisModule_UnlinkKey");
+    mock().expectOneCall("RedisModule_Replicate")
+          .withParameter("cmdname", "UNLINK");
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 1);
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, set_replaces_key_of_other_type)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(4);
+    const char *ops[] = { "SET" };
+
+    operationsRead(ops, 1);
+    operationsRead(ops, 1);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectNoCall("RedisModule_KeyType");
+    mock().expectOneCall("RedisModule_StringSet");
+    mock().expectOneCall("RedisModule_Replicate")
+          .withParameter("cmdname", "SET");
+    mock().expectOneCall("RedisModule_ReplyWithSimpleString")
+          .withParameter("msg", "OK");
+    mock().expectNoCall("RedisModule_ReplyWithError");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, del_deletes_key_of_other_type)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    const char *ops[] = { "DEL" };
+
+    operationsRead(ops, 1);
+    operationsRead(ops, 1);
+    mock().expectOneCall("RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_HASH);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectOneCall("RedisModule_UnlinkKey");
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 1);
+    mock().expectNoCall("RedisModule_ReplyWithError");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, key_positions_skip_channels)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(9);
+    const char *ops[] = { "SET", "PUBLISH", "GET" };
+
+    mock().expectOneCall("RedisModule_IsKeysPositionRequest")
+          .andReturnValue(1);
+    operationsRead(ops, 3);
+    mock().expectOneCall("RedisModule_KeyAtPos")
+          .withParameter("pos", 2);
+    mock().expectOneCall("RedisModule_KeyAtPos")
+          .withParameter("pos", 8);
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    mock().expectNoCall("RedisModule_OpenKey");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 9);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, keys_of_different_slots_in_cluster_run_nothing)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(9);
+
+    mock().expectOneCall("RedisModule_GetContextFlags")
+          .andReturnValue(REDISMODULE_CTX_FLAGS_CLUSTER);
+    stringPtrLenReturns("SET");
+    stringPtrLenReturns("{a},x");
+    stringPtrLenReturns("PUBLISH");
+    stringPtrLenReturns("GET");
+    stringPtrLenReturns("{b},x");
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    mock().expectNoCall("RedisModule_OpenKey");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 9);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, unknown_operation_runs_nothing)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(6);
+    const char *ops[] = { "SET", "INCR" };
+
+    operationsRead(ops, 2);
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    mock().expectNoCall("RedisModule_OpenKey");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_batch, truncated_operation_runs_nothing)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(6);
+    const char *ops[] = { "SET", "SETIE" };
+
+    operationsRead(ops, 2);
+    mock().expectOneCall("RedisModule_WrongArity");
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    mock().expectNoCall("RedisModule_OpenKey");
+
+    int ret = SdlBatch_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
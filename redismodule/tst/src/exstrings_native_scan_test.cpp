@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_native_scan)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+        native_scan_enabled = true;
+    }
+
+    void teardown()
+    {
+        mock().clear();
+        mock().disable();
+        native_scan_enabled = false;
+    }
+
+};
+
+static void scanStepVisits(int *keys, int more)
+{
+    mock().expectOneCall("RedisModule_Scan")
+          .withOutputParameterReturning("keys", keys, sizeof(*keys))
+          .andReturnValue(more);
+}
+
+TEST(exstrings_native_scan, nget_matches_keys_in_place)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    int visited = 3;
+
+    stringPtrLenReturns("k*");
+    mock().expectOneCall("RedisModule_ScanCursorCreate");
+    scanStepVisits(&visited, 0);
+    stringPtrLenReturns("k1");
+    stringPtrLenReturns("x1");
+    stringPtrLenReturns("k2");
+    mock().expectNCalls(2, "RedisModule_RetainString");
+    mock().expectNoCall("RedisModule_CallReplyLength");
+    stringValuesRead(2);
+    mock().expectOneCall("RedisModule_ScanCursorDestroy");
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", 4L);
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_native_scan, ndel_unlinks_a_batch_per_count_keys_visited)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long count = 2;
+    int first = 2, second = 1;
+
+    stringPtrLenReturns("*");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    scanStepVisits(&first, 1);
+    stringPtrLenReturns("k1");
+    stringPtrLenReturns("k2");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    scanStepVisits(&second, 0);
+    stringPtrLenReturns("k3");
+    mock().expectNCalls(3, "RedisModule_RetainString");
+    mock().expectOneCall("RedisModule_ScanCursorCreate");
+    mock().expectNCalls(2, "RedisModule_Call")
+          .withParameter("cmdname", "UNLINK");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(2);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(1);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 3);
+
+    int ret = NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_native_scan, nscan_keeps_scan_cursor)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    stringPtrLenReturns("0");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(0);
+    mock().expectNoCall("RedisModule_Scan");
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
@@ -29,6 +29,10 @@ extern "C" {
 
 #include "ut_helpers.hpp"
 
+#define UT_LOCK_BUDGET_US 200
+#define UT_SLOW_LOG_US    10000
+#define UT_NDEL_JOBS      16
+
 void nDelReturnNKeysFromUnlink(int count)
 {
     mock()
@@ -47,8 +51,14 @@ TEST_GROUP(exstrings_ndel)
 
     void teardown()
     {
+        RedisModuleCtx ctx;
         mock().clear();
         mock().disable();
+        /* Finishes the jobs the test left running and lets the timer lapse */
+        nget_lock_budget_us = UT_LOCK_BUDGET_US;
+        slow_log_us = UT_SLOW_LOG_US;
+        ndel_jobs_max = UT_NDEL_JOBS;
+        ndelJobsCron(&ctx, NULL);
     }
 
 };
@@ -162,3 +172,354 @@ TEST(exstrings_ndel, ndel_atomic_command_scan_3_keys_found_1_keys_deleted)
 
     delete []redisStrVec;
 }
+
+static void ndelJobIdGiven(long long *id)
+{
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", id, sizeof(*id));
+}
+
+static long long submitNDelJob(RedisModuleCtx *ctx, RedisModuleString **argv)
+{
+    long long id = ndel_next_job_id;
+    NDel_NoAtomic_RedisCommand(ctx, argv, 2);
+    mock().clear();
+    mock().ignoreOtherCalls();
+    return id;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    mock().expectNCalls(3, "RedisModule_WrongArity");
+    mock().expectNoCall("RedisModule_CreateTimer");
+    NDel_NoAtomic_RedisCommand(&ctx, redisStrVec, 3);
+    NDelStatus_RedisCommand(&ctx, redisStrVec, 3);
+    NDelCancel_RedisCommand(&ctx, redisStrVec, 1);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_replies_job_id_without_deleting)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long id = ndel_next_job_id;
+
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", id);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", id + 1);
+    mock().expectOneCall("RedisModule_CreateTimer")
+          .withParameter("period", 1L);
+    mock().expectNoCall("RedisModule_Call");
+    NDel_NoAtomic_RedisCommand(&ctx, redisStrVec, 2);
+    NDel_NoAtomic_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_slice_unlinks_until_scan_completes)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long id = submitNDelJob(&ctx, redisStrVec);
+
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    returnNKeysFromScanSome(3);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "UNLINK");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    nDelReturnNKeysFromUnlink(2);
+    mock().expectNoCall("RedisModule_CreateTimer");
+    ndelJobsCron(&ctx, NULL);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "done")
+          .withParameter("len", 4L);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", id);
+    /* Scanned and matched */
+    mock().expectNCalls(2, "RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 3);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 2);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 0);
+    NDelStatus_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_slice_ends_at_lock_budget)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    submitNDelJob(&ctx, redisStrVec);
+
+    nget_lock_budget_us = 0;
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyStringPtr")
+          .andReturnValue((void *)"42");
+    returnNKeysFromScanSome(0);
+    mock().expectOneCall("RedisModule_CreateTimer")
+          .withParameter("period", 1L);
+    ndelJobsCron(&ctx, NULL);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_jobs_fail_on_a_replica)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long id = submitNDelJob(&ctx, redisStrVec);
+
+    mock().expectOneCall("RedisModule_GetContextFlags")
+          .andReturnValue(REDISMODULE_CTX_FLAGS_SLAVE);
+    mock().expectNoCall("RedisModule_Call");
+    mock().expectNoCall("RedisModule_CreateTimer");
+    ndelJobsCron(&ctx, NULL);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "failed")
+          .withParameter("len", 6L);
+    NDelStatus_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_cancel_stops_job)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long id = submitNDelJob(&ctx, redisStrVec);
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 1);
+    NDelCancel_RedisCommand(&ctx, redisStrVec, 2);
+
+    mock().expectNoCall("RedisModule_Call");
+    mock().expectNoCall("RedisModule_CreateTimer");
+    ndelJobsCron(&ctx, NULL);
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 0);
+    NDelCancel_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "cancelled")
+          .withParameter("len", 9L);
+    NDelStatus_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_rejects_jobs_beyond_limit)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    ndel_jobs_max = ndel_jobs_running + 1;
+    long long id = submitNDelJob(&ctx, redisStrVec);
+
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_ReplyWithLongLong");
+    NDel_NoAtomic_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    /* A cancelled job makes room for another */
+    ndelJobIdGiven(&id);
+    NDelCancel_RedisCommand(&ctx, redisStrVec, 2);
+    mock().expectNoCall("RedisModule_ReplyWithError");
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", id + 1);
+    NDel_NoAtomic_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_status_of_unknown_job)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long id = ndel_next_job_id;
+
+    ndelJobIdGiven(&id);
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    int ret = NDelStatus_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+static const SlowLogEntry *slowLogNewest(void)
+{
+    const SlowLogEntry *entry = slowLogGet(&slow_log, 0);
+    CHECK(entry != NULL);
+    return entry;
+}
+
+TEST(exstrings_ndel, ndel_atomic_slow_execution_is_logged)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    slow_log_us = 0;
+    slowLogReset(&slow_log);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(3);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "UNLINK");
+    nDelReturnNKeysFromUnlink(3);
+    stringPtrLenReturns("key*");
+    NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    const SlowLogEntry *entry = slowLogNewest();
+    CHECK_EQUAL(cmdStatsFind("ndel.atomic"), entry->cmd);
+    CHECK_EQUAL(4, (int)entry->patternlen);
+    STRNCMP_EQUAL("key*", entry->pattern, 4);
+    CHECK_EQUAL(3, entry->scanned);
+    CHECK_EQUAL(3, entry->matched);
+    CHECK_EQUAL(1, entry->iterations);
+    CHECK_EQUAL(entry->wall_us, entry->lock_us);
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, ndel_noatomic_finished_job_is_logged)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    slow_log_us = 0;
+    slowLogReset(&slow_log);
+    submitNDelJob(&ctx, redisStrVec);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    returnNKeysFromScanSome(2);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    nDelReturnNKeysFromUnlink(2);
+    stringPtrLenReturns("job*");
+    ndelJobsCron(&ctx, NULL);
+    mock().checkExpectations();
+
+    const SlowLogEntry *entry = slowLogNewest();
+    CHECK_EQUAL(cmdStatsFind("ndel.noatomic"), entry->cmd);
+    CHECK_EQUAL(2, entry->scanned);
+    CHECK_EQUAL(2, entry->matched);
+    CHECK_EQUAL(1, entry->iterations);
+    CHECK(entry->lock_us <= entry->wall_us);
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, nslowlog_len_get_and_reset)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    long long count = -1;
+
+    slow_log_us = 0;
+    slowLogReset(&slow_log);
+    returnNKeysFromScanSome(0);
+    stringPtrLenReturns("key*");
+    NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("LEN");
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 1);
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("get");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 20L);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "key*")
+          .withParameter("len", 4L);
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 3);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("RESET");
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 2);
+    stringPtrLenReturns("GET");
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 0L);
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_ndel, nslowlog_syntax_error)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    long long count = -2;
+
+    mock().expectOneCall("RedisModule_WrongArity");
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 1);
+    stringPtrLenReturns("LOG");
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 2);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("GET");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_ReplyWithArray");
+    NSlowLog_RedisCommand(&ctx, redisStrVec, 3);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
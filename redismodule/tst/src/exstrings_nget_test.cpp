@@ -22,6 +22,7 @@
 extern "C" {
 #include "exstringsStub.h"
 #include "redismodule.h"
+#include "valuecodec.h"
 }
 
 #include <string.h>
@@ -31,6 +32,11 @@ extern "C" {
 
 #include "ut_helpers.hpp"
 
+#define UT_WORKERS 4
+#define UT_WORKER_QUEUE_LEN 1024
+#define UT_LOCK_BUDGET_US 200
+#define UT_SLOW_LOG_US    10000
+
 TEST_GROUP(exstrings_nget)
 {
     void setup()
@@ -43,6 +49,13 @@ TEST_GROUP(exstrings_nget)
     {
         mock().clear();
         mock().disable();
+        /* Runs whatever the test left queued and lets the pool restart */
+        workerPoolStop();
+        workerPoolMain(NULL);
+        worker_pool_queue_len = UT_WORKER_QUEUE_LEN;
+        worker_pool_size = UT_WORKERS;
+        nget_lock_budget_us = UT_LOCK_BUDGET_US;
+        slow_log_us = UT_SLOW_LOG_US;
     }
 
 };
@@ -53,21 +66,19 @@ void threadDetachedSuccess()
         .andReturnValue(0);
 }
 
-void nKeysFoundMget(long keys)
+void nKeysFound(long keys)
 {
-    for (long i = 0 ; i < keys ; i++) {
-        mock().expectOneCall("RedisModule_CreateStringFromCallReply")
-              .andReturnValue(malloc(UT_DUMMY_BUFFER_SIZE));
-        mock().expectNCalls(2, "RedisModule_ReplyWithString");
-    }
+    stringValuesRead(keys);
+    mock().expectNCalls(keys, "RedisModule_ReplyWithString");
+    mock().expectNCalls(keys, "RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "value")
+          .withParameter("len", 5L);
 }
 
-void nKeysNotFoundMget(long keys)
+void nKeysNotFound(long keys)
 {
-    void* ptr = NULL;
-    mock().expectNCalls(keys, "RedisModule_CreateStringFromCallReply")
-          .andReturnValue(ptr);
-    mock().expectNoCall("RedisModule_ReplyWithString");
+    mock().expectNCalls(keys, "RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_EMPTY);
 }
 
 void expectNReplies(long count)
@@ -102,8 +113,9 @@ TEST(exstrings_nget, nget_atomic_automemory_enabled)
 TEST(exstrings_nget, nget_atomic_command_parameter_number_incorrect)
 {
     RedisModuleCtx ctx;
-    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
 
+    stringPtrLenReturns("NOT_DECOMPRESS");
     mock().expectOneCall("RedisModule_WrongArity");
     int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  3);
     CHECK_EQUAL(ret, REDISMODULE_ERR);
@@ -194,7 +206,7 @@ TEST(exstrings_nget, nget_atomic_command_scan_returned_zero_keys)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_0_keys_mget)
+TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_0_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
@@ -207,10 +219,8 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_0_keys_mget)
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysNotFoundMget(3);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysNotFound(3);
+    mock().expectNoCall("RedisModule_ReplyWithString");
     expectNReplies(0);
     int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  2);
     CHECK_EQUAL(ret, REDISMODULE_OK);
@@ -219,7 +229,7 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_0_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_3_keys_mget)
+TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_3_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
@@ -231,10 +241,7 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_3_keys_mget)
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysFoundMget(3);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysFound(3);
     expectNReplies(3);
     int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  2);
     CHECK_EQUAL(ret, REDISMODULE_OK);
@@ -243,7 +250,7 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_3_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_2_keys_mget)
+TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_2_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
@@ -255,11 +262,8 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_2_keys_mget)
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysFoundMget(2);
-    nKeysNotFoundMget(1);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysFound(2);
+    nKeysNotFound(1);
     expectNReplies(2);
     int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  2);
     CHECK_EQUAL(ret, REDISMODULE_OK);
@@ -268,13 +272,85 @@ TEST(exstrings_nget, nget_atomic_command_3_keys_scanned_2_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_automemory_enabled)
+static void expectDecompressedValue(const char *stored, size_t *stored_len, const char *value, long len)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    mock().ignoreOtherCalls();
+    stringPtrLenReturns("DECOMPRESS");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(1);
+    mock().expectOneCall("RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_STRING);
+    mock().expectOneCall("RedisModule_StringDMA")
+          .withOutputParameterReturning("len", stored_len, sizeof(*stored_len))
+          .andReturnValue((void *)stored);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", value)
+          .withParameter("len", len);
+    expectNReplies(1);
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nget, nget_atomic_command_decompress_strips_value_header)
+{
+    bool compressed;
+    char stored[5 + VALUECODEC_HEADER_LEN + 1] = {0};
+    static size_t stored_len;
+
+    stored_len = valueEncode("value", 5, 100, stored, &compressed);
+    expectDecompressedValue(stored, &stored_len, "value", 5);
+}
+
+TEST(exstrings_nget, nget_atomic_command_decompress_keeps_plain_values_with_magic)
+{
+    /* Written by plain SET, it only looks like a raw header */
+    static const char stored[] = "\xc5\x5a\x01\x00\x00\x00\x00value";
+    static size_t stored_len = sizeof(stored) - 1;
+
+    expectDecompressedValue(stored, &stored_len, stored, (long)stored_len);
+}
+
+TEST(exstrings_nget, nget_atomic_command_skips_non_string_keys)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
 
-    mock().setData("pthread_create_free_block_client_args", 1);
+    mock().ignoreOtherCalls();
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(2);
+    mock().expectOneCall("RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_HASH);
+    nKeysFound(1);
+    mock().expectNCalls(2, "RedisModule_CloseKey");
+    expectNReplies(1);
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec,  2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+void workerPoolStarted(int workers)
+{
+    mock().expectNCalls(workers, "pthread_create");
+    CHECK_EQUAL(REDISMODULE_OK, workerPoolStart());
+    mock().checkExpectations();
+}
+
+TEST(exstrings_nget, nget_noatomic_automemory_enabled)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
 
+    workerPoolStarted(worker_pool_size);
     mock().ignoreOtherCalls();
     mock().expectOneCall("RedisModule_AutoMemory");
 
@@ -285,16 +361,15 @@ TEST(exstrings_nget, nget_noatomic_automemory_enabled)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_thread_create_success)
+TEST(exstrings_nget, nget_noatomic_job_queued_without_creating_thread)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
 
-    mock().setData("pthread_create_free_block_client_args", 1);
-
+    workerPoolStarted(worker_pool_size);
     mock().ignoreOtherCalls();
     mock().expectOneCall("RedisModule_BlockClient");
-    mock().expectOneCall("pthread_create");
+    mock().expectNoCall("pthread_create");
     mock().expectNoCall("RedisModule_AbortBlock");
 
     int ret = NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
@@ -304,19 +379,71 @@ TEST(exstrings_nget, nget_noatomic_thread_create_success)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_thread_create_fail)
+TEST(exstrings_nget, nget_noatomic_queue_full_rejected)
 {
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
 
+    worker_pool_queue_len = 1;
+    workerPoolStarted(worker_pool_size);
     mock().ignoreOtherCalls();
-    mock().expectOneCall("RedisModule_BlockClient");
+    mock().expectNCalls(2, "RedisModule_BlockClient");
+    mock().expectOneCall("RedisModule_AbortBlock");
+    mock().expectOneCall("RedisModule_ReplyWithError");
+
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nget, nget_noatomic_pool_start_fails)
+{
     mock().expectOneCall("pthread_create")
           .andReturnValue(1);
+    CHECK_EQUAL(REDISMODULE_ERR, workerPoolStart());
+    mock().checkExpectations();
+}
+
+TEST(exstrings_nget, nget_noatomic_pool_not_started_rejected)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    mock().ignoreOtherCalls();
     mock().expectOneCall("RedisModule_AbortBlock");
+    mock().expectOneCall("RedisModule_ReplyWithError");
 
-    int ret = NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
-    CHECK_EQUAL(ret, REDISMODULE_OK);
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nget, poolstats_counts_queued_and_rejected)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    worker_pool_queue_len = 1;
+    workerPoolStarted(worker_pool_size);
+    mock().ignoreOtherCalls();
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    mock().clear();
+
+    mock().ignoreOtherCalls();
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 16L);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", worker_pool_size);
+    mock().expectNCalls(5, "RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 1);
+    mock().expectNCalls(2, "RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 0);
+
+    PoolStats_RedisCommand(&ctx, redisStrVec, 1);
     mock().checkExpectations();
 
     delete []redisStrVec;
@@ -327,6 +454,7 @@ TEST(exstrings_nget, nget_noatomic_parameter_number_incorrect)
     RedisModuleCtx ctx;
     RedisModuleString ** redisStrVec = createRedisStrVec(4);
 
+    stringPtrLenReturns("NOT_DECOMPRESS");
     mock().expectOneCall("RedisModule_WrongArity");
     mock().expectNoCall("RedisModule_BlockClient");
 
@@ -392,7 +520,7 @@ typedef struct RedisModuleBlockedClientArgs {
     int argc;
 } RedisModuleBlockedClientArgs;
 
-TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_3_keys_mget)
+TEST(exstrings_nget, nget_noatomic_job_3_keys_scanned_3_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleBlockedClientArgs *bca =
@@ -405,22 +533,18 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_3_keys_mget)
     bca->argc = 2;
 
     mock().ignoreOtherCalls();
-    threadDetachedSuccess();
     mock().expectOneCall("RedisModule_ReplyWithArray")
           .withParameter("len", (long)REDISMODULE_POSTPONED_ARRAY_LEN);
     mock().expectOneCall("RedisModule_Call")
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysFoundMget(3);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysFound(3);
     expectNReplies(3);
     mock().expectOneCall("RedisModule_FreeThreadSafeContext");
     mock().expectOneCall("RedisModule_UnblockClient");
 
-    NGet_NoAtomic_ThreadMain((void*)bca);
+    NGet_NoAtomic_Job((void*)bca);
 
     mock().checkExpectations();
     threadSafeContextLockedAndUnlockedEqualTimes();
@@ -428,7 +552,40 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_3_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_0_keys_mget)
+TEST(exstrings_nget, nget_noatomic_slow_job_is_logged)
+{
+    RedisModuleCtx ctx;
+    RedisModuleBlockedClientArgs *bca =
+        (RedisModuleBlockedClientArgs*)RedisModule_Alloc(sizeof(RedisModuleBlockedClientArgs));
+    RedisModuleBlockedClient *bc = RedisModule_BlockClient(&ctx,NULL,NULL,NULL,0);
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    bca->bc = bc;
+    bca->argv = redisStrVec;
+    bca->argc = 2;
+
+    slow_log_us = 0;
+    slowLogReset(&slow_log);
+    mock().ignoreOtherCalls();
+    returnNKeysFromScanSome(3);
+    nKeysFound(3);
+    stringPtrLenReturns("key*");
+
+    NGet_NoAtomic_Job((void*)bca);
+
+    mock().checkExpectations();
+    const SlowLogEntry *entry = slowLogGet(&slow_log, 0);
+    CHECK(entry != NULL);
+    CHECK_EQUAL(cmdStatsFind("nget.noatomic"), entry->cmd);
+    CHECK_EQUAL(3, entry->scanned);
+    CHECK_EQUAL(3, entry->matched);
+    CHECK_EQUAL(1, entry->iterations);
+    CHECK(entry->lock_us <= entry->wall_us);
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nget, nget_noatomic_job_3_keys_scanned_0_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleBlockedClientArgs *bca = (RedisModuleBlockedClientArgs*)malloc(sizeof(RedisModuleBlockedClientArgs));
@@ -440,22 +597,19 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_0_keys_mget)
     bca->argc = 2;
 
     mock().ignoreOtherCalls();
-    threadDetachedSuccess();
     mock().expectOneCall("RedisModule_ReplyWithArray")
           .withParameter("len", (long)REDISMODULE_POSTPONED_ARRAY_LEN);
     mock().expectOneCall("RedisModule_Call")
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysNotFoundMget(3);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysNotFound(3);
+    mock().expectNoCall("RedisModule_ReplyWithString");
     expectNReplies(0);
     mock().expectOneCall("RedisModule_FreeThreadSafeContext");
     mock().expectOneCall("RedisModule_UnblockClient");
 
-    NGet_NoAtomic_ThreadMain((void*)bca);
+    NGet_NoAtomic_Job((void*)bca);
 
     mock().checkExpectations();
     threadSafeContextLockedAndUnlockedEqualTimes();
@@ -463,7 +617,7 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_0_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_2_keys_mget)
+TEST(exstrings_nget, nget_noatomic_job_3_keys_scanned_2_keys_found)
 {
     RedisModuleCtx ctx;
     RedisModuleBlockedClientArgs *bca = (RedisModuleBlockedClientArgs*)malloc(sizeof(RedisModuleBlockedClientArgs));
@@ -475,23 +629,19 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_2_keys_mget)
     bca->argc = 2;
 
     mock().ignoreOtherCalls();
-    threadDetachedSuccess();
     mock().expectOneCall("RedisModule_ReplyWithArray")
           .withParameter("len", (long)REDISMODULE_POSTPONED_ARRAY_LEN);
     mock().expectOneCall("RedisModule_Call")
           .withParameter("cmdname", "SCAN");
     returnNKeysFromScanSome(3);
     mock().expectOneCall("RedisModule_FreeCallReply");
-    mock().expectOneCall("RedisModule_Call")
-          .withParameter("cmdname", "MGET");
-    nKeysNotFoundMget(1);
-    nKeysFoundMget(2);
-    mock().expectOneCall("RedisModule_FreeCallReply");
+    nKeysNotFound(1);
+    nKeysFound(2);
     expectNReplies(2);
     mock().expectOneCall("RedisModule_FreeThreadSafeContext");
     mock().expectOneCall("RedisModule_UnblockClient");
 
-    NGet_NoAtomic_ThreadMain((void*)bca);
+    NGet_NoAtomic_Job((void*)bca);
 
     mock().checkExpectations();
     threadSafeContextLockedAndUnlockedEqualTimes();
@@ -499,7 +649,7 @@ TEST(exstrings_nget, nget_noatomic_threadmain_3_keys_scanned_2_keys_mget)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_threadmain_scan_returned_zero_keys)
+TEST(exstrings_nget, nget_noatomic_job_scan_returned_zero_keys)
 {
     RedisModuleCtx ctx;
     RedisModuleBlockedClientArgs *bca = (RedisModuleBlockedClientArgs*)malloc(sizeof(RedisModuleBlockedClientArgs));
@@ -511,7 +661,6 @@ TEST(exstrings_nget, nget_noatomic_threadmain_scan_returned_zero_keys)
     bca->argc = 2;
 
     mock().ignoreOtherCalls();
-    threadDetachedSuccess();
     mock().expectOneCall("RedisModule_ReplyWithArray")
           .withParameter("len", (long)REDISMODULE_POSTPONED_ARRAY_LEN);
     mock().expectOneCall("RedisModule_Call")
@@ -522,7 +671,7 @@ TEST(exstrings_nget, nget_noatomic_threadmain_scan_returned_zero_keys)
     mock().expectOneCall("RedisModule_FreeThreadSafeContext");
     mock().expectOneCall("RedisModule_UnblockClient");
 
-    NGet_NoAtomic_ThreadMain((void*)bca);
+    NGet_NoAtomic_Job((void*)bca);
 
     mock().checkExpectations();
     threadSafeContextLockedAndUnlockedEqualTimes();
@@ -530,23 +679,44 @@ TEST(exstrings_nget, nget_noatomic_threadmain_scan_returned_zero_keys)
     delete []redisStrVec;
 }
 
-TEST(exstrings_nget, nget_noatomic_threadmain_thread_detached)
+TEST(exstrings_nget, nget_noatomic_worker_detached_and_runs_queued_jobs)
 {
     RedisModuleCtx ctx;
-    RedisModuleBlockedClientArgs *bca = (RedisModuleBlockedClientArgs*)malloc(sizeof(RedisModuleBlockedClientArgs));
-    RedisModuleBlockedClient *bc = RedisModule_BlockClient(&ctx,NULL,NULL,NULL,0);
     RedisModuleString ** redisStrVec = createRedisStrVec(2);
 
-    bca->bc = bc;
-    bca->argv = redisStrVec;
-    bca->argc = 2;
+    worker_pool_size = 1;
+    workerPoolStarted(1);
+    mock().ignoreOtherCalls();
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    NGet_NoAtomic_RedisCommand(&ctx, redisStrVec,  2);
+    workerPoolStop();
+    mock().clear();
 
     mock().ignoreOtherCalls();
     threadDetachedSuccess();
+    mock().expectNCalls(2, "RedisModule_UnblockClient");
 
-    NGet_NoAtomic_ThreadMain((void*)bca);
+    workerPoolMain(NULL);
 
     mock().checkExpectations();
 
     delete []redisStrVec;
 }
+
+TEST(exstrings_nget, nget_noatomic_batch_grows_on_empty_and_fast_batches)
+{
+    CHECK_EQUAL(100, adaptBatchCount(50, 150, 0));
+    CHECK_EQUAL(100, adaptBatchCount(50, 10, 50));
+    CHECK_EQUAL(50, adaptBatchCount(50, 150, 50));
+    CHECK_EQUAL(10000, adaptBatchCount(8000, 0, 0));
+}
+
+TEST(exstrings_nget, nget_noatomic_batch_shrinks_over_lock_budget)
+{
+    CHECK_EQUAL(25, adaptBatchCount(50, 400, 0));
+    CHECK_EQUAL(40, adaptBatchCount(100, 500, 100));
+    CHECK_EQUAL(1, adaptBatchCount(2, 10000, 2));
+
+    nget_lock_budget_us = 1000;
+    CHECK_EQUAL(100, adaptBatchCount(50, 400, 50));
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_nscan)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+    }
+
+    void teardown()
+    {
+        mock().clear();
+        mock().disable();
+    }
+
+};
+
+static void scanStepReturns(const char *cursor, long keys)
+{
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyStringPtr")
+          .andReturnValue((void *)cursor);
+    returnNKeysFromScanSome(keys);
+}
+
+static void expectPage(const char *cursor, long pairs)
+{
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 2L);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", cursor)
+          .withParameter("len", (long)strlen(cursor));
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", (long)REDISMODULE_POSTPONED_ARRAY_LEN);
+    mock().expectNCalls(pairs, "RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "value")
+          .withParameter("len", 5L);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", 2*pairs);
+}
+
+TEST(exstrings_nscan, nscan_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(8);
+
+    mock().expectNCalls(3, "RedisModule_WrongArity");
+    NScan_RedisCommand(&ctx, redisStrVec, 2);
+    NScan_RedisCommand(&ctx, redisStrVec, 4);
+    NScan_RedisCommand(&ctx, redisStrVec, 8);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_command_unknown_option)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+
+    stringPtrLenReturns("LIMIT");
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_Call");
+    NScan_RedisCommand(&ctx, redisStrVec, 5);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_command_maxbytes_not_positive)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+    long long maxbytes = 0;
+
+    stringPtrLenReturns("maxbytes");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &maxbytes, sizeof(maxbytes));
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_Call");
+    NScan_RedisCommand(&ctx, redisStrVec, 5);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_command_invalid_cursors)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    const char *cursors[] = { "", "abc", "12x", "-1", "12:6b3", "12:zz", "12+6b3", "12+6b31:zz", "i6", "99999999999999999999" };
+
+    for (size_t i = 0; i < sizeof(cursors) / sizeof(cursors[0]); i++) {
+        stringPtrLenReturns(cursors[i]);
+        mock().expectOneCall("RedisModule_ReplyWithError");
+        mock().expectNoCall("RedisModule_Call");
+        NScan_RedisCommand(&ctx, redisStrVec, 3);
+        mock().checkExpectations();
+        mock().clear();
+        mock().ignoreOtherCalls();
+    }
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_first_page_is_one_scan_step)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    stringPtrLenReturns("0");
+    scanStepReturns("17", 2);
+    stringValuesRead(2);
+    mock().expectNCalls(2, "RedisModule_ReplyWithString");
+    expectPage("17", 2);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_last_page_returns_cursor_zero)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+    long long count = 10;
+
+    stringPtrLenReturns("COUNT");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    stringPtrLenReturns("17");
+    scanStepReturns("0", 1);
+    /* Expired since the SCAN step */
+    mock().expectOneCall("RedisModule_KeyType")
+          .andReturnValue(REDISMODULE_KEYTYPE_EMPTY);
+    mock().expectNoCall("RedisModule_ReplyWithString");
+    expectPage("0", 0);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_empty_scan_step_continues)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    stringPtrLenReturns("0");
+    scanStepReturns("42", 0);
+    mock().expectNoCall("RedisModule_CreateStringFromCallReply");
+    mock().expectNoCall("RedisModule_ReplyWithString");
+    expectPage("42", 0);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_keeps_last_key_of_index_walk)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    /* "k1" was the last key from the index before it was dropped */
+    stringPtrLenReturns("17:6b31");
+    scanStepReturns("23", 0);
+    expectPage("23:6b31", 0);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_maxbytes_cuts_scan_step_by_key_name)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+    long long maxbytes = 10;
+
+    stringPtrLenReturns("MAXBYTES");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &maxbytes, sizeof(maxbytes));
+    stringPtrLenReturns("0");
+    scanStepReturns("17", 2);
+    /* Ordered by name, then two bytes of key and five of value each */
+    stringPtrLenReturns("k2");
+    stringPtrLenReturns("k1");
+    stringValuesRead(2);
+    stringPtrLenReturns("k1");
+    stringPtrLenReturns("k2");
+    stringPtrLenReturns("k1");
+    stringValuesRead(1);
+    mock().expectOneCall("RedisModule_ReplyWithString");
+    /* The same step again, after "k1" */
+    expectPage("0+6b31", 1);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nscan, nscan_step_cursor_skips_keys_returned)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    stringPtrLenReturns("0+6b31");
+    scanStepReturns("17", 2);
+    stringPtrLenReturns("k2");
+    stringPtrLenReturns("k1");
+    stringValuesRead(1);
+    mock().expectOneCall("RedisModule_ReplyWithString");
+    expectPage("17", 1);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
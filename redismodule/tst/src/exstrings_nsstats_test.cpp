@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_nsstats)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+        ns_accounting_enabled = true;
+    }
+
+    void teardown()
+    {
+        RedisModuleCtx ctx;
+        mock().clear();
+        mock().disable();
+        ns_accounting_enabled = false;
+        nsAccountingResetAll();
+        /* Lets the timer lapse */
+        nsAccountingCron(&ctx, NULL);
+    }
+
+};
+
+static void notifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event,
+                                const char *key, size_t size)
+{
+    stringPtrLenReturns(key);
+    if (size) {
+        mock().expectOneCall("RedisModule_KeyType")
+              .andReturnValue(REDISMODULE_KEYTYPE_STRING);
+        mock().expectOneCall("RedisModule_StringDMA")
+              .withOutputParameterReturning("len", &size, sizeof(size));
+    }
+    nsAccountingNotify(ctx, type, event, (RedisModuleString *)key);
+}
+
+/* Builds the accounting of an empty database */
+static void readyNsAccounting(RedisModuleCtx *ctx)
+{
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    NsStats_RedisCommand(ctx, redisStrVec, 1);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    mock().expectOneCall("RedisModule_CallReplyLength")
+          .andReturnValue(0);
+    nsAccountingCron(ctx, NULL);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    delete []redisStrVec;
+}
+
+/* The namespace name is not terminated, it is told apart by its counts. All
+ * its values are shorter than 64 bytes. */
+static void expectNamespace(long long keys, long long bytes)
+{
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", (int)keys);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", (int)bytes);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", (long)NSSTATS_BUCKETS);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", (int)keys);
+    mock().expectNCalls(NSSTATS_BUCKETS - 1, "RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 0);
+}
+
+TEST(exstrings_nsstats, first_query_starts_build)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    mock().expectOneCall("RedisModule_CreateDict");
+    mock().expectOneCall("RedisModule_CreateTimer")
+          .withParameter("period", 1L);
+    mock().expectOneCall("RedisModule_ReplyWithError");
+
+    int ret = NsStats_RedisCommand(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nsstats, build_scans_namespaced_keys_only)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    NsStats_RedisCommand(&ctx, redisStrVec, 1);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    mock().expectOneCall("RedisModule_CallReplyLength")
+          .andReturnValue(0);
+    mock().expectNoCall("RedisModule_CreateTimer");
+    nsAccountingCron(&ctx, NULL);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nsstats, top_namespaces_by_bytes)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+    long long top = 1;
+
+    readyNsAccounting(&ctx);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{a},x", 10);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{a},y", 20);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{b},z", 40);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "nons", 0);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("TOP");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &top, sizeof(top));
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 4L);
+    expectNamespace(1, 40);
+    mock().expectNoCall("RedisModule_ReplyWithError");
+
+    int ret = NsStats_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nsstats, changed_and_deleted_keys_are_accounted)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    readyNsAccounting(&ctx);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{a},x", 10);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{a},y", 20);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{b},z", 40);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_STRING, "set", "{a},x", 50);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_GENERIC, "del", "{a},y", 0);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_EXPIRED, "expired", "{b},z", 0);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 1L);
+    mock().expectOneCall("RedisModule_ReplyWithArray")
+          .withParameter("len", 4L);
+    expectNamespace(1, 50);
+
+    int ret = NsStats_RedisCommand(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nsstats, flushall_drops_accounting)
+{
+    RedisModuleCtx ctx;
+    RedisModuleCommandFilterCtx fctx;
+
+    readyNsAccounting(&ctx);
+
+    mock().expectOneCall("RedisModule_CommandFilterArgGet")
+          .withParameter("pos", 0);
+    stringPtrLenReturns("FLUSHALL");
+    mock().expectOneCall("RedisModule_FreeDict");
+    prefixIndexCommandFilter(&fctx);
+    mock().checkExpectations();
+}
+
+TEST(exstrings_nsstats, replica_replies_error_and_drops_accounting)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    readyNsAccounting(&ctx);
+
+    mock().expectOneCall("RedisModule_GetContextFlags")
+          .andReturnValue(REDISMODULE_CTX_FLAGS_SLAVE);
+    mock().expectOneCall("RedisModule_FreeDict");
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_CreateDict");
+
+    int ret = NsStats_RedisCommand(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_nsstats, disabled_replies_error)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(1);
+
+    ns_accounting_enabled = false;
+    mock().expectOneCall("RedisModule_ReplyWithError");
+    mock().expectNoCall("RedisModule_CreateDict");
+
+    int ret = NsStats_RedisCommand(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
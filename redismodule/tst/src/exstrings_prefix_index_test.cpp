@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_prefix_index)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+        prefix_index_enabled = true;
+    }
+
+    void teardown()
+    {
+        RedisModuleCtx ctx;
+        mock().clear();
+        mock().disable();
+        prefix_index_enabled = false;
+        prefixIndexResetAll();
+        /* Lets the timer lapse */
+        prefixIndexCron(&ctx, NULL);
+    }
+
+};
+
+static void notifyKeyspaceEvent(RedisModuleCtx *ctx, int type, const char *event, const char *key)
+{
+    stringPtrLenReturns(key);
+    prefixIndexNotify(ctx, type, event, (RedisModuleString *)key);
+}
+
+/* Builds the index of an empty database, then creates 'keys' */
+static void readyPrefixIndex(RedisModuleCtx *ctx, const char **keys, size_t nkeys)
+{
+    prefixIndexRequest(ctx);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    mock().expectOneCall("RedisModule_CallReplyLength")
+          .andReturnValue(0);
+    prefixIndexCron(ctx, NULL);
+    for (size_t i = 0; i < nkeys; i++)
+        notifyKeyspaceEvent(ctx, REDISMODULE_NOTIFY_STRING, "set", keys[i]);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+}
+
+static void expectIndexWalk(long long dbsize, int keys)
+{
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue((int)dbsize);
+    mock().expectNCalls(keys, "RedisModule_CreateString");
+    stringValuesRead(keys);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", (long)2*keys);
+}
+
+static void expectScanFallback(void)
+{
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(0);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", (long)0);
+}
+
+TEST(exstrings_prefix_index, first_query_starts_build_and_scans)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_CreateDict");
+    mock().expectOneCall("RedisModule_CreateTimer")
+          .withParameter("period", 1L);
+    expectScanFallback();
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, build_completes_and_arms_replica_check)
+{
+    RedisModuleCtx ctx;
+
+    prefixIndexRequest(&ctx);
+    mock().expectOneCall("RedisModule_SelectDb")
+          .withParameter("newid", 0);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    mock().expectOneCall("RedisModule_CallReplyLength")
+          .andReturnValue(0);
+    mock().expectOneCall("RedisModule_CreateTimer")
+          .withParameter("period", 1000L);
+    prefixIndexCron(&ctx, NULL);
+    mock().checkExpectations();
+}
+
+TEST(exstrings_prefix_index, nget_walks_only_matching_keys)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a", "{ns},b", "{nt},a", "{n},a" };
+
+    readyPrefixIndex(&ctx, keys, 4);
+
+    stringPtrLenReturns("{ns},*");
+    expectIndexWalk(4, 2);
+    mock().expectNoCall("RedisModule_CallReplyLength");
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, deleted_and_expired_keys_leave_the_index)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a", "{ns},b", "{ns},c", "{ns},d" };
+
+    readyPrefixIndex(&ctx, keys, 4);
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_GENERIC, "del", "{ns},a");
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_EXPIRED, "expired", "{ns},b");
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_GENERIC, "rename_from", "{ns},c");
+    notifyKeyspaceEvent(&ctx, REDISMODULE_NOTIFY_GENERIC, "rename_to", "{ns},e");
+
+    stringPtrLenReturns("{ns},*");
+    expectIndexWalk(2, 2);
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, ndel_walks_index_in_batches)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a", "{ns},b", "{ns},c" };
+    long long batch = 2;
+
+    readyPrefixIndex(&ctx, keys, 3);
+
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(3);
+    mock().expectNCalls(2, "RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &batch, sizeof(batch));
+    mock().expectNCalls(3, "RedisModule_CreateString");
+    mock().expectNCalls(2, "RedisModule_Call")
+          .withParameter("cmdname", "UNLINK");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(2);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(1);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 3);
+
+    int ret = NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, other_glob_patterns_scan)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a" };
+
+    readyPrefixIndex(&ctx, keys, 1);
+
+    stringPtrLenReturns("{ns},?");
+    expectScanFallback();
+    mock().expectNoCall("RedisModule_CreateString");
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, keys_missing_from_index_drop_it)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a" };
+
+    readyPrefixIndex(&ctx, keys, 1);
+
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(2);
+    mock().expectOneCall("RedisModule_FreeDict");
+    expectScanFallback();
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, keys_removed_without_notification_drop_it)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    const char *keys[] = { "{ns},a", "{ns},b" };
+
+    readyPrefixIndex(&ctx, keys, 2);
+
+    /* As after a FLUSHALL run from a MULTI */
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(0);
+    mock().expectOneCall("RedisModule_FreeDict");
+    expectScanFallback();
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, flushall_drops_index)
+{
+    RedisModuleCtx ctx;
+    RedisModuleCommandFilterCtx fctx;
+    const char *keys[] = { "{ns},a" };
+
+    readyPrefixIndex(&ctx, keys, 1);
+
+    mock().expectOneCall("RedisModule_CommandFilterArgGet")
+          .withParameter("pos", 0);
+    stringPtrLenReturns("FLUSHALL");
+    mock().expectOneCall("RedisModule_FreeDict");
+    prefixIndexCommandFilter(&fctx);
+    mock().checkExpectations();
+}
+
+TEST(exstrings_prefix_index, debug_object_keeps_index)
+{
+    RedisModuleCtx ctx;
+    RedisModuleCommandFilterCtx fctx;
+    const char *keys[] = { "{ns},a" };
+
+    readyPrefixIndex(&ctx, keys, 1);
+
+    stringPtrLenReturns("DEBUG");
+    mock().expectOneCall("RedisModule_CommandFilterArgsCount")
+          .andReturnValue(3);
+    stringPtrLenReturns("OBJECT");
+    mock().expectNoCall("RedisModule_FreeDict");
+    prefixIndexCommandFilter(&fctx);
+    mock().checkExpectations();
+}
+
+TEST(exstrings_prefix_index, replica_drops_index_and_stops_timer)
+{
+    RedisModuleCtx ctx;
+    const char *keys[] = { "{ns},a" };
+
+    readyPrefixIndex(&ctx, keys, 1);
+
+    mock().expectOneCall("RedisModule_GetContextFlags")
+          .andReturnValue(REDISMODULE_CTX_FLAGS_SLAVE);
+    mock().expectOneCall("RedisModule_FreeDict");
+    mock().expectNoCall("RedisModule_CreateTimer");
+    prefixIndexCron(&ctx, NULL);
+    mock().checkExpectations();
+}
+
+static void expectNScanPage(const char *cursor, int keys, int pairs)
+{
+    mock().expectNCalls(keys, "RedisModule_CreateString");
+    /* The values are read from the keys, not with MGET */
+    mock().expectNoCall("RedisModule_CreateStringFromCallReply");
+    stringValuesRead(pairs);
+    mock().expectNCalls(pairs, "RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "value")
+          .withParameter("len", 5L);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", cursor)
+          .withParameter("len", (long)strlen(cursor));
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", (long)2*pairs);
+}
+
+TEST(exstrings_prefix_index, nscan_pages_through_index)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+    const char *keys[] = { "{ns},a", "{ns},b", "{ns},c", "{nt},a" };
+    long long count = 2;
+
+    readyPrefixIndex(&ctx, keys, 4);
+
+    stringPtrLenReturns("COUNT");
+    mock().expectNCalls(2, "RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    stringPtrLenReturns("0");
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(4);
+    /* Continues after "{ns},b" */
+    expectNScanPage("i7b6e737d2c62", 2, 2);
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    mock().clear();
+    mock().ignoreOtherCalls();
+
+    stringPtrLenReturns("COUNT");
+    mock().expectNCalls(2, "RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    stringPtrLenReturns("i7b6e737d2c62");
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(4);
+    expectNScanPage("0", 1, 1);
+    ret = NScan_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, nscan_maxbytes_ends_page_before_pair_that_exceeds_it)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(5);
+    const char *keys[] = { "{ns},a", "{ns},b", "{ns},c" };
+    long long maxbytes = 10, count = 50;
+
+    readyPrefixIndex(&ctx, keys, 3);
+
+    stringPtrLenReturns("MAXBYTES");
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &maxbytes, sizeof(maxbytes));
+    mock().expectOneCall("RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    stringPtrLenReturns("0");
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "DBSIZE");
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(3);
+    /* Six bytes of key and five of value each, read before the page */
+    stringValuesRead(2);
+    stringPtrLenReturns("{ns},a");
+    stringPtrLenReturns("{ns},b");
+    stringPtrLenReturns("{ns},a");
+    expectNScanPage("i7b6e737d2c61", 3, 1);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_prefix_index, nscan_index_cursor_finishes_with_scan_when_index_is_gone)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(3);
+
+    stringPtrLenReturns("i7b6e737d2c61");
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_CreateDict");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyStringPtr")
+          .andReturnValue((void *)"5");
+    returnNKeysFromScanSome(0);
+    mock().expectOneCall("RedisModule_ReplyWithStringBuffer")
+          .withParameter("buf", "5:7b6e737d2c61")
+          .withParameter("len", 14L);
+
+    int ret = NScan_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
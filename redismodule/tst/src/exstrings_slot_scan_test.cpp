@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "exstringsStub.h"
+#include "redismodule.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ut_helpers.hpp"
+
+TEST_GROUP(exstrings_slot_scan)
+{
+    void setup()
+    {
+        mock().enable();
+        mock().ignoreOtherCalls();
+        slot_scan_enabled = true;
+    }
+
+    void teardown()
+    {
+        mock().clear();
+        mock().disable();
+        slot_scan_enabled = false;
+    }
+
+};
+
+static void inCluster(void)
+{
+    mock().expectOneCall("RedisModule_GetContextFlags")
+          .andReturnValue(REDISMODULE_CTX_FLAGS_CLUSTER);
+}
+
+static void slotHasKeys(int keys)
+{
+    mock().expectNCalls(2, "RedisModule_Call")
+          .withParameter("cmdname", "CLUSTER");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(keys);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    returnNKeysFromScanSome(keys);
+}
+
+TEST(exstrings_slot_scan, nget_reads_only_the_slot_of_the_hash_tag)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    inCluster();
+    stringPtrLenReturns("{ns},*");
+    slotHasKeys(3);
+    stringPtrLenReturns("{ns},a");
+    /* Another tag in the same slot */
+    stringPtrLenReturns("{xy},b");
+    stringPtrLenReturns("{ns},c");
+    mock().expectNoCall("RedisModule_Scan");
+    stringValuesRead(2);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", 4L);
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_slot_scan, ndel_unlinks_the_slot_keys_a_batch_at_a_time)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+    long long count = 2;
+
+    inCluster();
+    stringPtrLenReturns("{ns},*");
+    slotHasKeys(3);
+    stringPtrLenReturns("{ns},a");
+    stringPtrLenReturns("{ns},b");
+    stringPtrLenReturns("{ns},c");
+    mock().expectNCalls(2, "RedisModule_StringToLongLong")
+          .withOutputParameterReturning("ll", &count, sizeof(count));
+    mock().expectNCalls(2, "RedisModule_Call")
+          .withParameter("cmdname", "UNLINK");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(2);
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(1);
+    mock().expectOneCall("RedisModule_ReplyWithLongLong")
+          .withParameter("ll", 3);
+
+    int ret = NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_slot_scan, nget_scans_when_the_cluster_commands_fail)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    inCluster();
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "CLUSTER");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ERROR);
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    returnNKeysFromScanSome(0);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", 0L);
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_slot_scan, large_slot_scans_instead_of_reading_every_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    inCluster();
+    stringPtrLenReturns("{ns},*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "CLUSTER");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_INTEGER);
+    mock().expectOneCall("RedisModule_CallReplyInteger")
+          .andReturnValue(1000000);
+    mock().expectNoCall("RedisModule_CreateStringFromCallReply");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    mock().expectOneCall("RedisModule_CallReplyType")
+          .andReturnValue(REDISMODULE_REPLY_ARRAY);
+    returnNKeysFromScanSome(0);
+    mock().expectOneCall("RedisModule_ReplySetArrayLength")
+          .withParameter("len", 0L);
+
+    int ret = NGet_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
+
+TEST(exstrings_slot_scan, pattern_without_hash_tag_scans_the_keyspace)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = createRedisStrVec(2);
+
+    inCluster();
+    stringPtrLenReturns("k*");
+    mock().expectOneCall("RedisModule_Call")
+          .withParameter("cmdname", "SCAN");
+    returnNKeysFromScanSome(0);
+
+    int ret = NDel_Atomic_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+
+    delete []redisStrVec;
+}
@@ -22,9 +22,13 @@
 
 extern "C" {
 #include "exstringsStub.h"
+#include "nsdict.h"
 #include "redismodule.h"
 }
 
+#include <stdio.h>
+#include <string.h>
+
 #include "CppUTest/TestHarness.h"
 #include "CppUTestExt/MockSupport.h"
 
@@ -51,6 +55,10 @@ TEST_GROUP(exstring)
 
     void teardown()
     {
+        /* OnLoad enables it, the other tests count PUBLISH calls */
+        native_publish_enabled = false;
+        cmd_stats_enabled = false;
+        ns_accounting_enabled = false;
         mock().clear();
         mock().disable();
     }
@@ -64,6 +72,39 @@ TEST(exstring, OnLoad)
     CHECK_EQUAL(ret, 0);
 }
 
+TEST(exstring, OnLoad_subscribes_nothing_by_default)
+{
+    RedisModuleCtx ctx;
+    int ret = RedisModule_OnLoad(&ctx, 0, 0);
+    CHECK_EQUAL(ret, 0);
+    CHECK_FALSE(ns_accounting_enabled);
+    CHECK_EQUAL(0, mock().getData("RedisModule_SubscribeToKeyspaceEvents").getIntValue());
+    CHECK_EQUAL(0, mock().getData("RedisModule_RegisterCommandFilter").getIntValue());
+}
+
+TEST(exstring, OnLoad_nsstats_subscribes_to_keyspace_events)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)1, (RedisModuleString *)2};
+
+    mock().setData("RedisModule_String_0x1", "NSSTATS");
+    mock().setData("RedisModule_String_0x2", "yes");
+    int ret = RedisModule_OnLoad(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, 0);
+    CHECK(ns_accounting_enabled);
+    CHECK_EQUAL(REDISMODULE_NOTIFY_ALL, mock().getData("RedisModule_SubscribeToKeyspaceEvents").getIntValue());
+    CHECK_EQUAL(1, mock().getData("RedisModule_RegisterCommandFilter").getIntValue());
+}
+
+TEST(exstring, OnLoad_args_without_value)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[1];
+    redisStrVec[0] = (RedisModuleString *)1;
+    int ret = RedisModule_OnLoad(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+}
+
 TEST(exstring, setie)
 {
     RedisModuleCtx ctx;
@@ -170,7 +211,131 @@ TEST(exstring, setie_command_key_string_nosame)
     int ret = setStringGenericCommand(&ctx, redisStrVec, 4, OBJ_OP_IE);
     CHECK_EQUAL(ret, 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setie_command_key_string_nosame_returncurrent)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    redisStrVec[4] = (RedisModuleString *)2;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+    mock().setData("RedisModule_String_returncurrent", (void *)redisStrVec[4]);
+
+    int ret = SetIE_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 6);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setiedigest_command_key_same_digest)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)3;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_String_digestvalue", (void *)redisStrVec[3]);
+
+    int ret = SetIEDigest_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setiedigest_command_key_nosame_digest)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)3;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+    mock().setData("RedisModule_String_digestvalue", (void *)redisStrVec[3]);
+
+    int ret = SetIEDigest_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setiedigest_command_invalid_digest)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+
+    int ret = SetIEDigest_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setie_command_digest_word_is_an_old_value)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)2;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_digest", (void *)redisStrVec[3]);
+
+    int ret = SetIE_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
     delete []redisStrVec;
 
 }
@@ -192,8 +357,68 @@ TEST(exstring, setie_command_key_same_string_reply)
 
     int ret = setStringGenericCommand(&ctx, redisStrVec, 4, OBJ_OP_IE);
     CHECK_EQUAL(ret, 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_SetExpire").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate_cmdname").getStringValue(), "SET");
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setne_command_key_string_nosame_with_expire)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[6]);
+
+    for (int i = 0 ; i < 6 ; i++)
+        redisStrVec[i] = (RedisModuleString *)1;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_px", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 100);
+
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
+    int ret = setStringGenericCommand(&ctx, redisStrVec, 6, OBJ_OP_NE);
+    CHECK_EQUAL(ret, 0);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_SetExpire").getIntValue(), 100);
+    CHECK_EQUAL(mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setie_command_key_same_string_unknown_option_uses_set)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+
+    for (int i = 0 ; i < 5 ; i++)
+        redisStrVec[i] = (RedisModuleString *)1;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_CallReplyType_null", 1);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = setStringGenericCommand(&ctx, redisStrVec, 5, OBJ_OP_IE);
+    CHECK_EQUAL(ret, 0);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("SET").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
     delete []redisStrVec;
 }
 
@@ -257,7 +482,8 @@ TEST(exstring, delie)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_null", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = DelIE_RedisCommand(&ctx, redisStrVec,  3);
     CHECK_EQUAL(ret, 0);
     mock().checkExpectations();
@@ -293,7 +519,7 @@ TEST(exstring, del_command_parameter_number_incorrect)
     CHECK_EQUAL(ret, 1);
 
     ret = 0;
-    ret = delStringGenericCommand(&ctx, 0, 4, OBJ_OP_NE);
+    ret = delStringGenericCommand(&ctx, 0, 5, OBJ_OP_NE);
     CHECK_EQUAL(ret, 1);
 }
 
@@ -314,6 +540,50 @@ TEST(exstring, delie_command_no_key)
 
 }
 
+TEST(exstring, delie_command_no_key_returncurrent)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)2;
+    mock().setData("RedisModule_OpenKey_no", 1);
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_String_returncurrent", (void *)redisStrVec[3]);
+
+    int ret = DelIE_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, deliedigest_command_key_same_digest)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[3]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)3;
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_String_digestvalue", (void *)redisStrVec[2]);
+
+    int ret = DelIEDigest_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    delete []redisStrVec;
+
+}
+
 TEST(exstring, delie_command_have_key_set)
 {
     RedisModuleCtx ctx;
@@ -354,14 +624,30 @@ TEST(exstring, delie_command_key_string_nosame)
     int ret = delStringGenericCommand(&ctx, redisStrVec, 3, OBJ_OP_IE);
     CHECK_EQUAL(ret, 0);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
     delete []redisStrVec;
 
 }
 
+TEST(exstring, setie_delie_failed_compare_never_opens_key_for_write)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+
+    /* Closing a key opened for write signals it as modified */
+    setStringGenericCommand(&ctx, redisStrVec, 4, OBJ_OP_IE);
+    delStringGenericCommand(&ctx, redisStrVec, 3, OBJ_OP_IE);
+    CHECK_EQUAL(0, mock().getData("RedisModule_OpenKey_write").getIntValue());
+}
 
 TEST(exstring, delie_command_key_same_string_reply)
 {
@@ -377,14 +663,19 @@ TEST(exstring, delie_command_key_same_string_reply)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_null", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = delStringGenericCommand(&ctx, redisStrVec, 3, OBJ_OP_IE);
     CHECK_EQUAL(ret, 0);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate_cmdname").getStringValue(), "UNLINK");
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
     delete []redisStrVec;
 }
 
@@ -408,10 +699,11 @@ TEST(exstring, delne_command_key_string_same_reply)
     int ret = delStringGenericCommand(&ctx, redisStrVec, 3, OBJ_OP_NE);
     CHECK_EQUAL(ret, 0);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
     delete []redisStrVec;
 
 }
@@ -431,14 +723,19 @@ TEST(exstring, delne_command_key_string_nosame_reply)
     mock().setData("RedisModule_String_nosame", 1);
     mock().setData("RedisModule_CallReplyType_inter", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = delStringGenericCommand(&ctx, redisStrVec, 3, OBJ_OP_NE);
     CHECK_EQUAL(ret, 0);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate_cmdname").getStringValue(), "UNLINK");
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
     delete []redisStrVec;
 
 }
@@ -459,8 +756,10 @@ TEST(exstring, setpub_command_parameter_number_incorrect)
     ret = SetMPub_RedisCommand(&ctx, 0, 2);
     CHECK_EQUAL(ret, REDISMODULE_ERR);
 
+    /* An even count is the PACKED form, the last argument is read */
+    RedisModuleString *redisStrVec[8] = {0};
     ret = 0;
-    ret = SetMPub_RedisCommand(&ctx, 0, 8);
+    ret = SetMPub_RedisCommand(&ctx, redisStrVec, 8);
     CHECK_EQUAL(ret, REDISMODULE_ERR);
 
     ret = 0;
@@ -691,58 +990,129 @@ TEST(exstring, setmpub_command_set_multipub)
 
 }
 
-TEST(exstring, setxxpub_command_has_no_key)
+TEST(exstring, setmpub_command_native_publish)
 {
     RedisModuleCtx ctx;
-    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[9]);
 
-    redisStrVec[0] = (RedisModuleString *)0;
-    redisStrVec[1] = (RedisModuleString *)1;
-    redisStrVec[2] = (RedisModuleString *)2;
-    redisStrVec[3] = (RedisModuleString *)3;
-    redisStrVec[4] = (RedisModuleString *)4;
+    for (long i = 0; i < 9; i++)
+        redisStrVec[i] = (RedisModuleString *)i;
 
     mock().setData("RedisModule_KeyType_empty", 1);
-    mock().setData("RedisModule_CallReplyType_null", 1);
-
-    mock().expectOneCall("RedisModule_CloseKey");
-    int ret = SetXXPub_RedisCommand(&ctx, redisStrVec, 5);
+    mock().setData("RedisModule_CallReplyType_str", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 1);
+    mock().setData("RedisModule_StringToLongLongCall_2", 2);
 
+    native_publish_enabled = true;
+    int ret = SetMPub_RedisCommand(&ctx, redisStrVec, 9);
     CHECK_EQUAL(ret, REDISMODULE_OK);
-    mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(1, mock().getData("MSET").getIntValue());
+    CHECK_EQUAL(0, mock().getData("PUBLISH").getIntValue());
+    CHECK_EQUAL(2, mock().getData("PublishMessage").getIntValue());
+    CHECK_EQUAL(1, mock().getData("RedisModule_FreeCallReply").getIntValue());
 
     delete []redisStrVec;
-
 }
 
-TEST(exstring, setxxpub_command_parameter_has_key_set)
+TEST(exstring, setmpub_command_packs_messages_of_a_channel)
 {
     RedisModuleCtx ctx;
-    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
-
-    redisStrVec[0] = (RedisModuleString *)0;
-    redisStrVec[1] = (RedisModuleString *)1;
-    redisStrVec[2] = (RedisModuleString *)2;
-    redisStrVec[3] = (RedisModuleString *)3;
-    redisStrVec[4] = (RedisModuleString *)4;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[10]);
 
-    mock().setData("RedisModule_KeyType_set", 1);
+    for (long i = 0; i < 10; i++)
+        redisStrVec[i] = (RedisModuleString *)i;
 
-    mock().expectOneCall("RedisModule_CloseKey");
-    int ret = SetXXPub_RedisCommand(&ctx, redisStrVec, 5);
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_CallReplyType_str", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 1);
+    mock().setData("RedisModule_StringToLongLongCall_2", 2);
+    mock().setData("RedisModule_String_packed", (void *)redisStrVec[9]);
 
+    /* The stub gives every other string the same content, one channel:
+     * one frame, created with its channel name */
+    int ret = SetMPub_RedisCommand(&ctx, redisStrVec, 10);
     CHECK_EQUAL(ret, REDISMODULE_OK);
-    mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    CHECK_EQUAL(1, mock().getData("MSET").getIntValue());
+    CHECK_EQUAL(1, mock().getData("PUBLISH").getIntValue());
+    CHECK_EQUAL(2, mock().getData("RedisModule_CreateString").getIntValue());
+    CHECK_EQUAL(2, mock().getData("RedisModule_FreeString").getIntValue());
+
+    delete []redisStrVec;
+}
+
+TEST(exstring, setmpub_command_without_packed_publishes_each_message)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[9]);
+
+    for (long i = 0; i < 9; i++)
+        redisStrVec[i] = (RedisModuleString *)i;
+
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_CallReplyType_str", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 1);
+    mock().setData("RedisModule_StringToLongLongCall_2", 2);
+
+    int ret = SetMPub_RedisCommand(&ctx, redisStrVec, 9);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(2, mock().getData("PUBLISH").getIntValue());
+    CHECK_FALSE(mock().hasData("RedisModule_CreateString"));
+
+    delete []redisStrVec;
+}
+
+TEST(exstring, setxxpub_command_has_no_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+
+    redisStrVec[0] = (RedisModuleString *)0;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)2;
+    redisStrVec[3] = (RedisModuleString *)3;
+    redisStrVec[4] = (RedisModuleString *)4;
+
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_CallReplyType_null", 1);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = SetXXPub_RedisCommand(&ctx, redisStrVec, 5);
+
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setxxpub_command_parameter_has_key_set)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+
+    redisStrVec[0] = (RedisModuleString *)0;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)2;
+    redisStrVec[3] = (RedisModuleString *)3;
+    redisStrVec[4] = (RedisModuleString *)4;
+
+    mock().setData("RedisModule_KeyType_set", 1);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = SetXXPub_RedisCommand(&ctx, redisStrVec, 5);
+
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
 
@@ -764,17 +1134,21 @@ TEST(exstring, setxxpub_command_has_key_string)
     mock().setData("RedisModule_KeyType_str", 1);
     mock().setData("RedisModule_CallReplyType_str", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = SetXXPub_RedisCommand(&ctx, redisStrVec, 5);
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -825,17 +1199,21 @@ TEST(exstring, setnxpub_command_has_no_key)
     mock().setData("RedisModule_KeyType_empty", 1);
     mock().setData("RedisModule_CallReplyType_str", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = SetNXPub_RedisCommand(&ctx, redisStrVec, 5);
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -897,11 +1275,74 @@ TEST(exstring, setiepub_command_key_string_nosame)
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(), 1);
+
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setiepub_command_key_string_nosame_returncurrent)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[7]);
+
+    redisStrVec[0] = (RedisModuleString *)0;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)2;
+    redisStrVec[3] = (RedisModuleString *)3;
+    redisStrVec[4] = (RedisModuleString *)4;
+    redisStrVec[5] = (RedisModuleString *)5;
+    redisStrVec[6] = (RedisModuleString *)6;
+
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+    mock().setData("RedisModule_String_returncurrent", (void *)redisStrVec[6]);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = SetIEPub_RedisCommand(&ctx, redisStrVec, 7);
+
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 6);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+
+    delete []redisStrVec;
+
+}
+
+TEST(exstring, setiedigestpub_command_key_same_digest)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[6]);
+
+    redisStrVec[0] = (RedisModuleString *)0;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)2;
+    redisStrVec[3] = (RedisModuleString *)3;
+    redisStrVec[4] = (RedisModuleString *)4;
+    redisStrVec[5] = (RedisModuleString *)5;
+
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_String_digestvalue", (void *)redisStrVec[3]);
+
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
+    int ret = SetIEDigestPub_RedisCommand(&ctx, redisStrVec, 6);
+
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -923,17 +1364,21 @@ TEST(exstring, setiepub_command_key_same_string_reply)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_str", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = SetIEPub_RedisCommand(&ctx, redisStrVec, 6);
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 3);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -955,17 +1400,21 @@ TEST(exstring, setnepub_command_has_no_key)
     mock().setData("RedisModule_CallReplyType_str", 1);
     mock().setData("RedisModule_String_nosame", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = SetNEPub_RedisCommand(&ctx, redisStrVec, 6);
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 3);
-    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(),1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_AutoMemory").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -992,11 +1441,12 @@ TEST(exstring, setnepub_command_key_string_same_reply)
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
 
     delete []redisStrVec;
 
@@ -1019,16 +1469,20 @@ TEST(exstring, setnepub_command_key_string_nosame_reply)
     mock().setData("RedisModule_CallReplyType_str", 1);
     mock().setData("RedisModule_String_nosame", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = SetNEPub_RedisCommand(&ctx, redisStrVec, 6);
 
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 3);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
 
     delete []redisStrVec;
 
@@ -1083,6 +1537,30 @@ TEST(exstring, delmpub)
     delete []redisStrVec;
 }
 
+TEST(exstring, delmpub_command_packed)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[9]);
+
+    for (long i = 0; i < 9; i++)
+        redisStrVec[i] = (RedisModuleString *)i;
+
+    mock().setData("RedisModule_CallReplyInteger", 1);
+    mock().setData("RedisModule_CallReplyType_inter", 1);
+    mock().setData("RedisModule_StringToLongLongCallCount", 0);
+    mock().setData("RedisModule_StringToLongLongCall_1", 1);
+    mock().setData("RedisModule_StringToLongLongCall_2", 2);
+    mock().setData("RedisModule_String_packed", (void *)redisStrVec[8]);
+
+    /* Two messages of one channel, one frame */
+    int ret = DelMPub_RedisCommand(&ctx, redisStrVec, 9);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(1, mock().getData("UNLINK").getIntValue());
+    CHECK_EQUAL(1, mock().getData("PUBLISH").getIntValue());
+
+    delete []redisStrVec;
+}
+
 TEST(exstring, deliepub)
 {
     RedisModuleCtx ctx;
@@ -1099,7 +1577,8 @@ TEST(exstring, deliepub)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_null", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = DelIEPub_RedisCommand(&ctx, redisStrVec,  5);
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
@@ -1122,7 +1601,8 @@ TEST(exstring, deliempub)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_null", 1);
 
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = DelIEMPub_RedisCommand(&ctx, redisStrVec,  5);
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
@@ -1559,41 +2039,100 @@ TEST(exstring, deliepub_command_key_string_nosame)
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
 
     delete []redisStrVec;
 }
 
-TEST(exstring, deliepub_command_same_string_replynull)
+TEST(exstring, deliepub_command_hex_channel_is_a_channel)
 {
     RedisModuleCtx ctx;
-    //RedisModuleString str;
     RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
 
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)2;
+    redisStrVec[3] = (RedisModuleString *)3;
+    redisStrVec[4] = (RedisModuleString *)1;
+
+    /* DELIEPUB key DIGEST <xxh64 of the value> message: the old value is
+     * "DIGEST", which the key does not hold */
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_String_digest", (void *)redisStrVec[2]);
+    mock().setData("RedisModule_String_digestvalue", (void *)redisStrVec[3]);
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = DelIEPub_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+
+    delete []redisStrVec;
+}
+
+TEST(exstring, deliepub_command_key_string_nosame_returncurrent)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[6]);
+
     redisStrVec[0] = (RedisModuleString *)1;
     redisStrVec[1] = (RedisModuleString *)1;
     redisStrVec[2] = (RedisModuleString *)1;
     redisStrVec[3] = (RedisModuleString *)1;
     redisStrVec[4] = (RedisModuleString *)1;
+    redisStrVec[5] = (RedisModuleString *)2;
 
     mock().setData("RedisModule_OpenKey_have", 1);
     mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+    mock().setData("RedisModule_String_returncurrent", (void *)redisStrVec[5]);
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = DelIEPub_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 6);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+
+    delete []redisStrVec;
+}
+
+TEST(exstring, deliepub_command_key_wrongtype)
+{
+    RedisModuleCtx ctx;
+    //RedisModuleString str;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    redisStrVec[4] = (RedisModuleString *)1;
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_set", 1);
     mock().setData("RedisModule_String_same", 1);
-    mock().setData("RedisModule_CallReplyType_null", 1);
     mock().expectOneCall("RedisModule_CloseKey");
     int ret = DelIEPub_RedisCommand(&ctx, redisStrVec, 5);
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
 
     delete []redisStrVec;
 }
@@ -1615,16 +2154,19 @@ TEST(exstring, deliepub_command_same_string_reply)
     mock().setData("RedisModule_String_same", 1);
     mock().setData("RedisModule_CallReplyType_str", 1);
     mock().setData("RedisModule_CallReplyInteger", 1);
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = DelIEPub_RedisCommand(&ctx, redisStrVec, 5);
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 3);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
 
     delete []redisStrVec;
 }
@@ -1650,11 +2192,12 @@ TEST(exstring, delnepub_command_same_string_reply)
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 0);
 
     delete []redisStrVec;
 }
@@ -1676,16 +2219,917 @@ TEST(exstring, delnepub_command_nosame_string_reply)
     mock().setData("RedisModule_String_nosame", 1);
     mock().setData("RedisModule_CallReplyType_str", 1);
     mock().setData("RedisModule_CallReplyInteger", 1);
-    mock().expectOneCall("RedisModule_CloseKey");
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
     int ret = DelNEPub_RedisCommand(&ctx, redisStrVec, 5);
     CHECK_EQUAL(ret, REDISMODULE_OK);
     mock().checkExpectations();
     CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
-    CHECK_EQUAL(mock().getData("GET").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("GET").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("UNLINK").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
     CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithCallReply").getIntValue(), 1);
-    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 3);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_FreeCallReply").getIntValue(), 1);
+
+    delete []redisStrVec;
+}
+
+TEST(exstring, mdigest_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+    int ret = MDigest_RedisCommand(&ctx, 0, 1);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+}
+
+TEST(exstring, mdigest_command_key_string)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[3]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_str", 1);
+
+    int ret = MDigest_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 16);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, mdigest_command_key_empty)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[2]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+
+    int ret = MDigest_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    delete []redisStrVec;
+}
+
+TEST(exstring, compressed_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+
+    CHECK_EQUAL(CSet_RedisCommand(&ctx, 0, 2), REDISMODULE_ERR);
+    CHECK_EQUAL(CSet_RedisCommand(&ctx, 0, 4), REDISMODULE_ERR);
+    CHECK_EQUAL(CSetIE_RedisCommand(&ctx, 0, 3), REDISMODULE_ERR);
+    CHECK_EQUAL(CSetIE_RedisCommand(&ctx, 0, 5), REDISMODULE_ERR);
+    CHECK_EQUAL(CSetIEPub_RedisCommand(&ctx, 0, 4), REDISMODULE_ERR);
+    CHECK_EQUAL(CSetIEPub_RedisCommand(&ctx, 0, 7), REDISMODULE_ERR);
+    CHECK_EQUAL(CGet_RedisCommand(&ctx, 0, 3), REDISMODULE_ERR);
+    CHECK_EQUAL(CStats_RedisCommand(&ctx, 0, 2), REDISMODULE_ERR);
+}
+
+TEST(exstring, cset_command_key_string)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)0, (RedisModuleString *)1,
+                                         (RedisModuleString *)2};
+
+    mock().setData("RedisModule_CallReplyType_str", 1);
+
+    int ret = CSet_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("MSET").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    /* The value is replaced by its encoded copy */
+    CHECK_EQUAL(mock().getData("RedisModule_CreateString").getIntValue(), 1);
+}
+
+TEST(exstring, csetie_command_key_string_same)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)0, (RedisModuleString *)1,
+                                         (RedisModuleString *)2, (RedisModuleString *)3};
+
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
+    int ret = CSetIE_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate_cmdname").getStringValue(), "MSET");
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_CreateString").getIntValue(), 1);
+}
+
+TEST(exstring, csetie_command_key_string_nosame)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)0, (RedisModuleString *)1,
+                                         (RedisModuleString *)2, (RedisModuleString *)3};
+
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = CSetIE_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_CreateString").getIntValue(), 0);
+}
+
+TEST(exstring, csetiepub_command_key_string_same)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[6] = {(RedisModuleString *)0, (RedisModuleString *)1,
+                                         (RedisModuleString *)2, (RedisModuleString *)3,
+                                         (RedisModuleString *)4, (RedisModuleString *)5};
+
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+
+    int ret = CSetIEPub_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_StringSet").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+}
+
+TEST(exstring, cget_command_key_string)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)0, (RedisModuleString *)1};
+
+    mock().setData("RedisModule_KeyType_str", 1);
+
+    int ret = CGet_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 5);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+}
+
+TEST(exstring, cget_command_key_empty)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)0, (RedisModuleString *)1};
+
+    mock().setData("RedisModule_KeyType_empty", 1);
+
+    int ret = CGet_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_StringDMA").getIntValue(), 0);
+}
+
+TEST(exstring, cget_command_key_wrongtype)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)0, (RedisModuleString *)1};
+
+    mock().setData("RedisModule_KeyType_set", 1);
+
+    int ret = CGet_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+}
+
+TEST(exstring, cstats_command)
+{
+    RedisModuleCtx ctx;
 
+    int ret = CStats_RedisCommand(&ctx, 0, 1);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 14);
+}
+
+TEST(exstring, versioned_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+    int ret = 0;
+
+    ret = GetVer_RedisCommand(&ctx, 0, 3);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+
+    ret = SetVer_RedisCommand(&ctx, 0, 3);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+
+    ret = SetIfVer_RedisCommand(&ctx, 0, 5);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+
+    ret = SetIfVerPub_RedisCommand(&ctx, 0, 7);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+
+    ret = DelIfVer_RedisCommand(&ctx, 0, 4);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+
+    ret = DelIfVerPub_RedisCommand(&ctx, 0, 4);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+}
+
+TEST(exstring, getver_command_no_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[2]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+
+    mock().expectOneCall("RedisModule_CloseKey");
+    int ret = GetVer_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, getver_command_key_versioned)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[2]);
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", vv);
+
+    int ret = GetVer_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 5);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 3);
+    freeVersionedValue(vv);
+    delete []redisStrVec;
+}
+
+TEST(exstring, getver_command_key_string)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[2]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_str", 1);
+
+    int ret = GetVer_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setifver_command_no_key_version_zero)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 0);
+
+    /* Closed once read and once after the write */
+    mock().expectNCalls(2, "RedisModule_CloseKey");
+    int ret = SetIfVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    mock().checkExpectations();
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_NotifyKeyspaceEvent").getIntValue(), 1);
+    STRCMP_EQUAL("SETVER", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    freeVersionedValue(mock().getData("RedisModule_ModuleTypeSetValue_value").getPointerValue());
+    delete []redisStrVec;
+}
+
+TEST(exstring, setifver_command_version_match)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", vv);
+    mock().setData("RedisModule_StringToLongLongCall_1", 3);
+
+    int ret = SetIfVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 4);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 0);
+    freeVersionedValue(mock().getData("RedisModule_ModuleTypeSetValue_value").getPointerValue());
+    freeVersionedValue(vv);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setifver_command_version_mismatch)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", vv);
+    mock().setData("RedisModule_StringToLongLongCall_1", 2);
+
+    int ret = SetIfVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 0);
+    freeVersionedValue(vv);
     delete []redisStrVec;
 }
+
+TEST(exstring, setifver_command_invalid_version)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    mock().setData("RedisModule_StringToLongLongCall_1", -1);
+
+    int ret = SetIfVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setifver_command_key_string)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_str", 1);
+
+    int ret = SetIfVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setifverpub_command_version_match)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[6]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    redisStrVec[4] = (RedisModuleString *)1;
+    redisStrVec[5] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 0);
+
+    int ret = SetIfVerPub_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
+    freeVersionedValue(mock().getData("RedisModule_ModuleTypeSetValue_value").getPointerValue());
+    delete []redisStrVec;
+}
+
+TEST(exstring, delifver_command_version_match)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[3]);
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", vv);
+    mock().setData("RedisModule_StringToLongLongCall_1", 3);
+
+    int ret = DelIfVer_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    STRCMP_EQUAL("UNLINK", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    freeVersionedValue(vv);
+    delete []redisStrVec;
+}
+
+TEST(exstring, delifver_command_no_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[3]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 0);
+
+    int ret = DelIfVer_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    delete []redisStrVec;
+}
+
+TEST(exstring, delifverpub_command_version_mismatch)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[5]);
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    redisStrVec[4] = (RedisModuleString *)1;
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", vv);
+    mock().setData("RedisModule_StringToLongLongCall_1", 4);
+
+    int ret = DelIfVerPub_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 0);
+    freeVersionedValue(vv);
+    delete []redisStrVec;
+}
+
+TEST(exstring, setver_command)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString ** redisStrVec = new (RedisModuleString*[4]);
+
+    redisStrVec[0] = (RedisModuleString *)1;
+    redisStrVec[1] = (RedisModuleString *)1;
+    redisStrVec[2] = (RedisModuleString *)1;
+    redisStrVec[3] = (RedisModuleString *)1;
+    mock().setData("RedisModule_KeyType_empty", 1);
+    mock().setData("RedisModule_StringToLongLongCall_1", 7);
+
+    int ret = SetVer_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    freeVersionedValue(mock().getData("RedisModule_ModuleTypeSetValue_value").getPointerValue());
+    delete []redisStrVec;
+}
+
+TEST(exstring, versioned_rdb_and_aof)
+{
+    RedisModuleIO io;
+    RedisModuleString *key = (RedisModuleString *)1;
+    void *vv = createVersionedValue("11111", 5, 3);
+
+    versionedRdbSave(&io, vv);
+    CHECK_EQUAL(mock().getData("RedisModule_SaveUnsigned").getIntValue(), 3);
+    CHECK_EQUAL(mock().getData("RedisModule_SaveStringBuffer").getIntValue(), 5);
+
+    versionedAofRewrite(&io, key, vv);
+    CHECK_EQUAL(mock().getData("RedisModule_EmitAOF").getIntValue(), 1);
+    STRCMP_EQUAL("SETVER", mock().getData("RedisModule_EmitAOF_cmdname").getStringValue());
+    freeVersionedValue(vv);
+
+    mock().setData("RedisModule_LoadUnsigned", 3);
+    vv = versionedRdbLoad(&io, 0);
+    CHECK(vv != NULL);
+    freeVersionedValue(vv);
+    CHECK(versionedRdbLoad(&io, 1) == NULL);
+}
+
+static NsDict *createNsWith(const char *field, const char *value)
+{
+    NsDict *d = (NsDict *)createNsValue();
+    nsDictSet(d, field, strlen(field), value, strlen(value));
+    return d;
+}
+
+TEST(exstring, ns_command_parameter_number_incorrect)
+{
+    RedisModuleCtx ctx;
+
+    CHECK_EQUAL(NsSet_RedisCommand(&ctx, 0, 5), REDISMODULE_ERR);
+    CHECK_EQUAL(NsSetPub_RedisCommand(&ctx, 0, 4), REDISMODULE_ERR);
+    CHECK_EQUAL(NsGet_RedisCommand(&ctx, 0, 2), REDISMODULE_ERR);
+    CHECK_EQUAL(NsMGet_RedisCommand(&ctx, 0, 2), REDISMODULE_ERR);
+    CHECK_EQUAL(NsGetAll_RedisCommand(&ctx, 0, 3), REDISMODULE_ERR);
+    CHECK_EQUAL(NsDel_RedisCommand(&ctx, 0, 2), REDISMODULE_ERR);
+    CHECK_EQUAL(NsDelPub_RedisCommand(&ctx, 0, 4), REDISMODULE_ERR);
+    CHECK_EQUAL(NsSetIE_RedisCommand(&ctx, 0, 4), REDISMODULE_ERR);
+    CHECK_EQUAL(NsSetIEPub_RedisCommand(&ctx, 0, 8), REDISMODULE_ERR);
+    CHECK_EQUAL(NsDelIE_RedisCommand(&ctx, 0, 5), REDISMODULE_ERR);
+    CHECK_EQUAL(NsDelIEPub_RedisCommand(&ctx, 0, 5), REDISMODULE_ERR);
+    CHECK_EQUAL(NsClear_RedisCommand(&ctx, 0, 3), REDISMODULE_ERR);
+    CHECK_EQUAL(NsClearPub_RedisCommand(&ctx, 0, 3), REDISMODULE_ERR);
+}
+
+TEST(exstring, ns_set_command_no_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[6] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+
+    mock().setData("RedisModule_KeyType_empty", 1);
+
+    int ret = NsSet_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ModuleTypeSetValue").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    STRCMP_EQUAL("NS.SET", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    NsDict *d = (NsDict *)mock().getData("RedisModule_ModuleTypeSetValue_value").getPointerValue();
+    CHECK_EQUAL(1U, d->len);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_get_command_key_ns)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsGet_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 3);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 0);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_get_command_key_versioned)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+
+    int ret = NsGet_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithError").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithStringBuffer").getIntValue(), 0);
+}
+
+TEST(exstring, ns_getall_command)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)1, (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+    nsDictSet(d, "x", 1, "yz", 2);
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsGetAll_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithArray").getIntValue(), 4);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_del_command_last_field_deletes_key)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsDel_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    STRCMP_EQUAL("NS.DEL", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_setie_command_value_mismatch)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[5] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsSetIE_RedisCommand(&ctx, redisStrVec, 5);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 0);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_delie_command_value_mismatch)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsDelIE_RedisCommand(&ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK(mock().hasData("RedisModule_ReplyWithLongLong"));
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_Replicate").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("RedisModule_OpenKey_write").getIntValue(), 0);
+    UNSIGNED_LONGS_EQUAL(1, d->len);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_setiepub_command_value_match)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[7] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "11111");
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    native_publish_enabled = false;
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsSetIEPub_RedisCommand(&ctx, redisStrVec, 7);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithSimpleString").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
+    STRCMP_EQUAL("NS.SET", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_deliepub_command_value_match)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[6] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "11111");
+    nsDictSet(d, "a", 1, "b", 1);
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    native_publish_enabled = false;
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsDelIEPub_RedisCommand(&ctx, redisStrVec, 6);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 1);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 0);
+    CHECK_EQUAL(mock().getData("PUBLISH").getIntValue(), 1);
+    STRCMP_EQUAL("NS.DEL", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    CHECK_EQUAL(1U, d->len);
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_clear_command)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[2] = {(RedisModuleString *)1, (RedisModuleString *)1};
+    NsDict *d = createNsWith("11111", "abc");
+    nsDictSet(d, "x", 1, "yz", 2);
+
+    RedisModule_OnLoad(&ctx, 0, 0);
+    mock().setData("RedisModule_KeyType_module", 1);
+    mock().setData("RedisModule_ModuleTypeGetType_ns", 1);
+    mock().setData("RedisModule_ModuleTypeGetValue", d);
+
+    int ret = NsClear_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(ret, REDISMODULE_OK);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithLongLong").getIntValue(), 2);
+    CHECK_EQUAL(mock().getData("RedisModule_UnlinkKey").getIntValue(), 1);
+    STRCMP_EQUAL("UNLINK", mock().getData("RedisModule_Replicate_cmdname").getStringValue());
+    freeNsValue(d);
+}
+
+TEST(exstring, ns_rdb_and_aof)
+{
+    RedisModuleIO io;
+    RedisModuleString *key = (RedisModuleString *)1;
+    NsDict *d = createNsWith("11111", "abc");
+    nsDictSet(d, "x", 1, "yz", 2);
+
+    nsRdbSave(&io, d);
+    CHECK_EQUAL(mock().getData("RedisModule_SaveUnsigned").getIntValue(), 2);
+
+    nsAofRewrite(&io, key, d);
+    CHECK_EQUAL(mock().getData("RedisModule_EmitAOF").getIntValue(), 2);
+    STRCMP_EQUAL("NS.SET", mock().getData("RedisModule_EmitAOF_cmdname").getStringValue());
+    CHECK(nsMemUsage(d) > sizeof(NsDict) + d->bytes);
+    freeNsValue(d);
+
+    mock().setData("RedisModule_LoadUnsigned", 2);
+    d = (NsDict *)nsRdbLoad(&io, 0);
+    CHECK(d != NULL);
+    CHECK_EQUAL(1U, d->len);
+    freeNsValue(d);
+    CHECK(nsRdbLoad(&io, 1) == NULL);
+}
+
+TEST(exstring, ns_defrag_resumes_from_cursor)
+{
+    RedisModuleDefragCtx ctx;
+    char field[8];
+    NsDict *d = (NsDict *)createNsValue();
+    void *value = d;
+    int i;
+
+    for (i = 0; i < 20; i++) {
+        snprintf(field, sizeof(field), "f%d", i);
+        nsDictSet(d, field, strlen(field), "v", 1);
+    }
+    mock().setData("RedisModule_DefragShouldStop", 1);
+    CHECK_EQUAL(1, nsDefrag(&ctx, NULL, &value));
+    CHECK_EQUAL(3, mock().getData("RedisModule_DefragAlloc").getIntValue());
+    unsigned int cursor = mock().getData("RedisModule_DefragCursorSet").getUnsignedIntValue();
+    CHECK(cursor > 0);
+
+    mock().setData("RedisModule_DefragShouldStop", 0);
+    mock().setData("RedisModule_DefragCursorGet", cursor);
+    CHECK_EQUAL(0, nsDefrag(&ctx, NULL, &value));
+    CHECK_EQUAL(2 + 20, mock().getData("RedisModule_DefragAlloc").getIntValue());
+    POINTERS_EQUAL(d, value);
+    freeNsValue(d);
+}
+
+TEST(exstring, OnLoad_create_data_type_fails)
+{
+    RedisModuleCtx ctx;
+    mock().setData("RedisModule_CreateDataType_fail", 1);
+    int ret = RedisModule_OnLoad(&ctx, 0, 0);
+    CHECK_EQUAL(ret, REDISMODULE_ERR);
+}
+
+/* CMDSTATS is off by default, the teardown turns it off again */
+static int resetCmdStats(const char *name)
+{
+    cmd_stats_enabled = true;
+    cmdStatsResetAll();
+    return cmdStatsFind(name);
+}
+
+TEST(exstring, cmdstats_counts_call_hit_and_keys)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+    int cmd = resetCmdStats("setie");
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_same", 1);
+    mock().setData("RedisModule_CallReplyType_null", 1);
+
+    int ret = cmdStatsCall(cmd, SetIE_RedisCommand, &ctx, redisStrVec, 4);
+    CHECK_EQUAL(ret, 0);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].calls);
+    UNSIGNED_LONGS_EQUAL(0, cmd_stats[cmd].errors);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].hits);
+    UNSIGNED_LONGS_EQUAL(0, cmd_stats[cmd].misses);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].keys);
+}
+
+TEST(exstring, cmdstats_counts_miss)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[4] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1, (RedisModuleString *)1};
+    int cmd = resetCmdStats("setie");
+
+    mock().setData("RedisModule_OpenKey_have", 1);
+    mock().setData("RedisModule_KeyType_str", 1);
+    mock().setData("RedisModule_String_nosame", 1);
+
+    cmdStatsCall(cmd, SetIE_RedisCommand, &ctx, redisStrVec, 4);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].calls);
+    UNSIGNED_LONGS_EQUAL(0, cmd_stats[cmd].hits);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].misses);
+    CHECK_EQUAL(mock().getData("RedisModule_ReplyWithNull").getIntValue(), 1);
+}
+
+TEST(exstring, cmdstats_counts_errors)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    int cmd = resetCmdStats("setie");
+
+    cmdStatsCall(cmd, SetIE_RedisCommand, &ctx, redisStrVec, 3);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].calls);
+    UNSIGNED_LONGS_EQUAL(1, cmd_stats[cmd].errors);
+    CHECK_EQUAL(mock().getData("RedisModule_WrongArity").getIntValue(), 1);
+}
+
+TEST(exstring, cmdstats_disabled)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    int cmd = resetCmdStats("setie");
+
+    cmd_stats_enabled = false;
+    cmdStatsCall(cmd, SetIE_RedisCommand, &ctx, redisStrVec, 3);
+    UNSIGNED_LONGS_EQUAL(0, cmd_stats[cmd].calls);
+    UNSIGNED_LONGS_EQUAL(0, cmd_stats[cmd].errors);
+    CHECK_EQUAL(mock().getData("RedisModule_WrongArity").getIntValue(), 1);
+}
+
+TEST(exstring, cmdstats_command_replies_called_commands)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+    int cmd = resetCmdStats("delie");
+
+    cmdStatsCall(cmd, DelIE_RedisCommand, &ctx, redisStrVec, 1);
+    int ret = CmdStats_RedisCommand(&ctx, redisStrVec, 1);
+    CHECK_EQUAL(ret, 0);
+    CHECK_EQUAL(2, mock().getData("RedisModule_ReplySetArrayLength").getIntValue());
+    CHECK_EQUAL(18, mock().getData("RedisModule_ReplyWithArray").getIntValue());
+
+    cmdStatsInfo(NULL, 0);
+    CHECK_EQUAL(1, mock().getData("RedisModule_InfoBeginDictField").getIntValue());
+    CHECK_EQUAL(9, mock().getData("RedisModule_InfoAddFieldULongLong").getIntValue());
+}
+
+TEST(exstring, cmdstats_command_syntax_error)
+{
+    RedisModuleCtx ctx;
+    RedisModuleString *redisStrVec[3] = {(RedisModuleString *)1, (RedisModuleString *)1,
+                                         (RedisModuleString *)1};
+
+    CmdStats_RedisCommand(&ctx, redisStrVec, 2);
+    CHECK_EQUAL(1, mock().getData("RedisModule_ReplyWithError").getIntValue());
+    mock().setData("RedisModule_ReplyWithError", 0);
+    CmdStats_RedisCommand(&ctx, redisStrVec, 3);
+    CHECK_EQUAL(1, mock().getData("RedisModule_ReplyWithError").getIntValue());
+}
+
+TEST(exstring, OnLoad_cmdstats_is_off_by_default)
+{
+    RedisModuleCtx ctx;
+    cmd_stats_enabled = true;
+    int ret = RedisModule_OnLoad(&ctx, 0, 0);
+    CHECK_EQUAL(ret, 0);
+    CHECK_FALSE(cmd_stats_enabled);
+    CHECK_EQUAL(0, mock().getData("RedisModule_RegisterInfoFunc").getIntValue());
+}
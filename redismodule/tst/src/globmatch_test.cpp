@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "globmatch.h"
+}
+
+#include <string.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(globmatch)
+{
+};
+
+static bool match(const char *pattern, const char *str)
+{
+    return globMatch(pattern, strlen(pattern), str, strlen(str));
+}
+
+TEST(globmatch, literal_and_star)
+{
+    CHECK(match("{ns},a", "{ns},a"));
+    CHECK_FALSE(match("{ns},a", "{ns},ab"));
+    CHECK(match("{ns},*", "{ns},"));
+    CHECK(match("{ns},*", "{ns},abc"));
+    CHECK_FALSE(match("{ns},*", "{nt},abc"));
+    CHECK(match("*", "a"));
+    /* As in the server, SCAN MATCH * skips matching instead */
+    CHECK_FALSE(match("*", ""));
+    CHECK(match("*a*b*", "xxaxxbxx"));
+    CHECK_FALSE(match("*a*b*", "xxbxxaxx"));
+    CHECK(match("a**", "a"));
+}
+
+TEST(globmatch, question_mark)
+{
+    CHECK(match("k?", "k1"));
+    CHECK_FALSE(match("k?", "k"));
+    CHECK_FALSE(match("k?", "k12"));
+}
+
+TEST(globmatch, character_classes)
+{
+    CHECK(match("k[abc]", "kb"));
+    CHECK_FALSE(match("k[abc]", "kd"));
+    CHECK(match("k[^abc]", "kd"));
+    CHECK_FALSE(match("k[^abc]", "ka"));
+    CHECK(match("k[a-c]", "kb"));
+    CHECK(match("k[c-a]", "kb"));
+    CHECK_FALSE(match("k[a-c]", "kd"));
+    CHECK(match("k[\\]]", "k]"));
+    CHECK(match("k[ab", "ka"));
+}
+
+TEST(globmatch, escapes)
+{
+    CHECK(match("k\\*", "k*"));
+    CHECK_FALSE(match("k\\*", "kx"));
+    CHECK(match("k\\?x", "k?x"));
+}
+
+TEST(globmatch, binary_safe)
+{
+    const char key[] = {'k', '\0', 'x'};
+    const char pattern[] = {'k', '\0', '*'};
+    CHECK(globMatch(pattern, sizeof(pattern), key, sizeof(key)));
+    CHECK_FALSE(globMatch("k*", 2, "x\0k", 3));
+}
+
+TEST(globmatch, many_stars_fail_fast)
+{
+    std::string str(10000, 'a');
+    CHECK_FALSE(match("*a*a*a*a*a*a*a*a*a*a*a*b", str.c_str()));
+}
+
+static GlobKind compile(GlobPattern *glob, const char *pattern, char *literal)
+{
+    globCompile(glob, pattern, strlen(pattern), literal);
+    return glob->kind;
+}
+
+TEST(globmatch, compile_classifies_patterns)
+{
+    GlobPattern glob;
+    char literal[16];
+
+    CHECK_EQUAL(GLOB_PREFIX, compile(&glob, "{ns},*", literal));
+    CHECK_EQUAL(5U, glob.literallen);
+    CHECK_EQUAL(0, memcmp(glob.literal, "{ns},", 5));
+
+    CHECK_EQUAL(GLOB_PREFIX, compile(&glob, "a\\*b\\?*", literal));
+    CHECK_EQUAL(4U, glob.literallen);
+    CHECK_EQUAL(0, memcmp(glob.literal, "a*b?", 4));
+
+    CHECK_EQUAL(GLOB_ANY, compile(&glob, "*", literal));
+    CHECK_EQUAL(GLOB_EXACT, compile(&glob, "{ns},a", literal));
+    CHECK_EQUAL(GLOB_EXACT, compile(&glob, "{ns},\\*", literal));
+    CHECK_EQUAL(6U, glob.literallen);
+    CHECK_EQUAL(GLOB_EXACT, compile(&glob, "", literal));
+
+    CHECK_EQUAL(GLOB_GENERIC, compile(&glob, "{ns},*a*", literal));
+    CHECK_EQUAL(GLOB_GENERIC, compile(&glob, "{ns},?*", literal));
+    /* The literal prefix is kept for the hash slot, see keyslot.h */
+    CHECK_EQUAL(5U, glob.literallen);
+    CHECK_EQUAL(GLOB_GENERIC, compile(&glob, "{ns},[ab]*", literal));
+    CHECK_EQUAL(GLOB_GENERIC, compile(&glob, "a**", literal));
+    CHECK_EQUAL(GLOB_GENERIC, compile(&glob, "a\\", literal));
+}
+
+TEST(globmatch, compiled_pattern_matches_like_matcher)
+{
+    const char *patterns[] = {"{ns},*", "{ns},a*", "*", "{ns},a", "", "k\\*", "k\\*x*",
+                              "{ns},?*", "a**", "k\\"};
+    const char *strs[] = {"{ns},", "{ns},a", "{ns},abc", "{nt},a", "", "a", "k*", "k*xy",
+                          "kx", "k\\", "{ns}"};
+    GlobPattern glob;
+    char literal[16];
+    size_t i, j;
+
+    for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        compile(&glob, patterns[i], literal);
+        for (j = 0; j < sizeof(strs) / sizeof(strs[0]); j++) {
+            bool expected = match(patterns[i], strs[j]);
+            /* SCAN MATCH * skips matching, so it takes the empty key too */
+            if (glob.kind == GLOB_ANY)
+                expected = true;
+            CHECK_EQUAL(expected, globPatternMatch(&glob, strs[j], strlen(strs[j])));
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "keyslot.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(keyslot)
+{
+};
+
+static int slot(const char *key)
+{
+    return keyHashSlot(key, strlen(key));
+}
+
+static int patternSlot(const char *pattern)
+{
+    GlobPattern glob;
+    char literal[32];
+
+    globCompile(&glob, pattern, strlen(pattern), literal);
+    return globHashSlot(&glob);
+}
+
+TEST(keyslot, crc16_is_the_xmodem_variant)
+{
+    CHECK_EQUAL(0x31c3, crc16("123456789", 9));
+    CHECK_EQUAL(0, crc16("", 0));
+}
+
+TEST(keyslot, key_slots_match_redis_cluster)
+{
+    CHECK_EQUAL(12182, slot("foo"));
+    CHECK_EQUAL(11058, slot("somekey"));
+    CHECK_EQUAL(slot("user1000"), slot("{user1000}.following"));
+    CHECK_EQUAL(slot("user1000"), slot("x{user1000}{y}"));
+    /* No tag, or an empty one: the whole key is hashed */
+    CHECK_EQUAL(crc16("{}ns", 4) & 16383, slot("{}ns"));
+    CHECK_EQUAL(crc16("{ns", 3) & 16383, slot("{ns"));
+}
+
+TEST(keyslot, pattern_with_a_whole_tag_has_its_slot)
+{
+    CHECK_EQUAL(slot("ns"), patternSlot("{ns},*"));
+    CHECK_EQUAL(slot("ns"), patternSlot("{ns},a*"));
+    CHECK_EQUAL(slot("ns"), patternSlot("{ns},?a*"));
+    CHECK_EQUAL(slot("ns"), patternSlot("{ns},[ab]"));
+    CHECK_EQUAL(slot("ns"), patternSlot("\\{ns\\},*"));
+    CHECK_EQUAL(slot("{ns},a"), patternSlot("{ns},a"));
+    CHECK_EQUAL(slot("k"), patternSlot("k"));
+}
+
+TEST(keyslot, pattern_without_a_whole_tag_has_no_slot)
+{
+    CHECK_EQUAL(-1, patternSlot("*"));
+    CHECK_EQUAL(-1, patternSlot("k*"));
+    CHECK_EQUAL(-1, patternSlot("{ns*"));
+    CHECK_EQUAL(-1, patternSlot("{n?},*"));
+    CHECK_EQUAL(-1, patternSlot("{}{ns},*"));
+    CHECK_EQUAL(-1, patternSlot("{ns\\"));
+}
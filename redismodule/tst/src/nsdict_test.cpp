@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "nsdict.h"
+}
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(nsdict)
+{
+    NsDict d;
+
+    void setup()
+    {
+        nsDictInit(&d);
+    }
+
+    void teardown()
+    {
+        nsDictClear(&d);
+    }
+
+    int set(const char *field, const char *value)
+    {
+        return nsDictSet(&d, field, strlen(field), value, strlen(value));
+    }
+
+    std::string get(const char *field)
+    {
+        NsEntry *e = nsDictFind(&d, field, strlen(field));
+        return e ? std::string(nsEntryValue(e), e->valuelen) : std::string("(nil)");
+    }
+
+    bool del(const char *field)
+    {
+        return nsDictDelete(&d, field, strlen(field));
+    }
+};
+
+TEST(nsdict, set_get_and_replace)
+{
+    CHECK_EQUAL("(nil)", get("a"));
+    CHECK_EQUAL(1, set("a", "1"));
+    CHECK_EQUAL(1, set("b", ""));
+    CHECK_EQUAL(0, set("a", "2"));
+    CHECK_EQUAL(0, set("b", "longer"));
+    CHECK_EQUAL("2", get("a"));
+    CHECK_EQUAL("longer", get("b"));
+    CHECK_EQUAL(2U, d.len);
+    CHECK_EQUAL(9U, d.bytes);
+}
+
+TEST(nsdict, fields_are_binary_safe)
+{
+    CHECK_EQUAL(1, nsDictSet(&d, "a\0b", 3, "x", 1));
+    CHECK_EQUAL(1, nsDictSet(&d, "a\0c", 3, "y", 1));
+    CHECK_EQUAL(1, nsDictSet(&d, "", 0, "z", 1));
+    CHECK_EQUAL('y', *nsEntryValue(nsDictFind(&d, "a\0c", 3)));
+    CHECK_EQUAL('z', *nsEntryValue(nsDictFind(&d, "", 0)));
+    CHECK(nsDictFind(&d, "a", 1) == NULL);
+}
+
+TEST(nsdict, grows_and_shrinks_keeping_every_field)
+{
+    char field[16];
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        snprintf(field, sizeof(field), "f%d", i);
+        CHECK_EQUAL(1, set(field, field));
+    }
+    CHECK_EQUAL(1000U, d.len);
+    CHECK(d.len * 4 <= d.size * 3);
+    size_t grown = d.size;
+
+    for (i = 0; i < 1000; i += 2) {
+        snprintf(field, sizeof(field), "f%d", i);
+        CHECK(del(field));
+        CHECK_FALSE(del(field));
+    }
+    for (i = 0; i < 1000; i++) {
+        snprintf(field, sizeof(field), "f%d", i);
+        CHECK_EQUAL(i % 2 ? std::string(field) : std::string("(nil)"), get(field));
+    }
+    for (i = 1; i < 1000; i += 4) {
+        snprintf(field, sizeof(field), "f%d", i);
+        CHECK(del(field));
+    }
+    CHECK_EQUAL(250U, d.len);
+    CHECK(d.size < grown);
+}
+
+TEST(nsdict, next_visits_each_entry_once)
+{
+    size_t pos = 0, n = 0, bytes = 0;
+    NsEntry *e;
+
+    set("a", "1");
+    set("bb", "22");
+    set("ccc", "333");
+    while ((e = nsDictNext(&d, &pos)) != NULL) {
+        CHECK_EQUAL(std::string(nsEntryField(e), e->fieldlen).size(), e->valuelen);
+        bytes += e->fieldlen + e->valuelen;
+        n++;
+    }
+    CHECK_EQUAL(3U, n);
+    CHECK_EQUAL(d.bytes, bytes);
+}
+
+TEST(nsdict, last_delete_frees_the_table)
+{
+    set("a", "1");
+    CHECK(d.size > 0);
+    CHECK(del("a"));
+    CHECK_EQUAL(0U, d.size);
+    CHECK(d.table == NULL);
+    CHECK_EQUAL(0U, nsDictMemUsage(&d));
+    CHECK(nsDictFind(&d, "a", 1) == NULL);
+}
+
+TEST(nsdict, reserve_sizes_for_the_load_factor)
+{
+    CHECK(nsDictReserve(&d, 100));
+    CHECK_EQUAL(256U, d.size);
+    size_t size = d.size;
+    char field[16];
+    for (int i = 0; i < 100; i++) {
+        snprintf(field, sizeof(field), "f%d", i);
+        set(field, "v");
+    }
+    CHECK_EQUAL(size, d.size);
+    CHECK_EQUAL(size * sizeof(NsEntry) + d.bytes, nsDictMemUsage(&d));
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "nsstats.h"
+}
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(nsstats)
+{
+    NsStats s;
+
+    void setup()
+    {
+        nsStatsInit(&s);
+    }
+
+    void teardown()
+    {
+        nsStatsClear(&s);
+    }
+
+    void change(const char *ns, long long oldsize, long long newsize)
+    {
+        CHECK(nsStatsChange(&s, ns, strlen(ns), oldsize, newsize));
+    }
+
+    NsCounters get(const char *ns)
+    {
+        NsCounters c;
+        if (!nsStatsGet(&s, ns, strlen(ns), &c))
+            memset(&c, 0, sizeof(c));
+        return c;
+    }
+
+    std::string name(const NsEntry *e)
+    {
+        return std::string(nsEntryField(e), e->fieldlen);
+    }
+};
+
+TEST(nsstats, key_namespace)
+{
+    const char *ns;
+    size_t nslen;
+
+    CHECK(nsStatsKeyNamespace("{xapp1},cell", 12, &ns, &nslen));
+    CHECK_EQUAL(std::string("xapp1"), std::string(ns, nslen));
+    CHECK(nsStatsKeyNamespace("{a},", 4, &ns, &nslen));
+    CHECK_EQUAL(std::string("a"), std::string(ns, nslen));
+    CHECK_FALSE(nsStatsKeyNamespace("xapp1,cell", 10, &ns, &nslen));
+    CHECK_FALSE(nsStatsKeyNamespace("{},cell", 7, &ns, &nslen));
+    CHECK_FALSE(nsStatsKeyNamespace("{xapp1}cell", 11, &ns, &nslen));
+    CHECK_FALSE(nsStatsKeyNamespace("{xapp1", 6, &ns, &nslen));
+    CHECK_FALSE(nsStatsKeyNamespace("{xapp1}", 7, &ns, &nslen));
+}
+
+TEST(nsstats, buckets)
+{
+    UNSIGNED_LONGS_EQUAL(0, nsStatsBucket(0));
+    UNSIGNED_LONGS_EQUAL(0, nsStatsBucket(63));
+    UNSIGNED_LONGS_EQUAL(1, nsStatsBucket(64));
+    UNSIGNED_LONGS_EQUAL(2, nsStatsBucket(256));
+    UNSIGNED_LONGS_EQUAL(6, nsStatsBucket(256 * 1024 - 1));
+    UNSIGNED_LONGS_EQUAL(7, nsStatsBucket(256 * 1024));
+    UNSIGNED_LONGS_EQUAL(7, nsStatsBucket(1LL << 40));
+}
+
+TEST(nsstats, keys_added_changed_and_removed)
+{
+    change("a", -1, 10);
+    change("a", -1, 100);
+    change("a", 10, 1000);
+
+    NsCounters c = get("a");
+    LONGS_EQUAL(2, c.keys);
+    LONGS_EQUAL(1100, c.bytes);
+    LONGS_EQUAL(0, c.sizes[0]);
+    LONGS_EQUAL(1, c.sizes[1]);
+    LONGS_EQUAL(1, c.sizes[2]);
+
+    change("a", 100, -1);
+    change("a", 1000, -1);
+    CHECK_FALSE(nsStatsGet(&s, "a", 1, &c));
+    UNSIGNED_LONGS_EQUAL(0, s.names.len);
+}
+
+TEST(nsstats, top_namespaces_by_bytes)
+{
+    const NsEntry *top[3];
+    char ns[8];
+
+    for (int i = 0; i < 20; i++) {
+        snprintf(ns, sizeof(ns), "ns%d", i);
+        change(ns, -1, (i * 7) % 20 * 10);
+    }
+
+    UNSIGNED_LONGS_EQUAL(3, nsStatsTop(&s, top, 3));
+    CHECK_EQUAL(std::string("ns17"), name(top[0]));
+    CHECK_EQUAL(std::string("ns14"), name(top[1]));
+    CHECK_EQUAL(std::string("ns11"), name(top[2]));
+
+    const NsEntry *all[30];
+    UNSIGNED_LONGS_EQUAL(20, nsStatsTop(&s, all, 30));
+    CHECK_EQUAL(std::string("ns0"), name(all[19]));
+    UNSIGNED_LONGS_EQUAL(0, nsStatsTop(&s, all, 0));
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "pubframe.h"
+}
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(pubframe)
+{
+};
+
+static std::string packFrame(const std::vector<std::string> &msgs)
+{
+    size_t total = 0;
+    for (const std::string &m : msgs)
+        total += m.size();
+    std::vector<char> buf(pubFrameMaxSize(msgs.size(), total));
+    char *p = pubFrameStart(buf.data(), msgs.size());
+    for (const std::string &m : msgs)
+        p = pubFrameAppend(p, m.data(), m.size());
+    CHECK(p <= buf.data() + buf.size());
+    return std::string(buf.data(), p - buf.data());
+}
+
+TEST(pubframe, format)
+{
+    std::string frame = packFrame({"a", "bc", ""});
+    CHECK_EQUAL(std::string("\x1eMPUB" "3:1:a2:bc0:"), frame);
+}
+
+TEST(pubframe, decodes_what_is_packed)
+{
+    std::vector<std::string> msgs = {"set,key1", std::string("x\0y:", 4), "12345678901"};
+    std::string frame = packFrame(msgs);
+    PubFrameReader reader;
+    const char *msg;
+    size_t len;
+
+    CHECK(pubFrameOpen(&reader, frame.data(), frame.size()));
+    for (const std::string &m : msgs) {
+        CHECK(pubFrameNext(&reader, &msg, &len));
+        CHECK_EQUAL(m, std::string(msg, len));
+    }
+    CHECK_FALSE(pubFrameNext(&reader, &msg, &len));
+}
+
+TEST(pubframe, plain_message_is_not_a_frame)
+{
+    PubFrameReader reader;
+
+    CHECK_FALSE(pubFrameOpen(&reader, "MPUB2:1:a1:b", 12));
+    CHECK_FALSE(pubFrameOpen(&reader, "\x1eMPUB", 5));
+    CHECK_FALSE(pubFrameOpen(&reader, "\x1eMPUBx:", 7));
+}
+
+TEST(pubframe, truncated_frame_stops)
+{
+    std::string frame = packFrame({"abc", "def"});
+    PubFrameReader reader;
+    const char *msg;
+    size_t len;
+
+    CHECK(pubFrameOpen(&reader, frame.data(), frame.size() - 1));
+    CHECK(pubFrameNext(&reader, &msg, &len));
+    CHECK_FALSE(pubFrameNext(&reader, &msg, &len));
+}
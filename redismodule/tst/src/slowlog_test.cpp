@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "slowlog.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+
+#define UT_SLOWLOG_SIZE 3
+
+TEST_GROUP(slowlog)
+{
+    SlowLog log;
+    SlowLogEntry entries[UT_SLOWLOG_SIZE];
+
+    void setup()
+    {
+        slowLogInit(&log, entries, UT_SLOWLOG_SIZE);
+    }
+};
+
+TEST(slowlog, empty_log_has_no_entries)
+{
+    CHECK(slowLogGet(&log, 0) == NULL);
+}
+
+TEST(slowlog, newest_entry_first)
+{
+    slowLogAdd(&log, "a*", 2)->scanned = 1;
+    slowLogAdd(&log, "b*", 2)->scanned = 2;
+
+    const SlowLogEntry *entry = slowLogGet(&log, 0);
+    CHECK_EQUAL(1, entry->id);
+    CHECK_EQUAL(2, entry->scanned);
+    CHECK_EQUAL(0, memcmp("b*", entry->pattern, entry->patternlen));
+    CHECK_EQUAL(0, slowLogGet(&log, 1)->id);
+    CHECK(slowLogGet(&log, 2) == NULL);
+}
+
+TEST(slowlog, full_ring_drops_oldest_entry)
+{
+    int i;
+    for (i = 0; i < UT_SLOWLOG_SIZE + 2; i++)
+        slowLogAdd(&log, "*", 1);
+
+    CHECK_EQUAL(UT_SLOWLOG_SIZE, (int)log.len);
+    CHECK_EQUAL(UT_SLOWLOG_SIZE + 1, slowLogGet(&log, 0)->id);
+    CHECK_EQUAL(2, slowLogGet(&log, UT_SLOWLOG_SIZE - 1)->id);
+    CHECK(slowLogGet(&log, UT_SLOWLOG_SIZE) == NULL);
+}
+
+TEST(slowlog, long_pattern_is_cut)
+{
+    char pattern[SLOWLOG_PATTERN_MAX + 10];
+    memset(pattern, 'k', sizeof(pattern));
+
+    SlowLogEntry *entry = slowLogAdd(&log, pattern, sizeof(pattern));
+    CHECK_EQUAL(SLOWLOG_PATTERN_MAX, (int)entry->patternlen);
+}
+
+TEST(slowlog, reset_keeps_counting_ids)
+{
+    slowLogAdd(&log, "*", 1);
+    slowLogReset(&log);
+    CHECK(slowLogGet(&log, 0) == NULL);
+    CHECK_EQUAL(1, slowLogAdd(&log, "*", 1)->id);
+    CHECK_EQUAL(1, (int)log.len);
+}
+
+TEST(slowlog, ring_without_room_takes_no_entries)
+{
+    slowLogInit(&log, NULL, 0);
+    CHECK(slowLogAdd(&log, "*", 1) == NULL);
+}
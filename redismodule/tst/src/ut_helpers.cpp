@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "redismodule.h"
 #include "ut_helpers.hpp"
@@ -46,3 +47,29 @@ void returnNKeysFromScanSome(long keys)
     }
 }
 
+
+void stringPtrLenReturns(const char *str)
+{
+    /* Several expectations can be pending, each needs its own length */
+    static size_t lens[16];
+    static size_t next;
+    size_t *len = &lens[next++ % 16];
+
+    *len = strlen(str);
+    mock().expectOneCall("RedisModule_StringPtrLen")
+          .withOutputParameterReturning("len", len, sizeof(*len))
+          .andReturnValue((void *)str);
+}
+
+void stringValuesRead(long keys)
+{
+    static size_t len = strlen("value");
+
+    for (long i = 0 ; i < keys ; i++) {
+        mock().expectOneCall("RedisModule_KeyType")
+              .andReturnValue(REDISMODULE_KEYTYPE_STRING);
+        mock().expectOneCall("RedisModule_StringDMA")
+              .withOutputParameterReturning("len", &len, sizeof(len))
+              .andReturnValue((void *)"value");
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "valuecmp.h"
+}
+
+#include <string.h>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(valuecmp)
+{
+};
+
+TEST(valuecmp, equal_values)
+{
+    CHECK(valueEqual("11111", 5, "11111", 5));
+    CHECK(valueEqual("", 0, "", 0));
+}
+
+TEST(valuecmp, different_length)
+{
+    CHECK_FALSE(valueEqual("11111", 5, "111111", 6));
+    CHECK_FALSE(valueEqual("11111", 5, "1111", 4));
+}
+
+TEST(valuecmp, embedded_nul_is_compared)
+{
+    const char a[] = {'a', '\0', 'b'};
+    const char b[] = {'a', '\0', 'c'};
+    CHECK_FALSE(valueEqual(a, sizeof(a), b, sizeof(b)));
+    CHECK(valueEqual(a, sizeof(a), a, sizeof(a)));
+}
+
+TEST(valuecmp, large_values)
+{
+    std::vector<char> a(1024 * 1024 + 3, 'x');
+    std::vector<char> b(a);
+
+    CHECK(valueEqual(a.data(), a.size(), b.data(), b.size()));
+    b[b.size() - 1] = 'y';
+    CHECK_FALSE(valueEqual(a.data(), a.size(), b.data(), b.size()));
+    b[b.size() - 1] = 'x';
+    b[100] = '\0';
+    CHECK_FALSE(valueEqual(a.data(), a.size(), b.data(), b.size()));
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+extern "C" {
+#include "valuecodec.h"
+}
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(valuecodec)
+{
+    std::string roundTrip(const std::string &value, size_t minlen, bool *compressed)
+    {
+        std::vector<char> enc(valueEncodeBound(value.size()));
+        size_t n = valueEncode(value.data(), value.size(), minlen, enc.data(), compressed);
+        size_t rawlen;
+        const char *raw = valueRaw(enc.data(), n, &rawlen);
+        encoded.assign(enc.data(), n);
+        if (raw)
+            return std::string(raw, rawlen);
+
+        std::vector<char> dec(valueDecodedLen(enc.data(), n) + 1);
+        CHECK(valueDecode(enc.data(), n, dec.data()));
+        return std::string(dec.data(), dec.size() - 1);
+    }
+
+    std::string encoded;
+};
+
+static std::string jsonConfig(int entries)
+{
+    std::string s = "{\"cells\":[";
+    char buf[96];
+    for (int i = 0; i < entries; i++) {
+        snprintf(buf, sizeof(buf), "{\"id\":%d,\"pci\":%d,\"band\":\"n78\",\"state\":\"active\"},",
+                 i, (i * 7) % 504);
+        s += buf;
+    }
+    return s + "]}";
+}
+
+TEST(valuecodec, compresses_repetitive_values)
+{
+    bool compressed;
+    std::string value = jsonConfig(200);
+
+    CHECK_EQUAL(value, roundTrip(value, 64, &compressed));
+    CHECK(compressed);
+    CHECK(encoded.size() * 4 < value.size());
+}
+
+TEST(valuecodec, short_values_are_stored_with_a_raw_header)
+{
+    bool compressed;
+    std::string value = jsonConfig(1);
+
+    CHECK_EQUAL(value, roundTrip(value, value.size() + 1, &compressed));
+    CHECK_FALSE(compressed);
+    UNSIGNED_LONGS_EQUAL(value.size() + VALUECODEC_HEADER_LEN, encoded.size());
+    CHECK_EQUAL(value, encoded.substr(VALUECODEC_HEADER_LEN));
+}
+
+TEST(valuecodec, incompressible_values_are_stored_with_a_raw_header)
+{
+    bool compressed;
+    std::string value;
+    unsigned int x = 12345;
+
+    for (int i = 0; i < 1000; i++) {
+        x = x * 1103515245 + 12345;
+        value += (char)(x >> 16);
+    }
+    CHECK_EQUAL(value, roundTrip(value, 0, &compressed));
+    CHECK_FALSE(compressed);
+    UNSIGNED_LONGS_EQUAL(value.size() + VALUECODEC_HEADER_LEN, encoded.size());
+}
+
+TEST(valuecodec, values_starting_with_the_magic_round_trip)
+{
+    bool compressed;
+    std::string value("\xc5\x5a\x01\x10\x00\x00\x00zz", 9);
+
+    CHECK_EQUAL(value, roundTrip(value, 100, &compressed));
+    CHECK_FALSE(compressed);
+    UNSIGNED_LONGS_EQUAL(value.size() + VALUECODEC_HEADER_LEN, encoded.size());
+}
+
+TEST(valuecodec, plain_values_starting_with_the_magic_read_as_they_are)
+{
+    size_t rawlen;
+    std::string raw_like("\xc5\x5a\x00\x00\x00\x00\x00payload", 14);
+    /* A well formed LZF header and stream, without the check */
+    std::string lzf_like("\xc5\x5a\x01\x00\x00\x00\x00\x03\x00\x00\x00\x02" "abc", 15);
+
+    const char *raw = valueRaw(raw_like.data(), raw_like.size(), &rawlen);
+    CHECK_EQUAL(raw_like, std::string(raw, rawlen));
+    raw = valueRaw(lzf_like.data(), lzf_like.size(), &rawlen);
+    CHECK(raw != NULL);
+    CHECK_EQUAL(lzf_like, std::string(raw, rawlen));
+}
+
+TEST(valuecodec, headers_with_a_wrong_check_are_ignored)
+{
+    bool compressed;
+    size_t rawlen;
+    std::string value = jsonConfig(50);
+    std::vector<char> enc(valueEncodeBound(value.size()));
+    size_t n = valueEncode(value.data(), value.size(), 0, enc.data(), &compressed);
+
+    CHECK(compressed);
+    CHECK(valueRaw(enc.data(), n, &rawlen) == NULL);
+    enc[3] ^= 1;
+    CHECK(valueRaw(enc.data(), n, &rawlen) == enc.data());
+    UNSIGNED_LONGS_EQUAL(n, rawlen);
+}
+
+TEST(valuecodec, values_without_header_read_as_they_are)
+{
+    size_t rawlen;
+    const char *raw = valueRaw("plain", 5, &rawlen);
+
+    CHECK_EQUAL(std::string("plain"), std::string(raw, rawlen));
+    raw = valueRaw("", 0, &rawlen);
+    CHECK(raw != NULL);
+    UNSIGNED_LONGS_EQUAL(0, rawlen);
+}
+
+TEST(valuecodec, long_matches_and_far_references)
+{
+    bool compressed;
+    std::string value(10000, 'a');
+
+    CHECK_EQUAL(value, roundTrip(value, 0, &compressed));
+    CHECK(compressed);
+
+    std::string block;
+    unsigned int x = 1;
+    for (int i = 0; i < 8000; i++) {
+        x = x * 1103515245 + 12345;
+        block += (char)('a' + (x >> 16) % 26);
+    }
+    value = block + block + block;
+    CHECK_EQUAL(value, roundTrip(value, 0, &compressed));
+    CHECK(compressed);
+}
+
+TEST(valuecodec, corrupt_streams_are_rejected)
+{
+    std::string value = jsonConfig(20);
+    std::vector<char> out(value.size());
+    std::vector<char> enc(value.size());
+    size_t n = lzfCompress(value.data(), value.size(), enc.data(), enc.size());
+
+    CHECK(n > 0);
+    CHECK(lzfDecompress(enc.data(), n, out.data(), out.size()));
+    CHECK_FALSE(lzfDecompress(enc.data(), n - 1, out.data(), out.size()));
+    CHECK_FALSE(lzfDecompress(enc.data(), n, out.data(), out.size() - 1));
+    /* A reference before the start of the output */
+    const char bad[] = {0x00, 'a', 0x20, 0x05};
+    CHECK_FALSE(lzfDecompress(bad, sizeof(bad), out.data(), 4));
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2018-2020 Nokia.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * This source code is part of the near-RT RIC (RAN Intelligent Controller)
+ * platform project (RICP).
+ */
+
+
+extern "C" {
+#include "xxhash64.h"
+}
+
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+
+TEST_GROUP(xxhash64)
+{
+};
+
+TEST(xxhash64, empty_input)
+{
+    CHECK(xxhash64("", 0, 0) == 0xef46db3751d8e999ULL);
+}
+
+TEST(xxhash64, short_input)
+{
+    CHECK(xxhash64("abc", 3, 0) == 0x44bc2cf5ad770999ULL);
+    CHECK(xxhash64("11111", 5, 0) == 0x3baf032d46de01d6ULL);
+}
+
+TEST(xxhash64, long_input)
+{
+    unsigned char buf[771];
+    for (int i = 0; i < 768; i++)
+        buf[i] = (unsigned char)i;
+    memcpy(buf + 768, "xyz", 3);
+    CHECK(xxhash64(buf, sizeof(buf), 0) == 0xe921a1b45bd779f8ULL);
+}
+
+TEST(xxhash64, hex_round_trip)
+{
+    char hex[XXHASH64_HEX_LEN + 1];
+    uint64_t hash = 0;
+
+    xxhash64ToHex(0x44bc2cf5ad770999ULL, hex);
+    STRCMP_EQUAL("44bc2cf5ad770999", hex);
+    CHECK(xxhash64FromHex("44BC2CF5AD770999", XXHASH64_HEX_LEN, &hash));
+    CHECK(hash == 0x44bc2cf5ad770999ULL);
+}
+
+TEST(xxhash64, hex_invalid)
+{
+    uint64_t hash = 0;
+
+    CHECK_FALSE(xxhash64FromHex("44bc2cf5ad77099", 15, &hash));
+    CHECK_FALSE(xxhash64FromHex("44bc2cf5ad77099g", XXHASH64_HEX_LEN, &hash));
+    CHECK_FALSE(xxhash64FromHex(NULL, XXHASH64_HEX_LEN, &hash));
+}